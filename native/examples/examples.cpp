@@ -167,6 +167,8 @@ void example_bfv_performance();
 
 void example_ckks_performance();
 
+void example_multiparty_performance();
+
 int main()
 {
 #ifdef SEAL_VERSION
@@ -184,6 +186,7 @@ int main()
         cout << " 7. CKKS Basics II" << endl;
         cout << " 8. CKKS Basics III" << endl;
         cout << " 9. CKKS Performance Test" << endl;
+        cout << "10. Multiparty Performance Test" << endl;
         cout << " 0. Exit" << endl;
 
         /*
@@ -244,6 +247,10 @@ int main()
             break;
         }
 
+        case 10:
+            example_multiparty_performance();
+            break;
+
         case 0:
             return 0;
 
@@ -2122,7 +2129,21 @@ void example_bfv_performance()
 
         Encryptor encryptor(context, public_key);
         Decryptor decryptor(context, secret_key);
+
+        /*
+        A PrecomputedEncryptor computes encryptions of zero in a background
+        thread, so that the online encryption is only a plaintext addition.
+        */
+        PrecomputedEncryptor precomputed_encryptor(context, public_key, 1);
         Evaluator evaluator(context);
+
+        /*
+        A second Evaluator multiplies with the algorithm of Halevi, Polyakov, and
+        Shoup instead of the default one of Bajard, Eynard, Hasan, and Zucca, so
+        that we can compare the two.
+        */
+        Evaluator evaluator_hps(context);
+        evaluator_hps.set_bfv_multiply_type(bfv_multiply_type::HPS);
         BatchEncoder batch_encoder(context);
         IntegerEncoder encoder(context);
 
@@ -2132,11 +2153,14 @@ void example_bfv_performance()
         chrono::microseconds time_batch_sum(0);
         chrono::microseconds time_unbatch_sum(0);
         chrono::microseconds time_encrypt_sum(0);
+        chrono::microseconds time_encrypt_online_sum(0);
         chrono::microseconds time_decrypt_sum(0);
         chrono::microseconds time_add_sum(0);
         chrono::microseconds time_multiply_sum(0);
         chrono::microseconds time_multiply_plain_sum(0);
         chrono::microseconds time_square_sum(0);
+        chrono::microseconds time_multiply_hps_sum(0);
+        chrono::microseconds time_square_hps_sum(0);
         chrono::microseconds time_relinearize_sum(0);
         chrono::microseconds time_rotate_rows_one_step_sum(0);
         chrono::microseconds time_rotate_rows_random_sum(0);
@@ -2203,6 +2227,21 @@ void example_bfv_performance()
             time_encrypt_sum += chrono::duration_cast<
                 chrono::microseconds>(time_end - time_start);
 
+            /*
+            [Online Encryption]
+            We encrypt the same plaintext using a precomputed encryption of zero.
+            In an interactive application the queue is refilled while the client
+            is idle; here we simply wait for the background thread to refill it
+            so that it does not compete with the timed operations.
+            */
+            precomputed_encryptor.wait_until_full();
+            Ciphertext encrypted_online(context);
+            time_start = chrono::high_resolution_clock::now();
+            precomputed_encryptor.encrypt(plain, encrypted_online);
+            time_end = chrono::high_resolution_clock::now();
+            time_encrypt_online_sum += chrono::duration_cast<
+                chrono::microseconds>(time_end - time_start);
+
             /*
             [Decryption]
             We decrypt what we just encrypted.
@@ -2235,6 +2274,20 @@ void example_bfv_performance()
             time_add_sum += chrono::duration_cast<
                 chrono::microseconds>(time_end - time_start) / 3;
 
+            /*
+            [Multiply (HPS)]
+            First we multiply the two ciphertexts of size 2 with HPS. The product
+            is written to a copy of encrypted1, so that the multiplication below
+            starts from the same ciphertexts.
+            */
+            Ciphertext product_hps = encrypted1;
+            product_hps.reserve(3);
+            time_start = chrono::high_resolution_clock::now();
+            evaluator_hps.multiply_inplace(product_hps, encrypted2);
+            time_end = chrono::high_resolution_clock::now();
+            time_multiply_hps_sum += chrono::duration_cast<
+                chrono::microseconds>(time_end - time_start);
+
             /*
             [Multiply]
             We multiply two ciphertexts of size 2. Since the size of the result
@@ -2260,6 +2313,18 @@ void example_bfv_performance()
             time_multiply_plain_sum += chrono::duration_cast<
                 chrono::microseconds>(time_end - time_start);
 
+            /*
+            [Square (HPS)]
+            As for multiply, we first square a copy of encrypted2 with HPS.
+            */
+            Ciphertext square_hps = encrypted2;
+            square_hps.reserve(3);
+            time_start = chrono::high_resolution_clock::now();
+            evaluator_hps.square_inplace(square_hps);
+            time_end = chrono::high_resolution_clock::now();
+            time_square_hps_sum += chrono::duration_cast<
+                chrono::microseconds>(time_end - time_start);
+
             /*
             [Square]
             We continue to use the size 2 ciphertext encrypted2. Now we square 
@@ -2331,11 +2396,14 @@ void example_bfv_performance()
         auto avg_batch = time_batch_sum.count() / count;
         auto avg_unbatch = time_unbatch_sum.count() / count;
         auto avg_encrypt = time_encrypt_sum.count() / count;
+        auto avg_encrypt_online = time_encrypt_online_sum.count() / count;
         auto avg_decrypt = time_decrypt_sum.count() / count;
         auto avg_add = time_add_sum.count() / count;
         auto avg_multiply = time_multiply_sum.count() / count;
         auto avg_multiply_plain = time_multiply_plain_sum.count() / count;
         auto avg_square = time_square_sum.count() / count;
+        auto avg_multiply_hps = time_multiply_hps_sum.count() / count;
+        auto avg_square_hps = time_square_hps_sum.count() / count;
         auto avg_relinearize = time_relinearize_sum.count() / count;
         auto avg_rotate_rows_one_step = time_rotate_rows_one_step_sum.count() / count;
         auto avg_rotate_rows_random = time_rotate_rows_random_sum.count() / count;
@@ -2344,11 +2412,14 @@ void example_bfv_performance()
         cout << "Average batch: " << avg_batch << " microseconds" << endl;
         cout << "Average unbatch: " << avg_unbatch << " microseconds" << endl;
         cout << "Average encrypt: " << avg_encrypt << " microseconds" << endl;
+        cout << "Average online encrypt: " << avg_encrypt_online << " microseconds" << endl;
         cout << "Average decrypt: " << avg_decrypt << " microseconds" << endl;
         cout << "Average add: " << avg_add << " microseconds" << endl;
         cout << "Average multiply: " << avg_multiply << " microseconds" << endl;
         cout << "Average multiply plain: " << avg_multiply_plain << " microseconds" << endl;
         cout << "Average square: " << avg_square << " microseconds" << endl;
+        cout << "Average multiply (HPS): " << avg_multiply_hps << " microseconds" << endl;
+        cout << "Average square (HPS): " << avg_square_hps << " microseconds" << endl;
         cout << "Average relinearize: " << avg_relinearize << " microseconds" << endl;
         cout << "Average rotate rows one step: " << avg_rotate_rows_one_step << " microseconds" << endl;
         cout << "Average rotate rows random: " << avg_rotate_rows_random << " microseconds" << endl;
@@ -2662,3 +2733,128 @@ void example_ckks_performance()
     // parms.set_coeff_modulus(DefaultParams::coeff_modulus_128(32768));
     // performance_test(SEALContext::Create(parms));
 }
+
+void example_multiparty_performance()
+{
+    print_example_banner("Example: Multiparty Performance Test");
+
+    /*
+    In this example we time the distributed operations with several parties
+    holding additive shares of a joint secret key: joint key generation, joint
+    Galois key generation, and batched threshold decryption of a large number
+    of ciphertexts.
+    */
+    auto performance_test = [](auto context, size_t party_count,
+        size_t ciphertext_count)
+    {
+        chrono::high_resolution_clock::time_point time_start, time_end;
+        chrono::microseconds time_diff;
+
+        print_parameters(context);
+        cout << "Parties: " << party_count << ", ciphertexts: "
+            << ciphertext_count << ", threads: "
+            << thread::hardware_concurrency() << endl;
+
+        /*
+        Every party generates its keys from a common KeyGenCRS.
+        */
+        cout << "Generating key shares: ";
+        time_start = chrono::high_resolution_clock::now();
+        vector<unique_ptr<KeyGenerator>> keygens;
+        keygens.emplace_back(new KeyGenerator(context));
+        for (size_t k = 1; k < party_count; k++)
+        {
+            keygens.emplace_back(new KeyGenerator(context, keygens[0]->keygen_crs()));
+        }
+        time_end = chrono::high_resolution_clock::now();
+        time_diff = chrono::duration_cast<chrono::microseconds>(time_end - time_start);
+        cout << "Done [" << time_diff.count() << " microseconds]" << endl;
+
+        /*
+        Every party generates its Galois key shares, using all hardware threads.
+        The aggregator adds them up one at a time as they arrive.
+        */
+        ShareAggregator aggregator(context);
+        int dbc = DefaultParams::dbc_max();
+        cout << "Generating Galois key shares (dbc = " << dbc << "): ";
+        time_start = chrono::high_resolution_clock::now();
+        auto galois_keys = keygens[0]->galois_keys_share(dbc);
+        for (size_t k = 1; k < party_count; k++)
+        {
+            aggregator.aggregate_inplace(galois_keys, keygens[k]->galois_keys_share(dbc));
+        }
+        time_end = chrono::high_resolution_clock::now();
+        time_diff = chrono::duration_cast<chrono::microseconds>(time_end - time_start);
+        cout << "Done [" << time_diff.count() << " microseconds]" << endl;
+
+        vector<PublicKey> public_keys;
+        for (auto &keygen : keygens)
+        {
+            public_keys.emplace_back(keygen->public_key());
+        }
+        Encryptor encryptor(context, aggregator.public_key(public_keys));
+        vector<unique_ptr<Decryptor>> decryptors;
+        for (auto &keygen : keygens)
+        {
+            decryptors.emplace_back(new Decryptor(context, keygen->secret_key()));
+        }
+
+        /*
+        Encrypt the batch under the joint public key.
+        */
+        vector<Ciphertext> encrypted(ciphertext_count);
+        Plaintext plain("1x^3 + 2x^2 + 3");
+        for (auto &ciphertext : encrypted)
+        {
+            encryptor.encrypt(plain, ciphertext);
+        }
+
+        /*
+        Each party computes its decryption shares for the whole batch. The
+        shares use 40 bits of smudging noise.
+        */
+        vector<vector<Plaintext>> shares(party_count);
+        time_start = chrono::high_resolution_clock::now();
+        for (size_t k = 0; k < party_count; k++)
+        {
+            decryptors[k]->partial_decrypt(encrypted, shares[k], 40);
+        }
+        time_end = chrono::high_resolution_clock::now();
+        time_diff = chrono::duration_cast<chrono::microseconds>(time_end - time_start);
+        auto avg_partial_decrypt = time_diff.count() / (party_count * ciphertext_count);
+
+        /*
+        Combine the shares.
+        */
+        vector<Plaintext> decrypted;
+        time_start = chrono::high_resolution_clock::now();
+        aggregator.decrypt(encrypted, shares, decrypted);
+        time_end = chrono::high_resolution_clock::now();
+        time_diff = chrono::duration_cast<chrono::microseconds>(time_end - time_start);
+        auto avg_combine = time_diff.count() / ciphertext_count;
+
+        for (auto &result : decrypted)
+        {
+            if (result != plain)
+            {
+                throw runtime_error("threshold decryption failed");
+            }
+        }
+
+        cout << "Average partial decrypt: " << avg_partial_decrypt
+            << " microseconds" << endl;
+        cout << "Average combine shares: " << avg_combine << " microseconds" << endl;
+        cout.flush();
+    };
+
+    EncryptionParameters parms(scheme_type::BFV);
+    parms.set_poly_modulus_degree(4096);
+    parms.set_coeff_modulus(DefaultParams::coeff_modulus_128(4096));
+    parms.set_plain_modulus(786433);
+    performance_test(SEALContext::Create(parms), 3, 1000);
+
+    cout << endl;
+    parms.set_poly_modulus_degree(8192);
+    parms.set_coeff_modulus(DefaultParams::coeff_modulus_128(8192));
+    performance_test(SEALContext::Create(parms), 3, 1000);
+}
@@ -5,14 +5,58 @@
 #include <cstdlib>
 #include <random>
 #include <limits>
+#include <algorithm>
 #include "seal/batchencoder.h"
 #include "seal/util/polycore.h"
+#include "seal/util/parallel.h"
 
 using namespace std;
 using namespace seal::util;
 
 namespace seal
 {
+    namespace
+    {
+        inline bool is_valid_slot_value(uint64_t value, uint64_t modulus)
+        {
+            return value < modulus;
+        }
+
+        inline bool is_valid_slot_value(int64_t value, uint64_t modulus)
+        {
+            return !unsigned_gt(llabs(value), modulus >> 1);
+        }
+
+        inline uint64_t slot_value_to_uint(uint64_t value, uint64_t)
+        {
+            return value;
+        }
+
+        inline uint64_t slot_value_to_uint(int64_t value, uint64_t modulus)
+        {
+            return (value < 0) ? (modulus + static_cast<uint64_t>(value)) :
+                static_cast<uint64_t>(value);
+        }
+
+        template<typename T>
+        inline T slot_value_from_uint(uint64_t value, uint64_t, uint64_t);
+
+        template<>
+        inline uint64_t slot_value_from_uint(uint64_t value, uint64_t, uint64_t)
+        {
+            return value;
+        }
+
+        template<>
+        inline int64_t slot_value_from_uint(uint64_t value, uint64_t modulus,
+            uint64_t plain_modulus_div_two)
+        {
+            return (value > plain_modulus_div_two) ?
+                (static_cast<int64_t>(value) - static_cast<int64_t>(modulus)) :
+                static_cast<int64_t>(value);
+        }
+    }
+
     BatchEncoder::BatchEncoder(std::shared_ptr<SEALContext> context) : 
         context_(std::move(context))
     {
@@ -91,186 +135,121 @@ namespace seal
             pos *= gen;
             pos &= (m - 1);
         }
+
     }
 
-    void BatchEncoder::encode(const vector<uint64_t> &values_matrix, 
-        Plaintext &destination)
+    template<typename T>
+    void BatchEncoder::verify_encode(const T *values, size_t values_size) const
     {
-        auto &context_data = *context_->context_data();
-
-        // Validate input parameters
-        size_t values_matrix_size = values_matrix.size();
-        if (values_matrix_size > slots_)
+        if (values_size > slots_)
         {
             throw logic_error("values_matrix size is too large");
         }
 #ifdef SEAL_DEBUG
-        uint64_t modulus = context_data.parms().plain_modulus().value();
-        for (auto v : values_matrix)
+        uint64_t modulus = context_->context_data()->parms().plain_modulus().value();
+        for (size_t i = 0; i < values_size; i++)
         {
             // Validate the i-th input
-            if (v >= modulus)
+            if (!is_valid_slot_value(values[i], modulus))
             {
                 throw invalid_argument("input value is larger than plain_modulus");
             }
         }
+#else
+        (void)values;
 #endif
-        // Set destination to full size
-        destination.resize(slots_);
-        destination.parms_id() = parms_id_zero;
-
-        // First write the values to destination coefficients. 
-        // Read in top row, then bottom row.
-        for (size_t i = 0; i < values_matrix_size; i++)
-        {
-            *(destination.data() + matrix_reps_index_map_[i]) = values_matrix[i];
-        }
-        for (size_t i = values_matrix_size; i < slots_; i++)
-        {
-            *(destination.data() + matrix_reps_index_map_[i]) = 0;
-        }
-
-        // Transform destination using inverse of negacyclic NTT
-        // Note: We already performed bit-reversal when reading in the matrix
-        inverse_ntt_negacyclic_harvey(destination.data(), *context_data.plain_ntt_tables());
     }
 
-    void BatchEncoder::encode(const vector<int64_t> &values_matrix, 
-        Plaintext &destination)
+    template<typename T>
+    void BatchEncoder::encode_internal(const T *values, size_t values_size,
+        Plaintext &destination) const
     {
         auto &context_data = *context_->context_data();
         uint64_t modulus = context_data.parms().plain_modulus().value();
 
-        // Validate input parameters
-        size_t values_matrix_size = values_matrix.size();
-        if (values_matrix_size > slots_)
-        {
-            throw logic_error("values_matrix size is too large");
-        }
-#ifdef SEAL_DEBUG
-        uint64_t plain_modulus_div_two = modulus >> 1;
-        for (auto v : values_matrix)
-        {
-            // Validate the i-th input
-            if (unsigned_gt(llabs(v), plain_modulus_div_two))
-            {
-                throw invalid_argument("input value is larger than plain_modulus");
-            }
-        }
-#endif
         // Set destination to full size
         destination.resize(slots_);
         destination.parms_id() = parms_id_zero;
 
-        // First write the values to destination coefficients.  
+        // First write the values to destination coefficients. 
         // Read in top row, then bottom row.
-        for (size_t i = 0; i < values_matrix_size; i++)
+        uint64_t *poly = destination.data();
+        for (size_t i = 0; i < values_size; i++)
         {
-            *(destination.data() + matrix_reps_index_map_[i]) = 
-                (values_matrix[i] < 0) ? (modulus + static_cast<uint64_t>(values_matrix[i])) : 
-                    static_cast<uint64_t>(values_matrix[i]);
+            poly[matrix_reps_index_map_[i]] = slot_value_to_uint(values[i], modulus);
         }
-        for (size_t i = values_matrix_size; i < slots_; i++)
+        for (size_t i = values_size; i < slots_; i++)
         {
-            *(destination.data() + matrix_reps_index_map_[i]) = 0;
+            poly[matrix_reps_index_map_[i]] = 0;
         }
 
         // Transform destination using inverse of negacyclic NTT
         // Note: We already performed bit-reversal when reading in the matrix
-        inverse_ntt_negacyclic_harvey(destination.data(), *context_data.plain_ntt_tables());
+        inverse_ntt_negacyclic_harvey(poly, *context_data.plain_ntt_tables());
+    }
+
+    void BatchEncoder::encode(const vector<uint64_t> &values_matrix, 
+        Plaintext &destination)
+    {
+        verify_encode(values_matrix.data(), values_matrix.size());
+        encode_internal(values_matrix.data(), values_matrix.size(), destination);
+    }
+
+    void BatchEncoder::encode(const vector<int64_t> &values_matrix, 
+        Plaintext &destination)
+    {
+        verify_encode(values_matrix.data(), values_matrix.size());
+        encode_internal(values_matrix.data(), values_matrix.size(), destination);
     }
 #ifdef SEAL_USE_MSGSL_SPAN
     void BatchEncoder::encode(gsl::span<const uint64_t> values_matrix, 
         Plaintext &destination)
     {
-        auto &context_data = *context_->context_data();
-
-        // Validate input parameters
         size_t values_matrix_size = static_cast<size_t>(values_matrix.size());
-        if (values_matrix_size > slots_)
-        {
-            throw logic_error("values_matrix size is too large");
-        }
-#ifdef SEAL_DEBUG
-        uint64_t modulus = context_data.parms().plain_modulus().value();
-        for (auto v : values_matrix)
-        {
-            // Validate the i-th input
-            if (v >= modulus)
-            {
-                throw invalid_argument("input value is larger than plain_modulus");
-            }
-        }
-#endif
-        // Set destination to full size
-        destination.resize(slots_);
-        destination.parms_id() = parms_id_zero;
-
-        // First write the values to destination coefficients. Read 
-        // in top row, then bottom row.
-        using index_type = decltype(values_matrix)::index_type;
-        for (size_t i = 0; i < values_matrix_size; i++)
-        {
-            *(destination.data() + matrix_reps_index_map_[i]) = 
-                values_matrix[static_cast<index_type>(i)];
-        }
-        for (size_t i = values_matrix_size; i < slots_; i++)
-        {
-            *(destination.data() + matrix_reps_index_map_[i]) = 0;
-        }
-
-        // Transform destination using inverse of negacyclic NTT
-        // Note: We already performed bit-reversal when reading in the matrix
-        inverse_ntt_negacyclic_harvey(destination.data(), *context_data.plain_ntt_tables());
+        verify_encode(values_matrix.data(), values_matrix_size);
+        encode_internal(values_matrix.data(), values_matrix_size, destination);
     }
 
     void BatchEncoder::encode(gsl::span<const int64_t> values_matrix, 
         Plaintext &destination)
     {
-        auto &context_data = *context_->context_data();
-        uint64_t modulus = context_data.parms().plain_modulus().value();
-
-        // Validate input parameters
         size_t values_matrix_size = static_cast<size_t>(values_matrix.size());
-        if (values_matrix_size > slots_)
-        {
-            throw logic_error("values_matrix size is too large");
-        }
-#ifdef SEAL_DEBUG
-        uint64_t plain_modulus_div_two = modulus >> 1;
-        for (auto v : values_matrix)
-        {
-            // Validate the i-th input
-            if (unsigned_gt(llabs(v), plain_modulus_div_two))
-            {
-                throw invalid_argument("input value is larger than plain_modulus");
-            }
-        }
+        verify_encode(values_matrix.data(), values_matrix_size);
+        encode_internal(values_matrix.data(), values_matrix_size, destination);
+    }
 #endif
-        // Set destination to full size
-        destination.resize(slots_);
-        destination.parms_id() = parms_id_zero;
-
-        // First write the values to destination coefficients. Read 
-        // in top row, then bottom row.
-        using index_type = decltype(values_matrix)::index_type;
-        for (size_t i = 0; i < values_matrix_size; i++)
-        {
-            *(destination.data() + matrix_reps_index_map_[i]) = 
-                (values_matrix[static_cast<index_type>(i)] < 0) ? 
-                (modulus + static_cast<uint64_t>(values_matrix[static_cast<index_type>(i)])) : 
-                static_cast<uint64_t>(values_matrix[static_cast<index_type>(i)]);
-        }
-        for (size_t i = values_matrix_size; i < slots_; i++)
+    template<typename T>
+    void BatchEncoder::encode_batch(const vector<vector<T>> &values_matrices,
+        vector<Plaintext> &destination, size_t thread_count)
+    {
+        for (auto &values_matrix : values_matrices)
         {
-            *(destination.data() + matrix_reps_index_map_[i]) = 0;
+            verify_encode(values_matrix.data(), values_matrix.size());
         }
 
-        // Transform destination using inverse of negacyclic NTT
-        // Note: We already performed bit-reversal when reading in the matrix
-        inverse_ntt_negacyclic_harvey(destination.data(), *context_data.plain_ntt_tables());
+        destination.resize(values_matrices.size());
+        parallel_for(values_matrices.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    encode_internal(values_matrices[i].data(),
+                        values_matrices[i].size(), destination[i]);
+                }
+            });
     }
-#endif
+
+    void BatchEncoder::encode(const vector<vector<uint64_t>> &values_matrices,
+        vector<Plaintext> &destination, size_t thread_count)
+    {
+        encode_batch(values_matrices, destination, thread_count);
+    }
+
+    void BatchEncoder::encode(const vector<vector<int64_t>> &values_matrices,
+        vector<Plaintext> &destination, size_t thread_count)
+    {
+        encode_batch(values_matrices, destination, thread_count);
+    }
+
     void BatchEncoder::encode(Plaintext &plain, MemoryPoolHandle pool)
     {
         if (plain.is_ntt_form())
@@ -302,28 +281,12 @@ namespace seal
         auto temp(allocate_uint(input_plain_coeff_count, pool));
         set_uint_uint(plain.data(), input_plain_coeff_count, temp.get());
 
-        // Set plain to full slot count size.
-        plain.resize(slots_);
-        plain.parms_id() = parms_id_zero;
-
-        // First write the values to destination coefficients. Read 
-        // in top row, then bottom row.
-        for (size_t i = 0; i < input_plain_coeff_count; i++)
-        {
-            *(plain.data() + matrix_reps_index_map_[i]) = temp[i];
-        }
-        for (size_t i = input_plain_coeff_count; i < slots_; i++)
-        {
-            *(plain.data() + matrix_reps_index_map_[i]) = 0;
-        }
-
-        // Transform destination using inverse of negacyclic NTT
-        // Note: We already performed bit-reversal when reading in the matrix
-        inverse_ntt_negacyclic_harvey(plain.data(), *context_data.plain_ntt_tables());
+        // Write the values to the coefficients of plain, set to full slot 
+        // count size, and transform
+        encode_internal(temp.get(), input_plain_coeff_count, plain);
     }
 
-    void BatchEncoder::decode(const Plaintext &plain, vector<uint64_t> &destination,
-        MemoryPoolHandle pool)
+    void BatchEncoder::verify_decode(const Plaintext &plain) const
     {
         if (!plain.is_valid_for(context_))
         {
@@ -333,15 +296,14 @@ namespace seal
         {
             throw invalid_argument("plain cannot be in NTT form");
         }
-        if (!pool)
-        {
-            throw invalid_argument("pool is uninitialized");
-        }
+    }
 
+    template<typename T>
+    void BatchEncoder::decode_internal(const Plaintext &plain, T *destination,
+        MemoryPool &pool) const
+    {
         auto &context_data = *context_->context_data();
-
-        // Set destination size
-        destination.resize(slots_);
+        uint64_t modulus = context_data.parms().plain_modulus().value();
 
         // Never include the leading zero coefficient (if present)
         size_t plain_coeff_count = min(plain.coeff_count(), slots_);
@@ -355,52 +317,74 @@ namespace seal
         // Transform destination using negacyclic NTT.
         ntt_negacyclic_harvey(temp_dest.get(), *context_data.plain_ntt_tables());
 
-        // Read top row
+        // Read top row, then bottom row
+        uint64_t plain_modulus_div_two = modulus >> 1;
         for (size_t i = 0; i < slots_; i++)
         {
-            destination[i] = temp_dest[matrix_reps_index_map_[i]];
+            destination[i] = slot_value_from_uint<T>(
+                temp_dest[matrix_reps_index_map_[i]], modulus, plain_modulus_div_two);
         }
     }
 
-    void BatchEncoder::decode(const Plaintext &plain, vector<int64_t> &destination,
+    void BatchEncoder::decode(const Plaintext &plain, vector<uint64_t> &destination,
         MemoryPoolHandle pool)
     {
-        if (!plain.is_valid_for(context_))
-        {
-            throw invalid_argument("plain is not valid for encryption parameters");
-        }
-        if (plain.is_ntt_form())
+        verify_decode(plain);
+        if (!pool)
         {
-            throw invalid_argument("plain cannot be in NTT form");
+            throw invalid_argument("pool is uninitialized");
         }
+
+        destination.resize(slots_);
+        decode_internal(plain, destination.data(), pool);
+    }
+
+    void BatchEncoder::decode(const Plaintext &plain, vector<int64_t> &destination,
+        MemoryPoolHandle pool)
+    {
+        verify_decode(plain);
         if (!pool)
         {
             throw invalid_argument("pool is uninitialized");
         }
 
+        destination.resize(slots_);
+        decode_internal(plain, destination.data(), pool);
+    }
+
+    void BatchEncoder::decode_poly(uint64_t *poly, vector<uint64_t> &destination) const
+    {
         auto &context_data = *context_->context_data();
-        uint64_t modulus = context_data.parms().plain_modulus().value();
 
         // Set destination size
         destination.resize(slots_);
 
-        // Never include the leading zero coefficient (if present)
-        size_t plain_coeff_count = min(plain.coeff_count(), slots_);
+        // Transform poly using negacyclic NTT.
+        ntt_negacyclic_harvey(poly, *context_data.plain_ntt_tables());
 
-        auto temp_dest(allocate_uint(slots_, pool));
+        // Read top row
+        for (size_t i = 0; i < slots_; i++)
+        {
+            destination[i] = poly[matrix_reps_index_map_[i]];
+        }
+    }
 
-        // Make a copy of poly
-        set_uint_uint(plain.data(), plain_coeff_count, temp_dest.get());
-        set_zero_uint(slots_ - plain_coeff_count, temp_dest.get() + plain_coeff_count);
+    void BatchEncoder::decode_poly(uint64_t *poly, vector<int64_t> &destination) const
+    {
+        auto &context_data = *context_->context_data();
+        uint64_t modulus = context_data.parms().plain_modulus().value();
 
-        // Transform destination using negacyclic NTT.
-        ntt_negacyclic_harvey(temp_dest.get(), *context_data.plain_ntt_tables());
+        // Set destination size
+        destination.resize(slots_);
+
+        // Transform poly using negacyclic NTT.
+        ntt_negacyclic_harvey(poly, *context_data.plain_ntt_tables());
 
         // Read top row, then bottom row
         uint64_t plain_modulus_div_two = modulus >> 1;
         for (size_t i = 0; i < slots_; i++)
         {
-            uint64_t curr_value = temp_dest[matrix_reps_index_map_[i]];
+            uint64_t curr_value = poly[matrix_reps_index_map_[i]];
             destination[i] = (curr_value > plain_modulus_div_two) ?
                 (static_cast<int64_t>(curr_value) - static_cast<int64_t>(modulus)) : 
                 static_cast<int64_t>(curr_value);
@@ -410,106 +394,74 @@ namespace seal
     void BatchEncoder::decode(const Plaintext &plain, gsl::span<uint64_t> destination,
         MemoryPoolHandle pool)
     {
-        if (!plain.is_valid_for(context_))
-        {
-            throw invalid_argument("plain is not valid for encryption parameters");
-        }
-        if (plain.is_ntt_form())
-        {
-            throw invalid_argument("plain cannot be in NTT form");
-        }
+        verify_decode(plain);
         if (!pool)
         {
             throw invalid_argument("pool is uninitialized");
         }
-
-        auto &context_data = *context_->context_data();
-
-        using index_type = decltype(destination)::index_type;
         if(unsigned_gt(destination.size(), numeric_limits<int>::max()) || 
             unsigned_neq(destination.size(), slots_))
         {
             throw invalid_argument("destination has incorrect size");
         }
 
-        // Never include the leading zero coefficient (if present)
-        size_t plain_coeff_count = min(plain.coeff_count(), slots_);
-
-        auto temp_dest(allocate_uint(slots_, pool));
-
-        // Make a copy of poly
-        set_uint_uint(plain.data(), plain_coeff_count, temp_dest.get());
-        set_zero_uint(slots_ - plain_coeff_count, temp_dest.get() + plain_coeff_count);
-
-        // Transform destination using negacyclic NTT.
-        ntt_negacyclic_harvey(temp_dest.get(), *context_data.plain_ntt_tables());
-
-        // Read top row
-        for (size_t i = 0; i < slots_; i++)
-        {
-            destination[static_cast<index_type>(i)] = temp_dest[matrix_reps_index_map_[i]];
-        }
+        decode_internal(plain, destination.data(), pool);
     }
 
     void BatchEncoder::decode(const Plaintext &plain, gsl::span<int64_t> destination,
         MemoryPoolHandle pool)
     {
-        if (!plain.is_valid_for(context_))
-        {
-            throw invalid_argument("plain is not valid for encryption parameters");
-        }
-        if (plain.is_ntt_form())
-        {
-            throw invalid_argument("plain cannot be in NTT form");
-        }
+        verify_decode(plain);
         if (!pool)
         {
             throw invalid_argument("pool is uninitialized");
         }
-
-        auto &context_data = *context_->context_data();
-        uint64_t modulus = context_data.parms().plain_modulus().value();
-
-        using index_type = decltype(destination)::index_type;
         if(unsigned_gt(destination.size(), numeric_limits<int>::max()) || 
             unsigned_neq(destination.size(), slots_))
         {
             throw invalid_argument("destination has incorrect size");
         }
 
-        // Never include the leading zero coefficient (if present)
-        size_t plain_coeff_count = min(plain.coeff_count(), slots_);
-
-        auto temp_dest(allocate_uint(slots_, pool));
-
-        // Make a copy of poly
-        set_uint_uint(plain.data(), plain_coeff_count, temp_dest.get());
-        set_zero_uint(slots_ - plain_coeff_count, temp_dest.get() + plain_coeff_count);
+        decode_internal(plain, destination.data(), pool);
+    }
+#endif
+    template<typename T>
+    void BatchEncoder::decode_batch(const vector<Plaintext> &plains,
+        vector<vector<T>> &destination, size_t thread_count)
+    {
+        for (auto &plain : plains)
+        {
+            verify_decode(plain);
+        }
+
+        destination.resize(plains.size());
+        parallel_for(plains.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                // Thread-local pool for the scratch space
+                auto pool = MemoryPoolHandle::New();
+                for (size_t i = begin; i < end; i++)
+                {
+                    destination[i].resize(slots_);
+                    decode_internal(plains[i], destination[i].data(), pool);
+                }
+            });
+    }
 
-        // Transform destination using negacyclic NTT.
-        ntt_negacyclic_harvey(temp_dest.get(), *context_data.plain_ntt_tables());
+    void BatchEncoder::decode(const vector<Plaintext> &plains,
+        vector<vector<uint64_t>> &destination, size_t thread_count)
+    {
+        decode_batch(plains, destination, thread_count);
+    }
 
-        // Read top row, then bottom row
-        uint64_t plain_modulus_div_two = modulus >> 1;
-        for (size_t i = 0; i < slots_; i++)
-        {
-            uint64_t curr_value = temp_dest[matrix_reps_index_map_[i]];
-            destination[static_cast<index_type>(i)] = (curr_value > plain_modulus_div_two) ?
-                    (static_cast<int64_t>(curr_value) - static_cast<int64_t>(modulus)) : 
-                    static_cast<int64_t>(curr_value);
-        }
+    void BatchEncoder::decode(const vector<Plaintext> &plains,
+        vector<vector<int64_t>> &destination, size_t thread_count)
+    {
+        decode_batch(plains, destination, thread_count);
     }
-#endif
+
     void BatchEncoder::decode(Plaintext &plain, MemoryPoolHandle pool)
     {
-        if (!plain.is_valid_for(context_))
-        {
-            throw invalid_argument("plain is not valid for encryption parameters");
-        }
-        if (plain.is_ntt_form())
-        {
-            throw invalid_argument("plain cannot be in NTT form");
-        }
+        verify_decode(plain);
         if (!pool)
         {
             throw invalid_argument("pool is uninitialized");
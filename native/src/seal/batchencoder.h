@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <limits>
 #include "seal/util/defines.h"
@@ -51,6 +52,8 @@ namespace seal
     */
     class BatchEncoder
     {
+        friend class Decryptor;
+
     public:
         /**
         Creates a BatchEncoder. It is necessary that the encryption parameters 
@@ -350,6 +353,72 @@ namespace seal
         */
         void decode(Plaintext &plain, MemoryPoolHandle pool = MemoryManager::GetPool());
 
+        /**
+        Creates plaintexts from a batch of matrices, exactly as the encode function
+        for a single matrix does, and stores them in destination, which is resized
+        to the number of matrices. The matrices are split among thread_count
+        threads. A thread_count of zero uses one thread per hardware thread.
+
+        @param[in] values_matrices The matrices of integers modulo plaintext modulus
+        to batch
+        @param[out] destination The plaintexts to overwrite with the results
+        @param[in] thread_count The number of threads to use
+        @throws std::logic_error if some matrix is too large
+        */
+        void encode(const std::vector<std::vector<std::uint64_t>> &values_matrices,
+            std::vector<Plaintext> &destination, std::size_t thread_count = 0);
+
+        /**
+        Creates plaintexts from a batch of matrices, exactly as the encode function
+        for a single matrix does, and stores them in destination, which is resized
+        to the number of matrices. The matrices are split among thread_count
+        threads. A thread_count of zero uses one thread per hardware thread.
+
+        @param[in] values_matrices The matrices of integers modulo plaintext modulus
+        to batch
+        @param[out] destination The plaintexts to overwrite with the results
+        @param[in] thread_count The number of threads to use
+        @throws std::logic_error if some matrix is too large
+        */
+        void encode(const std::vector<std::vector<std::int64_t>> &values_matrices,
+            std::vector<Plaintext> &destination, std::size_t thread_count = 0);
+
+        /**
+        Unbatches a batch of plaintexts, exactly as the decode function for a
+        single plaintext does, and stores the matrices in destination, which is
+        resized to the number of plaintexts. The plaintexts are split among
+        thread_count threads. A thread_count of zero uses one thread per hardware
+        thread.
+
+        @param[in] plains The plaintext polynomials to unbatch
+        @param[out] destination The matrices to be overwritten with the values in
+        the slots
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some plaintext is not valid for the
+        encryption parameters or is in NTT form
+        */
+        void decode(const std::vector<Plaintext> &plains,
+            std::vector<std::vector<std::uint64_t>> &destination,
+            std::size_t thread_count = 0);
+
+        /**
+        Unbatches a batch of plaintexts, exactly as the decode function for a
+        single plaintext does, and stores the matrices in destination, which is
+        resized to the number of plaintexts. The plaintexts are split among
+        thread_count threads. A thread_count of zero uses one thread per hardware
+        thread.
+
+        @param[in] plains The plaintext polynomials to unbatch
+        @param[out] destination The matrices to be overwritten with the values in
+        the slots
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some plaintext is not valid for the
+        encryption parameters or is in NTT form
+        */
+        void decode(const std::vector<Plaintext> &plains,
+            std::vector<std::vector<std::int64_t>> &destination,
+            std::size_t thread_count = 0);
+
         /**
         Returns the number of slots.
         */
@@ -372,6 +441,33 @@ namespace seal
 
         void populate_matrix_reps_index_map();
 
+        template<typename T>
+        void verify_encode(const T *values, std::size_t values_size) const;
+
+        template<typename T>
+        void encode_internal(const T *values, std::size_t values_size,
+            Plaintext &destination) const;
+
+        template<typename T>
+        void encode_batch(const std::vector<std::vector<T>> &values_matrices,
+            std::vector<Plaintext> &destination, std::size_t thread_count);
+
+        void verify_decode(const Plaintext &plain) const;
+
+        template<typename T>
+        void decode_internal(const Plaintext &plain, T *destination,
+            util::MemoryPool &pool) const;
+
+        template<typename T>
+        void decode_batch(const std::vector<Plaintext> &plains,
+            std::vector<std::vector<T>> &destination, std::size_t thread_count);
+
+        void decode_poly(std::uint64_t *poly,
+            std::vector<std::uint64_t> &destination) const;
+
+        void decode_poly(std::uint64_t *poly,
+            std::vector<std::int64_t> &destination) const;
+
         inline void reverse_bits(std::uint64_t *input)
         {
 #ifdef SEAL_DEBUG
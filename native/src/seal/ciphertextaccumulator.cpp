@@ -0,0 +1,320 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include "seal/ciphertextaccumulator.h"
+#include "seal/util/common.h"
+#include "seal/util/uintarith.h"
+#include "seal/util/uintarithsmallmod.h"
+
+using namespace std;
+using namespace seal::util;
+
+namespace seal
+{
+    CiphertextAccumulator::CiphertextAccumulator(shared_ptr<SEALContext> context,
+        MemoryPoolHandle pool) : context_(move(context)), pool_(move(pool)),
+        sums_(pool_)
+    {
+        // Verify parameters
+        if (!context_)
+        {
+            throw invalid_argument("invalid context");
+        }
+        if (!context_->parameters_set())
+        {
+            throw invalid_argument("encryption parameters are not set correctly");
+        }
+        if (!pool_)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+    }
+
+    void CiphertextAccumulator::add(const Ciphertext &encrypted)
+    {
+        // Verify parameters.
+        if (!encrypted.is_metadata_valid_for(context_))
+        {
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+
+        prepare(encrypted.parms_id(), encrypted.size(), encrypted.is_ntt_form(),
+            encrypted.scale(), 1);
+
+        const uint64_t *encrypted_ptr = encrypted.data();
+        uint64_t *sums_ptr = sums_.begin();
+        for (size_t k = 0; k < encrypted.uint64_count(); k++, sums_ptr += 2)
+        {
+            unsigned long long temp;
+            sums_ptr[1] += add_uint64(sums_ptr[0], *encrypted_ptr++, &temp);
+            sums_ptr[0] = temp;
+        }
+    }
+
+    void CiphertextAccumulator::add(const CiphertextAccumulator &other)
+    {
+        // Verify parameters.
+        if (other.context_ != context_)
+        {
+            throw invalid_argument("other is not valid for encryption parameters");
+        }
+        if (other.empty())
+        {
+            return;
+        }
+        if (empty())
+        {
+            parms_id_ = other.parms_id_;
+            size_ = other.size_;
+            is_ntt_form_ = other.is_ntt_form_;
+            scale_ = other.scale_;
+            term_count_ = other.term_count_;
+            term_budget_ = other.term_budget_;
+            pending_terms_ = other.pending_terms_;
+            sums_ = other.sums_;
+            return;
+        }
+
+        // The sums of other are reduced while they are added if the budget does
+        // not allow adding them as they are. The term count of other is read
+        // first, since prepare changes it when other is this accumulator.
+        bool reduce_other = other.pending_terms_ > term_budget_ - 1;
+        size_t other_term_count = other.term_count_;
+        prepare(other.parms_id_, other.size_, other.is_ntt_form_, other.scale_,
+            reduce_other ? 1 : other.pending_terms_);
+
+        auto &coeff_modulus = context_->context_data(parms_id_)->parms().coeff_modulus();
+        size_t coeff_count = context_->context_data(parms_id_)->parms().poly_modulus_degree();
+        size_t poly_count = other.size_ * coeff_modulus.size();
+        const uint64_t *other_ptr = other.sums_.cbegin();
+        uint64_t *sums_ptr = sums_.begin();
+        for (size_t k = 0; k < poly_count; k++)
+        {
+            auto &modulus = coeff_modulus[k % coeff_modulus.size()];
+            for (size_t l = 0; l < coeff_count; l++, other_ptr += 2, sums_ptr += 2)
+            {
+                unsigned long long temp;
+                if (reduce_other)
+                {
+                    sums_ptr[1] += add_uint64(sums_ptr[0],
+                        barrett_reduce_128(other_ptr, modulus), &temp);
+                }
+                else
+                {
+                    sums_ptr[1] += other_ptr[1] + add_uint64(sums_ptr[0], other_ptr[0], &temp);
+                }
+                sums_ptr[0] = temp;
+            }
+        }
+        term_count_ += other_term_count - 1;
+    }
+
+    void CiphertextAccumulator::multiply_plain_add(const Ciphertext &encrypted_ntt,
+        const Plaintext &plain_ntt)
+    {
+        // Verify parameters.
+        if (!plain_ntt.is_metadata_valid_for(context_))
+        {
+            throw invalid_argument("plain_ntt is not valid for encryption parameters");
+        }
+        if (!plain_ntt.is_ntt_form())
+        {
+            throw invalid_argument("plain_ntt is not in NTT form");
+        }
+        if (encrypted_ntt.parms_id() != plain_ntt.parms_id())
+        {
+            throw invalid_argument("encrypted_ntt and plain_ntt parameter mismatch");
+        }
+
+        multiply_plain_add(encrypted_ntt, plain_ntt.data(), plain_ntt.scale());
+    }
+
+    void CiphertextAccumulator::multiply_plain_add(const Ciphertext &encrypted_ntt,
+        const PlaintextDatabase &database, size_t index)
+    {
+        // Verify parameters.
+        if (encrypted_ntt.parms_id() != database.parms_id())
+        {
+            throw invalid_argument("encrypted_ntt and database parameter mismatch");
+        }
+
+        multiply_plain_add(encrypted_ntt, database.data(index), database.scale(index));
+    }
+
+    void CiphertextAccumulator::multiply_plain_add(const Ciphertext &encrypted_ntt,
+        const uint64_t *plain_ntt, double plain_scale)
+    {
+        // Verify parameters.
+        if (!encrypted_ntt.is_metadata_valid_for(context_))
+        {
+            throw invalid_argument("encrypted_ntt is not valid for encryption parameters");
+        }
+        if (!encrypted_ntt.is_ntt_form())
+        {
+            throw invalid_argument("encrypted_ntt is not in NTT form");
+        }
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data(encrypted_ntt.parms_id());
+        size_t coeff_count = context_data.parms().poly_modulus_degree();
+        size_t coeff_mod_count = context_data.parms().coeff_modulus().size();
+        size_t plain_uint64_count = coeff_count * coeff_mod_count;
+
+        double new_scale = encrypted_ntt.scale() * plain_scale;
+
+        // Check that scale is positive and not too large
+        if (new_scale <= 0 || (static_cast<int>(log2(new_scale)) >=
+            context_data.total_coeff_modulus_bit_count()))
+        {
+            throw invalid_argument("scale out of bounds");
+        }
+
+        prepare(encrypted_ntt.parms_id(), encrypted_ntt.size(), true, new_scale, 1);
+
+        const uint64_t *encrypted_ptr = encrypted_ntt.data();
+        uint64_t *sums_ptr = sums_.begin();
+        for (size_t i = 0; i < encrypted_ntt.size(); i++)
+        {
+            const uint64_t *plain_ptr = plain_ntt;
+            for (size_t k = 0; k < plain_uint64_count; k++, sums_ptr += 2)
+            {
+                unsigned long long product[2];
+                unsigned long long temp;
+                multiply_uint64(*encrypted_ptr++, *plain_ptr++, product);
+                sums_ptr[1] += product[1] + add_uint64(sums_ptr[0], product[0], &temp);
+                sums_ptr[0] = temp;
+            }
+        }
+    }
+
+    void CiphertextAccumulator::reduce(Ciphertext &destination) const
+    {
+        if (empty())
+        {
+            throw logic_error("accumulator is empty");
+        }
+
+        auto &parms = context_->context_data(parms_id_)->parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t poly_count = size_ * coeff_modulus.size();
+
+        destination.resize(context_, parms_id_, size_);
+        destination.is_ntt_form() = is_ntt_form_;
+        destination.scale() = scale_;
+        const uint64_t *sums_ptr = sums_.cbegin();
+        uint64_t *destination_ptr = destination.data();
+        for (size_t k = 0; k < poly_count; k++)
+        {
+            auto &modulus = coeff_modulus[k % coeff_modulus.size()];
+            for (size_t l = 0; l < coeff_count; l++, sums_ptr += 2)
+            {
+                *destination_ptr++ = barrett_reduce_128(sums_ptr, modulus);
+            }
+        }
+#ifndef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (destination.is_transparent())
+        {
+            throw logic_error("result ciphertext is transparent");
+        }
+#endif
+    }
+
+    void CiphertextAccumulator::clear() noexcept
+    {
+        parms_id_ = parms_id_zero;
+        size_ = 0;
+        is_ntt_form_ = false;
+        scale_ = 1.0;
+        term_count_ = 0;
+        term_budget_ = 0;
+        pending_terms_ = 0;
+        sums_.clear();
+    }
+
+    void CiphertextAccumulator::prepare(const parms_id_type &parms_id, size_t size,
+        bool is_ntt_form, double scale, uint64_t term_weight)
+    {
+        auto &parms = context_->context_data(parms_id)->parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+
+        if (empty())
+        {
+            // The budget is floor((2^128 - 1) / (q - 1)^2) for the largest prime q
+            term_budget_ = numeric_limits<uint64_t>::max();
+            for (auto &modulus : coeff_modulus)
+            {
+                uint64_t max_value = modulus.value() - 1;
+                uint64_t numerator[2]{ numeric_limits<uint64_t>::max(),
+                    numeric_limits<uint64_t>::max() };
+                uint64_t quotient[2];
+                divide_uint128_uint64_inplace(numerator, max_value, quotient);
+                numerator[0] = quotient[0];
+                numerator[1] = quotient[1];
+                divide_uint128_uint64_inplace(numerator, max_value, quotient);
+                if (!quotient[1])
+                {
+                    term_budget_ = min(term_budget_, quotient[0]);
+                }
+            }
+            parms_id_ = parms_id;
+            size_ = 0;
+            is_ntt_form_ = is_ntt_form;
+            scale_ = scale;
+            sums_.resize(0);
+        }
+        else
+        {
+            if (parms_id != parms_id_)
+            {
+                throw invalid_argument("parameter mismatch");
+            }
+            if (is_ntt_form != is_ntt_form_)
+            {
+                throw invalid_argument("NTT form mismatch");
+            }
+            if (!are_close<double>(scale, scale_))
+            {
+                throw invalid_argument("scale mismatch");
+            }
+            if (pending_terms_ > term_budget_ - term_weight)
+            {
+                fold();
+            }
+        }
+
+        // Grow the accumulators to the size of the term
+        if (size > size_)
+        {
+            sums_.resize(mul_safe(size, coeff_count, coeff_modulus.size(), size_t(2)));
+            size_ = size;
+        }
+        pending_terms_ += term_weight;
+        term_count_++;
+    }
+
+    void CiphertextAccumulator::fold() noexcept
+    {
+        auto &parms = context_->context_data(parms_id_)->parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t poly_count = size_ * coeff_modulus.size();
+        uint64_t *sums_ptr = sums_.begin();
+        for (size_t k = 0; k < poly_count; k++)
+        {
+            auto &modulus = coeff_modulus[k % coeff_modulus.size()];
+            for (size_t l = 0; l < coeff_count; l++, sums_ptr += 2)
+            {
+                sums_ptr[0] = barrett_reduce_128(sums_ptr, modulus);
+                sums_ptr[1] = 0;
+            }
+        }
+        pending_terms_ = 1;
+    }
+}
@@ -0,0 +1,223 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "seal/context.h"
+#include "seal/ciphertext.h"
+#include "seal/plaintext.h"
+#include "seal/plaintextdatabase.h"
+#include "seal/intarray.h"
+#include "seal/memorymanager.h"
+#include "seal/encryptionparams.h"
+
+namespace seal
+{
+    /**
+    Accumulates a sum of ciphertexts and of products of ciphertexts with
+    plaintexts without reducing the coefficients after every term. Large
+    encrypted sums, as in secure aggregation, and inner products of ciphertexts
+    with plaintexts, as in the answers of private information retrieval, spend
+    much of their time in modular reductions when computed with Evaluator::add
+    and Evaluator::multiply_plain. A CiphertextAccumulator instead keeps every
+    coefficient as a 128-bit integer, adds the terms to it without reduction,
+    and reduces once when the result is written out with reduce.
+
+    @par Overflow Budget
+    Every term added to the accumulator is less than (q-1)^2 for every prime q
+    in the coefficient modulus, so floor((2^128-1) / (q-1)^2) terms, at least
+    256 for primes of up to 60 bits, fit into the 128-bit accumulators. This
+    number is returned by term_budget. When the budget is used up, the
+    accumulators are reduced in place before the next term is added, so any
+    number of terms can be accumulated.
+
+    @par Thread Safety
+    A CiphertextAccumulator is not thread-safe. To accumulate in several
+    threads, use one accumulator per thread and add them together at the end.
+
+    @see Evaluator::add_many for adding a vector of ciphertexts.
+    */
+    class CiphertextAccumulator
+    {
+    public:
+        /**
+        Creates an empty CiphertextAccumulator. The first term added to it
+        determines the parms_id, the NTT form, and the scale of the result.
+
+        @param[in] context The SEALContext
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        CiphertextAccumulator(std::shared_ptr<SEALContext> context,
+            MemoryPoolHandle pool = MemoryManager::GetPool());
+
+        /**
+        Adds a ciphertext to the sum.
+
+        @param[in] encrypted The ciphertext to add
+        @throws std::invalid_argument if encrypted is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if encrypted does not match the parms_id,
+        the NTT form, or the scale of the terms added before
+        */
+        void add(const Ciphertext &encrypted);
+
+        /**
+        Adds the sum of another CiphertextAccumulator to the sum.
+
+        @param[in] other The accumulator to add
+        @throws std::invalid_argument if other is for different encryption
+        parameters
+        @throws std::invalid_argument if the sum of other does not match the
+        parms_id, the NTT form, or the scale of the terms added before
+        */
+        void add(const CiphertextAccumulator &other);
+
+        /**
+        Adds the product of a ciphertext and a plaintext, both in NTT form, to
+        the sum. The scale of the product is the product of the scales.
+
+        @param[in] encrypted_ntt The ciphertext to multiply
+        @param[in] plain_ntt The plaintext to multiply
+        @throws std::invalid_argument if encrypted_ntt or plain_ntt is not valid
+        for the encryption parameters
+        @throws std::invalid_argument if encrypted_ntt or plain_ntt is not in NTT
+        form
+        @throws std::invalid_argument if encrypted_ntt and plain_ntt have
+        different parms_id
+        @throws std::invalid_argument if the scale of the product is out of bounds
+        @throws std::invalid_argument if the product does not match the parms_id,
+        the NTT form, or the scale of the terms added before
+        */
+        void multiply_plain_add(const Ciphertext &encrypted_ntt,
+            const Plaintext &plain_ntt);
+
+        /**
+        Adds the product of a ciphertext in NTT form and a plaintext in a
+        PlaintextDatabase to the sum. The plaintext is read in place from the
+        database.
+
+        @param[in] encrypted_ntt The ciphertext to multiply
+        @param[in] database The database holding the plaintext
+        @param[in] index The index of the plaintext in the database
+        @throws std::invalid_argument if encrypted_ntt is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if encrypted_ntt is not in NTT form
+        @throws std::invalid_argument if encrypted_ntt is not at the parms_id of
+        the database
+        @throws std::out_of_range if index is not within [0, database.size())
+        @throws std::invalid_argument if the scale of the product is out of bounds
+        @throws std::invalid_argument if the product does not match the parms_id,
+        the NTT form, or the scale of the terms added before
+        */
+        void multiply_plain_add(const Ciphertext &encrypted_ntt,
+            const PlaintextDatabase &database, std::size_t index);
+
+        /**
+        Reduces the accumulated sum and writes it to destination. The
+        accumulator is not changed, so more terms can be added afterwards.
+
+        @param[out] destination The ciphertext to overwrite with the sum
+        @throws std::logic_error if the accumulator is empty
+        @throws std::logic_error if result ciphertext is transparent
+        */
+        void reduce(Ciphertext &destination) const;
+
+        /**
+        Removes all terms from the accumulator. The memory of the accumulators
+        is kept for reuse.
+        */
+        void clear() noexcept;
+
+        /**
+        Returns whether no terms have been added to the accumulator.
+        */
+        inline bool empty() const noexcept
+        {
+            return term_count_ == 0;
+        }
+
+        /**
+        Returns the number of terms added to the accumulator.
+        */
+        inline std::size_t term_count() const noexcept
+        {
+            return term_count_;
+        }
+
+        /**
+        Returns the number of terms that fit into the 128-bit accumulators
+        between two reductions. The budget depends on the coefficient modulus
+        of the terms and is zero for an empty accumulator.
+        */
+        inline std::uint64_t term_budget() const noexcept
+        {
+            return term_budget_;
+        }
+
+        /**
+        Returns the parms_id of the sum. The parms_id is parms_id_zero for an
+        empty accumulator.
+        */
+        inline const parms_id_type &parms_id() const noexcept
+        {
+            return parms_id_;
+        }
+
+        /**
+        Returns the scale of the sum.
+        */
+        inline double scale() const noexcept
+        {
+            return scale_;
+        }
+
+        /**
+        Returns whether the sum is in NTT form.
+        */
+        inline bool is_ntt_form() const noexcept
+        {
+            return is_ntt_form_;
+        }
+
+    private:
+        // Sets up the accumulators for the first term or checks that a term
+        // matches the terms added before, and makes room for another term
+        void prepare(const parms_id_type &parms_id, std::size_t size,
+            bool is_ntt_form, double scale, std::uint64_t term_weight);
+
+        // Reduces the accumulators modulo the coefficient modulus in place
+        void fold() noexcept;
+
+        void multiply_plain_add(const Ciphertext &encrypted_ntt,
+            const std::uint64_t *plain_ntt, double plain_scale);
+
+        std::shared_ptr<SEALContext> context_{ nullptr };
+
+        MemoryPoolHandle pool_;
+
+        parms_id_type parms_id_ = parms_id_zero;
+
+        std::size_t size_ = 0;
+
+        bool is_ntt_form_ = false;
+
+        double scale_ = 1.0;
+
+        std::size_t term_count_ = 0;
+
+        std::uint64_t term_budget_ = 0;
+
+        // Number of terms in the accumulators since the last reduction
+        std::uint64_t pending_terms_ = 0;
+
+        // The 128-bit accumulators with the low word first, in the layout of
+        // the ciphertext
+        IntArray<std::uint64_t> sums_;
+    };
+}
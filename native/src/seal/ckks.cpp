@@ -5,6 +5,8 @@
 #include <random>
 #include <limits>
 #include <cinttypes>
+#include <algorithm>
+#include <vector>
 #include "seal/ckks.h"
 
 using namespace std;
@@ -37,37 +39,142 @@ namespace seal
 
         size_t coeff_count = context_data.parms().poly_modulus_degree();
         slots_ = coeff_count >> 1;
-        int logn = get_power_of_two(coeff_count);
+        uint64_t m = coeff_count << 1;
 
-        matrix_reps_index_map_ = allocate_uint(coeff_count, pool_);
+        /*
+        Slot i holds the value at psi^(3^i) for a primitive m-th root of unity
+        psi. Since the coefficients are real, the value at psi^(-k) is the
+        conjugate of the value at psi^k. For odd i we have 3^i = 3 (mod 4), so
+        -3^i is a power of 5, as is 3^i for even i; we record which power of 5.
+        At the powers of 5 the polynomial is sum_j (c_j + i * c_(j + N/2)) X^j
+        of degree N/2, so the transform works on N/2 complex numbers.
+        */
+        vector<uint64_t> power_of_five_index(m, 0);
+        uint64_t power_of_five = 1;
+        for (size_t i = 0; i < slots_; i++)
+        {
+            power_of_five_index[power_of_five] = i;
+            power_of_five = (power_of_five * 5) & (m - 1);
+        }
 
-        // Copy from the matrix to the value vectors 
+        matrix_reps_index_map_ = allocate_uint(slots_, pool_);
         uint64_t gen = 3;
         uint64_t pos = 1;
-        uint64_t m = coeff_count << 1;
         for (size_t i = 0; i < slots_; i++)
         {
-            // Position in normal bit order
-            uint64_t index1 = (pos - 1) >> 1;
-            uint64_t index2 = (m - pos - 1) >> 1;
-
-            // Set the bit-reversed locations
-            matrix_reps_index_map_[i] = reverse_bits(index1, logn);
-            matrix_reps_index_map_[slots_ | i] = reverse_bits(index2, logn);
+            matrix_reps_index_map_[i] = power_of_five_index[(i & 1) ? m - pos : pos];
 
             // Next primitive root
             pos *= gen;
             pos &= (m - 1);
         }
 
-        roots_ = allocate<complex<double>>(coeff_count, pool_);
-        inv_roots_ = allocate<complex<double>>(coeff_count, pool_);
-        complex<double> psi{ cos((2 * PI_) / static_cast<double>(m)), 
-            sin((2 * PI_) / static_cast<double>(m)) };
-        for (size_t i = 0; i < coeff_count; i++)
+        // Twiddle factors of the stage on blocks of length len are stored
+        // contiguously from index len / 2 on
+        roots_ = allocate<complex<double>>(slots_, pool_);
+        inv_roots_ = allocate<complex<double>>(slots_, pool_);
+        for (size_t len = 2; len <= slots_; len <<= 1)
+        {
+            size_t lenh = len >> 1;
+            uint64_t lenq = len << 2;
+            power_of_five = 1;
+            for (size_t j = 0; j < lenh; j++)
+            {
+                double angle = (2 * PI_ * static_cast<double>(power_of_five % lenq)) /
+                    static_cast<double>(lenq);
+                roots_[lenh + j] = polar(1.0, angle);
+                inv_roots_[lenh + j] = conj(roots_[lenh + j]);
+                power_of_five = (power_of_five * 5) & (m - 1);
+            }
+        }
+    }
+
+    namespace
+    {
+        // Butterflies on separate real and imaginary parts; this avoids the
+        // special case handling in std::complex multiplication
+        inline void fft_butterfly(complex<double> *values, size_t begin,
+            size_t lenh, const complex<double> *roots)
+        {
+            double *x = reinterpret_cast<double *>(values + begin);
+            double *y = reinterpret_cast<double *>(values + begin + lenh);
+            const double *w = reinterpret_cast<const double *>(roots + lenh);
+            for (size_t j = 0; j < 2 * lenh; j += 2)
+            {
+                double vr = y[j] * w[j] - y[j + 1] * w[j + 1];
+                double vi = y[j] * w[j + 1] + y[j + 1] * w[j];
+                double ur = x[j];
+                double ui = x[j + 1];
+                x[j] = ur + vr;
+                x[j + 1] = ui + vi;
+                y[j] = ur - vr;
+                y[j + 1] = ui - vi;
+            }
+        }
+
+        inline void inverse_fft_butterfly(complex<double> *values, size_t begin,
+            size_t lenh, const complex<double> *inv_roots)
         {
-            roots_[i] = pow(psi, static_cast<double>(reverse_bits(i, logn)));
-            inv_roots_[i] = 1.0 / roots_[i];
+            double *x = reinterpret_cast<double *>(values + begin);
+            double *y = reinterpret_cast<double *>(values + begin + lenh);
+            const double *w = reinterpret_cast<const double *>(inv_roots + lenh);
+            for (size_t j = 0; j < 2 * lenh; j += 2)
+            {
+                double dr = x[j] - y[j];
+                double di = x[j + 1] - y[j + 1];
+                x[j] += y[j];
+                x[j + 1] += y[j + 1];
+                y[j] = dr * w[j] - di * w[j + 1];
+                y[j + 1] = dr * w[j + 1] + di * w[j];
+            }
+        }
+
+        // Blocks of this many complex numbers (16 KB) are transformed through
+        // all of their short stages while they are in the L1 cache
+        constexpr size_t fft_block_size = 1024;
+    }
+
+    void CKKSEncoder::fft_special(complex<double> *values) const
+    {
+        size_t block_size = min(fft_block_size, slots_);
+        for (size_t block = 0; block < slots_; block += block_size)
+        {
+            for (size_t len = 2; len <= block_size; len <<= 1)
+            {
+                for (size_t i = block; i < block + block_size; i += len)
+                {
+                    fft_butterfly(values, i, len >> 1, roots_.get());
+                }
+            }
+        }
+        for (size_t len = block_size << 1; len <= slots_; len <<= 1)
+        {
+            for (size_t i = 0; i < slots_; i += len)
+            {
+                fft_butterfly(values, i, len >> 1, roots_.get());
+            }
+        }
+    }
+
+    void CKKSEncoder::inverse_fft_special(complex<double> *values) const
+    {
+        size_t block_size = min(fft_block_size, slots_);
+        for (size_t len = slots_; len > block_size; len >>= 1)
+        {
+            for (size_t i = 0; i < slots_; i += len)
+            {
+                inverse_fft_butterfly(values, i, len >> 1, inv_roots_.get());
+            }
+        }
+        for (size_t block = 0; block < slots_; block += block_size)
+        {
+            for (size_t len = block_size; len >= 2; len >>= 1)
+            {
+                for (size_t i = block; i < block + block_size; i += len)
+                {
+                    inverse_fft_butterfly(values, i, len >> 1, inv_roots_.get());
+                }
+            }
         }
     }
 
@@ -56,6 +56,8 @@ namespace seal
     */
     class CKKSEncoder
     {
+        friend class Decryptor;
+
     public:
         /**
         Creates a CKKSEncoder instance initialized with the specified SEALContext.
@@ -376,55 +378,37 @@ namespace seal
             // input_size is guaranteed to be no bigger than slots_
             std::size_t input_size = values.size();
             std::size_t n = util::mul_safe(slots_, std::size_t(2));
+            int log_slots = util::get_power_of_two(slots_);
 
-            auto conj_values = util::allocate<std::complex<double>>(n, pool, 0);
+            // Values at the powers of 5; see the constructor
+            auto fft_values = util::allocate<std::complex<double>>(slots_, pool, 0);
             for (std::size_t i = 0; i < input_size; i++)
             {
-                conj_values[matrix_reps_index_map_[i]] = values[i];
-                conj_values[matrix_reps_index_map_[i + slots_]] = std::conj(values[i]);
+                std::complex<double> value(values[i]);
+                fft_values[matrix_reps_index_map_[i]] = (i & 1) ? std::conj(value) : value;
             }
 
-            int logn = util::get_power_of_two(n);
-            std::size_t tt = 1;
-            for (int i = 0; i < logn; i++)
-            {
-                std::size_t mm = std::size_t(1) << (logn - i);
-                std::size_t k_start = 0;
-                std::size_t h = mm / 2;
-
-                for (std::size_t j = 0; j < h; j++)
-                {
-                    std::size_t k_end = k_start + tt;
-                    auto s = inv_roots_[h + j];
-
-                    for (std::size_t k = k_start; k < k_end; k++)
-                    {
-                        auto u = conj_values[k];
-                        auto v = conj_values[k + tt];
-                        conj_values[k] = u + v;
-                        conj_values[k + tt] = (u - v) * s;
-                    }
-
-                    k_start += 2 * tt;
-                }
-                tt *= 2;
-            }
-
-            double n_inv = double(1.0) / static_cast<double>(n);
-            
-            // Put the scale in at this point 
-            n_inv *= scale;
+            inverse_fft_special(fft_values.get());
 
+            // The transform leaves the values in bit-reversed order; coefficient i
+            // and i + N/2 are the real and imaginary parts of value i. Put the
+            // scale in at this point.
+            double n_inv = scale / static_cast<double>(slots_);
+            auto coeffs = util::allocate<double>(n, pool);
             int max_coeff_bit_count = 1;
-            for (std::size_t i = 0; i < n; i++)
+            for (std::size_t i = 0; i < slots_; i++)
             {
-                // Multiply by scale and n_inv (see above)
-                conj_values[i] *= n_inv;
+                auto value = fft_values[util::reverse_bits(
+                    static_cast<std::uint64_t>(i), log_slots)];
+                coeffs[i] = value.real() * n_inv;
+                coeffs[i + slots_] = value.imag() * n_inv;
 
                 // Verify that the values are not too large to fit in coeff_modulus
                 // Note that we have an extra + 1 for the sign bit
                 max_coeff_bit_count = std::max(max_coeff_bit_count,
-                    static_cast<int>(std::log2(std::fabs(conj_values[i].real()))) + 2);
+                    static_cast<int>(std::log2(std::fabs(coeffs[i]))) + 2);
+                max_coeff_bit_count = std::max(max_coeff_bit_count,
+                    static_cast<int>(std::log2(std::fabs(coeffs[i + slots_]))) + 2);
             }
             if (max_coeff_bit_count >= context_data.total_coeff_modulus_bit_count())
             {
@@ -444,18 +428,20 @@ namespace seal
             {
                 for (std::size_t i = 0; i < n; i++)
                 {
-                    double coeffd = std::round(conj_values[i].real());
+                    double coeffd = std::round(coeffs[i]);
                     bool is_negative = std::signbit(coeffd);
 
-                    std::uint64_t coeffu = 
-                        static_cast<std::uint64_t>(std::fabs(coeffd));
+                    // Barrett reduction avoids a division for every prime
+                    std::uint64_t coeffu[2]{
+                        static_cast<std::uint64_t>(std::fabs(coeffd)), 0 };
 
                     if (is_negative)
                     {
                         for (std::size_t j = 0; j < coeff_mod_count; j++)
                         {
                             destination[i + (j * coeff_count)] = util::negate_uint_mod(
-                                coeffu % coeff_modulus[j].value(), coeff_modulus[j]);
+                                util::barrett_reduce_128(coeffu, coeff_modulus[j]),
+                                coeff_modulus[j]);
                         }
                     }
                     else
@@ -463,7 +449,7 @@ namespace seal
                         for (std::size_t j = 0; j < coeff_mod_count; j++)
                         {
                             destination[i + (j * coeff_count)] = 
-                                coeffu % coeff_modulus[j].value();
+                                util::barrett_reduce_128(coeffu, coeff_modulus[j]);
                         }
                     }
                 }
@@ -472,7 +458,7 @@ namespace seal
             {
                 for (std::size_t i = 0; i < n; i++)
                 {
-                    double coeffd = std::round(conj_values[i].real());
+                    double coeffd = std::round(coeffs[i]);
                     bool is_negative = std::signbit(coeffd);
                     coeffd = std::fabs(coeffd);
 
@@ -506,7 +492,7 @@ namespace seal
                 auto decomp_coeffu(util::allocate_uint(coeff_mod_count, pool));
                 for (std::size_t i = 0; i < n; i++)
                 {
-                    double coeffd = std::round(conj_values[i].real());
+                    double coeffd = std::round(coeffs[i]);
                     bool is_negative = std::signbit(coeffd);
                     coeffd = std::fabs(coeffd);
 
@@ -574,30 +560,49 @@ namespace seal
                 throw std::invalid_argument("pool is uninitialized");
             }
 
-            auto context_data_ptr = context_->context_data(plain.parms_id());
-            auto &parms = context_data_ptr->parms();
+            auto &context_data = *context_->context_data(plain.parms_id());
+            auto &parms = context_data.parms();
+            std::size_t rns_poly_uint64_count = util::mul_safe(
+                parms.poly_modulus_degree(), parms.coeff_modulus().size());
+
+            // Create mutable copy of input
+            auto plain_copy = util::allocate_uint(rns_poly_uint64_count, pool);
+            util::set_uint_uint(plain.data(), rns_poly_uint64_count, plain_copy.get());
+
+            decode_poly(plain_copy.get(), context_data, plain.scale(),
+                destination, std::move(pool));
+        }
+
+        // Decodes a polynomial in NTT form given in RNS representation for the
+        // given encryption parameters; the polynomial is overwritten
+        template<typename T,
+            typename = std::enable_if_t<std::is_same<T, double>::value ||
+            std::is_same<T, std::complex<double>>::value>>
+        void decode_poly(std::uint64_t *plain,
+            const SEALContext::ContextData &context_data, double scale,
+            std::vector<T> &destination, MemoryPoolHandle pool) const
+        {
+            auto &parms = context_data.parms();
             auto &coeff_modulus = parms.coeff_modulus();
             std::size_t coeff_mod_count = coeff_modulus.size();
             std::size_t coeff_count = parms.poly_modulus_degree();
-            std::size_t rns_poly_uint64_count = 
-                util::mul_safe(coeff_count, coeff_mod_count);
 
-            auto &small_ntt_tables = context_data_ptr->small_ntt_tables();
+            auto &small_ntt_tables = context_data.small_ntt_tables();
 
             // Check that scale is positive and not too large
-            if (plain.scale() <= 0 || (static_cast<int>(log2(plain.scale())) >=
-                context_data_ptr->total_coeff_modulus_bit_count()))
+            if (scale <= 0 || (static_cast<int>(log2(scale)) >=
+                context_data.total_coeff_modulus_bit_count()))
             {
                 throw std::invalid_argument("scale out of bounds");
             }
 
-            auto decryption_modulus = context_data_ptr->total_coeff_modulus();
-            auto upper_half_threshold = context_data_ptr->upper_half_threshold();
+            auto decryption_modulus = context_data.total_coeff_modulus();
+            auto upper_half_threshold = context_data.upper_half_threshold();
 
             auto &inv_coeff_products_mod_coeff_array =
-                context_data_ptr->base_converter()->get_inv_coeff_mod_coeff_array();
+                context_data.base_converter()->get_inv_coeff_mod_coeff_array();
             auto coeff_products_array =
-                context_data_ptr->base_converter()->get_coeff_products_array();
+                context_data.base_converter()->get_coeff_products_array();
 
             int logn = util::get_power_of_two(coeff_count);
 
@@ -608,64 +613,140 @@ namespace seal
                 throw std::logic_error("invalid parameters");
             }
 
-            double inv_scale = double(1.0) / plain.scale();
-
-            // Create mutable copy of input
-            auto plain_copy = util::allocate_uint(rns_poly_uint64_count, pool);
-            util::set_uint_uint(plain.data(), rns_poly_uint64_count, plain_copy.get());
-
-            // Array to keep number bigger than std::uint64_t
-            auto temp(util::allocate_uint(coeff_mod_count, pool));
-
-            // destination mod q
-            auto wide_tmp_dest(util::allocate_zero_uint(rns_poly_uint64_count, pool));
+            double inv_scale = double(1.0) / scale;
 
             // Transform each polynomial from NTT domain
             for (std::size_t i = 0; i < coeff_mod_count; i++)
             {
                 util::inverse_ntt_negacyclic_harvey(
-                    plain_copy.get() + (i * coeff_count), small_ntt_tables[i]);
+                    plain + (i * coeff_count), small_ntt_tables[i]);
             }
 
-            auto res = util::allocate<std::complex<double>>(coeff_count, pool);
+            // Coefficients i and i + N/2 become the real and imaginary parts of
+            // the input to the transform, in bit-reversed order; see the constructor
+            auto fft_values = util::allocate<std::complex<double>>(slots_, pool);
+            double *res_base = reinterpret_cast<double *>(fft_values.get());
+            int log_slots = util::get_power_of_two(slots_);
+
+            // With y_j = x_j * (q/q_j)^(-1) mod q_j every coefficient equals
+            // sum_j y_j * (q/q_j) - v * q, where v is the integer nearest to
+            // sum_j y_j / q_j. Both sums are accumulated over the primes in an
+            // outer loop: the fraction in double precision and the first sum
+            // modulo 2^128. Subtracting v * q gives a candidate for the centered
+            // coefficient that is accepted if it is less than q / 2 in absolute
+            // value and agrees with every residue; by the CRT this holds only for
+            // the correct value, whatever the rounding error in v. Coefficients
+            // that do not pass are composed exactly as a multi-precision integer.
+            auto inv_coeff_modulus = util::allocate<double>(coeff_mod_count, pool);
+            for (std::size_t j = 0; j < coeff_mod_count; j++)
+            {
+                inv_coeff_modulus[j] = 1.0 / static_cast<double>(coeff_modulus[j].value());
+            }
+            auto fractions = util::allocate<double>(coeff_count, pool, 0);
+            auto wide_sums(util::allocate_zero_uint(
+                util::mul_safe(coeff_count, std::size_t(2)), pool));
+            for (std::size_t j = 0; j < coeff_mod_count; j++)
+            {
+                const std::uint64_t *plain_ptr = plain + (j * coeff_count);
+                const std::uint64_t *coeff_product = 
+                    coeff_products_array + (j * coeff_mod_count);
+                std::uint64_t coeff_product_high = 
+                    (coeff_mod_count > 1) ? coeff_product[1] : 0;
+                for (std::size_t i = 0; i < coeff_count; i++)
+                {
+                    std::uint64_t tmp = util::multiply_uint_uint_mod(plain_ptr[i],
+                        inv_coeff_products_mod_coeff_array[j], coeff_modulus[j]);
+                    fractions[i] += static_cast<double>(tmp) * inv_coeff_modulus[j];
+
+                    unsigned long long prod[2];
+                    util::multiply_uint64(tmp, coeff_product[0], prod);
+                    std::uint64_t *sum = wide_sums.get() + (2 * i);
+                    unsigned char carry = util::add_uint64(sum[0], prod[0], sum);
+                    sum[1] += prod[1] + (tmp * coeff_product_high) + carry;
+                }
+            }
+
+            std::uint64_t modulus_high = (coeff_mod_count > 1) ? decryption_modulus[1] : 0;
+            int max_bit_count = context_data.total_coeff_modulus_bit_count() - 2;
+
+            // Array to keep number bigger than std::uint64_t
+            auto temp(util::allocate_uint(coeff_mod_count, pool));
+
+            // destination mod q
+            auto wide_tmp_dest(util::allocate_uint(coeff_mod_count, pool));
 
             double two_pow_64 = std::pow(2.0, 64);
             for (std::size_t i = 0; i < coeff_count; i++)
             {
+                double &res = res_base[2 * util::reverse_bits(
+                    static_cast<std::uint64_t>(i % slots_), log_slots) + (i / slots_)];
+
+                // Candidate sum_j y_j * (q/q_j) - v * q modulo 2^128
+                auto v = static_cast<std::uint64_t>(fractions[i] + 0.5);
+                unsigned long long prod[2];
+                util::multiply_uint64(v, decryption_modulus[0], prod);
+                std::uint64_t candidate[2];
+                unsigned char borrow = util::sub_uint64(
+                    wide_sums[2 * i], prod[0], candidate);
+                candidate[1] = wide_sums[2 * i + 1] - prod[1] - 
+                    (v * modulus_high) - borrow;
+
+                bool is_negative = static_cast<bool>(candidate[1] >> 63);
+                if (is_negative)
+                {
+                    util::negate_uint(candidate, 2, candidate);
+                }
+                bool is_valid = 
+                    util::get_significant_bit_count_uint(candidate, 2) <= max_bit_count;
+                for (std::size_t j = 0; is_valid && j < coeff_mod_count; j++)
+                {
+                    std::uint64_t residue = plain[(j * coeff_count) + i];
+                    is_valid = util::barrett_reduce_128(candidate, coeff_modulus[j]) ==
+                        (is_negative ? util::negate_uint_mod(residue, coeff_modulus[j]) : residue);
+                }
+                if (is_valid)
+                {
+                    res = (static_cast<double>(candidate[1]) * two_pow_64 + 
+                        static_cast<double>(candidate[0])) * inv_scale;
+                    if (is_negative)
+                    {
+                        res = -res;
+                    }
+                    continue;
+                }
+
+                util::set_zero_uint(coeff_mod_count, wide_tmp_dest.get());
                 for (std::size_t j = 0; j < coeff_mod_count; j++)
                 {
                     std::uint64_t tmp = util::multiply_uint_uint_mod(
-                        plain_copy[(j * coeff_count) + i],
+                        plain[(j * coeff_count) + i],
                         inv_coeff_products_mod_coeff_array[j], // (qi/q * plain[i]) mod qi
                         coeff_modulus[j]);
                     util::multiply_uint_uint64(
                         coeff_products_array + (j * coeff_mod_count),
                         coeff_mod_count, tmp, coeff_mod_count, temp.get());
-                    util::add_uint_uint_mod(temp.get(),
-                        wide_tmp_dest.get() + (i * coeff_mod_count),
-                        decryption_modulus, coeff_mod_count,
-                        wide_tmp_dest.get() + (i * coeff_mod_count));
+                    util::add_uint_uint_mod(temp.get(), wide_tmp_dest.get(),
+                        decryption_modulus, coeff_mod_count, wide_tmp_dest.get());
                 }
 
-                res[i] = 0.0;
-                if (util::is_greater_than_or_equal_uint_uint(
-                    wide_tmp_dest.get() + (i * coeff_mod_count),
+                res = 0.0;
+                if (util::is_greater_than_or_equal_uint_uint(wide_tmp_dest.get(),
                     upper_half_threshold, coeff_mod_count))
                 {
                     double scaled_two_pow_64 = inv_scale;
                     for (std::size_t j = 0; j < coeff_mod_count; 
                         j++, scaled_two_pow_64 *= two_pow_64)
                     {
-                        if (wide_tmp_dest[i * coeff_mod_count + j] > decryption_modulus[j])
+                        if (wide_tmp_dest[j] > decryption_modulus[j])
                         {
-                            auto diff = wide_tmp_dest[i * coeff_mod_count + j] - decryption_modulus[j];
-                            res[i] += diff ? 
+                            auto diff = wide_tmp_dest[j] - decryption_modulus[j];
+                            res += diff ? 
                                 static_cast<double>(diff) * scaled_two_pow_64 : 0.0;
                         }
                         else
                         {
-                            auto diff = decryption_modulus[j] - wide_tmp_dest[i * coeff_mod_count + j];
-                            res[i] -= diff ? 
+                            auto diff = decryption_modulus[j] - wide_tmp_dest[j];
+                            res -= diff ? 
                                 static_cast<double>(diff) * scaled_two_pow_64 : 0.0;
                         }
                     }
@@ -676,8 +757,8 @@ namespace seal
                     for (std::size_t j = 0; j < coeff_mod_count; 
                         j++, scaled_two_pow_64 *= two_pow_64)
                     {
-                        auto curr_coeff = wide_tmp_dest[i * coeff_mod_count + j];
-                        res[i] += curr_coeff ? 
+                        auto curr_coeff = wide_tmp_dest[j];
+                        res += curr_coeff ? 
                             static_cast<double>(curr_coeff) * scaled_two_pow_64 : 0.0;
                     }
                 }
@@ -688,34 +769,15 @@ namespace seal
                 // res[i] = res_accum * inv_scale;
             }
 
-            std::size_t tt = coeff_count;
-            for (int i = 0; i < logn; i++)
-            {
-                std::size_t mm = std::size_t(1) << i;
-                tt >>= 1;
-
-                for (std::size_t j = 0; j < mm; j++)
-                {
-                    std::size_t j1 = 2 * j * tt;
-                    std::size_t j2 = j1 + tt - 1;
-                    auto s = roots_[mm + j];
-
-                    for (std::size_t k = j1; k < j2 + 1; k++)
-                    {
-                        auto u = res[k];
-                        auto v = res[k + tt] * s;
-                        res[k] = u + v;
-                        res[k + tt] = u - v;
-                    }
-                }
-            }
+            fft_special(fft_values.get());
 
             destination.clear();
             destination.reserve(slots_);
             for (std::size_t i = 0; i < slots_; i++)
             {
+                auto value = fft_values[matrix_reps_index_map_[i]];
                 destination.emplace_back(
-                    from_complex<T>(res[matrix_reps_index_map_[i]]));
+                    from_complex<T>((i & 1) ? std::conj(value) : value));
             }
         }
 
@@ -733,6 +795,10 @@ namespace seal
         void encode_internal(std::int64_t value,
             parms_id_type parms_id, Plaintext &destination);
 
+        void fft_special(std::complex<double> *values) const;
+
+        void inverse_fft_special(std::complex<double> *values) const;
+
         MemoryPoolHandle pool_ = MemoryManager::GetPool();
 
         static constexpr double PI_ = 3.14159265358979323846;
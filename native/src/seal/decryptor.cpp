@@ -2,8 +2,10 @@
 // Licensed under the MIT license.
 
 #include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include "seal/decryptor.h"
+#include "seal/randomtostd.h"
 #include "seal/util/common.h"
 #include "seal/util/uintcore.h"
 #include "seal/util/uintarith.h"
@@ -12,6 +14,7 @@
 #include "seal/util/polycore.h"
 #include "seal/util/polyarithmod.h"
 #include "seal/util/polyarithsmallmod.h"
+#include "seal/util/parallel.h"
 
 using namespace std;
 using namespace seal::util;
@@ -19,7 +22,7 @@ using namespace seal::util;
 namespace seal
 {
     Decryptor::Decryptor(std::shared_ptr<SEALContext> context,
-        const SecretKey &secret_key) : context_(move(context))
+        const SecretKey &secret_key, size_t max_power) : context_(move(context))
     {
         // Verify parameters
         if (!context_)
@@ -45,11 +48,22 @@ namespace seal
         set_poly_poly(secret_key.data().data(), coeff_count, coeff_mod_count, 
             secret_key_.get());
 
+        if (max_power < 1)
+        {
+            throw invalid_argument("max_power must be at least 1");
+        }
+
         // Set the secret_key_array to have size 1 (first power of secret)
-        secret_key_array_ = allocate_poly(coeff_count, coeff_mod_count, pool_);
+        auto secret_key_array(allocate_poly(coeff_count, coeff_mod_count, pool_));
         set_poly_poly(secret_key_.get(), coeff_count, coeff_mod_count, 
-            secret_key_array_.get());
-        secret_key_array_size_ = 1;
+            secret_key_array.get());
+        secret_key_array_.store(secret_key_array.get());
+        secret_key_array_size_.store(1);
+        secret_key_arrays_.emplace_back(move(secret_key_array));
+
+        // Precompute the powers up to max_power so that decryption never needs
+        // to extend the array
+        compute_secret_key_array(max_power);
     }
 
     void Decryptor::decrypt(const Ciphertext &encrypted, Plaintext &destination)
@@ -78,14 +92,214 @@ namespace seal
         }
     }
 
-    void Decryptor::bfv_decrypt(const Ciphertext &encrypted, 
-        Plaintext &destination, MemoryPoolHandle pool)
+    void Decryptor::decrypt(const vector<Ciphertext> &encrypted,
+        vector<Plaintext> &destination, size_t thread_count)
+    {
+        size_t max_power = verify_decrypt(encrypted);
+
+        // Compute the secret key powers once so that the threads only read them
+        compute_secret_key_array(max_power);
+
+        auto scheme = context_->context_data()->parms().scheme();
+        destination.resize(encrypted.size());
+        parallel_for(encrypted.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                // Thread-local pool; it holds secret data
+                auto pool = MemoryPoolHandle::New(true);
+                for (size_t i = begin; i < end; i++)
+                {
+                    if (scheme == scheme_type::BFV)
+                    {
+                        bfv_decrypt(encrypted[i], destination[i], pool);
+                    }
+                    else
+                    {
+                        ckks_decrypt(encrypted[i], destination[i], pool);
+                    }
+                }
+            });
+    }
+
+    void Decryptor::decrypt_decode(const Ciphertext &encrypted,
+        const BatchEncoder &encoder, vector<uint64_t> &destination)
+    {
+        verify_decrypt(encrypted);
+        verify_encoder(encoder.context_);
+        decrypt_decode_internal(encrypted, encoder, destination, pool_);
+    }
+
+    void Decryptor::decrypt_decode(const Ciphertext &encrypted,
+        const BatchEncoder &encoder, vector<int64_t> &destination)
+    {
+        verify_decrypt(encrypted);
+        verify_encoder(encoder.context_);
+        decrypt_decode_internal(encrypted, encoder, destination, pool_);
+    }
+
+    void Decryptor::decrypt_decode(const Ciphertext &encrypted,
+        const CKKSEncoder &encoder, vector<double> &destination)
+    {
+        verify_decrypt(encrypted);
+        verify_encoder(encoder.context_);
+        decrypt_decode_internal(encrypted, encoder, destination, pool_);
+    }
+
+    void Decryptor::decrypt_decode(const Ciphertext &encrypted,
+        const CKKSEncoder &encoder, vector<complex<double>> &destination)
+    {
+        verify_decrypt(encrypted);
+        verify_encoder(encoder.context_);
+        decrypt_decode_internal(encrypted, encoder, destination, pool_);
+    }
+
+    void Decryptor::decrypt_decode(const vector<Ciphertext> &encrypted,
+        const BatchEncoder &encoder, vector<vector<uint64_t>> &destination,
+        size_t thread_count)
     {
-        if (encrypted.is_ntt_form())
+        verify_encoder(encoder.context_);
+        decrypt_decode_batch(encrypted, encoder, destination, thread_count);
+    }
+
+    void Decryptor::decrypt_decode(const vector<Ciphertext> &encrypted,
+        const BatchEncoder &encoder, vector<vector<int64_t>> &destination,
+        size_t thread_count)
+    {
+        verify_encoder(encoder.context_);
+        decrypt_decode_batch(encrypted, encoder, destination, thread_count);
+    }
+
+    void Decryptor::decrypt_decode(const vector<Ciphertext> &encrypted,
+        const CKKSEncoder &encoder, vector<vector<double>> &destination,
+        size_t thread_count)
+    {
+        verify_encoder(encoder.context_);
+        decrypt_decode_batch(encrypted, encoder, destination, thread_count);
+    }
+
+    void Decryptor::decrypt_decode(const vector<Ciphertext> &encrypted,
+        const CKKSEncoder &encoder, vector<vector<complex<double>>> &destination,
+        size_t thread_count)
+    {
+        verify_encoder(encoder.context_);
+        decrypt_decode_batch(encrypted, encoder, destination, thread_count);
+    }
+
+    size_t Decryptor::verify_decrypt(const Ciphertext &encrypted) const
+    {
+        if (!encrypted.is_valid_for(context_))
         {
-            throw invalid_argument("encrypted cannot be in NTT form");
+            throw invalid_argument("encrypted is not valid for encryption parameters");
         }
 
+        auto &parms = context_->context_data()->parms();
+        switch (parms.scheme())
+        {
+        case scheme_type::BFV:
+            // BFV ciphertexts can be in either form
+            break;
+
+        case scheme_type::CKKS:
+            if (!encrypted.is_ntt_form())
+            {
+                throw invalid_argument("encrypted must be in NTT form");
+            }
+            break;
+
+        default:
+            throw invalid_argument("unsupported scheme");
+        }
+        return encrypted.size() - 1;
+    }
+
+    size_t Decryptor::verify_decrypt(const vector<Ciphertext> &encrypted) const
+    {
+        size_t max_power = 1;
+        for (auto &ciphertext : encrypted)
+        {
+            max_power = max(max_power, verify_decrypt(ciphertext));
+        }
+        return max_power;
+    }
+
+    void Decryptor::verify_encoder(
+        const shared_ptr<SEALContext> &encoder_context) const
+    {
+        if (encoder_context->first_parms_id() != context_->first_parms_id())
+        {
+            throw invalid_argument("encoder is not valid for encryption parameters");
+        }
+    }
+
+    template<typename T>
+    void Decryptor::decrypt_decode_internal(const Ciphertext &encrypted,
+        const BatchEncoder &encoder, vector<T> &destination, MemoryPoolHandle pool)
+    {
+        // Decrypt straight into scratch memory and decode it in place
+        size_t coeff_count = context_->context_data()->parms().poly_modulus_degree();
+        auto temp(allocate_uint(coeff_count, pool));
+        bfv_decrypt_poly(encrypted, temp.get(), pool);
+        encoder.decode_poly(temp.get(), destination);
+    }
+
+    template<typename T>
+    void Decryptor::decrypt_decode_internal(const Ciphertext &encrypted,
+        const CKKSEncoder &encoder, vector<T> &destination, MemoryPoolHandle pool)
+    {
+        // Decrypt straight into scratch memory and decode it in place
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        auto temp(allocate_poly(parms.poly_modulus_degree(),
+            parms.coeff_modulus().size(), pool));
+        ckks_decrypt_poly(encrypted, temp.get(), pool);
+        encoder.decode_poly(temp.get(), context_data, encrypted.scale(),
+            destination, pool);
+    }
+
+    template<typename Encoder, typename T>
+    void Decryptor::decrypt_decode_batch(const vector<Ciphertext> &encrypted,
+        const Encoder &encoder, vector<vector<T>> &destination, size_t thread_count)
+    {
+        size_t max_power = verify_decrypt(encrypted);
+
+        // Compute the secret key powers once so that the threads only read them
+        compute_secret_key_array(max_power);
+
+        destination.resize(encrypted.size());
+        parallel_for(encrypted.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                // Thread-local pool; it holds secret data
+                auto pool = MemoryPoolHandle::New(true);
+                for (size_t i = begin; i < end; i++)
+                {
+                    decrypt_decode_internal(encrypted[i], encoder,
+                        destination[i], pool);
+                }
+            });
+    }
+
+    void Decryptor::bfv_decrypt(const Ciphertext &encrypted, 
+        Plaintext &destination, MemoryPoolHandle pool)
+    {
+        size_t coeff_count = context_->context_data()->parms().poly_modulus_degree();
+
+        // Allocate a full size destination to write to
+        auto wide_destination(allocate_uint(coeff_count, pool));
+        bfv_decrypt_poly(encrypted, wide_destination.get(), pool);
+
+        // How many non-zero coefficients do we really have in the result?
+        size_t plain_coeff_count = get_significant_uint64_count_uint(
+            wide_destination.get(), coeff_count);
+
+        // Resize destination to appropriate size
+        destination.resize(max(plain_coeff_count, size_t(1)));
+        destination.parms_id() = parms_id_zero;
+        set_uint_uint(wide_destination.get(), max(plain_coeff_count, size_t(1)),
+            destination.data());
+    }
+
+    void Decryptor::bfv_decrypt_poly(const Ciphertext &encrypted,
+        uint64_t *destination, MemoryPoolHandle pool)
+    {
         auto &context_data = *context_->context_data(encrypted.parms_id());
         auto &parms = context_data.parms();
         auto &coeff_modulus = parms.coeff_modulus();
@@ -98,19 +312,9 @@ namespace seal
 
         auto &small_ntt_tables = context_data.small_ntt_tables();
         auto &base_converter = context_data.base_converter();
-        auto &plain_gamma_product = base_converter->get_plain_gamma_product();
-        auto &plain_gamma_array = base_converter->get_plain_gamma_array();
-        auto &neg_inv_coeff = base_converter->get_neg_inv_coeff();
-        auto inv_gamma = base_converter->get_inv_gamma();
-
-        // The number of uint64 count for plain_modulus and gamma together
-        size_t plain_gamma_uint64_count = 2;
-
-        // Allocate a full size destination to write to
-        auto wide_destination(allocate_uint(coeff_count, pool));
 
         // Make sure we have enough secret key powers computed
-        compute_secret_key_array(encrypted_size - 1);
+        const uint64_t *secret_key_array = compute_secret_key_array(encrypted_size - 1);
 
         /*
         Firstly find c_0 + c_1 *s + ... + c_{count-1} * s^{count-1} mod q
@@ -125,21 +329,26 @@ namespace seal
         // put < (c_1 , c_2, ... , c_{count-1}) , (s,s^2,...,s^{count-1}) > mod q in destination
 
         // Now do the dot product of encrypted_copy and the secret key array using NTT.
-        // The secret key powers are already NTT transformed.
+        // The secret key powers are already NTT transformed. A ciphertext in NTT
+        // form needs no transform, and c_0 is added before the inverse NTT.
+        bool is_ntt_form = encrypted.is_ntt_form();
         auto copy_operand1(allocate_uint(coeff_count, pool));
         for (size_t i = 0; i < coeff_mod_count; i++)
         {
             // Initialize pointers for multiplication
             const uint64_t *current_array1 = encrypted.data(1) + (i * coeff_count);
-            const uint64_t *current_array2 = secret_key_array_.get() + (i * coeff_count);
+            const uint64_t *current_array2 = secret_key_array + (i * coeff_count);
 
             for (size_t j = 0; j < encrypted_size - 1; j++)
             {
                 // Perform the dyadic product.
                 set_uint_uint(current_array1, coeff_count, copy_operand1.get());
 
-                // Lazy reduction
-                ntt_negacyclic_harvey_lazy(copy_operand1.get(), small_ntt_tables[i]);
+                if (!is_ntt_form)
+                {
+                    // Lazy reduction
+                    ntt_negacyclic_harvey_lazy(copy_operand1.get(), small_ntt_tables[i]);
+                }
 
                 dyadic_product_coeffmod(copy_operand1.get(), current_array2, coeff_count,
                     coeff_modulus[i], copy_operand1.get());
@@ -151,13 +360,20 @@ namespace seal
                 current_array2 += first_rns_poly_uint64_count;
             }
 
+            if (is_ntt_form)
+            {
+                add_poly_poly_coeffmod(tmp_dest_modq.get() + (i * coeff_count),
+                    encrypted.data() + (i * coeff_count), coeff_count, coeff_modulus[i],
+                    tmp_dest_modq.get() + (i * coeff_count));
+            }
+
             // Perform inverse NTT
             inverse_ntt_negacyclic_harvey(tmp_dest_modq.get() + (i * coeff_count),
                 small_ntt_tables[i]);
         }
 
         // add c_0 into destination
-        for (size_t i = 0; i < coeff_mod_count; i++)
+        for (size_t i = 0; i < coeff_mod_count && !is_ntt_form; i++)
         {
             //add_poly_poly_coeffmod(tmp_dest_modq.get() + (i * coeff_count),
             //  encrypted.data() + (i * coeff_count), coeff_count, coeff_modulus_[i],
@@ -168,74 +384,42 @@ namespace seal
             {
                 tmp_dest_modq[j + (i * coeff_count)] += encrypted[j + (i * coeff_count)];
             }
-
-            // Compute |gamma * plain|qi * ct(s)
-            multiply_poly_scalar_coeffmod(tmp_dest_modq.get() + (i * coeff_count), coeff_count,
-                plain_gamma_product[i], coeff_modulus[i], tmp_dest_modq.get() + (i * coeff_count));
         }
 
-        // Make another temp destination to get the poly in mod {gamma U plain_modulus}
-        auto tmp_dest_plain_gamma(allocate_poly(coeff_count, plain_gamma_uint64_count, pool));
-
-        // Compute FastBConvert from q to {gamma, plain_modulus}
-        base_converter->fastbconv_plain_gamma(tmp_dest_modq.get(), tmp_dest_plain_gamma.get(), pool);
+        // Scale by t/q and round to get the plaintext
+        base_converter->decrypt_scale_and_round(tmp_dest_modq.get(),
+            destination, pool);
+    }
 
-        // Compute result multiply by coeff_modulus inverse in mod {gamma U plain_modulus}
-        for (size_t i = 0; i < plain_gamma_uint64_count; i++)
+    void Decryptor::ckks_decrypt(const Ciphertext &encrypted, 
+        Plaintext &destination, MemoryPoolHandle pool)
+    {
+        if (!encrypted.is_ntt_form())
         {
-            multiply_poly_scalar_coeffmod(tmp_dest_plain_gamma.get() + (i * coeff_count),
-                coeff_count, neg_inv_coeff[i], plain_gamma_array[i],
-                tmp_dest_plain_gamma.get() + (i * coeff_count));
+            throw invalid_argument("encrypted must be in NTT form");
         }
 
-        // First correct the values which are larger than floor(gamma/2)
-        uint64_t gamma_div_2 = plain_gamma_array[1].value() >> 1;
+        auto &parms = context_->context_data(encrypted.parms_id())->parms();
+        size_t rns_poly_uint64_count = mul_safe(parms.poly_modulus_degree(),
+            parms.coeff_modulus().size());
 
-        // Now compute the subtraction to remove error and perform final multiplication by
-        // gamma inverse mod plain_modulus
-        for (size_t i = 0; i < coeff_count; i++)
-        {
-            // Need correction beacuse of center mod
-            if (tmp_dest_plain_gamma[i + coeff_count] > gamma_div_2)
-            {
-                // Compute -(gamma - a) instead of (a - gamma)
-                tmp_dest_plain_gamma[i + coeff_count] = plain_gamma_array[1].value() -
-                    tmp_dest_plain_gamma[i + coeff_count];
-                tmp_dest_plain_gamma[i + coeff_count] %= plain_gamma_array[0].value();
-                wide_destination[i] = add_uint_uint_mod(tmp_dest_plain_gamma[i],
-                    tmp_dest_plain_gamma[i + coeff_count], plain_gamma_array[0]);
-            }
-            // No correction needed
-            else
-            {
-                tmp_dest_plain_gamma[i + coeff_count] %= plain_gamma_array[0].value();
-                wide_destination[i] = sub_uint_uint_mod(tmp_dest_plain_gamma[i],
-                    tmp_dest_plain_gamma[i + coeff_count], plain_gamma_array[0]);
-            }
-        }
-
-        // How many non-zero coefficients do we really have in the result?
-        size_t plain_coeff_count = get_significant_uint64_count_uint(
-            wide_destination.get(), coeff_count);
+        // Since we overwrite destination, we zeroize destination parameters
+        // This is necessary, otherwise resize will throw an exception.
+        destination.parms_id() = parms_id_zero;
 
         // Resize destination to appropriate size
-        destination.resize(max(plain_coeff_count, size_t(1)));
-        destination.parms_id() = parms_id_zero;
+        destination.resize(rns_poly_uint64_count);
 
-        // Perform final multiplication by gamma inverse mod plain_modulus
-        multiply_poly_scalar_coeffmod(wide_destination.get(), 
-            max(plain_coeff_count, size_t(1)),
-            inv_gamma, plain_gamma_array[0], destination.data());
+        ckks_decrypt_poly(encrypted, destination.data(), pool);
+
+        // Set destination parameters as in encrypted
+        destination.parms_id() = encrypted.parms_id();
+        destination.scale() = encrypted.scale();
     }
 
-    void Decryptor::ckks_decrypt(const Ciphertext &encrypted, 
-        Plaintext &destination, MemoryPoolHandle pool)
+    void Decryptor::ckks_decrypt_poly(const Ciphertext &encrypted,
+        uint64_t *destination, MemoryPoolHandle pool)
     {
-        if (!encrypted.is_ntt_form())
-        {
-            throw invalid_argument("encrypted must be in NTT form");
-        }
-
         // We already know that the parameters are valid
         auto &context_data = *context_->context_data(encrypted.parms_id());
         auto &parms = context_data.parms();
@@ -248,7 +432,7 @@ namespace seal
         size_t encrypted_size = encrypted.size();
 
         // Make sure we have enough secret key powers computed
-        compute_secret_key_array(encrypted_size - 1);
+        const uint64_t *secret_key_array = compute_secret_key_array(encrypted_size - 1);
 
         /*
         Decryption consists in finding c_0 + c_1 *s + ... + c_{count-1} * s^{count-1} mod q_1 * q_2 * q_3
@@ -256,13 +440,6 @@ namespace seal
         This is equal to m + v where ||v|| is small enough.
         */
 
-        // Since we overwrite destination, we zeroize destination parameters
-        // This is necessary, otherwise resize will throw an exception.
-        destination.parms_id() = parms_id_zero;
-
-        // Resize destination to appropriate size
-        destination.resize(rns_poly_uint64_count);
-
         // Make a temp destination for all the arithmetic mod q1, q2, q3
         //auto tmp_dest_modq(allocate_zero_poly(coeff_count, decryption_coeff_mod_count, pool));
 
@@ -278,9 +455,9 @@ namespace seal
             // c_1 mod qi
             const uint64_t *current_array1 = encrypted.data(1) + (i * coeff_count);
             // s mod qi
-            const uint64_t *current_array2 = secret_key_array_.get() + (i * coeff_count);
+            const uint64_t *current_array2 = secret_key_array + (i * coeff_count);
             // set destination coefficients to zero modulo q_i
-            set_zero_uint(coeff_count, destination.data() + (i * coeff_count));
+            set_zero_uint(coeff_count, destination + (i * coeff_count));
 
             for (size_t j = 0; j < encrypted_size - 1; j++)
             {
@@ -291,9 +468,9 @@ namespace seal
                 //ntt_negacyclic_harvey_lazy(copy_operand1.get(), small_ntt_tables[i]);
                 dyadic_product_coeffmod(copy_operand1.get(), current_array2, coeff_count,
                     coeff_modulus[i], copy_operand1.get());
-                add_poly_poly_coeffmod(destination.data() + (i * coeff_count),
+                add_poly_poly_coeffmod(destination + (i * coeff_count),
                     copy_operand1.get(), coeff_count, coeff_modulus[i],
-                    destination.data() + (i * coeff_count));
+                    destination + (i * coeff_count));
 
                 // go to c_{1+j+1} and s^{1+j+1} mod qi
                 current_array1 += rns_poly_uint64_count;
@@ -301,18 +478,162 @@ namespace seal
             }
 
             // add c_0 into destination
-            add_poly_poly_coeffmod(destination.data() + (i * coeff_count),
+            add_poly_poly_coeffmod(destination + (i * coeff_count),
                 encrypted.data() + (i * coeff_count), coeff_count,
-                coeff_modulus[i], destination.data() + (i * coeff_count));
+                coeff_modulus[i], destination + (i * coeff_count));
+        }
+    }
+
+    void Decryptor::partial_decrypt(const Ciphertext &encrypted,
+        Plaintext &destination, int smudging_bit_count)
+    {
+        if (smudging_bit_count < 0 || smudging_bit_count > 60)
+        {
+            throw invalid_argument("smudging_bit_count is out of bounds");
+        }
+        verify_partial_decrypt(encrypted);
+
+        auto &parms = context_->context_data()->parms();
+        shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
+        partial_decrypt_internal(encrypted, destination, smudging_bit_count,
+            move(random), pool_);
+    }
+
+    void Decryptor::partial_decrypt(const vector<Ciphertext> &encrypted,
+        vector<Plaintext> &destination, int smudging_bit_count, size_t thread_count)
+    {
+        if (smudging_bit_count < 0 || smudging_bit_count > 60)
+        {
+            throw invalid_argument("smudging_bit_count is out of bounds");
+        }
+        for (auto &ciphertext : encrypted)
+        {
+            verify_partial_decrypt(ciphertext);
+        }
+
+        auto &parms = context_->context_data()->parms();
+        destination.resize(encrypted.size());
+        parallel_for(encrypted.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                // Thread-local pool and generator; the pool holds secret data
+                auto pool = MemoryPoolHandle::New(true);
+                shared_ptr<UniformRandomGenerator> random(
+                    parms.random_generator()->create());
+                for (size_t i = begin; i < end; i++)
+                {
+                    partial_decrypt_internal(encrypted[i], destination[i],
+                        smudging_bit_count, random, pool);
+                }
+            });
+    }
+
+    void Decryptor::verify_partial_decrypt(const Ciphertext &encrypted) const
+    {
+        if (!encrypted.is_valid_for(context_))
+        {
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+        if (encrypted.size() != 2)
+        {
+            throw invalid_argument("encrypted must have size 2");
+        }
+
+        auto &parms = context_->context_data()->parms();
+        switch (parms.scheme())
+        {
+        case scheme_type::BFV:
+            // BFV ciphertexts can be in either form
+            break;
+
+        case scheme_type::CKKS:
+            if (!encrypted.is_ntt_form())
+            {
+                throw invalid_argument("encrypted must be in NTT form");
+            }
+            break;
+
+        default:
+            throw invalid_argument("unsupported scheme");
+        }
+    }
+
+    void Decryptor::partial_decrypt_internal(const Ciphertext &encrypted,
+        Plaintext &destination, int smudging_bit_count,
+        shared_ptr<UniformRandomGenerator> random, MemoryPoolHandle pool)
+    {
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        size_t rns_poly_uint64_count = mul_safe(coeff_count, coeff_mod_count);
+        auto &small_ntt_tables = context_data.small_ntt_tables();
+        bool transform_c1 = !encrypted.is_ntt_form();
+
+        // Sample the smudging noise and transform it to NTT form
+        auto noise(allocate_poly(coeff_count, coeff_mod_count, pool));
+        set_poly_coeffs_smudging(context_data, noise.get(), smudging_bit_count,
+            random);
+        for (size_t i = 0; i < coeff_mod_count; i++)
+        {
+            ntt_negacyclic_harvey(noise.get() + (i * coeff_count),
+                small_ntt_tables[i]);
+        }
+
+        // Since we overwrite destination, we zeroize destination parameters
+        // This is necessary, otherwise resize will throw an exception.
+        destination.parms_id() = parms_id_zero;
+        destination.resize(rns_poly_uint64_count);
+
+        // Compute c_1 * s_i + e in NTT form. The secret key is already NTT
+        // transformed, and its first coeff_mod_count components are the ones
+        // needed at the level of encrypted.
+        for (size_t i = 0; i < coeff_mod_count; i++)
+        {
+            uint64_t *share = destination.data() + (i * coeff_count);
+            set_uint_uint(encrypted.data(1) + (i * coeff_count), coeff_count, share);
+            if (transform_c1)
+            {
+                // Lazy reduction
+                ntt_negacyclic_harvey_lazy(share, small_ntt_tables[i]);
+            }
+            dyadic_product_coeffmod(share, secret_key_.get() + (i * coeff_count),
+                coeff_count, coeff_modulus[i], share);
+            add_poly_poly_coeffmod(share, noise.get() + (i * coeff_count),
+                coeff_count, coeff_modulus[i], share);
         }
 
-        // Set destination parameters as in encrypted
-        //destination.parms_id() = last_parms_id;
         destination.parms_id() = encrypted.parms_id();
         destination.scale() = encrypted.scale();
     }
 
-    void Decryptor::compute_secret_key_array(size_t max_power)
+    void Decryptor::set_poly_coeffs_smudging(
+        const SEALContext::ContextData &context_data, uint64_t *poly,
+        int smudging_bit_count, shared_ptr<UniformRandomGenerator> random) const
+    {
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+
+        // Magnitude below 2^smudging_bit_count and a random sign
+        RandomToStandardAdapter engine(random);
+        uint64_t mask = (uint64_t(1) << smudging_bit_count) - 1;
+        for (size_t i = 0; i < coeff_count; i++)
+        {
+            uint64_t magnitude = ((static_cast<uint64_t>(engine()) << 32) +
+                static_cast<uint64_t>(engine())) & mask;
+            bool negative = engine() & 1;
+            for (size_t j = 0; j < coeff_mod_count; j++)
+            {
+                uint64_t value = magnitude % coeff_modulus[j].value();
+                poly[i + (j * coeff_count)] = (negative && value) ?
+                    coeff_modulus[j].value() - value : value;
+            }
+        }
+    }
+
+    const uint64_t *Decryptor::compute_secret_key_array(size_t max_power)
     {
 #ifdef SEAL_DEBUG
         if (max_power < 1)
@@ -320,6 +641,25 @@ namespace seal
             throw invalid_argument("max_power must be at least 1");
         }
 #endif
+        // Readers only load the size and the array. The size is stored after the
+        // array it belongs to, and arrays are never released before the
+        // Decryptor, so an array loaded after a large enough size has at least
+        // that many powers.
+        if (max_power <= secret_key_array_size_.load(memory_order_acquire))
+        {
+            return secret_key_array_.load(memory_order_acquire);
+        }
+
+        // Need to extend the array; writers are serialized
+        lock_guard<mutex> lock(secret_key_arrays_mutex_);
+        size_t old_size = secret_key_array_size_.load(memory_order_relaxed);
+        const uint64_t *old_secret_key_array = secret_key_array_.load(
+            memory_order_relaxed);
+        if (max_power <= old_size)
+        {
+            return old_secret_key_array;
+        }
+
         // WARNING: This function must be called with the original context_data
         auto &context_data = *context_->context_data();
         auto &parms = context_data.parms();
@@ -327,24 +667,12 @@ namespace seal
         size_t coeff_count = parms.poly_modulus_degree();
         size_t coeff_mod_count = coeff_modulus.size();
         size_t rns_poly_uint64_count = mul_safe(coeff_count, coeff_mod_count);
+        size_t new_size = max_power;
 
-        ReaderLock reader_lock(secret_key_array_locker_.acquire_read());
-
-        size_t old_size = secret_key_array_size_;
-        size_t new_size = max(max_power, old_size);
-
-        if (old_size == new_size)
-        {
-            return;
-        }
-
-        reader_lock.unlock();
-
-        // Need to extend the array
         // Compute powers of secret key until max_power
         auto new_secret_key_array(allocate_poly(mul_safe(new_size, coeff_count),
             coeff_mod_count, pool_));
-        set_poly_poly(secret_key_array_.get(), mul_safe(old_size, coeff_count), 
+        set_poly_poly(old_secret_key_array, mul_safe(old_size, coeff_count), 
             coeff_mod_count, new_secret_key_array.get());
 
         uint64_t *prev_poly_ptr = new_secret_key_array.get() +
@@ -367,78 +695,47 @@ namespace seal
             next_poly_ptr += rns_poly_uint64_count;
         }
 
-
-        // Take writer lock to update array
-        WriterLock writer_lock(secret_key_array_locker_.acquire_write());
-
-        // Do we still need to update size?
-        old_size = secret_key_array_size_;
-        new_size = max(max_power, secret_key_array_size_);
-
-        if (old_size == new_size)
-        {
-            return;
-        }
-
-        // Acquire new array
-        secret_key_array_size_ = new_size;
-        secret_key_array_.acquire(new_secret_key_array);
+        // Publish the new array; readers may still be using the old ones
+        const uint64_t *new_secret_key_array_ptr = new_secret_key_array.get();
+        secret_key_arrays_.emplace_back(move(new_secret_key_array));
+        secret_key_array_.store(new_secret_key_array_ptr, memory_order_release);
+        secret_key_array_size_.store(new_size, memory_order_release);
+        return new_secret_key_array_ptr;
     }
 
-    void Decryptor::compose(
-        const SEALContext::ContextData &context_data, uint64_t *value)
+    int Decryptor::invariant_noise_budget(const Ciphertext &encrypted)
     {
-#ifdef SEAL_DEBUG
-        if (value == nullptr)
-        {
-            throw invalid_argument("input cannot be null");
-        }
-#endif
-        auto &parms = context_data.parms();
-        auto &coeff_modulus = parms.coeff_modulus();
-        size_t coeff_count = parms.poly_modulus_degree();
-        size_t coeff_mod_count = coeff_modulus.size();
-        size_t rns_poly_uint64_count = mul_safe(coeff_count, coeff_mod_count);
-
-        auto &base_converter = context_data.base_converter();
-        auto coeff_products_array = base_converter->get_coeff_products_array();
-        auto &inv_coeff_mod_coeff_array = base_converter->get_inv_coeff_mod_coeff_array();
-
-        // Set temporary coefficients_ptr pointer to point to either an existing
-        // allocation given as parameter, or else to a new allocation from the memory pool.
-        auto coefficients(allocate_uint(rns_poly_uint64_count, pool_));
-        uint64_t *coefficients_ptr = coefficients.get();
+        verify_invariant_noise_budget(encrypted);
+        return invariant_noise_budget_internal(encrypted, pool_);
+    }
 
-        // Re-merge the coefficients first
-        for (size_t i = 0; i < coeff_count; i++)
+    void Decryptor::invariant_noise_budget(const vector<Ciphertext> &encrypted,
+        vector<int> &destination, size_t thread_count)
+    {
+        size_t max_power = 1;
+        for (auto &ciphertext : encrypted)
         {
-            for (size_t j = 0; j < coeff_mod_count; j++)
-            {
-                coefficients_ptr[j + (i * coeff_mod_count)] = value[(j * coeff_count) + i];
-            }
+            verify_invariant_noise_budget(ciphertext);
+            max_power = max(max_power, ciphertext.size() - 1);
         }
 
-        auto temp(allocate_uint(coeff_mod_count, pool_));
-        set_zero_uint(rns_poly_uint64_count, value);
-
-        for (size_t i = 0; i < coeff_count; i++)
-        {
-            for (size_t j = 0; j < coeff_mod_count; j++)
-            {
-                uint64_t tmp = multiply_uint_uint_mod(coefficients_ptr[j],
-                    inv_coeff_mod_coeff_array[j], coeff_modulus[j]);
-                multiply_uint_uint64(coeff_products_array + (j * coeff_mod_count),
-                    coeff_mod_count, tmp, coeff_mod_count, temp.get());
-                add_uint_uint_mod(temp.get(), value + (i * coeff_mod_count),
-                    context_data.total_coeff_modulus(), 
-                    coeff_mod_count, value + (i * coeff_mod_count));
-            }
-            set_zero_uint(coeff_mod_count, temp.get());
-            coefficients_ptr += coeff_mod_count;
-        }
+        // Compute the secret key powers once so that the threads only read them
+        compute_secret_key_array(max_power);
+
+        destination.resize(encrypted.size());
+        parallel_for(encrypted.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                // Thread-local pool; it holds secret data
+                auto pool = MemoryPoolHandle::New(true);
+                for (size_t i = begin; i < end; i++)
+                {
+                    destination[i] = invariant_noise_budget_internal(
+                        encrypted[i], pool);
+                }
+            });
     }
 
-    int Decryptor::invariant_noise_budget(const Ciphertext &encrypted)
+    void Decryptor::verify_invariant_noise_budget(const Ciphertext &encrypted) const
     {
         // Verify that encrypted is valid.
         if (!encrypted.is_valid_for(context_))
@@ -450,62 +747,59 @@ namespace seal
         {
             throw logic_error("unsupported scheme");
         }
-        if (encrypted.is_ntt_form())
-        {
-            throw invalid_argument("encrypted cannot be in NTT form");
-        }
+    }
 
+    int Decryptor::invariant_noise_budget_internal(const Ciphertext &encrypted,
+        MemoryPoolHandle pool)
+    {
         auto &context_data = *context_->context_data(encrypted.parms_id());
         auto &parms = context_data.parms();
         auto &coeff_modulus = parms.coeff_modulus();
         size_t coeff_count = parms.poly_modulus_degree();
         size_t coeff_mod_count = coeff_modulus.size();
         size_t rns_poly_uint64_count = mul_safe(coeff_count, coeff_mod_count);
+        size_t first_rns_poly_uint64_count = mul_safe(coeff_count,
+            context_->context_data()->parms().coeff_modulus().size());
         size_t encrypted_size = encrypted.size();
         uint64_t plain_modulus = parms.plain_modulus().value();
 
         auto &small_ntt_tables = context_data.small_ntt_tables();
 
-        // Storage for noise uint
-        auto destination(allocate_uint(coeff_mod_count, pool_));
+        // Make sure we have enough secret key powers computed
+        const uint64_t *secret_key_array = compute_secret_key_array(encrypted_size - 1);
 
         // Storage for noise poly
-        auto noise_poly(allocate_zero_poly(coeff_count, coeff_mod_count, pool_));
+        auto noise_poly(allocate_zero_poly(coeff_count, coeff_mod_count, pool));
 
         // Now need to compute c(s) - Delta*m (mod q)
 
-        // Make sure we have enough secret keys computed
-        compute_secret_key_array(encrypted_size - 1);
-
         /*
         Firstly find c_0 + c_1 *s + ... + c_{count-1} * s^{count-1} mod q
         This is equal to Delta m + v where ||v|| < Delta/2.
         */
         // put < (c_1 , c_2, ... , c_{count-1}) , (s,s^2,...,s^{count-1}) > mod q
         // in destination_poly.
-        // Make a copy of the encryption for NTT (except the first polynomial is 
-        // not needed).
-        auto encrypted_copy(allocate_poly(
-            mul_safe(encrypted_size - 1, coeff_count), coeff_mod_count, pool_));
-        set_poly_poly(encrypted.data(1), mul_safe(encrypted_size - 1, coeff_count),
-            coeff_mod_count, encrypted_copy.get());
-
-        // Now do the dot product of encrypted_copy and the secret key array using NTT.
-        // The secret key powers are already NTT transformed.
-        auto copy_operand1(allocate_uint(coeff_count, pool_));
+        // Now do the dot product of encrypted and the secret key array using NTT.
+        // The secret key powers are already NTT transformed. A ciphertext in NTT
+        // form needs no transform, and c_0 is added before the inverse NTT.
+        bool is_ntt_form = encrypted.is_ntt_form();
+        auto copy_operand1(allocate_uint(coeff_count, pool));
         for (size_t i = 0; i < coeff_mod_count; i++)
         {
             // Initialize pointers for multiplication
             const uint64_t *current_array1 = encrypted.data(1) + (i * coeff_count);
-            const uint64_t *current_array2 = secret_key_array_.get() + (i * coeff_count);
+            const uint64_t *current_array2 = secret_key_array + (i * coeff_count);
 
             for (size_t j = 0; j < encrypted_size - 1; j++)
             {
                 // Perform the dyadic product.
                 set_uint_uint(current_array1, coeff_count, copy_operand1.get());
 
-                // Lazy reduction
-                ntt_negacyclic_harvey_lazy(copy_operand1.get(), small_ntt_tables[i]);
+                if (!is_ntt_form)
+                {
+                    // Lazy reduction
+                    ntt_negacyclic_harvey_lazy(copy_operand1.get(), small_ntt_tables[i]);
+                }
 
                 dyadic_product_coeffmod(copy_operand1.get(), current_array2, coeff_count,
                     coeff_modulus[i], copy_operand1.get());
@@ -515,7 +809,15 @@ namespace seal
                     noise_poly.get() + (i * coeff_count));
 
                 current_array1 += rns_poly_uint64_count;
-                current_array2 += rns_poly_uint64_count;
+                current_array2 += first_rns_poly_uint64_count;
+            }
+
+            // add c_0 into noise_poly, in NTT form if encrypted is
+            if (is_ntt_form)
+            {
+                add_poly_poly_coeffmod(noise_poly.get() + (i * coeff_count),
+                    encrypted.data() + (i * coeff_count), coeff_count, coeff_modulus[i],
+                    noise_poly.get() + (i * coeff_count));
             }
 
             // Perform inverse NTT
@@ -526,9 +828,12 @@ namespace seal
         for (size_t i = 0; i < coeff_mod_count; i++)
         {
             // add c_0 into noise_poly
-            add_poly_poly_coeffmod(noise_poly.get() + (i * coeff_count),
-                encrypted.data() + (i * coeff_count), coeff_count, coeff_modulus[i],
-                noise_poly.get() + (i * coeff_count));
+            if (!is_ntt_form)
+            {
+                add_poly_poly_coeffmod(noise_poly.get() + (i * coeff_count),
+                    encrypted.data() + (i * coeff_count), coeff_count, coeff_modulus[i],
+                    noise_poly.get() + (i * coeff_count));
+            }
 
             // Multiply by parms.plain_modulus() and reduce mod parms.coeff_modulus() to get
             // parms.coeff_modulus()*noise
@@ -537,16 +842,205 @@ namespace seal
                 noise_poly.get() + (i * coeff_count));
         }
 
-        // Compose the noise
-        compose(context_data, noise_poly.get());
-
-        // Next we compute the infinity norm mod parms.coeff_modulus()
-        poly_infty_norm_coeffmod(noise_poly.get(), coeff_count, coeff_mod_count,
-            context_data.total_coeff_modulus(), destination.get(), pool_);
-
         // The -1 accounts for scaling the invariant noise by 2
         int bit_count_diff = context_data.total_coeff_modulus_bit_count() -
-            get_significant_bit_count_uint(destination.get(), coeff_mod_count) - 1;
+            infty_norm_bit_count(context_data, noise_poly.get(), pool) - 1;
         return max(0, bit_count_diff);
     }
+
+    int Decryptor::infty_norm_bit_count(const SEALContext::ContextData &context_data,
+        const uint64_t *poly, MemoryPoolHandle pool) const
+    {
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        int total_bit_count = context_data.total_coeff_modulus_bit_count();
+        auto total_coeff_modulus = context_data.total_coeff_modulus();
+
+        auto &base_converter = context_data.base_converter();
+        auto coeff_products_array = base_converter->get_coeff_products_array();
+        auto &inv_coeff_mod_coeff_array = base_converter->get_inv_coeff_mod_coeff_array();
+
+        /*
+        Write q = q_1 * ... * q_k and y_j = [x_j * (q/q_j)^(-1)]_{q_j}. The centered
+        representative of x is then x = sum_j y_j * (q/q_j) - v * q, where v is
+        sum_j y_j / q_j rounded to the nearest integer, and x / q is the centered
+        fractional part of sum_j y_j / q_j.
+
+        We first compute x / q for every coefficient in double precision. Each of
+        the k terms y_j / q_j has an absolute error of at most 3 * 2^(-53), and
+        each of the k additions at most k * 2^(-53); error_bound below is twice
+        that, which also covers rounding the bounds themselves. From the maximum
+        M of the absolute values we get bounds (M - error_bound) * q and
+        (M + error_bound) * q on the infinity norm; when both have the same bit
+        count it is the result. This is the case for all but very small noise.
+
+        Otherwise we reconstruct x modulo 2^(64 * w) using single precision
+        arithmetic on w words. If the upper bound is meaningful, w is chosen to
+        hold it. If not, we start from w = 1: a result that is congruent to x_j
+        modulo every q_j and smaller in absolute value than 2^(64 * w - 1) <= q / 2
+        must be x, because the difference is a multiple of q smaller than q. If
+        the check fails for some coefficient, w is doubled; once 64 * w exceeds
+        the bit count of q no check is needed.
+        */
+        size_t full_uint64_count = static_cast<size_t>(total_bit_count) / bits_per_uint64 + 1;
+        double error_bound = ldexp(static_cast<double>(coeff_mod_count) *
+            static_cast<double>(coeff_mod_count + 3), -52);
+
+        // First pass: compute y_j and find the maximal |x| / q
+        auto y_poly(allocate_poly(coeff_count, coeff_mod_count, pool));
+        vector<double> inv_moduli(coeff_mod_count);
+        for (size_t j = 0; j < coeff_mod_count; j++)
+        {
+            inv_moduli[j] = 1.0 / static_cast<double>(coeff_modulus[j].value());
+            multiply_poly_scalar_coeffmod(poly + (j * coeff_count), coeff_count,
+                inv_coeff_mod_coeff_array[j], coeff_modulus[j],
+                y_poly.get() + (j * coeff_count));
+        }
+        auto frac_sum = [&](size_t i) {
+            double sum = 0;
+            for (size_t j = 0; j < coeff_mod_count; j++)
+            {
+                sum += static_cast<double>(y_poly[i + (j * coeff_count)]) * inv_moduli[j];
+            }
+            return sum;
+        };
+        double max_frac = 0;
+        for (size_t i = 0; i < coeff_count; i++)
+        {
+            double sum = frac_sum(i);
+            max_frac = max(max_frac, fabs(sum - floor(sum + 0.5)));
+        }
+
+        // Bit count of floor(value * q) for 0 <= value < 1, with value
+        // truncated to 64 bits of fixed point
+        size_t product_uint64_count = coeff_mod_count + 1;
+        auto product(allocate_uint(product_uint64_count, pool));
+        auto scaled_bit_count = [&](double value) {
+            uint64_t fixed = static_cast<uint64_t>(ldexp(value, bits_per_uint64));
+            multiply_uint_uint64(total_coeff_modulus, coeff_mod_count, fixed,
+                product_uint64_count, product.get());
+            return max(0, get_significant_bit_count_uint(product.get(),
+                product_uint64_count) - bits_per_uint64);
+        };
+
+        double upper_frac = min(max_frac + error_bound, 0.75);
+        int upper_bit_count = scaled_bit_count(upper_frac);
+        if (max_frac > error_bound &&
+            scaled_bit_count(max_frac - error_bound) == upper_bit_count)
+        {
+            return upper_bit_count;
+        }
+
+        // Second pass: exact reconstruction modulo 2^(64 * exact_uint64_count).
+        // If the bound on the norm is below q / 4, rounding sum_j y_j / q_j
+        // cannot go wrong and the bound alone shows when no check is needed.
+        bool bound_is_small = upper_frac < 0.25;
+        auto max_value(allocate_uint(full_uint64_count, pool));
+        auto value(allocate_uint(full_uint64_count, pool));
+        auto temp(allocate_uint(full_uint64_count + 1, pool));
+        auto exact_products(allocate_uint(
+            mul_safe(coeff_mod_count, full_uint64_count), pool));
+        auto exact_modulus(allocate_uint(full_uint64_count, pool));
+        // Unless the noise is so small that the bound says nothing about it,
+        // start with enough words to hold the bound
+        size_t start_uint64_count = 1;
+        if (bound_is_small && max_frac > error_bound)
+        {
+            start_uint64_count = static_cast<size_t>(upper_bit_count) / bits_per_uint64 + 1;
+        }
+        for (size_t exact_uint64_count = start_uint64_count; ;
+            exact_uint64_count *= 2)
+        {
+            exact_uint64_count = min(exact_uint64_count, full_uint64_count);
+            int exact_bit_count = static_cast<int>(
+                mul_safe(exact_uint64_count, static_cast<size_t>(bits_per_uint64)));
+            bool is_full = exact_uint64_count == full_uint64_count;
+            bool check = !is_full &&
+                !(bound_is_small && upper_bit_count < exact_bit_count);
+            if (check && exact_bit_count >= total_bit_count)
+            {
+                // The check is only conclusive for 2^(64 * w - 1) <= q / 2
+                continue;
+            }
+
+            // The products q/q_j and q reduced modulo 2^(64 * exact_uint64_count)
+            size_t copy_uint64_count = min(coeff_mod_count, exact_uint64_count);
+            for (size_t j = 0; j < coeff_mod_count; j++)
+            {
+                uint64_t *exact_product = exact_products.get() + (j * exact_uint64_count);
+                set_uint_uint(coeff_products_array + (j * coeff_mod_count),
+                    copy_uint64_count, exact_uint64_count, exact_product);
+            }
+            set_uint_uint(total_coeff_modulus, copy_uint64_count,
+                exact_uint64_count, exact_modulus.get());
+
+            set_zero_uint(exact_uint64_count, max_value.get());
+            bool success = true;
+            for (size_t i = 0; i < coeff_count && success; i++)
+            {
+                set_zero_uint(exact_uint64_count, value.get());
+                for (size_t j = 0; j < coeff_mod_count; j++)
+                {
+                    multiply_uint_uint64(exact_products.get() + (j * exact_uint64_count),
+                        exact_uint64_count, y_poly[i + (j * coeff_count)],
+                        exact_uint64_count, temp.get());
+                    add_uint_uint(value.get(), temp.get(), exact_uint64_count,
+                        value.get());
+                }
+
+                // Subtract v * q
+                double sum = frac_sum(i);
+                uint64_t v = static_cast<uint64_t>(floor(sum + 0.5));
+                multiply_uint_uint64(exact_modulus.get(), exact_uint64_count, v,
+                    exact_uint64_count, temp.get());
+                sub_uint_uint(value.get(), temp.get(), exact_uint64_count, value.get());
+                bool is_negative = is_high_bit_set_uint(value.get(), exact_uint64_count);
+                if (is_negative)
+                {
+                    negate_uint(value.get(), exact_uint64_count, value.get());
+                }
+
+                if (is_full)
+                {
+                    // Near q / 2 the rounding of v may be off by one, giving
+                    // x +- q instead of x; both are smaller than q in absolute
+                    // value and the centered representative is the smaller of
+                    // |value| and q - |value|
+                    sub_uint_uint(exact_modulus.get(), value.get(),
+                        exact_uint64_count, temp.get());
+                    if (is_less_than_uint_uint(temp.get(), value.get(), exact_uint64_count))
+                    {
+                        set_uint_uint(temp.get(), exact_uint64_count, value.get());
+                    }
+                }
+                else if (check)
+                {
+                    success = !is_high_bit_set_uint(value.get(), exact_uint64_count);
+                    for (size_t j = 0; j < coeff_mod_count && success; j++)
+                    {
+                        // Reduce with Barrett reduction also in the one word case
+                        set_uint_uint(value.get(), exact_uint64_count,
+                            exact_uint64_count + 1, temp.get());
+                        modulo_uint_inplace(temp.get(), exact_uint64_count + 1,
+                            coeff_modulus[j]);
+                        uint64_t residue = is_negative ?
+                            negate_uint_mod(temp[0], coeff_modulus[j]) : temp[0];
+                        success = residue == poly[i + (j * coeff_count)];
+                    }
+                }
+
+                if (is_greater_than_uint_uint(value.get(), max_value.get(),
+                    exact_uint64_count))
+                {
+                    set_uint_uint(value.get(), exact_uint64_count, max_value.get());
+                }
+            }
+            if (success)
+            {
+                return get_significant_bit_count_uint(max_value.get(), exact_uint64_count);
+            }
+        }
+    }
 }
@@ -3,7 +3,12 @@
 
 #pragma once
 
+#include <cstddef>
+#include <atomic>
+#include <complex>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "seal/randomgen.h"
 #include "seal/encryptionparams.h"
 #include "seal/context.h"
@@ -12,9 +17,10 @@
 #include "seal/ciphertext.h"
 #include "seal/plaintext.h"
 #include "seal/secretkey.h"
+#include "seal/batchencoder.h"
+#include "seal/ckks.h"
 #include "seal/util/baseconverter.h"
 #include "seal/smallmodulus.h"
-#include "seal/util/locks.h"
 
 namespace seal
 {
@@ -42,24 +48,30 @@ namespace seal
     should remain by default in the usual coefficient representation, i.e. not in 
     NTT form. When using the CKKS scheme (scheme_type::CKKS), all plaintexts and 
     ciphertexts should remain by default in NTT form. We call these scheme-specific 
-    NTT states the "default NTT form". Decryption requires the input ciphertexts 
-    to be in the default NTT form, and will throw an exception if this is not the 
-    case.
+    NTT states the "default NTT form". Decryption requires CKKS ciphertexts to be 
+    in the default NTT form, and will throw an exception if this is not the case. 
+    BFV ciphertexts can be decrypted in either form.
     */
     class Decryptor
     {
     public:
         /**
         Creates a Decryptor instance initialized with the specified SEALContext 
-        and secret key.
+        and secret key. The powers of the secret key up to max_power are computed
+        here; ciphertexts of size up to max_power + 1 can then be decrypted
+        without ever extending the powers. Larger ciphertexts extend them on
+        demand, which serializes only the threads doing the extension.
 
         @param[in] context The SEALContext
         @param[in] secret_key The secret key
+        @param[in] max_power The highest power of the secret key to precompute
         @throws std::invalid_argument if the context is not set or encryption
         parameters are not valid
         @throws std::invalid_argument if secret_key is not valid
+        @throws std::invalid_argument if max_power is zero
         */
-        Decryptor(std::shared_ptr<SEALContext> context, const SecretKey &secret_key);
+        Decryptor(std::shared_ptr<SEALContext> context, const SecretKey &secret_key,
+            std::size_t max_power = 1);
 
         /*
         Decrypts a Ciphertext and stores the result in the destination parameter. 
@@ -71,6 +83,190 @@ namespace seal
         */
         void decrypt(const Ciphertext &encrypted, Plaintext &destination);
 
+        /**
+        Decrypts a batch of ciphertexts and stores the results in destination,
+        which is resized to the number of ciphertexts. The secret key powers are
+        computed once for the whole batch, and the batch is split among
+        thread_count threads, each of which uses its own memory pool. A
+        thread_count of zero uses one thread per hardware thread.
+
+        @param[in] encrypted The ciphertexts to decrypt
+        @param[out] destination The plaintexts to overwrite with the decrypted
+        ciphertexts
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters or not in the default NTT form
+        */
+        void decrypt(const std::vector<Ciphertext> &encrypted,
+            std::vector<Plaintext> &destination, std::size_t thread_count = 0);
+
+        /**
+        Decrypts a ciphertext and decodes the result with the given BatchEncoder.
+        This is equivalent to calling decrypt followed by BatchEncoder::decode,
+        but the intermediate plaintext is never materialized: the decryption is
+        written to scratch memory and decoded in place.
+
+        @param[in] encrypted The ciphertext to decrypt
+        @param[in] encoder The BatchEncoder to decode with
+        @param[out] destination The matrix to be overwritten with the values in
+        the slots
+        @throws std::invalid_argument if encrypted is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if encrypted is not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        */
+        void decrypt_decode(const Ciphertext &encrypted,
+            const BatchEncoder &encoder, std::vector<std::uint64_t> &destination);
+
+        /**
+        Decrypts a ciphertext and decodes the result with the given BatchEncoder
+        into signed integers. This is equivalent to calling decrypt followed by
+        BatchEncoder::decode, but the intermediate plaintext is never
+        materialized.
+
+        @param[in] encrypted The ciphertext to decrypt
+        @param[in] encoder The BatchEncoder to decode with
+        @param[out] destination The matrix to be overwritten with the values in
+        the slots
+        @throws std::invalid_argument if encrypted is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if encrypted is not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        */
+        void decrypt_decode(const Ciphertext &encrypted,
+            const BatchEncoder &encoder, std::vector<std::int64_t> &destination);
+
+        /**
+        Decrypts a ciphertext and decodes the result with the given CKKSEncoder
+        into real numbers. This is equivalent to calling decrypt followed by
+        CKKSEncoder::decode, but the intermediate plaintext is never
+        materialized.
+
+        @param[in] encrypted The ciphertext to decrypt
+        @param[in] encoder The CKKSEncoder to decode with
+        @param[out] destination The vector to be overwritten with the values in
+        the slots
+        @throws std::invalid_argument if encrypted is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if encrypted is not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        @throws std::invalid_argument if the scale of encrypted is out of bounds
+        */
+        void decrypt_decode(const Ciphertext &encrypted,
+            const CKKSEncoder &encoder, std::vector<double> &destination);
+
+        /**
+        Decrypts a ciphertext and decodes the result with the given CKKSEncoder
+        into complex numbers. This is equivalent to calling decrypt followed by
+        CKKSEncoder::decode, but the intermediate plaintext is never
+        materialized.
+
+        @param[in] encrypted The ciphertext to decrypt
+        @param[in] encoder The CKKSEncoder to decode with
+        @param[out] destination The vector to be overwritten with the values in
+        the slots
+        @throws std::invalid_argument if encrypted is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if encrypted is not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        @throws std::invalid_argument if the scale of encrypted is out of bounds
+        */
+        void decrypt_decode(const Ciphertext &encrypted,
+            const CKKSEncoder &encoder,
+            std::vector<std::complex<double>> &destination);
+
+        /**
+        Decrypts and decodes a batch of ciphertexts with the given BatchEncoder.
+        The secret key powers are computed once for the whole batch, and the
+        batch is split among thread_count threads, each of which uses its own
+        memory pool for scratch memory. A thread_count of zero uses one thread
+        per hardware thread.
+
+        @param[in] encrypted The ciphertexts to decrypt
+        @param[in] encoder The BatchEncoder to decode with
+        @param[out] destination The matrices to be overwritten with the values in
+        the slots
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters or not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        */
+        void decrypt_decode(const std::vector<Ciphertext> &encrypted,
+            const BatchEncoder &encoder,
+            std::vector<std::vector<std::uint64_t>> &destination,
+            std::size_t thread_count = 0);
+
+        /**
+        Decrypts and decodes a batch of ciphertexts with the given BatchEncoder
+        into signed integers. The work is split among thread_count threads as in
+        the unsigned overload.
+
+        @param[in] encrypted The ciphertexts to decrypt
+        @param[in] encoder The BatchEncoder to decode with
+        @param[out] destination The matrices to be overwritten with the values in
+        the slots
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters or not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        */
+        void decrypt_decode(const std::vector<Ciphertext> &encrypted,
+            const BatchEncoder &encoder,
+            std::vector<std::vector<std::int64_t>> &destination,
+            std::size_t thread_count = 0);
+
+        /**
+        Decrypts and decodes a batch of ciphertexts with the given CKKSEncoder
+        into real numbers. The secret key powers are computed once for the whole
+        batch, and the batch is split among thread_count threads, each of which
+        uses its own memory pool for scratch memory. A thread_count of zero uses
+        one thread per hardware thread.
+
+        @param[in] encrypted The ciphertexts to decrypt
+        @param[in] encoder The CKKSEncoder to decode with
+        @param[out] destination The vectors to be overwritten with the values in
+        the slots
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters or not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        @throws std::invalid_argument if the scale of some ciphertext is out of
+        bounds
+        */
+        void decrypt_decode(const std::vector<Ciphertext> &encrypted,
+            const CKKSEncoder &encoder,
+            std::vector<std::vector<double>> &destination,
+            std::size_t thread_count = 0);
+
+        /**
+        Decrypts and decodes a batch of ciphertexts with the given CKKSEncoder
+        into complex numbers. The work is split among thread_count threads as in
+        the real overload.
+
+        @param[in] encrypted The ciphertexts to decrypt
+        @param[in] encoder The CKKSEncoder to decode with
+        @param[out] destination The vectors to be overwritten with the values in
+        the slots
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters or not in the default NTT form
+        @throws std::invalid_argument if encoder was created for different
+        encryption parameters
+        @throws std::invalid_argument if the scale of some ciphertext is out of
+        bounds
+        */
+        void decrypt_decode(const std::vector<Ciphertext> &encrypted,
+            const CKKSEncoder &encoder,
+            std::vector<std::vector<std::complex<double>>> &destination,
+            std::size_t thread_count = 0);
+
         /*
         Computes the invariant noise budget (in bits) of a ciphertext. The invariant 
         noise budget measures the amount of room there is for the noise to grow while 
@@ -88,20 +284,132 @@ namespace seal
         computations are performed. When the budget reaches zero, the ciphertext 
         becomes too noisy to decrypt correctly.
 
+        @par Computation
+        The infinity norm of the noise is computed in RNS form without composing
+        the coefficients into multi-precision integers. The noise divided by the
+        coefficient modulus is first evaluated in double precision, which
+        determines the bit count of the norm unless the norm is very small
+        compared to the coefficient modulus or very close to a power of two. In
+        those cases the coefficients are reconstructed modulo a power of two just
+        large enough to hold them, using the error bound of the first step or,
+        for the smallest norms, a check against the RNS representation. The
+        result is always exact.
+
         @param[in] encrypted The ciphertext
         @throws std::invalid_argument if the scheme is not BFV
         @throws std::invalid_argument if encrypted is not valid for the encryption parameters
-        @throws std::invalid_argument if encrypted is in NTT form
         */
         int invariant_noise_budget(const Ciphertext &encrypted);
 
+        /**
+        Computes the invariant noise budgets (in bits) of a batch of ciphertexts
+        and stores them in destination, which is resized to the number of
+        ciphertexts. The secret key powers are computed once for the whole batch,
+        and the batch is split among thread_count threads, each of which uses its
+        own memory pool. A thread_count of zero uses one thread per hardware
+        thread.
+
+        @param[in] encrypted The ciphertexts
+        @param[out] destination The vector to overwrite with the noise budgets
+        @param[in] thread_count The number of threads to use
+        @throws std::logic_error if the scheme is not BFV
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters
+        */
+        void invariant_noise_budget(const std::vector<Ciphertext> &encrypted,
+            std::vector<int> &destination, std::size_t thread_count = 0);
+
+        /**
+        Computes this party's share in a threshold decryption of a ciphertext
+        encrypted under a joint secret key, where the secret key given to the
+        Decryptor is the party's additive share of the joint secret key. The
+        share is c_1*s_i + e, where e is smudging noise with coefficients drawn
+        uniformly from (-2^smudging_bit_count, 2^smudging_bit_count) to hide the
+        secret key share. The shares of all parties are combined with
+        ShareAggregator::decrypt.
+
+        The share is stored in destination as a plaintext in NTT form with the
+        same parms_id and scale as encrypted. The ciphertext must have size 2.
+        Like Decryptor::decrypt, BFV ciphertexts can be in either form.
+
+        @param[in] encrypted The ciphertext to compute the decryption share for
+        @param[out] destination The plaintext to overwrite with the share
+        @param[in] smudging_bit_count The bit count of the smudging noise
+        @throws std::invalid_argument if encrypted is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if encrypted is not in the default NTT form
+        @throws std::invalid_argument if the size of encrypted is not 2
+        @throws std::invalid_argument if smudging_bit_count is not in the range
+        [0, 60]
+        */
+        void partial_decrypt(const Ciphertext &encrypted, Plaintext &destination,
+            int smudging_bit_count);
+
+        /**
+        Computes this party's threshold decryption shares for a batch of
+        ciphertexts. The batch is split among thread_count threads, each of which
+        uses its own memory pool and random number generator. A thread_count of
+        zero uses one thread per hardware thread. The shares are stored in
+        destination, which is resized to the number of ciphertexts.
+
+        @param[in] encrypted The ciphertexts to compute the decryption shares for
+        @param[out] destination The plaintexts to overwrite with the shares
+        @param[in] smudging_bit_count The bit count of the smudging noise
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters, not in the default NTT form, or not of size 2
+        @throws std::invalid_argument if smudging_bit_count is not in the range
+        [0, 60]
+        */
+        void partial_decrypt(const std::vector<Ciphertext> &encrypted,
+            std::vector<Plaintext> &destination, int smudging_bit_count,
+            std::size_t thread_count = 0);
+
     private:
+        std::size_t verify_decrypt(const Ciphertext &encrypted) const;
+
+        std::size_t verify_decrypt(const std::vector<Ciphertext> &encrypted) const;
+
+        void verify_encoder(
+            const std::shared_ptr<SEALContext> &encoder_context) const;
+
+        template<typename T>
+        void decrypt_decode_internal(const Ciphertext &encrypted,
+            const BatchEncoder &encoder, std::vector<T> &destination,
+            MemoryPoolHandle pool);
+
+        template<typename T>
+        void decrypt_decode_internal(const Ciphertext &encrypted,
+            const CKKSEncoder &encoder, std::vector<T> &destination,
+            MemoryPoolHandle pool);
+
+        template<typename Encoder, typename T>
+        void decrypt_decode_batch(const std::vector<Ciphertext> &encrypted,
+            const Encoder &encoder, std::vector<std::vector<T>> &destination,
+            std::size_t thread_count);
+
+        void verify_partial_decrypt(const Ciphertext &encrypted) const;
+
+        void partial_decrypt_internal(const Ciphertext &encrypted,
+            Plaintext &destination, int smudging_bit_count,
+            std::shared_ptr<UniformRandomGenerator> random, MemoryPoolHandle pool);
+
+        void set_poly_coeffs_smudging(const SEALContext::ContextData &context_data,
+            std::uint64_t *poly, int smudging_bit_count,
+            std::shared_ptr<UniformRandomGenerator> random) const;
+
         void bfv_decrypt(const Ciphertext &encrypted, Plaintext &destination,
             MemoryPoolHandle pool);
 
         void ckks_decrypt(const Ciphertext &encrypted, Plaintext &destination,
             MemoryPoolHandle pool);
 
+        void bfv_decrypt_poly(const Ciphertext &encrypted,
+            std::uint64_t *destination, MemoryPoolHandle pool);
+
+        void ckks_decrypt_poly(const Ciphertext &encrypted,
+            std::uint64_t *destination, MemoryPoolHandle pool);
+
         Decryptor(const Decryptor &copy) = delete;
 
         Decryptor(Decryptor &&source) = delete;
@@ -110,10 +418,15 @@ namespace seal
 
         Decryptor &operator =(Decryptor &&assign) = delete;
 
-        void compute_secret_key_array(std::size_t max_power);
+        const std::uint64_t *compute_secret_key_array(std::size_t max_power);
 
-        void compose(const SEALContext::ContextData &context_data, 
-            std::uint64_t *value);
+        void verify_invariant_noise_budget(const Ciphertext &encrypted) const;
+
+        int invariant_noise_budget_internal(const Ciphertext &encrypted,
+            MemoryPoolHandle pool);
+
+        int infty_norm_bit_count(const SEALContext::ContextData &context_data,
+            const std::uint64_t *poly, MemoryPoolHandle pool) const;
 
         /**
         We use a fresh memory pool with `clear_on_destruction' enabled
@@ -124,10 +437,17 @@ namespace seal
 
         util::Pointer<std::uint64_t> secret_key_;
 
-        std::size_t secret_key_array_size_ = 0;
+        /**
+        The NTT transformed powers of the secret key. Extending the powers
+        publishes a new array and keeps the old ones alive until the Decryptor
+        is destroyed, so readers never take a lock.
+        */
+        std::atomic<const std::uint64_t*> secret_key_array_{ nullptr };
+
+        std::atomic<std::size_t> secret_key_array_size_{ 0 };
 
-        util::Pointer<std::uint64_t> secret_key_array_;
+        std::vector<util::Pointer<std::uint64_t>> secret_key_arrays_;
 
-        mutable util::ReaderWriterLocker secret_key_array_locker_;
+        std::mutex secret_key_arrays_mutex_;
     };
 }
@@ -12,6 +12,7 @@
 #include "seal/util/polyarithsmallmod.h"
 #include "seal/util/clipnormal.h"
 #include "seal/util/smallntt.h"
+#include "seal/util/parallel.h"
 
 using namespace std;
 using namespace seal::util;
@@ -67,17 +68,71 @@ namespace seal
             throw invalid_argument("plain is not valid for encryption parameters");
         }
 
-        auto &context_data = *context_->context_data();
-        auto &parms = context_data.parms();
+        auto &parms = context_->context_data()->parms();
+        shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
+        encrypt_internal(plain, destination, move(random), move(pool));
+    }
 
+    void Encryptor::encrypt(const vector<Plaintext> &plains,
+        vector<Ciphertext> &destination, size_t thread_count)
+    {
+        // Verify all plaintexts before anything is written to destination
+        auto &parms = context_->context_data()->parms();
+        for (auto &plain : plains)
+        {
+            if (!plain.is_valid_for(context_))
+            {
+                throw invalid_argument("plain is not valid for encryption parameters");
+            }
+            if (parms.scheme() == scheme_type::BFV && plain.is_ntt_form())
+            {
+                throw invalid_argument("plain cannot be in NTT form");
+            }
+            if (parms.scheme() == scheme_type::CKKS && !plain.is_ntt_form())
+            {
+                throw invalid_argument("plain must be in NTT form");
+            }
+        }
+
+        // Allocate the ciphertexts on the calling thread; the workers then
+        // only write into them and do not contend on their memory pool
+        destination.resize(plains.size());
+        for (size_t i = 0; i < plains.size(); i++)
+        {
+            destination[i].resize(context_, parms.scheme() == scheme_type::CKKS ?
+                plains[i].parms_id() : parms.parms_id(), 2);
+        }
+
+        parallel_for(plains.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                // Thread-local pool for the scratch memory, which is recycled
+                // across the range, and a thread-local generator. Sampling u
+                // and e for the whole range up front would not be cheaper:
+                // every coefficient still costs its own calls to the
+                // generator, and the per-polynomial setup is negligible.
+                auto pool = MemoryPoolHandle::New();
+                shared_ptr<UniformRandomGenerator> random(
+                    parms.random_generator()->create());
+                for (size_t i = begin; i < end; i++)
+                {
+                    encrypt_internal(plains[i], destination[i], random, pool);
+                }
+            });
+    }
+
+    void Encryptor::encrypt_internal(const Plaintext &plain,
+        Ciphertext &destination, shared_ptr<UniformRandomGenerator> random,
+        MemoryPoolHandle pool)
+    {
+        auto &parms = context_->context_data()->parms();
         switch (parms.scheme())
         {
         case scheme_type::BFV:
-            bfv_encrypt(plain, destination, move(pool));
+            bfv_encrypt(plain, destination, move(random), move(pool));
             return;
 
         case scheme_type::CKKS:
-            ckks_encrypt(plain, destination, move(pool));
+            ckks_encrypt(plain, destination, move(random), move(pool));
             return;
 
         default:
@@ -85,8 +140,8 @@ namespace seal
         }
     }
 
-    void Encryptor::bfv_encrypt(const Plaintext &plain, 
-        Ciphertext &destination, MemoryPoolHandle pool)
+    void Encryptor::bfv_encrypt(const Plaintext &plain, Ciphertext &destination,
+        shared_ptr<UniformRandomGenerator> random, MemoryPoolHandle pool)
     {
         if (plain.is_ntt_form())
         {
@@ -115,7 +170,6 @@ namespace seal
 
         // Generate u 
         auto u(allocate_poly(coeff_count, coeff_mod_count, pool));
-        shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
         
         set_poly_coeffs_zero_one_negone(u.get(), random, context_data);
 
@@ -159,8 +213,8 @@ namespace seal
         }
     }
 
-    void Encryptor::ckks_encrypt(const Plaintext &plain, 
-        Ciphertext &destination, MemoryPoolHandle pool)
+    void Encryptor::ckks_encrypt(const Plaintext &plain, Ciphertext &destination,
+        shared_ptr<UniformRandomGenerator> random, MemoryPoolHandle pool)
     {
         if (!plain.is_ntt_form())
         {
@@ -196,7 +250,6 @@ namespace seal
 
         // Generate u 
         auto u(allocate_poly(coeff_count, coeff_mod_count, pool));
-        shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
 
         set_poly_coeffs_zero_one_negone(u.get(), random, context_data);
         
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <memory>
 #include "seal/encryptionparams.h"
@@ -41,6 +42,8 @@ namespace seal
     */
     class Encryptor
     {
+        friend class PrecomputedEncryptor;
+
     public:
         /**
         Creates an Encryptor instance initialized with the specified SEALContext 
@@ -69,6 +72,26 @@ namespace seal
         void encrypt(const Plaintext &plain, Ciphertext &destination, 
             MemoryPoolHandle pool = MemoryManager::GetPool());
 
+        /**
+        Encrypts a batch of plaintexts and stores the results in destination,
+        which is resized to the number of plaintexts. The batch is split among
+        thread_count threads; a thread_count of zero uses one thread per hardware
+        thread. Every thread uses its own random number generator and its own
+        memory pool for the temporary values, so the threads do not contend for
+        either, and the scratch memory is reused across the plaintexts of the
+        thread.
+
+        @param[in] plains The plaintexts to encrypt
+        @param[out] destination The ciphertexts to overwrite with the encrypted
+        plaintexts
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some plaintext is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if some plaintext is not in default NTT form
+        */
+        void encrypt(const std::vector<Plaintext> &plains,
+            std::vector<Ciphertext> &destination, std::size_t thread_count = 0);
+
     private:
         Encryptor(const Encryptor &copy) = delete;
 
@@ -93,11 +116,14 @@ namespace seal
             std::shared_ptr<UniformRandomGenerator> random,
             const SEALContext::ContextData &context_data) const;
 
+        void encrypt_internal(const Plaintext &plain, Ciphertext &destination,
+            std::shared_ptr<UniformRandomGenerator> random, MemoryPoolHandle pool);
+
         void bfv_encrypt(const Plaintext &plain, Ciphertext &destination,
-            MemoryPoolHandle pool);
+            std::shared_ptr<UniformRandomGenerator> random, MemoryPoolHandle pool);
 
         void ckks_encrypt(const Plaintext &plain, Ciphertext &destination,
-            MemoryPoolHandle pool);
+            std::shared_ptr<UniformRandomGenerator> random, MemoryPoolHandle pool);
 
         MemoryPoolHandle pool_ = MemoryManager::GetPool();
 
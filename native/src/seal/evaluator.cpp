@@ -7,10 +7,14 @@
 #include <limits>
 #include <functional>
 #include "seal/evaluator.h"
+#include "seal/plaintextcache.h"
+#include "seal/plaintextdatabase.h"
+#include "seal/ciphertextaccumulator.h"
 #include "seal/util/common.h"
 #include "seal/util/uintarith.h"
 #include "seal/util/polycore.h"
 #include "seal/util/polyarithsmallmod.h"
+#include "seal/util/parallel.h"
 
 using namespace std;
 using namespace seal::util;
@@ -24,6 +28,75 @@ namespace seal
         {
             return util::are_close<double>(value1.scale(), value2.scale());
         }
+
+        bool changes_operands(const CKKSAlignment &alignment)
+        {
+            bool changes = alignment.scale_adjustment != 0.0;
+            for (size_t i = 0; i < 2; i++)
+            {
+                changes = changes || alignment.mod_switch_levels[i] || alignment.rescale_count[i];
+            }
+            return changes;
+        }
+
+        // Copies size RNS polynomials in NTT form and transforms the copies
+        // back to coefficient form
+        Pointer<uint64_t> inverse_ntt_copy(const uint64_t *poly_array, size_t size,
+            size_t coeff_count, size_t coeff_mod_count,
+            const SmallNTTTables *small_ntt_tables, MemoryPoolHandle pool)
+        {
+            auto copy(allocate_poly(mul_safe(size, coeff_count), coeff_mod_count, pool));
+            set_poly_poly(poly_array, size * coeff_count, coeff_mod_count, copy.get());
+            uint64_t *copy_ptr = copy.get();
+            for (size_t i = 0; i < size * coeff_mod_count; i++, copy_ptr += coeff_count)
+            {
+                inverse_ntt_negacyclic_harvey(copy_ptr, small_ntt_tables[i % coeff_mod_count]);
+            }
+            return copy;
+        }
+
+        // Reduces a plaintext coefficient, taken as centered modulo the plain
+        // modulus, modulo a prime of the coefficient modulus. A coefficient x
+        // in the upper half stands for -(t - x), which is reduced directly, so
+        // there is no need to compose x + (q - t) modulo the full q first.
+        // For CKKS the plain modulus is zero and t - x wraps around to 2^64 - x.
+        inline uint64_t lift_plain_coeff(uint64_t coeff, uint64_t plain_modulus,
+            uint64_t plain_upper_half_threshold, const SmallModulus &modulus)
+        {
+            bool is_upper_half = coeff >= plain_upper_half_threshold;
+            uint64_t reduced = barrett_reduce_64(
+                is_upper_half ? plain_modulus - coeff : coeff, modulus);
+            return is_upper_half ? negate_uint_mod(reduced, modulus) : reduced;
+        }
+
+        // Lifts the coefficients of a plaintext to every prime of the
+        // coefficient modulus and transforms each prime's component to NTT
+        // form right after it is written. The plaintext may be at the start
+        // of destination, since the first component is written last.
+        void lift_plain_to_ntt(const SEALContext::ContextData &context_data,
+            const uint64_t *plain, size_t plain_coeff_count, uint64_t *destination)
+        {
+            auto &parms = context_data.parms();
+            auto &coeff_modulus = parms.coeff_modulus();
+            size_t coeff_count = parms.poly_modulus_degree();
+            uint64_t plain_modulus = parms.plain_modulus().value();
+            uint64_t plain_upper_half_threshold = context_data.plain_upper_half_threshold();
+            auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
+
+            for (size_t j = coeff_modulus.size(); j--; )
+            {
+                auto &modulus = coeff_modulus[j];
+                uint64_t *destination_ptr = destination + (j * coeff_count);
+                for (size_t i = 0; i < plain_coeff_count; i++)
+                {
+                    destination_ptr[i] = lift_plain_coeff(plain[i], plain_modulus,
+                        plain_upper_half_threshold, modulus);
+                }
+                set_zero_uint(coeff_count - plain_coeff_count,
+                    destination_ptr + plain_coeff_count);
+                ntt_negacyclic_harvey(destination_ptr, coeff_small_ntt_tables[j]);
+            }
+        }
     }
 
     Evaluator::Evaluator(shared_ptr<SEALContext> context) : context_(move(context))
@@ -59,6 +132,341 @@ namespace seal
         }
     }
 
+    void Evaluator::enable_ckks_auto_alignment(double max_scale_adjustment,
+        CKKSAlignmentHandler handler)
+    {
+        if (context_->context_data()->parms().scheme() != scheme_type::CKKS)
+        {
+            throw logic_error("unsupported scheme");
+        }
+        if (!(max_scale_adjustment >= 0 && max_scale_adjustment < 1))
+        {
+            throw invalid_argument("max_scale_adjustment is not within [0, 1)");
+        }
+        ckks_auto_alignment_ = true;
+        max_scale_adjustment_ = max_scale_adjustment;
+        alignment_handler_ = move(handler);
+    }
+
+    void Evaluator::disable_ckks_auto_alignment() noexcept
+    {
+        ckks_auto_alignment_ = false;
+        max_scale_adjustment_ = 0.0;
+        alignment_handler_ = CKKSAlignmentHandler();
+    }
+
+    void Evaluator::set_bfv_multiply_type(bfv_multiply_type type)
+    {
+        if (context_->context_data()->parms().scheme() != scheme_type::BFV)
+        {
+            throw logic_error("unsupported scheme");
+        }
+
+        switch (type)
+        {
+        case bfv_multiply_type::BEHZ:
+            break;
+
+        case bfv_multiply_type::HPS:
+            if (hps_converters_.empty())
+            {
+                // Create the HPS pre-computations for every level
+                vector<shared_ptr<const HPSConverter>> hps_converters(
+                    add_safe(context_->context_data()->chain_index(), size_t(1)));
+                for (auto context_data_ptr = context_->context_data(); context_data_ptr;
+                    context_data_ptr = context_data_ptr->next_context_data())
+                {
+                    auto &parms = context_data_ptr->parms();
+                    auto hps_converter = make_shared<HPSConverter>(parms.coeff_modulus(),
+                        parms.poly_modulus_degree(), parms.plain_modulus(),
+                        MemoryManager::GetPool());
+                    if (!hps_converter->is_generated())
+                    {
+                        throw logic_error("HPS pre-computations failed");
+                    }
+                    hps_converters[context_data_ptr->chain_index()] = move(hps_converter);
+                }
+                hps_converters_ = move(hps_converters);
+            }
+            break;
+
+        default:
+            throw invalid_argument("invalid multiply type");
+        }
+        bfv_multiply_type_ = type;
+    }
+
+    template<typename T>
+    bool Evaluator::perform_aligned_ckks(Ciphertext &encrypted1, const T &operand2,
+        bool match_scales, const char *operation, MemoryPoolHandle pool,
+        const function<void(Ciphertext &, const T &)> &perform)
+    {
+        CKKSAlignment alignment;
+        alignment.operation = operation;
+        Ciphertext aligned1(pool);
+        T aligned2(pool);
+        auto &aligned_operand2 = align_ckks(encrypted1, operand2, aligned1, aligned2,
+            match_scales, alignment, pool);
+        if (!changes_operands(alignment))
+        {
+            return false;
+        }
+
+        // The operation works on a copy, so that encrypted1 is left unchanged and
+        // nothing is reported if the operands cannot be aligned
+        if (!alignment.rescale_count[0] && !alignment.mod_switch_levels[0])
+        {
+            aligned1 = encrypted1;
+        }
+        perform(aligned1, aligned_operand2);
+        encrypted1 = move(aligned1);
+        report_ckks_alignment(alignment);
+        return true;
+    }
+
+    const Ciphertext &Evaluator::align_ckks(const Ciphertext &encrypted1,
+        const Ciphertext &encrypted2, Ciphertext &aligned1, Ciphertext &aligned2,
+        bool match_scales, CKKSAlignment &alignment, MemoryPoolHandle pool)
+    {
+        // The operands are written to aligned1 and aligned2 when they first change
+        const Ciphertext *operand1 = &encrypted1;
+        const Ciphertext *operand2 = &encrypted2;
+        auto rescale_operand1 = [&]() {
+            if (operand1 == &encrypted1)
+            {
+                rescale_to_next(encrypted1, aligned1, pool);
+                operand1 = &aligned1;
+            }
+            else
+            {
+                rescale_to_next_inplace(aligned1, pool);
+            }
+            alignment.rescale_count[0]++;
+        };
+        auto rescale_operand2 = [&]() {
+            if (operand2 == &encrypted2)
+            {
+                rescale_to_next(encrypted2, aligned2, pool);
+                operand2 = &aligned2;
+            }
+            else
+            {
+                rescale_to_next_inplace(aligned2, pool);
+            }
+            alignment.rescale_count[1]++;
+        };
+
+        // A ciphertext squared is only rescaled, and its square is the aligned
+        // first operand
+        if (&encrypted1 == &encrypted2)
+        {
+            while (!match_scales && rescales_for_multiply(*operand1))
+            {
+                rescale_operand1();
+                alignment.rescale_count[1]++;
+            }
+            return *operand1;
+        }
+
+        if (match_scales)
+        {
+            while (!are_same_scale(*operand1, *operand2))
+            {
+                if (operand1->scale() > operand2->scale() &&
+                    rescales_toward(*operand1, operand2->scale()))
+                {
+                    rescale_operand1();
+                }
+                else if (operand2->scale() > operand1->scale() &&
+                    rescales_toward(*operand2, operand1->scale()))
+                {
+                    rescale_operand2();
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+        else
+        {
+            while (rescales_for_multiply(*operand1))
+            {
+                rescale_operand1();
+            }
+            while (rescales_for_multiply(*operand2))
+            {
+                rescale_operand2();
+            }
+        }
+
+        // Switch the operand at the higher level down to the other one
+        size_t chain_index1 = context_->context_data(operand1->parms_id())->chain_index();
+        size_t chain_index2 = context_->context_data(operand2->parms_id())->chain_index();
+        if (chain_index1 > chain_index2)
+        {
+            if (operand1 == &encrypted1)
+            {
+                mod_switch_to(encrypted1, operand2->parms_id(), aligned1, pool);
+                operand1 = &aligned1;
+            }
+            else
+            {
+                mod_switch_to_inplace(aligned1, operand2->parms_id(), pool);
+            }
+            alignment.mod_switch_levels[0] = chain_index1 - chain_index2;
+        }
+        else if (chain_index2 > chain_index1)
+        {
+            if (operand2 == &encrypted2)
+            {
+                mod_switch_to(encrypted2, operand1->parms_id(), aligned2, pool);
+                operand2 = &aligned2;
+            }
+            else
+            {
+                mod_switch_to_inplace(aligned2, operand1->parms_id(), pool);
+            }
+            alignment.mod_switch_levels[1] = chain_index2 - chain_index1;
+        }
+
+        if (match_scales && !are_same_scale(*operand1, *operand2))
+        {
+            double scale_adjustment = fabs(operand2->scale() / operand1->scale() - 1.0);
+            if (scale_adjustment <= max_scale_adjustment_)
+            {
+                if (operand2 == &encrypted2)
+                {
+                    aligned2 = encrypted2;
+                    operand2 = &aligned2;
+                }
+                aligned2.scale() = operand1->scale();
+                alignment.scale_adjustment = scale_adjustment;
+            }
+        }
+
+        return *operand2;
+    }
+
+    const Plaintext &Evaluator::align_ckks(const Ciphertext &encrypted,
+        const Plaintext &plain, Ciphertext &aligned, Plaintext &aligned_plain,
+        bool match_scales, CKKSAlignment &alignment, MemoryPoolHandle pool)
+    {
+        // Plaintexts not in NTT form have no level; the operation rejects them
+        auto plain_context_data_ptr = context_->context_data(plain.parms_id());
+        if (!plain_context_data_ptr)
+        {
+            return plain;
+        }
+
+        // The ciphertext is written to aligned when it first changes
+        const Ciphertext *operand1 = &encrypted;
+        auto rescale_operand1 = [&]() {
+            if (operand1 == &encrypted)
+            {
+                rescale_to_next(encrypted, aligned, pool);
+                operand1 = &aligned;
+            }
+            else
+            {
+                rescale_to_next_inplace(aligned, pool);
+            }
+            alignment.rescale_count[0]++;
+        };
+
+        // Plaintexts cannot be rescaled
+        if (match_scales)
+        {
+            while (operand1->scale() > plain.scale() && !are_same_scale(*operand1, plain) &&
+                rescales_toward(*operand1, plain.scale()))
+            {
+                rescale_operand1();
+            }
+        }
+        else
+        {
+            while (rescales_for_multiply(*operand1))
+            {
+                rescale_operand1();
+            }
+        }
+
+        // Switch the operand at the higher level down to the other one
+        const Plaintext *operand2 = &plain;
+        size_t chain_index1 = context_->context_data(operand1->parms_id())->chain_index();
+        size_t chain_index2 = plain_context_data_ptr->chain_index();
+        if (chain_index1 > chain_index2)
+        {
+            if (operand1 == &encrypted)
+            {
+                mod_switch_to(encrypted, plain.parms_id(), aligned, pool);
+                operand1 = &aligned;
+            }
+            else
+            {
+                mod_switch_to_inplace(aligned, plain.parms_id(), pool);
+            }
+            alignment.mod_switch_levels[0] = chain_index1 - chain_index2;
+        }
+        else if (chain_index2 > chain_index1)
+        {
+            aligned_plain = plain;
+            mod_switch_to_inplace(aligned_plain, operand1->parms_id());
+            operand2 = &aligned_plain;
+            alignment.mod_switch_levels[1] = chain_index2 - chain_index1;
+        }
+
+        if (match_scales && !are_same_scale(*operand1, *operand2))
+        {
+            double scale_adjustment = fabs(operand2->scale() / operand1->scale() - 1.0);
+            if (scale_adjustment <= max_scale_adjustment_)
+            {
+                if (operand2 == &plain)
+                {
+                    aligned_plain = plain;
+                    operand2 = &aligned_plain;
+                }
+                aligned_plain.scale() = operand1->scale();
+                alignment.scale_adjustment = scale_adjustment;
+            }
+        }
+
+        return *operand2;
+    }
+
+    bool Evaluator::rescales_for_multiply(const Ciphertext &encrypted) const
+    {
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        if (!context_data.next_context_data() || encrypted.size() != 2)
+        {
+            return false;
+        }
+        double prime = static_cast<double>(
+            context_data.parms().coeff_modulus().back().value());
+        return encrypted.scale() / prime >= sqrt(prime);
+    }
+
+    bool Evaluator::rescales_toward(const Ciphertext &encrypted, double scale) const
+    {
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        if (!context_data.next_context_data() || encrypted.size() != 2)
+        {
+            return false;
+        }
+        double prime = static_cast<double>(
+            context_data.parms().coeff_modulus().back().value());
+        return fabs(log2(encrypted.scale() / prime) - log2(scale)) <
+            fabs(log2(encrypted.scale()) - log2(scale));
+    }
+
+    void Evaluator::report_ckks_alignment(const CKKSAlignment &alignment) const
+    {
+        if (changes_operands(alignment) && alignment_handler_)
+        {
+            alignment_handler_(alignment);
+        }
+    }
+
     void Evaluator::negate_inplace(Ciphertext &encrypted)
     {
         // Verify parameters.
@@ -104,6 +512,14 @@ namespace seal
         {
             throw invalid_argument("encrypted1 is not valid for encryption parameters");
         }
+        if (ckks_auto_alignment_ && perform_aligned_ckks<Ciphertext>(encrypted1, encrypted2,
+            true, "add_inplace", MemoryManager::GetPool(),
+            [this](Ciphertext &operand1, const Ciphertext &operand2) {
+                add_inplace(operand1, operand2);
+            }))
+        {
+            return;
+        }
         if (encrypted1.parms_id() != encrypted2.parms_id())
         {
             throw invalid_argument("encrypted1 and encrypted2 parameter mismatch");
@@ -164,24 +580,145 @@ namespace seal
 #endif
     }
 
-    void Evaluator::add_many(const vector<Ciphertext> &encrypteds, Ciphertext &destination)
+    void Evaluator::add_many(const vector<Ciphertext> &encrypteds, Ciphertext &destination,
+        MemoryPoolHandle pool, size_t thread_count)
     {
         if (encrypteds.empty())
         {
             throw invalid_argument("encrypteds cannot be empty");
         }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+
+        // The sum is computed at the lowest level among the ciphertexts
+        const SEALContext::ContextData *context_data_ptr = nullptr;
+        size_t max_size = 0;
         for (size_t i = 0; i < encrypteds.size(); i++)
         {
             if (&encrypteds[i] == &destination)
             {
                 throw invalid_argument("encrypteds must be different from destination");
             }
+            if (!encrypteds[i].is_metadata_valid_for(context_))
+            {
+                throw invalid_argument("encrypteds is not valid for encryption parameters");
+            }
+            if (encrypteds[i].is_ntt_form() != encrypteds[0].is_ntt_form())
+            {
+                throw invalid_argument("NTT form mismatch");
+            }
+            if (!are_same_scale(encrypteds[i], encrypteds[0]))
+            {
+                throw invalid_argument("scale mismatch");
+            }
+            auto encrypted_context_data_ptr = 
+                context_->context_data(encrypteds[i].parms_id()).get();
+            if (!context_data_ptr || 
+                encrypted_context_data_ptr->chain_index() < context_data_ptr->chain_index())
+            {
+                context_data_ptr = encrypted_context_data_ptr;
+            }
+            max_size = max(max_size, encrypteds[i].size());
+        }
+
+        // Extract encryption parameters.
+        auto &parms = context_data_ptr->parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+
+        // Size check
+        if (!product_fits_in(max_size, coeff_count, coeff_mod_count))
+        {
+            throw logic_error("invalid parameters");
+        }
+        size_t poly_count = max_size * coeff_mod_count;
+        size_t sum_uint64_count = poly_count * coeff_count;
+
+        // Coefficients are added without reduction as long as the sum fits in
+        // 64 bits. Since every coefficient is less than the largest prime q, this 
+        // allows floor((2^64 - 1) / (q - 1)) summands, at least 16 for 60-bit primes.
+        uint64_t max_summands = numeric_limits<uint64_t>::max();
+        for (auto &mod : coeff_modulus)
+        {
+            max_summands = min(max_summands, numeric_limits<uint64_t>::max() / (mod.value() - 1));
+        }
+        auto reduce = [&](uint64_t *sum) {
+            for (size_t k = 0; k < poly_count; k++)
+            {
+                auto &mod = coeff_modulus[k % coeff_mod_count];
+                for (size_t l = 0; l < coeff_count; l++, sum++)
+                {
+                    uint64_t wide_sum[2]{ *sum, 0 };
+                    *sum = barrett_reduce_128(wide_sum, mod);
+                }
+            }
+        };
+
+        // Each thread sums a contiguous range of the ciphertexts; the partial
+        // sums are added at the end. A thread gets at least max_summands 
+        // ciphertexts so that small sums do not pay for starting threads.
+        if (!thread_count)
+        {
+            thread_count = hardware_thread_count();
+        }
+        thread_count = min(thread_count, 
+            safe_cast<size_t>((encrypteds.size() - 1) / max_summands + 1));
+        auto partial_sums(allocate_zero_uint(mul_safe(thread_count, sum_uint64_count), pool));
+        parallel_for(thread_count, thread_count, [&](size_t thread_index, size_t) {
+            auto thread_pool = thread_index ? MemoryPoolHandle::New() : pool;
+            uint64_t *sum = partial_sums.get() + thread_index * sum_uint64_count;
+            size_t begin = encrypteds.size() * thread_index / thread_count;
+            size_t end = encrypteds.size() * (thread_index + 1) / thread_count;
+            Ciphertext aligned(thread_pool);
+            uint64_t summands = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                const Ciphertext *encrypted = &encrypteds[i];
+                if (encrypted->parms_id() != parms.parms_id())
+                {
+                    mod_switch_to(*encrypted, parms.parms_id(), aligned, thread_pool);
+                    encrypted = &aligned;
+                }
+                if (summands == max_summands)
+                {
+                    reduce(sum);
+                    summands = 1;
+                }
+                const uint64_t *encrypted_ptr = encrypted->data();
+                uint64_t *sum_ptr = sum;
+                for (size_t k = 0; k < encrypted->uint64_count(); k++)
+                {
+                    *sum_ptr++ += *encrypted_ptr++;
+                }
+                summands++;
+            }
+            reduce(sum);
+        });
+
+        destination.resize(context_, parms.parms_id(), max_size);
+        destination.is_ntt_form() = encrypteds[0].is_ntt_form();
+        destination.scale() = encrypteds[0].scale();
+        set_uint_uint(partial_sums.get(), sum_uint64_count, destination.data());
+        for (size_t t = 1; t < thread_count; t++)
+        {
+            const uint64_t *partial_sum = partial_sums.get() + t * sum_uint64_count;
+            for (size_t k = 0; k < poly_count; k++)
+            {
+                add_poly_poly_coeffmod(destination.data() + k * coeff_count, 
+                    partial_sum + k * coeff_count, coeff_count, 
+                    coeff_modulus[k % coeff_mod_count], destination.data() + k * coeff_count);
+            }
         }
-        destination = encrypteds[0];
-        for (size_t i = 1; i < encrypteds.size(); i++)
+#ifndef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (destination.is_transparent())
         {
-            add_inplace(destination, encrypteds[i]);
+            throw logic_error("result ciphertext is transparent");
         }
+#endif
     }
 
     void Evaluator::sub_inplace(Ciphertext &encrypted1, const Ciphertext &encrypted2)
@@ -195,6 +732,14 @@ namespace seal
         {
             throw invalid_argument("encrypted2 is not valid for encryption parameters");
         }
+        if (ckks_auto_alignment_ && perform_aligned_ckks<Ciphertext>(encrypted1, encrypted2,
+            true, "sub_inplace", MemoryManager::GetPool(),
+            [this](Ciphertext &operand1, const Ciphertext &operand2) {
+                sub_inplace(operand1, operand2);
+            }))
+        {
+            return;
+        }
         if (encrypted1.parms_id() != encrypted2.parms_id())
         {
             throw invalid_argument("encrypted1 and encrypted2 parameter mismatch");
@@ -270,6 +815,14 @@ namespace seal
         {
             throw invalid_argument("encrypted2 is not valid for encryption parameters");
         }
+        if (ckks_auto_alignment_ && perform_aligned_ckks<Ciphertext>(encrypted1, encrypted2,
+            false, "multiply_inplace", pool,
+            [this, &pool](Ciphertext &operand1, const Ciphertext &operand2) {
+                multiply_inplace(operand1, operand2, pool);
+            }))
+        {
+            return;
+        }
         if (encrypted1.parms_id() != encrypted2.parms_id())
         {
             throw invalid_argument("encrypted1 and encrypted2 parameter mismatch");
@@ -279,7 +832,14 @@ namespace seal
         switch (context_data_ptr->parms().scheme())
         {
         case scheme_type::BFV:
-            bfv_multiply(encrypted1, encrypted2, pool);
+            if (bfv_multiply_type_ == bfv_multiply_type::HPS)
+            {
+                bfv_multiply_hps(encrypted1, encrypted2, pool);
+            }
+            else
+            {
+                bfv_multiply(encrypted1, encrypted2, pool);
+            }
             break;
 
         case scheme_type::CKKS:
@@ -301,9 +861,9 @@ namespace seal
     void Evaluator::bfv_multiply(Ciphertext &encrypted1, 
         const Ciphertext &encrypted2, MemoryPoolHandle pool)
     {
-        if (encrypted1.is_ntt_form() || encrypted2.is_ntt_form())
+        if (encrypted1.is_ntt_form() != encrypted2.is_ntt_form())
         {
-            throw invalid_argument("encrypted1 or encrypted2 cannot be in NTT form");
+            throw invalid_argument("NTT form mismatch");
         }
 
         // Extract encryption parameters.
@@ -352,13 +912,31 @@ namespace seal
         auto tmp_encrypted2_bsk(allocate_poly(
             coeff_count * encrypted2_size, bsk_base_mod_count, pool));
 
+        // The base conversions need the inputs in coefficient form. Inputs in NTT
+        // form are transformed back in temporary copies, and the products in base
+        // q below use them as they are.
+        bool is_ntt_form = encrypted1.is_ntt_form();
+        Pointer<uint64_t> encrypted1_coeff_copy;
+        Pointer<uint64_t> encrypted2_coeff_copy;
+        const uint64_t *encrypted1_coeff = encrypted1.data();
+        const uint64_t *encrypted2_coeff = encrypted2.data();
+        if (is_ntt_form)
+        {
+            encrypted1_coeff_copy = inverse_ntt_copy(encrypted1.data(), encrypted1_size,
+                coeff_count, coeff_mod_count, coeff_small_ntt_tables.get(), pool);
+            encrypted1_coeff = encrypted1_coeff_copy.get();
+            encrypted2_coeff_copy = inverse_ntt_copy(encrypted2.data(), encrypted2_size,
+                coeff_count, coeff_mod_count, coeff_small_ntt_tables.get(), pool);
+            encrypted2_coeff = encrypted2_coeff_copy.get();
+        }
+
         // Step 0: fast base convert from q to Bsk U {m_tilde}
         // Step 1: reduce q-overflows in Bsk
         // Iterate over all the ciphertexts inside encrypted1
         for (size_t i = 0; i < encrypted1_size; i++)
         {
             base_converter->fastbconv_mtilde(
-                encrypted1.data(i),
+                encrypted1_coeff + (i * encrypted_ptr_increment),
                 tmp_encrypted1_bsk_mtilde.get() + (i * encrypted_bsk_mtilde_ptr_increment),
                 pool);
             base_converter->mont_rq(
@@ -370,7 +948,7 @@ namespace seal
         for (size_t i = 0; i < encrypted2_size; i++)
         {
             base_converter->fastbconv_mtilde(
-                encrypted2.data(i),
+                encrypted2_coeff + (i * encrypted_ptr_increment),
                 tmp_encrypted2_bsk_mtilde.get() + (i * encrypted_bsk_mtilde_ptr_increment), pool);
             base_converter->mont_rq(
                 tmp_encrypted2_bsk_mtilde.get() + (i * encrypted_bsk_mtilde_ptr_increment),
@@ -421,7 +999,7 @@ namespace seal
 
         for (size_t i = 0; i < encrypted1_size; i++)
         {
-            for (size_t j = 0; j < coeff_mod_count; j++)
+            for (size_t j = 0; j < coeff_mod_count && !is_ntt_form; j++)
             {
                 // Lazy reduction
                 ntt_negacyclic_harvey_lazy(copy_encrypted1_ntt_coeff_mod.get() +
@@ -437,7 +1015,7 @@ namespace seal
 
         for (size_t i = 0; i < encrypted2_size; i++)
         {
-            for (size_t j = 0; j < coeff_mod_count; j++)
+            for (size_t j = 0; j < coeff_mod_count && !is_ntt_form; j++)
             {
                 // Lazy reduction
                 ntt_negacyclic_harvey_lazy(copy_encrypted2_ntt_coeff_mod.get() +
@@ -573,15 +1151,25 @@ namespace seal
                 tmp_result_bsk.get() + (i * encrypted_bsk_ptr_increment),
                 encrypted1.data(i), pool);
         }
+
+        // Transform the result back to NTT form
+        if (is_ntt_form)
+        {
+            for (size_t i = 0; i < dest_count * coeff_mod_count; i++)
+            {
+                ntt_negacyclic_harvey(encrypted1.data() + (i * coeff_count),
+                    coeff_small_ntt_tables[i % coeff_mod_count]);
+            }
+        }
     }
 
-    void Evaluator::ckks_multiply(Ciphertext &encrypted1, 
+    void Evaluator::bfv_multiply_hps(Ciphertext &encrypted1,
         const Ciphertext &encrypted2, MemoryPoolHandle pool)
     {
-        if (!(encrypted1.is_ntt_form() && encrypted2.is_ntt_form()))
+        if (encrypted1.is_ntt_form() != encrypted2.is_ntt_form())
         {
-            throw invalid_argument("encrypted1 or encrypted2 must be in NTT form");
-        } 
+            throw invalid_argument("NTT form mismatch");
+        }
 
         // Extract encryption parameters.
         auto &context_data = *context_->context_data(encrypted1.parms_id());
@@ -591,13 +1179,158 @@ namespace seal
         size_t coeff_mod_count = coeff_modulus.size();
         size_t encrypted1_size = encrypted1.size();
         size_t encrypted2_size = encrypted2.size();
+        bool is_square = &encrypted1 == &encrypted2;
+        bool is_ntt_form = encrypted1.is_ntt_form();
 
-        double new_scale = encrypted1.scale() * encrypted2.scale(); 
-        
-        // Check that scale is positive and not too large
-        if (new_scale <= 0 || (static_cast<int>(log2(new_scale)) >=
-            context_data.total_coeff_modulus_bit_count()))
-        {
+        auto &hps_converter = *hps_converters_[context_data.chain_index()];
+        auto &aux_modulus = hps_converter.get_aux_mod_array();
+        size_t aux_mod_count = hps_converter.aux_base_mod_count();
+        size_t total_mod_count = add_safe(coeff_mod_count, aux_mod_count);
+        auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
+        auto &aux_small_ntt_tables = hps_converter.get_aux_small_ntt_tables();
+
+        // Determine destination.size()
+        size_t dest_count = sub_safe(add_safe(encrypted1_size, encrypted2_size), size_t(1));
+
+        // Size check
+        if (!product_fits_in(dest_count, coeff_count, total_mod_count))
+        {
+            throw logic_error("invalid parameters");
+        }
+
+        size_t encrypted_ptr_increment = coeff_count * coeff_mod_count;
+        size_t extended_ptr_increment = coeff_count * total_mod_count;
+
+        // Extends the components of a ciphertext to q U P, with the part in q first,
+        // and transforms them to NTT form. The base extension needs the components
+        // in coefficient form, but parts in q already in NTT form are used as they are.
+        auto extend_to_ntt = [&](const Ciphertext &encrypted, uint64_t *destination) {
+            size_t encrypted_size = encrypted.size();
+            Pointer<uint64_t> encrypted_coeff_copy;
+            const uint64_t *encrypted_coeff = encrypted.data();
+            if (is_ntt_form)
+            {
+                encrypted_coeff_copy = inverse_ntt_copy(encrypted.data(), encrypted_size,
+                    coeff_count, coeff_mod_count, coeff_small_ntt_tables.get(), pool);
+                encrypted_coeff = encrypted_coeff_copy.get();
+            }
+            for (size_t i = 0; i < encrypted_size; i++, destination += extended_ptr_increment)
+            {
+                set_uint_uint(encrypted.data(i), encrypted_ptr_increment, destination);
+                hps_converter.extend_to_aux(encrypted_coeff + (i * encrypted_ptr_increment),
+                    destination + encrypted_ptr_increment, pool);
+                for (size_t j = 0; j < coeff_mod_count && !is_ntt_form; j++)
+                {
+                    // Lazy reduction
+                    ntt_negacyclic_harvey_lazy(destination + (j * coeff_count),
+                        coeff_small_ntt_tables[j]);
+                }
+                for (size_t j = 0; j < aux_mod_count; j++)
+                {
+                    // Lazy reduction
+                    ntt_negacyclic_harvey_lazy(destination + encrypted_ptr_increment +
+                        (j * coeff_count), aux_small_ntt_tables[j]);
+                }
+            }
+        };
+
+        auto encrypted1_extended(allocate_poly(
+            coeff_count * encrypted1_size, total_mod_count, pool));
+        extend_to_ntt(encrypted1, encrypted1_extended.get());
+        Pointer<uint64_t> encrypted2_extended;
+        const uint64_t *encrypted2_extended_ptr = encrypted1_extended.get();
+        if (!is_square)
+        {
+            encrypted2_extended = allocate_poly(
+                coeff_count * encrypted2_size, total_mod_count, pool);
+            extend_to_ntt(encrypted2, encrypted2_extended.get());
+            encrypted2_extended_ptr = encrypted2_extended.get();
+        }
+
+        // Compute the tensor product in q U P; the cross terms of a square are
+        // computed only once
+        auto tmp_des_extended(allocate_zero_poly(
+            coeff_count * dest_count, total_mod_count, pool));
+        auto tmp_poly(allocate_uint(coeff_count, pool));
+        for (size_t encrypted1_index = 0; encrypted1_index < encrypted1_size;
+            encrypted1_index++)
+        {
+            for (size_t encrypted2_index = is_square ? encrypted1_index : 0;
+                encrypted2_index < encrypted2_size; encrypted2_index++)
+            {
+                bool is_cross_term = is_square && encrypted2_index != encrypted1_index;
+                const uint64_t *encrypted1_ptr = encrypted1_extended.get() +
+                    (encrypted1_index * extended_ptr_increment);
+                const uint64_t *encrypted2_ptr = encrypted2_extended_ptr +
+                    (encrypted2_index * extended_ptr_increment);
+                uint64_t *tmp_des_ptr = tmp_des_extended.get() +
+                    ((encrypted1_index + encrypted2_index) * extended_ptr_increment);
+                for (size_t j = 0; j < total_mod_count; j++, encrypted1_ptr += coeff_count,
+                    encrypted2_ptr += coeff_count, tmp_des_ptr += coeff_count)
+                {
+                    auto &modulus = j < coeff_mod_count ?
+                        coeff_modulus[j] : aux_modulus[j - coeff_mod_count];
+                    dyadic_product_coeffmod(encrypted1_ptr, encrypted2_ptr,
+                        coeff_count, modulus, tmp_poly.get());
+                    add_poly_poly_coeffmod(tmp_poly.get(), tmp_des_ptr,
+                        coeff_count, modulus, tmp_des_ptr);
+                    if (is_cross_term)
+                    {
+                        add_poly_poly_coeffmod(tmp_poly.get(), tmp_des_ptr,
+                            coeff_count, modulus, tmp_des_ptr);
+                    }
+                }
+            }
+        }
+
+        // Convert back from NTT form, scale by t/q, and transform the result back to
+        // NTT form if the inputs were in NTT form
+        encrypted1.resize(context_, parms.parms_id(), dest_count);
+        uint64_t *tmp_des_ptr = tmp_des_extended.get();
+        for (size_t i = 0; i < dest_count; i++, tmp_des_ptr += extended_ptr_increment)
+        {
+            for (size_t j = 0; j < coeff_mod_count; j++)
+            {
+                inverse_ntt_negacyclic_harvey(tmp_des_ptr + (j * coeff_count),
+                    coeff_small_ntt_tables[j]);
+            }
+            for (size_t j = 0; j < aux_mod_count; j++)
+            {
+                inverse_ntt_negacyclic_harvey(tmp_des_ptr + encrypted_ptr_increment +
+                    (j * coeff_count), aux_small_ntt_tables[j]);
+            }
+            hps_converter.scale_and_round(tmp_des_ptr, encrypted1.data(i), pool);
+            for (size_t j = 0; j < coeff_mod_count && is_ntt_form; j++)
+            {
+                ntt_negacyclic_harvey(encrypted1.data(i) + (j * coeff_count),
+                    coeff_small_ntt_tables[j]);
+            }
+        }
+    }
+
+    void Evaluator::ckks_multiply(Ciphertext &encrypted1, 
+        const Ciphertext &encrypted2, MemoryPoolHandle pool)
+    {
+        if (!(encrypted1.is_ntt_form() && encrypted2.is_ntt_form()))
+        {
+            throw invalid_argument("encrypted1 or encrypted2 must be in NTT form");
+        } 
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data(encrypted1.parms_id());
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        size_t encrypted1_size = encrypted1.size();
+        size_t encrypted2_size = encrypted2.size();
+
+        double new_scale = encrypted1.scale() * encrypted2.scale(); 
+        
+        // Check that scale is positive and not too large
+        if (new_scale <= 0 || (static_cast<int>(log2(new_scale)) >=
+            context_data.total_coeff_modulus_bit_count()))
+        {
             throw invalid_argument("scale out of bounds");
         }
 
@@ -702,11 +1435,27 @@ namespace seal
             throw invalid_argument("encrypted is not valid for encryption parameters");
         }
 
+        if (ckks_auto_alignment_ && perform_aligned_ckks<Ciphertext>(encrypted, encrypted,
+            false, "square_inplace", pool,
+            [this, &pool](Ciphertext &operand, const Ciphertext &) {
+                square_inplace(operand, pool);
+            }))
+        {
+            return;
+        }
+
         auto context_data_ptr = context_->context_data(encrypted.parms_id());
         switch (context_data_ptr->parms().scheme())
         {
         case scheme_type::BFV:
-            bfv_square(encrypted, move(pool));
+            if (bfv_multiply_type_ == bfv_multiply_type::HPS)
+            {
+                bfv_multiply_hps(encrypted, encrypted, move(pool));
+            }
+            else
+            {
+                bfv_square(encrypted, move(pool));
+            }
             break;
 
         case scheme_type::CKKS:
@@ -727,11 +1476,6 @@ namespace seal
 
     void Evaluator::bfv_square(Ciphertext &encrypted, MemoryPoolHandle pool)
     {
-        if (encrypted.is_ntt_form())
-        {
-            throw invalid_argument("encrypted cannot be in NTT form");
-        }
-
         // Extract encryption parameters.
         auto &context_data = *context_->context_data(encrypted.parms_id());
         auto &parms = context_data.parms();
@@ -779,13 +1523,24 @@ namespace seal
         auto tmp_encrypted_bsk(allocate_poly(
             coeff_count * encrypted_size, bsk_base_mod_count, pool));
 
+        // The base conversions need the input in coefficient form; see bfv_multiply
+        bool is_ntt_form = encrypted.is_ntt_form();
+        Pointer<uint64_t> encrypted_coeff_copy;
+        const uint64_t *encrypted_coeff = encrypted.data();
+        if (is_ntt_form)
+        {
+            encrypted_coeff_copy = inverse_ntt_copy(encrypted.data(), encrypted_size,
+                coeff_count, coeff_mod_count, coeff_small_ntt_tables.get(), pool);
+            encrypted_coeff = encrypted_coeff_copy.get();
+        }
+
         // Step 0: fast base convert from q to Bsk U {m_tilde}
         // Step 1: reduce q-overflows in Bsk
         // Iterate over all the ciphertexts inside encrypted1
         for (size_t i = 0; i < encrypted_size; i++)
         {
             base_converter->fastbconv_mtilde(
-                encrypted.data(i),
+                encrypted_coeff + (i * encrypted_ptr_increment),
                 tmp_encrypted_bsk_mtilde.get() +
                 (i * encrypted_bsk_mtilde_ptr_increment), pool);
             base_converter->mont_rq(
@@ -818,7 +1573,7 @@ namespace seal
 
         for (size_t i = 0; i < encrypted_size; i++)
         {
-            for (size_t j = 0; j < coeff_mod_count; j++)
+            for (size_t j = 0; j < coeff_mod_count && !is_ntt_form; j++)
             {
                 ntt_negacyclic_harvey_lazy(
                     copy_encrypted_ntt_coeff_mod.get() + (j * coeff_count) +
@@ -962,6 +1717,16 @@ namespace seal
             base_converter->fastbconv_sk(
                 tmp_result_bsk.get() + (i * encrypted_bsk_ptr_increment), encrypted.data(i), pool);
         }
+
+        // Transform the result back to NTT form
+        if (is_ntt_form)
+        {
+            for (size_t i = 0; i < dest_count * coeff_mod_count; i++)
+            {
+                ntt_negacyclic_harvey(encrypted.data() + (i * coeff_count),
+                    coeff_small_ntt_tables[i % coeff_mod_count]);
+            }
+        }
     }
 
     void Evaluator::ckks_square(Ciphertext &encrypted, MemoryPoolHandle pool)
@@ -1156,46 +1921,28 @@ namespace seal
             return;
         }
 
-        // Calculate number of relinearize_one_step calls needed
-        size_t relins_needed = encrypted_size - destination_size;
-
-        // Update temp to store the current result after relinearization
         switch (context_data.parms().scheme())
         {
             case scheme_type::BFV:
-            {
-                if (encrypted.is_ntt_form())
-                {
-                    throw invalid_argument("BFV encrypted cannot be in NTT form");
-                }
-                for (size_t i = 0; i < relins_needed; i++)
-                {
-                    bfv_relinearize_one_step(encrypted.data(), encrypted_size,
-                        context_data, relin_keys, pool);
-                    encrypted_size--;
-                }
+                // Ciphertexts in NTT form are relinearized as in CKKS, which
+                // keeps them in NTT form
                 break;
-            }
 
             case scheme_type::CKKS:
-            {
                 if (!encrypted.is_ntt_form())
                 {
                     throw invalid_argument("CKKS encrypted must be in NTT form");
                 }
-                for (size_t i = 0; i < relins_needed; i++)
-                {
-                    ckks_relinearize_one_step(encrypted.data(), encrypted_size,
-                        context_data, relin_keys, pool);
-                    encrypted_size--;
-                }
                 break;
-            }
 
             default:
                 throw invalid_argument("unsupported scheme");
         }
 
+        // All components beyond destination_size are switched in one pass
+        relinearize_components(encrypted.data(), encrypted_size, destination_size,
+            encrypted.is_ntt_form(), context_data, relin_keys, pool);
+
         // Put the output of final relinearization into destination.
         // Prepare destination only at this point because we are resizing down
         encrypted.resize(context_, parms.parms_id(), destination_size);
@@ -1208,9 +1955,10 @@ namespace seal
 #endif
     }
 
-    void Evaluator::bfv_relinearize_one_step(uint64_t *encrypted, 
-        size_t encrypted_size, const SEALContext::ContextData &context_data,
-        const RelinKeys &relin_keys, MemoryPool &pool)
+    void Evaluator::relinearize_components(uint64_t *encrypted,
+        size_t encrypted_size, size_t destination_size, bool is_ntt_form,
+        const SEALContext::ContextData &context_data, const RelinKeys &relin_keys,
+        MemoryPool &pool)
     {
         // Extract encryption parameters.
         // Parameters corresponding to the ciphertext level
@@ -1236,9 +1984,9 @@ namespace seal
         {
             throw invalid_argument("encrypted cannot be null");
         }
-        if (encrypted_size <= 2)
+        if (destination_size < 2 || destination_size >= encrypted_size)
         {
-            throw invalid_argument("encrypted_size must be at least 3");
+            throw invalid_argument("destination_size must be at least 2 and less than encrypted_size");
         }
         if (relin_keys.size() < sub_safe(encrypted_size, size_t(2)))
         {
@@ -1249,9 +1997,12 @@ namespace seal
         auto &first_context_data = *context_->context_data();
         auto &coeff_small_ntt_tables = first_context_data.small_ntt_tables();
 
-        // Decompose encrypted_array[count-1] into base w
-        // Want to create an array of polys, each of whose components i is
-        // (encrypted_array[count-1])^(i) - in the notation of FV paper.
+        // Decompose every component c_j, j >= destination_size, into base w
+        // and accumulate the inner products of the decompositions with the
+        // keys for s^j into c_0 and c_1. This is the same as relinearizing one
+        // component at a time from the top, since every step only adds to c_0
+        // and c_1, but the sums are reduced and, for ciphertexts not in NTT
+        // form, transformed back only once.
         // This allocation stores one of the decomposed factors modulo one of the primes.
         auto decomp_encrypted_last(allocate_uint(coeff_count, pool));
 
@@ -1267,362 +2018,253 @@ namespace seal
         are at most 60 bits, if the total number of summands is K, then the size of the
         total sum of products (without reduction) is at most 62 + 60 + bit_length(K).
         We need this to be at most 128, thus we need bit_length(K) <= 6. Thus, we need K <= 63.
-        In this case, this means sum_i relin_keys.data()[encrypted_size - 3][i].size() / 2 <= 63.
+        Across components, the accumulators are therefore reduced in place whenever
+        the summands of the next component would exceed this bound.
         */
-        const uint64_t *encrypted_coeff = encrypted + (encrypted_size - 1) * rns_poly_uint64_count;
-
-        for (size_t i = 0; i < coeff_mod_count; i++, encrypted_coeff += coeff_count)
+        const size_t max_lazy_summands = 63;
+        size_t lazy_summands = 0;
+        int decomposition_bit_count = relin_keys.decomposition_bit_count();
+        for (size_t component = encrypted_size; component-- > destination_size; )
         {
-            // We use HPS improvement to Bajard's RNS key switching so scaling by q_i/q not needed
-            // multiply_poly_scalar_coeffmod(
-            //     encrypted_coeff, coeff_count,
-            //     inv_coeff_products_mod_coeff_array[i], coeff_modulus[i],
-            //     encrypted_coeff_prod_inv_coeff.get());
-
-            int shift = 0;
-            auto &key_component_ref = relin_keys.data()[encrypted_size - 3][i];
-            size_t keys_size = key_component_ref.size();
-            for (size_t k = 0; k < keys_size; k += 2)
+            auto &key_ref = relin_keys.data()[component - 2];
+            size_t component_summands = 0;
+            for (size_t i = 0; i < coeff_mod_count; i++)
             {
-                const uint64_t *key_ptr_0 = key_component_ref.data(k);
-                const uint64_t *key_ptr_1 = key_component_ref.data(k + 1);
-
-                // Decompose here
-                int decomposition_bit_count = relin_keys.decomposition_bit_count();
-                for (size_t coeff_index = 0; coeff_index < coeff_count; coeff_index++)
+                component_summands += key_ref[i].size() / 2;
+            }
+            if (lazy_summands && lazy_summands + component_summands > max_lazy_summands)
+            {
+                uint64_t *wide_innerresult0_ptr = wide_innerresult0.get();
+                uint64_t *wide_innerresult1_ptr = wide_innerresult1.get();
+                for (size_t i = 0; i < coeff_mod_count; i++)
                 {
-                    decomp_encrypted_last[coeff_index] =
-                        encrypted_coeff[coeff_index] >> shift;
-                    decomp_encrypted_last[coeff_index] &= 
-                        (uint64_t(1) << decomposition_bit_count) - 1;
+                    for (size_t m = 0; m < coeff_count; m++,
+                        wide_innerresult0_ptr += 2, wide_innerresult1_ptr += 2)
+                    {
+                        wide_innerresult0_ptr[0] = barrett_reduce_128(
+                            wide_innerresult0_ptr, coeff_modulus[i]);
+                        wide_innerresult0_ptr[1] = 0;
+                        wide_innerresult1_ptr[0] = barrett_reduce_128(
+                            wide_innerresult1_ptr, coeff_modulus[i]);
+                        wide_innerresult1_ptr[1] = 0;
+                    }
                 }
+                lazy_summands = 0;
+            }
+            lazy_summands += component_summands;
 
-                uint64_t *wide_innerresult0_ptr = wide_innerresult0.get();
-                uint64_t *wide_innerresult1_ptr = wide_innerresult1.get();
-                for (size_t j = 0; j < coeff_mod_count; j++)
+            uint64_t *encrypted_coeff = encrypted + component * rns_poly_uint64_count;
+            for (size_t i = 0; i < coeff_mod_count; i++, encrypted_coeff += coeff_count)
+            {
+                // Convert the component from NTT to create a bit-decomposition;
+                // it is discarded afterwards
+                if (is_ntt_form)
                 {
-                    uint64_t *temp_decomp_coeff_ptr = temp_decomp_coeff.get();
-                    set_uint_uint(decomp_encrypted_last.get(), coeff_count, temp_decomp_coeff_ptr);
+                    inverse_ntt_negacyclic_harvey(encrypted_coeff, coeff_small_ntt_tables[i]);
+                }
 
-                    // We don't reduce here, so might get up to two extra bits. Thus 62 bits at most.
-                    ntt_negacyclic_harvey_lazy(temp_decomp_coeff_ptr, coeff_small_ntt_tables[j]);
+                // We use HPS improvement to Bajard's RNS key switching so scaling by q_i/q not needed
+                int shift = 0;
+                auto &key_component_ref = key_ref[i];
+                size_t keys_size = key_component_ref.size();
+                for (size_t k = 0; k < keys_size; k += 2)
+                {
+                    const uint64_t *key_ptr_0 = key_component_ref.data(k);
+                    const uint64_t *key_ptr_1 = key_component_ref.data(k + 1);
 
-                    // Lazy reduction
-                    unsigned long long wide_innerproduct[2];
-                    unsigned long long temp;
-                    for (size_t m = 0; m < coeff_count; m++, wide_innerresult0_ptr += 2)
+                    // Decompose here
+                    for (size_t coeff_index = 0; coeff_index < coeff_count; coeff_index++)
                     {
-                        multiply_uint64(*temp_decomp_coeff_ptr++, *key_ptr_0++, wide_innerproduct);
-                        unsigned char carry = add_uint64(wide_innerresult0_ptr[0],
-                            wide_innerproduct[0], &temp);
-                        wide_innerresult0_ptr[0] = temp;
-                        wide_innerresult0_ptr[1] += wide_innerproduct[1] + carry;
+                        decomp_encrypted_last[coeff_index] =
+                            encrypted_coeff[coeff_index] >> shift;
+                        decomp_encrypted_last[coeff_index] &= 
+                            (uint64_t(1) << decomposition_bit_count) - 1;
                     }
 
-                    temp_decomp_coeff_ptr = temp_decomp_coeff.get();
-                    for (size_t m = 0; m < coeff_count; m++, wide_innerresult1_ptr += 2)
+                    uint64_t *wide_innerresult0_ptr = wide_innerresult0.get();
+                    uint64_t *wide_innerresult1_ptr = wide_innerresult1.get();
+                    for (size_t j = 0; j < coeff_mod_count; j++)
                     {
-                        multiply_uint64(*temp_decomp_coeff_ptr++, *key_ptr_1++, wide_innerproduct);
-                        unsigned char carry = add_uint64(wide_innerresult1_ptr[0],
-                            wide_innerproduct[0], &temp);
-                        wide_innerresult1_ptr[0] = temp;
-                        wide_innerresult1_ptr[1] += wide_innerproduct[1] + carry;
+                        uint64_t *temp_decomp_coeff_ptr = temp_decomp_coeff.get();
+                        set_uint_uint(decomp_encrypted_last.get(), coeff_count, temp_decomp_coeff_ptr);
+
+                        // We don't reduce here, so might get up to two extra bits. Thus 62 bits at most.
+                        ntt_negacyclic_harvey_lazy(temp_decomp_coeff_ptr, coeff_small_ntt_tables[j]);
+
+                        // Lazy reduction
+                        unsigned long long wide_innerproduct[2];
+                        unsigned long long temp;
+                        for (size_t m = 0; m < coeff_count; m++, wide_innerresult0_ptr += 2)
+                        {
+                            multiply_uint64(*temp_decomp_coeff_ptr++, *key_ptr_0++, wide_innerproduct);
+                            unsigned char carry = add_uint64(wide_innerresult0_ptr[0],
+                                wide_innerproduct[0], &temp);
+                            wide_innerresult0_ptr[0] = temp;
+                            wide_innerresult0_ptr[1] += wide_innerproduct[1] + carry;
+                        }
+
+                        temp_decomp_coeff_ptr = temp_decomp_coeff.get();
+                        for (size_t m = 0; m < coeff_count; m++, wide_innerresult1_ptr += 2)
+                        {
+                            multiply_uint64(*temp_decomp_coeff_ptr++, *key_ptr_1++, wide_innerproduct);
+                            unsigned char carry = add_uint64(wide_innerresult1_ptr[0],
+                                wide_innerproduct[0], &temp);
+                            wide_innerresult1_ptr[0] = temp;
+                            wide_innerresult1_ptr[1] += wide_innerproduct[1] + carry;
+                        }
                     }
+                    shift += decomposition_bit_count;
                 }
-                shift += decomposition_bit_count;
             }
         }
 
-        uint64_t *innerresult_poly_ptr = innerresult.get();
-        uint64_t *wide_innerresult_poly_ptr = wide_innerresult0.get();
+        // Reduce the sums, transform them back if encrypted is not in NTT
+        // form, and add them to c_0 and c_1
         uint64_t *encrypted_ptr = encrypted;
-        uint64_t *innerresult_coeff_ptr = innerresult_poly_ptr;
-        uint64_t *wide_innerresult_coeff_ptr = wide_innerresult_poly_ptr;
-        for (size_t i = 0; i < coeff_mod_count; i++, innerresult_poly_ptr += coeff_count,
-            wide_innerresult_poly_ptr += 2 * coeff_count, encrypted_ptr += coeff_count)
+        for (uint64_t *wide_innerresult_ptr : { wide_innerresult0.get(), wide_innerresult1.get() })
         {
-            for (size_t m = 0; m < coeff_count; m++, wide_innerresult_coeff_ptr += 2)
+            uint64_t *innerresult_poly_ptr = innerresult.get();
+            for (size_t i = 0; i < coeff_mod_count; i++, innerresult_poly_ptr += coeff_count,
+                encrypted_ptr += coeff_count)
             {
-                *innerresult_coeff_ptr++ = barrett_reduce_128(
-                    wide_innerresult_coeff_ptr, coeff_modulus[i]);
+                uint64_t *innerresult_coeff_ptr = innerresult_poly_ptr;
+                for (size_t m = 0; m < coeff_count; m++, wide_innerresult_ptr += 2)
+                {
+                    *innerresult_coeff_ptr++ = barrett_reduce_128(
+                        wide_innerresult_ptr, coeff_modulus[i]);
+                }
+                if (!is_ntt_form)
+                {
+                    inverse_ntt_negacyclic_harvey(innerresult_poly_ptr, coeff_small_ntt_tables[i]);
+                }
+                add_poly_poly_coeffmod(encrypted_ptr, innerresult_poly_ptr, coeff_count,
+                    coeff_modulus[i], encrypted_ptr);
             }
-            inverse_ntt_negacyclic_harvey(innerresult_poly_ptr, coeff_small_ntt_tables[i]);
-            add_poly_poly_coeffmod(encrypted_ptr, innerresult_poly_ptr, coeff_count,
-                coeff_modulus[i], encrypted_ptr);
         }
+    }
 
-        innerresult_poly_ptr = innerresult.get();
-        wide_innerresult_poly_ptr = wide_innerresult1.get();
-        encrypted_ptr = encrypted + rns_poly_uint64_count;
-        innerresult_coeff_ptr = innerresult_poly_ptr;
-        wide_innerresult_coeff_ptr = wide_innerresult_poly_ptr;
-        for (size_t i = 0; i < coeff_mod_count; i++, innerresult_poly_ptr += coeff_count,
-            wide_innerresult_poly_ptr += 2 * coeff_count, encrypted_ptr += coeff_count)
+    void Evaluator::mod_switch_scale_to_next(const Ciphertext &encrypted, 
+        Ciphertext &destination, MemoryPoolHandle pool)
+    {
+        auto context_data_ptr = context_->context_data(encrypted.parms_id());
+        if (context_data_ptr->parms().scheme() == scheme_type::CKKS &&
+            !encrypted.is_ntt_form())
         {
-            for (size_t m = 0; m < coeff_count; m++, wide_innerresult_coeff_ptr += 2)
-            {
-                *innerresult_coeff_ptr++ = barrett_reduce_128(
-                    wide_innerresult_coeff_ptr, coeff_modulus[i]);
-            }
-            inverse_ntt_negacyclic_harvey(innerresult_poly_ptr, coeff_small_ntt_tables[i]);
-            add_poly_poly_coeffmod(encrypted_ptr, innerresult_poly_ptr, coeff_count,
-                coeff_modulus[i], encrypted_ptr);
+            throw invalid_argument("CKKS encrypted must be in NTT form");
+        }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
         }
-    }
 
-    void Evaluator::ckks_relinearize_one_step(uint64_t *encrypted, 
-        size_t encrypted_size, const SEALContext::ContextData &context_data,
-        const RelinKeys &relin_keys, MemoryPool &pool)
-    {
         // Extract encryption parameters.
-        // Parameters corresponding to the ciphertext level
-        auto &parms = context_data.parms();
-
-        // q_l corresponding to the ciphertext level
-        auto &coeff_modulus = parms.coeff_modulus();
-        size_t coeff_count = parms.poly_modulus_degree();
+        auto &context_data = *context_data_ptr;
+        auto &next_parms = context_data.next_context_data()->parms();
+        bool is_ntt_form = encrypted.is_ntt_form();
 
-        // number of factors in q_l
-        size_t coeff_mod_count = coeff_modulus.size();
+        // q_1,...,q_{k-1}
+        auto &next_coeff_modulus = next_parms.coeff_modulus();
+        size_t next_coeff_mod_count = next_coeff_modulus.size();
+        size_t coeff_count = next_parms.poly_modulus_degree();
+        size_t encrypted_size = encrypted.size();
+        auto &inv_last_coeff_mod_array =
+            context_data.base_converter()->get_inv_last_coeff_mod_array();
 
         // Size test
-        if (!product_fits_in(encrypted_size, coeff_count, coeff_mod_count))
+        if (!product_fits_in(coeff_count, encrypted_size, next_coeff_mod_count))
         {
             throw logic_error("invalid parameters");
         }
 
-        // n * number of factors in q_l
-        size_t rns_poly_uint64_count = coeff_count * coeff_mod_count;
-#ifdef SEAL_DEBUG
-        if (encrypted == nullptr)
+        // Only the component modulo the dropped prime q_k is needed in every
+        // other prime. In NTT form, it alone is transformed to coefficient
+        // representation and, reduced modulo each q_i, back to NTT form; the
+        // other components are updated where they are and stay in NTT form.
+        auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
+        auto &scaled_inv_last_coeff_mod_array =
+            context_data.base_converter()->get_scaled_inv_last_coeff_mod_array();
+        auto last_modulus = context_data.parms().coeff_modulus().back().value();
+        auto temp(allocate_uint(2 * coeff_count, pool));
+        uint64_t *last_ptr = temp.get();
+        uint64_t *temp_ptr = last_ptr + coeff_count;
+
+        // In-place the result is written over the input, which is safe since
+        // every component moves only towards the front
+        const uint64_t *encrypted_ptr = encrypted.data();
+        uint64_t *destination_ptr;
+        if (&encrypted == &destination)
         {
-            throw invalid_argument("encrypted cannot be null");
+            destination_ptr = destination.data();
         }
-        if (encrypted_size <= 2)
+        else
         {
-            throw invalid_argument("encrypted_size must be at least 3");
+            destination.resize(context_, next_parms.parms_id(), encrypted_size);
+            destination_ptr = destination.data();
         }
-        if (relin_keys.size() < sub_safe(encrypted_size, size_t(2)))
+
+        for (size_t poly_index = 0; poly_index < encrypted_size; poly_index++)
         {
-            throw invalid_argument("not enough evaluation keys");
-        }
-#endif
-        // q/qi mod qi
-        auto &first_context_data = *context_->context_data();
-        auto &coeff_small_ntt_tables = first_context_data.small_ntt_tables();
+            // Set last_ptr to ct mod qk in coefficient representation
+            set_uint_uint(encrypted_ptr + next_coeff_mod_count * coeff_count,
+                coeff_count, last_ptr);
+            if (is_ntt_form)
+            {
+                inverse_ntt_negacyclic_harvey(last_ptr,
+                    coeff_small_ntt_tables[next_coeff_mod_count]);
+            }
+            for (size_t mod_index = 0; mod_index < next_coeff_mod_count; mod_index++,
+                encrypted_ptr += coeff_count, destination_ptr += coeff_count)
+            {
+                auto &modulus = next_coeff_modulus[mod_index];
+                uint64_t modulus_value = modulus.value();
 
-        // Decompose encrypted_array[count-1] into base w
-        // Want to create an array of polys, each of whose components i is
-        // (encrypted_array[count-1])^(i) - in the notation of FV paper.
-        // This allocation stores one of the decomposed factors modulo one of the primes.
-        auto decomp_encrypted_last(allocate_uint(coeff_count, pool));
+                // (ct mod qk) mod qi, in NTT form with values in [0, 4qi)
+                if (last_modulus > modulus_value)
+                {
+                    for (size_t i = 0; i < coeff_count; i++)
+                    {
+                        uint64_t wide_coeff[2]{ last_ptr[i], 0 };
+                        temp_ptr[i] = barrett_reduce_128(wide_coeff, modulus);
+                    }
+                }
+                else
+                {
+                    set_uint_uint(last_ptr, coeff_count, temp_ptr);
+                }
+                if (is_ntt_form)
+                {
+                    ntt_negacyclic_harvey_lazy(temp_ptr, coeff_small_ntt_tables[mod_index]);
+                }
 
-        // Lazy reduction
-        auto wide_innerresult0(allocate_zero_poly(coeff_count, 2 * coeff_mod_count, pool));
-        auto wide_innerresult1(allocate_zero_poly(coeff_count, 2 * coeff_mod_count, pool));
-        auto innerresult(allocate_poly(coeff_count, coeff_mod_count, pool));
-        auto temp_decomp_coeff(allocate_uint(coeff_count, pool));
+                // qk^(-1) * ((ct mod qi) - (ct mod qk)) mod qi with Shoup's
+                // multiplication by the precomputed inverse
+                uint64_t four_times_modulus = modulus_value << 2;
+                uint64_t inv_last = inv_last_coeff_mod_array[mod_index];
+                uint64_t scaled_inv_last = scaled_inv_last_coeff_mod_array[mod_index];
+                for (size_t i = 0; i < coeff_count; i++)
+                {
+                    uint64_t difference = encrypted_ptr[i] + four_times_modulus - temp_ptr[i];
+                    unsigned long long quotient;
+                    multiply_uint64_hw64(scaled_inv_last, difference, &quotient);
+                    uint64_t result = difference * inv_last - quotient * modulus_value;
+                    destination_ptr[i] = result - (modulus_value &
+                        static_cast<uint64_t>(-static_cast<int64_t>(result >= modulus_value)));
+                }
+            }
 
-        /*
-        For lazy reduction to work here, we need to ensure that the 128-bit accumulators
-        (wide_innerresult0 and wide_innerresult1) do not overflow. Since the modulus primes
-        are at most 60 bits, if the total number of summands is K, then the size of the
-        total sum of products (without reduction) is at most 62 + 60 + bit_length(K).
-        We need this to be at most 128, thus we need bit_length(K) <= 6. Thus, we need K <= 63.
-        In this case, this means sum_i evaluation_keys.data()[encrypted_size - 3][i].size() / 2 <= 63.
-        */
-        uint64_t *encrypted_coeff = encrypted + (encrypted_size - 1) * rns_poly_uint64_count;
-
-        // inner product of evaluation keys and the bit-decomposition of the last ciphertext polynomial
-        for (size_t i = 0; i < coeff_mod_count; i++, encrypted_coeff += coeff_count)
-        {
-            // Convert the last polynomial of encrypted from NTT to create a bit-decomposition
-            inverse_ntt_negacyclic_harvey(encrypted_coeff, coeff_small_ntt_tables[i]);
-
-            // We use HPS improvement to Bajard's RNS key switching so scaling by q_i/q not needed
-            // multiply_poly_scalar_coeffmod(
-            //     encrypted_coeff, coeff_count,
-            //     inv_coeff_products_mod_coeff_array[i], coeff_modulus[i],
-            //     encrypted_coeff_prod_inv_coeff.get());
-
-            int shift = 0;
-            auto &key_component_ref = relin_keys.data()[encrypted_size - 3][i];
-            size_t keys_size = key_component_ref.size();
-            for (size_t k = 0; k < keys_size; k += 2)
-            {
-                const uint64_t *key_ptr_0 = key_component_ref.data(k);
-                const uint64_t *key_ptr_1 = key_component_ref.data(k + 1);
-
-                // Decompose here
-                int decomposition_bit_count = relin_keys.decomposition_bit_count();
-                for (size_t coeff_index = 0; coeff_index < coeff_count; coeff_index++)
-                {
-                    decomp_encrypted_last[coeff_index] =
-                        encrypted_coeff[coeff_index] >> shift;
-                    decomp_encrypted_last[coeff_index] &= 
-                        (uint64_t(1) << decomposition_bit_count) - 1;
-                }
-
-                uint64_t *wide_innerresult0_ptr = wide_innerresult0.get();
-                uint64_t *wide_innerresult1_ptr = wide_innerresult1.get();
-                for (size_t j = 0; j < coeff_mod_count; j++)
-                {
-                    uint64_t *temp_decomp_coeff_ptr = temp_decomp_coeff.get();
-                    set_uint_uint(decomp_encrypted_last.get(), coeff_count, temp_decomp_coeff_ptr);
-
-                    // We don't reduce here, so might get up to two extra bits. Thus 62 bits at most.
-                    ntt_negacyclic_harvey_lazy(temp_decomp_coeff_ptr, coeff_small_ntt_tables[j]);
-
-                    // Lazy reduction
-                    unsigned long long wide_innerproduct[2];
-                    unsigned long long temp;
-                    for (size_t m = 0; m < coeff_count; m++, wide_innerresult0_ptr += 2)
-                    {
-                        multiply_uint64(*temp_decomp_coeff_ptr++, *key_ptr_0++, wide_innerproduct);
-                        unsigned char carry = add_uint64(wide_innerresult0_ptr[0],
-                            wide_innerproduct[0], &temp);
-                        wide_innerresult0_ptr[0] = temp;
-                        wide_innerresult0_ptr[1] += wide_innerproduct[1] + carry;
-                    }
-
-                    temp_decomp_coeff_ptr = temp_decomp_coeff.get();
-                    for (size_t m = 0; m < coeff_count; m++, wide_innerresult1_ptr += 2)
-                    {
-                        multiply_uint64(*temp_decomp_coeff_ptr++, *key_ptr_1++, wide_innerproduct);
-                        unsigned char carry = add_uint64(wide_innerresult1_ptr[0],
-                            wide_innerproduct[0], &temp);
-                        wide_innerresult1_ptr[0] = temp;
-                        wide_innerresult1_ptr[1] += wide_innerproduct[1] + carry;
-                    }
-                }
-                shift += decomposition_bit_count;
-            }
-        }
-
-        uint64_t *innerresult_poly_ptr = innerresult.get();
-        uint64_t *wide_innerresult_poly_ptr = wide_innerresult0.get();
-        uint64_t *encrypted_ptr = encrypted;
-        uint64_t *innerresult_coeff_ptr = innerresult_poly_ptr;
-        uint64_t *wide_innerresult_coeff_ptr = wide_innerresult_poly_ptr;
-        for (size_t i = 0; i < coeff_mod_count; i++, innerresult_poly_ptr += coeff_count,
-            wide_innerresult_poly_ptr += 2 * coeff_count, encrypted_ptr += coeff_count)
-        {
-            for (size_t m = 0; m < coeff_count; m++, wide_innerresult_coeff_ptr += 2)
-            {
-                *innerresult_coeff_ptr++ = barrett_reduce_128(
-                    wide_innerresult_coeff_ptr, coeff_modulus[i]);
-            }
-            add_poly_poly_coeffmod(encrypted_ptr, innerresult_poly_ptr, coeff_count,
-                coeff_modulus[i], encrypted_ptr);
-        }
-
-        innerresult_poly_ptr = innerresult.get();
-        wide_innerresult_poly_ptr = wide_innerresult1.get();
-        encrypted_ptr = encrypted + rns_poly_uint64_count;
-        innerresult_coeff_ptr = innerresult_poly_ptr;
-        wide_innerresult_coeff_ptr = wide_innerresult_poly_ptr;
-        for (size_t i = 0; i < coeff_mod_count; i++, innerresult_poly_ptr += coeff_count,
-            wide_innerresult_poly_ptr += 2 * coeff_count, encrypted_ptr += coeff_count)
-        {
-            for (size_t m = 0; m < coeff_count; m++, wide_innerresult_coeff_ptr += 2)
-            {
-                *innerresult_coeff_ptr++ = barrett_reduce_128(
-                    wide_innerresult_coeff_ptr, coeff_modulus[i]);
-            }
-            add_poly_poly_coeffmod(encrypted_ptr, innerresult_poly_ptr, coeff_count,
-                coeff_modulus[i], encrypted_ptr);
-        }
-    }
-
-    void Evaluator::mod_switch_scale_to_next(const Ciphertext &encrypted, 
-        Ciphertext &destination, MemoryPoolHandle pool)
-    {
-        auto context_data_ptr = context_->context_data(encrypted.parms_id());
-        if (context_data_ptr->parms().scheme() == scheme_type::BFV &&
-            encrypted.is_ntt_form())
-        {
-            throw invalid_argument("BFV encrypted cannot be in NTT form");
-        }
-        if (context_data_ptr->parms().scheme() == scheme_type::CKKS &&
-            !encrypted.is_ntt_form())
-        {
-            throw invalid_argument("CKKS encrypted must be in NTT form");
-        }
-        if (!pool)
-        {
-            throw invalid_argument("pool is uninitialized");
-        }
-
-        // Extract encryption parameters.
-        auto &context_data = *context_data_ptr;
-        auto &next_parms = context_data.next_context_data()->parms();
-
-        // q_1,...,q_{k-1}
-        auto &next_coeff_modulus = next_parms.coeff_modulus();
-        size_t next_coeff_mod_count = next_coeff_modulus.size();
-        size_t coeff_count = next_parms.poly_modulus_degree();
-        size_t encrypted_size = encrypted.size();
-        auto &inv_last_coeff_mod_array =
-            context_data.base_converter()->get_inv_last_coeff_mod_array();
-
-        // Size test
-        if (!product_fits_in(coeff_count, encrypted_size, next_coeff_mod_count))
-        {
-            throw logic_error("invalid parameters");
+            // Skip the component modulo qk
+            encrypted_ptr += coeff_count;
         }
 
-        // In CKKS need to transform away from NTT form
-        Ciphertext encrypted_copy(pool);
-        encrypted_copy = encrypted;
-        if (next_parms.scheme() == scheme_type::CKKS)
-        {
-            transform_from_ntt_inplace(encrypted_copy);
-        }
-
-        auto temp1(allocate_uint(coeff_count, pool));
-
-        // Allocate enough room for the result
-        auto temp2(allocate_poly(coeff_count * encrypted_size, next_coeff_mod_count, pool));
-        auto temp2_ptr = temp2.get();
-
-        for (size_t poly_index = 0; poly_index < encrypted_size; poly_index++)
+        if (&encrypted == &destination)
         {
-            // Set temp1 to ct mod qk
-            set_uint_uint(encrypted_copy.data(poly_index) + next_coeff_mod_count * coeff_count,
-                coeff_count, temp1.get());
-            for (size_t mod_index = 0; mod_index < next_coeff_mod_count; mod_index++,
-                temp2_ptr += coeff_count)
-            {
-                // (ct mod qk) mod qi
-                modulo_poly_coeffs(temp1.get(), coeff_count,
-                    next_coeff_modulus[mod_index], temp2_ptr);
-                // (-(ct mod qk)) mod qi
-                negate_poly_coeffmod(temp2_ptr, coeff_count,
-                    next_coeff_modulus[mod_index], temp2_ptr);
-                // ((ct mod qi) - (ct mod qk)) mod qi
-                add_poly_poly_coeffmod(
-                    encrypted_copy.data(poly_index) + mod_index * coeff_count, temp2_ptr,
-                    coeff_count, next_coeff_modulus[mod_index], temp2_ptr);
-                // qk^(-1) * ((ct mod qi) - (ct mod qk)) mod qi
-                multiply_poly_scalar_coeffmod(temp2_ptr, coeff_count,
-                    inv_last_coeff_mod_array[mod_index],
-                    next_coeff_modulus[mod_index], temp2_ptr);
-            }
+            destination.resize(context_, next_parms.parms_id(), encrypted_size);
         }
+        destination.is_ntt_form() = is_ntt_form;
 
-        // Resize destination
-        destination.resize(context_, next_parms.parms_id(), encrypted_size);
-        destination.is_ntt_form() = false;
-
-        set_poly_poly(temp2.get(), coeff_count * encrypted_size, next_coeff_mod_count,
-            destination.data());
-
-        // In CKKS need to transform back to NTT form
+        // In CKKS also change the scale
         if (next_parms.scheme() == scheme_type::CKKS)
         {
-            transform_to_ntt_inplace(destination);
-
-            // Also change the scale
             destination.scale() = encrypted.scale() /
                 static_cast<double>(context_data.parms().coeff_modulus().back().value());
         }
@@ -1943,9 +2585,9 @@ namespace seal
 #endif
     }
 
-    void Evaluator::multiply_many(vector<Ciphertext> &encrypteds,
+    void Evaluator::multiply_many(const vector<Ciphertext> &encrypteds,
         const RelinKeys &relin_keys, Ciphertext &destination,
-        MemoryPoolHandle pool)
+        MemoryPoolHandle pool, size_t thread_count)
     {
         // Verify parameters.
         if (encrypteds.size() == 0)
@@ -1962,22 +2604,10 @@ namespace seal
             {
                 throw invalid_argument("encrypteds must be different from destination");
             }
-        }
-
-        // There is at least one ciphertext
-        auto context_data_ptr = context_->context_data(encrypteds[0].parms_id());
-        if (!context_data_ptr)
-        {
-            throw invalid_argument("encrypteds is not valid for encryption parameters");
-        }
-
-        // Extract encryption parameters.
-        auto &context_data = *context_data_ptr;
-        auto &parms = context_data.parms();
-
-        if (parms.scheme() != scheme_type::BFV)
-        {
-            throw logic_error("unsupported scheme");
+            if (!context_->context_data(encrypteds[i].parms_id()))
+            {
+                throw invalid_argument("encrypteds is not valid for encryption parameters");
+            }
         }
 
         // If there is only one ciphertext, return it.
@@ -1987,29 +2617,80 @@ namespace seal
             return;
         }
 
-        // Repeatedly multiply and add to the back of the vector until the end is reached
-        Ciphertext product(context_, parms.parms_id(), pool);
-        for (size_t i = 0; i < encrypteds.size() - 1; i += 2)
+        // Multiply the ciphertexts as a balanced binary tree. The pairs on a level
+        // are multiplied in parallel; with an odd count the last ciphertext moves
+        // up a level unchanged. The products of a level are kept until the next 
+        // level has been computed.
+        vector<const Ciphertext *> operands;
+        for (auto &encrypted : encrypteds)
+        {
+            operands.push_back(&encrypted);
+        }
+        vector<Ciphertext> level;
+        while (operands.size() > 1)
         {
-            // We only compare pointers to determine if a faster path can be taken.
-            // This is under the assumption that if the two pointers are the same and
-            // the parameter sets match, then it makes no sense for one of the ciphertexts
-            // to be of different size than the other. More generally, it seems like
-            // a reasonable assumption that if the pointers are the same, then the
-            // ciphertexts are the same.
-            if (encrypteds[i].data() == encrypteds[i + 1].data())
+            size_t pair_count = operands.size() / 2;
+            vector<Ciphertext> products(operands.size() - pair_count);
+            parallel_for(pair_count, thread_count, [&](size_t begin, size_t end) {
+                auto thread_pool = begin ? MemoryPoolHandle::New() : pool;
+                Ciphertext aligned(thread_pool);
+                for (size_t i = begin; i < end; i++)
+                {
+                    const Ciphertext *encrypted1 = operands[2 * i];
+                    const Ciphertext *encrypted2 = operands[2 * i + 1];
+
+                    // Switch the operand at the higher level down to the level of 
+                    // the other
+                    if (encrypted1->parms_id() != encrypted2->parms_id())
+                    {
+                        if (context_->context_data(encrypted1->parms_id())->chain_index() >
+                            context_->context_data(encrypted2->parms_id())->chain_index())
+                        {
+                            swap(encrypted1, encrypted2);
+                        }
+                        mod_switch_to(*encrypted2, encrypted1->parms_id(), aligned, thread_pool);
+                        encrypted2 = &aligned;
+                    }
+
+                    Ciphertext product(thread_pool);
+                    
+                    // We only compare pointers to determine if a faster path can be taken.
+                    // This is under the assumption that if the two pointers are the same and
+                    // the parameter sets match, then it makes no sense for one of the ciphertexts
+                    // to be of different size than the other. More generally, it seems like
+                    // a reasonable assumption that if the pointers are the same, then the
+                    // ciphertexts are the same.
+                    if (encrypted1->data() == encrypted2->data())
+                    {
+                        square(*encrypted1, product, thread_pool);
+                    }
+                    else
+                    {
+                        multiply(*encrypted1, *encrypted2, product, thread_pool);
+                    }
+                    relinearize_inplace(product, relin_keys, thread_pool);
+                    if (context_->context_data(product.parms_id())->parms().scheme() == 
+                        scheme_type::CKKS)
+                    {
+                        rescale_to_next_inplace(product, thread_pool);
+                    }
+                    products[i] = move(product);
+                }
+            });
+            if (operands.size() & 1)
             {
-                square(encrypteds[i], product);
+                products.back() = *operands.back();
             }
-            else
+
+            level = move(products);
+            operands.clear();
+            for (auto &product : level)
             {
-                multiply(encrypteds[i], encrypteds[i + 1], product);
+                operands.push_back(&product);
             }
-            relinearize_inplace(product, relin_keys, pool);
-            encrypteds.emplace_back(product);
         }
 
-        destination = encrypteds[encrypteds.size() - 1];
+        destination = move(level[0]);
     }
 
     void Evaluator::exponentiate_inplace(Ciphertext &encrypted, uint64_t exponent,
@@ -2033,6 +2714,10 @@ namespace seal
         {
             throw invalid_argument("exponent cannot be 0");
         }
+        if (context_data_ptr->parms().scheme() != scheme_type::BFV)
+        {
+            throw logic_error("unsupported scheme");
+        }
 
         // Fast case
         if (exponent == 1)
@@ -2045,7 +2730,8 @@ namespace seal
         multiply_many(exp_vector, relin_keys, encrypted, move(pool));
     }
 
-    void Evaluator::add_plain_inplace(Ciphertext &encrypted, const Plaintext &plain)
+    void Evaluator::add_plain_inplace(Ciphertext &encrypted, const Plaintext &plain,
+        MemoryPoolHandle pool)
     {
         // Verify parameters.
         if (!encrypted.is_metadata_valid_for(context_))
@@ -2056,22 +2742,35 @@ namespace seal
         {
             throw invalid_argument("plain is not valid for encryption parameters");
         }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+
+        if (ckks_auto_alignment_ && perform_aligned_ckks<Plaintext>(encrypted, plain,
+            true, "add_plain_inplace", pool,
+            [this, &pool](Ciphertext &operand1, const Plaintext &operand2) {
+                add_plain_inplace(operand1, operand2, pool);
+            }))
+        {
+            return;
+        }
 
         auto &context_data = *context_->context_data(encrypted.parms_id());
         auto &parms = context_data.parms();
-        if (parms.scheme() == scheme_type::BFV && encrypted.is_ntt_form())
+        if (parms.scheme() == scheme_type::BFV && plain.is_ntt_form())
         {
-            throw invalid_argument("BFV encrypted cannot be in NTT form");
+            throw invalid_argument("BFV plain cannot be in NTT form");
         }
         if (parms.scheme() == scheme_type::CKKS && !encrypted.is_ntt_form())
         {
             throw invalid_argument("CKKS encrypted must be in NTT form");
         }
-        if (plain.is_ntt_form() != encrypted.is_ntt_form())
+        if (parms.scheme() == scheme_type::CKKS && !plain.is_ntt_form())
         {
             throw invalid_argument("NTT form mismatch");
         }
-        if (encrypted.is_ntt_form() &&
+        if (plain.is_ntt_form() &&
             (encrypted.parms_id() != plain.parms_id()))
         {
             throw invalid_argument("encrypted and plain parameter mismatch");
@@ -2100,6 +2799,16 @@ namespace seal
             auto plain_upper_half_threshold = context_data.plain_upper_half_threshold();
             auto upper_half_increment = context_data.upper_half_increment();
 
+            // For a ciphertext in NTT form the scaled plaintext is first written
+            // to a temporary polynomial and then added in NTT form
+            Pointer<uint64_t> scaled_plain;
+            uint64_t *destination = encrypted.data();
+            if (encrypted.is_ntt_form())
+            {
+                scaled_plain = allocate_zero_poly(coeff_count, coeff_mod_count, pool);
+                destination = scaled_plain.get();
+            }
+
             for (size_t i = 0; i < plain.coeff_count(); i++)
             {
                 // This is Encryptor::preencrypt
@@ -2114,8 +2823,8 @@ namespace seal
                         multiply_uint64(coeff_div_plain_modulus[j], plain[i], temp);
                         temp[1] += add_uint64(temp[0], upper_half_increment[j], temp);
                         uint64_t scaled_plain_coeff = barrett_reduce_128(temp, coeff_modulus[j]);
-                        *(encrypted.data() + i + (j * coeff_count)) = add_uint_uint_mod(
-                            *(encrypted.data() + i + (j * coeff_count)),
+                        *(destination + i + (j * coeff_count)) = add_uint_uint_mod(
+                            *(destination + i + (j * coeff_count)),
                             scaled_plain_coeff, coeff_modulus[j]);
                     }
                 }
@@ -2125,12 +2834,25 @@ namespace seal
                     {
                         uint64_t scaled_plain_coeff = multiply_uint_uint_mod(
                             coeff_div_plain_modulus[j], plain[i], coeff_modulus[j]);
-                        *(encrypted.data() + i + (j * coeff_count)) = add_uint_uint_mod(
-                            *(encrypted.data() + i + (j * coeff_count)),
+                        *(destination + i + (j * coeff_count)) = add_uint_uint_mod(
+                            *(destination + i + (j * coeff_count)),
                             scaled_plain_coeff, coeff_modulus[j]);
                     }
                 }
             }
+
+            if (encrypted.is_ntt_form())
+            {
+                auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
+                for (size_t j = 0; j < coeff_mod_count; j++)
+                {
+                    ntt_negacyclic_harvey(scaled_plain.get() + (j * coeff_count),
+                        coeff_small_ntt_tables[j]);
+                    add_poly_poly_coeffmod(encrypted.data() + (j * coeff_count),
+                        scaled_plain.get() + (j * coeff_count), coeff_count,
+                        coeff_modulus[j], encrypted.data() + (j * coeff_count));
+                }
+            }
             break;
         }
 
@@ -2157,7 +2879,8 @@ namespace seal
 #endif
     }
 
-    void Evaluator::sub_plain_inplace(Ciphertext &encrypted, const Plaintext &plain)
+    void Evaluator::sub_plain_inplace(Ciphertext &encrypted, const Plaintext &plain,
+        MemoryPoolHandle pool)
     {
         // Verify parameters.
         if (!encrypted.is_metadata_valid_for(context_))
@@ -2168,22 +2891,35 @@ namespace seal
         {
             throw invalid_argument("plain is not valid for encryption parameters");
         }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+
+        if (ckks_auto_alignment_ && perform_aligned_ckks<Plaintext>(encrypted, plain,
+            true, "sub_plain_inplace", pool,
+            [this, &pool](Ciphertext &operand1, const Plaintext &operand2) {
+                sub_plain_inplace(operand1, operand2, pool);
+            }))
+        {
+            return;
+        }
 
         auto &context_data = *context_->context_data(encrypted.parms_id());
         auto &parms = context_data.parms();
-        if (parms.scheme() == scheme_type::BFV && encrypted.is_ntt_form())
+        if (parms.scheme() == scheme_type::BFV && plain.is_ntt_form())
         {
-            throw invalid_argument("BFV encrypted cannot be in NTT form");
+            throw invalid_argument("BFV plain cannot be in NTT form");
         }
         if (parms.scheme() == scheme_type::CKKS && !encrypted.is_ntt_form())
         {
             throw invalid_argument("CKKS encrypted must be in NTT form");
         }
-        if (plain.is_ntt_form() != encrypted.is_ntt_form())
+        if (parms.scheme() == scheme_type::CKKS && !plain.is_ntt_form())
         {
             throw invalid_argument("NTT form mismatch");
         }
-        if (encrypted.is_ntt_form() &&
+        if (plain.is_ntt_form() &&
             (encrypted.parms_id() != plain.parms_id()))
         {
             throw invalid_argument("encrypted and plain parameter mismatch");
@@ -2212,6 +2948,16 @@ namespace seal
             auto plain_upper_half_threshold = context_data.plain_upper_half_threshold();
             auto upper_half_increment = context_data.upper_half_increment();
 
+            // For a ciphertext in NTT form the scaled plaintext is first written
+            // to a temporary polynomial and then added in NTT form
+            Pointer<uint64_t> scaled_plain;
+            uint64_t *destination = encrypted.data();
+            if (encrypted.is_ntt_form())
+            {
+                scaled_plain = allocate_zero_poly(coeff_count, coeff_mod_count, pool);
+                destination = scaled_plain.get();
+            }
+
             for (size_t i = 0; i < plain.coeff_count(); i++)
             {
                 // This is Encryptor::preencrypt changed to subtract instead
@@ -2226,8 +2972,8 @@ namespace seal
                         multiply_uint64(coeff_div_plain_modulus[j], plain[i], temp);
                         temp[1] += add_uint64(temp[0], upper_half_increment[j], temp);
                         uint64_t scaled_plain_coeff = barrett_reduce_128(temp, coeff_modulus[j]);
-                        *(encrypted.data() + i + (j * coeff_count)) = sub_uint_uint_mod(
-                            *(encrypted.data() + i + (j * coeff_count)),
+                        *(destination + i + (j * coeff_count)) = sub_uint_uint_mod(
+                            *(destination + i + (j * coeff_count)),
                             scaled_plain_coeff, coeff_modulus[j]);
                     }
                 }
@@ -2237,12 +2983,25 @@ namespace seal
                     {
                         uint64_t scaled_plain_coeff = multiply_uint_uint_mod(
                             coeff_div_plain_modulus[j], plain[i], coeff_modulus[j]);
-                        *(encrypted.data() + i + (j * coeff_count)) = sub_uint_uint_mod(
-                            *(encrypted.data() + i + (j * coeff_count)),
+                        *(destination + i + (j * coeff_count)) = sub_uint_uint_mod(
+                            *(destination + i + (j * coeff_count)),
                             scaled_plain_coeff, coeff_modulus[j]);
                     }
                 }
             }
+
+            if (encrypted.is_ntt_form())
+            {
+                auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
+                for (size_t j = 0; j < coeff_mod_count; j++)
+                {
+                    ntt_negacyclic_harvey(scaled_plain.get() + (j * coeff_count),
+                        coeff_small_ntt_tables[j]);
+                    add_poly_poly_coeffmod(encrypted.data() + (j * coeff_count),
+                        scaled_plain.get() + (j * coeff_count), coeff_count,
+                        coeff_modulus[j], encrypted.data() + (j * coeff_count));
+                }
+            }
             break;
         }
 
@@ -2285,7 +3044,11 @@ namespace seal
         {
             throw invalid_argument("encrypted is not valid for encryption parameters");
         }
-        if (encrypted.is_ntt_form() != plain.is_ntt_form())
+        // BFV ciphertexts in NTT form can be multiplied with plaintexts in
+        // either form
+        if (encrypted.is_ntt_form() != plain.is_ntt_form() &&
+            (plain.is_ntt_form() ||
+            context_->context_data()->parms().scheme() != scheme_type::BFV))
         {
             throw invalid_argument("NTT form mismatch");
         }
@@ -2294,7 +3057,16 @@ namespace seal
             throw invalid_argument("pool is uninitialized");
         }
 
-        if (encrypted.is_ntt_form())
+        if (ckks_auto_alignment_ && perform_aligned_ckks<Plaintext>(encrypted, plain,
+            false, "multiply_plain_inplace", pool,
+            [this, &pool](Ciphertext &operand1, const Plaintext &operand2) {
+                multiply_plain_inplace(operand1, operand2, pool);
+            }))
+        {
+            return;
+        }
+
+        if (plain.is_ntt_form())
         {
             multiply_plain_ntt(encrypted, plain);
         }
@@ -2311,172 +3083,276 @@ namespace seal
 #endif
     }
 
-    void Evaluator::multiply_plain_normal(Ciphertext &encrypted, 
-        const Plaintext &plain, MemoryPool &pool)
+    void Evaluator::multiply_plain_inplace(Ciphertext &encrypted,
+        const Plaintext &plain, PlaintextNTTCache &cache, MemoryPoolHandle pool)
     {
-        // Extract encryption parameters.
-        auto &context_data = *context_->context_data(encrypted.parms_id());
-        auto &parms = context_data.parms();
-        auto &coeff_modulus = parms.coeff_modulus();
-        size_t coeff_count = parms.poly_modulus_degree();
-        size_t coeff_mod_count = coeff_modulus.size();
-
-        auto plain_upper_half_threshold = context_data.plain_upper_half_threshold();
-        auto plain_upper_half_increment = context_data.plain_upper_half_increment();
-        auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
-
-        size_t encrypted_size = encrypted.size();
-        size_t plain_coeff_count = plain.coeff_count();
-
-        // Size check
-        if (!product_fits_in(encrypted_size, coeff_count, coeff_mod_count))
+        // Constant plaintexts are multiplied without any NTT and plaintexts in
+        // NTT form need no transformation
+        if (plain.is_ntt_form() || plain.coeff_count() <= 1 ||
+            context_->context_data()->parms().scheme() != scheme_type::BFV)
         {
-            throw logic_error("invalid parameters");
+            multiply_plain_inplace(encrypted, plain, move(pool));
+            return;
         }
 
-        double new_scale = encrypted.scale() * plain.scale();
-
-        // Check that scale is positive and not too large
-        if (new_scale <= 0 || (static_cast<int>(log2(new_scale)) >=
-            context_data.total_coeff_modulus_bit_count()))
+        // Verify parameters; plain is verified by the cache
+        if (!encrypted.is_metadata_valid_for(context_))
         {
-            throw invalid_argument("scale out of bounds");
+            throw invalid_argument("encrypted is not valid for encryption parameters");
         }
-
-        // Set the scale
-        encrypted.scale() = new_scale;
-
-        // Multiplying just by a constant?
-        if (plain_coeff_count == 1)
+        if (!context_->context_data(encrypted.parms_id()))
         {
-            if (!context_data.qualifiers().using_fast_plain_lift)
-            {
-                auto adjusted_coeff(allocate_uint(coeff_mod_count, pool));
-                if (plain[0] >= plain_upper_half_threshold)
-                {
-                    auto decomposed_coeff(allocate_uint(coeff_mod_count, pool));
-                    add_uint_uint64(plain_upper_half_increment, plain[0],
-                        coeff_mod_count, adjusted_coeff.get());
-                    decompose_single_coeff(context_data, adjusted_coeff.get(), 
-                        decomposed_coeff.get(), pool);
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
 
-                    for (size_t i = 0; i < encrypted_size; i++)
-                    {
-                        for (size_t j = 0; j < coeff_mod_count; j++)
-                        {
-                            multiply_poly_scalar_coeffmod(
-                                encrypted.data(i) + (j * coeff_count), coeff_count,
-                                decomposed_coeff[j], coeff_modulus[j],
-                                encrypted.data(i) + (j * coeff_count));
-                        }
-                    }
-                }
-                else
-                {
-                    for (size_t i = 0; i < encrypted_size; i++)
-                    {
-                        for (size_t j = 0; j < coeff_mod_count; j++)
-                        {
-                            multiply_poly_scalar_coeffmod(
-                                encrypted.data(i) + (j * coeff_count), coeff_count,
-                                plain[0], coeff_modulus[j],
-                                encrypted.data(i) + (j * coeff_count));
-                        }
-                    }
-                }
-                return;
-            }
-            else
-            {
-                // Need for lift plain coefficient in RNS form regarding to each qi
-                if (plain[0] >= plain_upper_half_threshold)
+        auto plain_ntt = cache.get(plain, encrypted.parms_id(), move(pool));
+        multiply_plain_transformed(encrypted, plain_ntt->data());
+#ifndef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (encrypted.is_transparent())
+        {
+            throw logic_error("result ciphertext is transparent");
+        }
+#endif
+    }
+
+    void Evaluator::multiply_plain_inplace(Ciphertext &encrypted_ntt,
+        const PlaintextDatabase &database, size_t index)
+    {
+        // Verify parameters.
+        if (!encrypted_ntt.is_metadata_valid_for(context_))
+        {
+            throw invalid_argument("encrypted_ntt is not valid for encryption parameters");
+        }
+        if (!encrypted_ntt.is_ntt_form())
+        {
+            throw invalid_argument("encrypted_ntt is not in NTT form");
+        }
+        if (encrypted_ntt.parms_id() != database.parms_id())
+        {
+            throw invalid_argument("encrypted_ntt and database parameter mismatch");
+        }
+
+        multiply_plain_ntt(encrypted_ntt, database.data(index), database.scale(index));
+#ifndef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (encrypted_ntt.is_transparent())
+        {
+            throw logic_error("result ciphertext is transparent");
+        }
+#endif
+    }
+
+    void Evaluator::inner_product_plain(const vector<Ciphertext> &encrypteds,
+        const vector<Plaintext> &plains, Ciphertext &destination,
+        MemoryPoolHandle pool, size_t thread_count)
+    {
+        if (encrypteds.size() != plains.size())
+        {
+            throw invalid_argument("encrypteds and plains size mismatch");
+        }
+
+        inner_product_plain_internal(encrypteds, [&](CiphertextAccumulator &accumulator,
+            const Ciphertext &encrypted_ntt, size_t index, Plaintext &plain_ntt,
+            const MemoryPoolHandle &thread_pool) {
+                auto &plain = plains[index];
+                if (plain.is_ntt_form())
                 {
-                    for (size_t i = 0; i < encrypted_size; i++)
-                    {
-                        for (size_t j = 0; j < coeff_mod_count; j++)
-                        {
-                            multiply_poly_scalar_coeffmod(
-                                encrypted.data(i) + (j * coeff_count), coeff_count,
-                                plain[0] + plain_upper_half_increment[j],
-                                coeff_modulus[j], encrypted.data(i) + (j * coeff_count));
-                        }
-                    }
+                    accumulator.multiply_plain_add(encrypted_ntt, plain);
                 }
-                // No need for lifting
                 else
                 {
-                    for (size_t i = 0; i < encrypted_size; i++)
-                    {
-                        for (size_t j = 0; j < coeff_mod_count; j++)
-                        {
-                            multiply_poly_scalar_coeffmod(
-                                encrypted.data(i) + (j * coeff_count), coeff_count,
-                                plain[0], coeff_modulus[j],
-                                encrypted.data(i) + (j * coeff_count));
-                        }
-                    }
+                    transform_to_ntt(plain, encrypted_ntt.parms_id(), plain_ntt, thread_pool);
+                    accumulator.multiply_plain_add(encrypted_ntt, plain_ntt);
                 }
-                return;
+            }, destination, move(pool), thread_count);
+    }
+
+    void Evaluator::inner_product_plain(const vector<Ciphertext> &encrypteds,
+        const PlaintextDatabase &database, size_t first_index, 
+        Ciphertext &destination, MemoryPoolHandle pool, size_t thread_count)
+    {
+        if (first_index > database.size() || 
+            encrypteds.size() > database.size() - first_index)
+        {
+            throw out_of_range("database is too small");
+        }
+
+        inner_product_plain_internal(encrypteds, [&](CiphertextAccumulator &accumulator,
+            const Ciphertext &encrypted_ntt, size_t index, Plaintext &, 
+            const MemoryPoolHandle &) {
+                accumulator.multiply_plain_add(encrypted_ntt, database, first_index + index);
+            }, destination, move(pool), thread_count);
+    }
+
+    void Evaluator::inner_product_plain_internal(const vector<Ciphertext> &encrypteds,
+        const function<void(CiphertextAccumulator &, const Ciphertext &, 
+            size_t, Plaintext &, const MemoryPoolHandle &)> &multiply_add,
+        Ciphertext &destination, MemoryPoolHandle pool, size_t thread_count)
+    {
+        // Verify parameters.
+        if (encrypteds.empty())
+        {
+            throw invalid_argument("encrypteds cannot be empty");
+        }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            if (&encrypteds[i] == &destination)
+            {
+                throw invalid_argument("encrypteds must be different from destination");
+            }
+            if (!encrypteds[i].is_metadata_valid_for(context_))
+            {
+                throw invalid_argument("encrypteds is not valid for encryption parameters");
+            }
+            if (encrypteds[i].parms_id() != encrypteds[0].parms_id())
+            {
+                throw invalid_argument("encrypteds parameter mismatch");
+            }
+            if (encrypteds[i].is_ntt_form() != encrypteds[0].is_ntt_form())
+            {
+                throw invalid_argument("NTT form mismatch");
             }
         }
 
-        // Generic plain case
-        auto adjusted_poly(allocate_zero_uint(coeff_count * coeff_mod_count, pool));
-        auto decomposed_poly(allocate_uint(coeff_count * coeff_mod_count, pool));
-        uint64_t *poly_to_transform = nullptr;
-        if (!context_data.qualifiers().using_fast_plain_lift)
+        // BFV ciphertexts are transformed to NTT form term by term and the sum is 
+        // transformed back once at the end
+        bool transform = !encrypteds[0].is_ntt_form();
+
+        // Each thread accumulates a contiguous range of the terms in its own 
+        // accumulator
+        if (!thread_count)
         {
-            // Reposition coefficients.
-            const uint64_t *plain_ptr = plain.data();
-            uint64_t *adjusted_poly_ptr = adjusted_poly.get();
-            for (size_t i = 0; i < plain_coeff_count; i++, plain_ptr++,
-                adjusted_poly_ptr += coeff_mod_count)
+            thread_count = hardware_thread_count();
+        }
+        thread_count = min(thread_count, encrypteds.size());
+        vector<MemoryPoolHandle> pools;
+        vector<CiphertextAccumulator> accumulators;
+        accumulators.reserve(thread_count);
+        for (size_t t = 0; t < thread_count; t++)
+        {
+            pools.push_back(t ? MemoryPoolHandle::New() : pool);
+            accumulators.emplace_back(context_, pools[t]);
+        }
+        parallel_for(thread_count, thread_count, [&](size_t thread_index, size_t) {
+            auto &thread_pool = pools[thread_index];
+            size_t begin = encrypteds.size() * thread_index / thread_count;
+            size_t end = encrypteds.size() * (thread_index + 1) / thread_count;
+            Ciphertext encrypted_ntt(thread_pool);
+            Plaintext plain_ntt(thread_pool);
+            for (size_t i = begin; i < end; i++)
             {
-                if (*plain_ptr >= plain_upper_half_threshold)
-                {
-                    add_uint_uint64(plain_upper_half_increment,
-                        *plain_ptr, coeff_mod_count, adjusted_poly_ptr);
-                }
-                else
+                const Ciphertext *encrypted = &encrypteds[i];
+                if (transform)
                 {
-                    *adjusted_poly_ptr = *plain_ptr;
+                    encrypted_ntt = *encrypted;
+                    transform_to_ntt_inplace(encrypted_ntt);
+                    encrypted = &encrypted_ntt;
                 }
+                multiply_add(accumulators[thread_index], *encrypted, i, plain_ntt, 
+                    thread_pool);
             }
-            decompose(context_data, adjusted_poly.get(), decomposed_poly.get(), pool);
-            poly_to_transform = decomposed_poly.get();
+        });
+
+        for (size_t t = 1; t < thread_count; t++)
+        {
+            accumulators[0].add(accumulators[t]);
         }
-        else
+        accumulators[0].reduce(destination);
+        if (transform)
+        {
+            transform_from_ntt_inplace(destination);
+        }
+#ifndef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (destination.is_transparent())
+        {
+            throw logic_error("result ciphertext is transparent");
+        }
+#endif
+    }
+
+    void Evaluator::multiply_plain_normal(Ciphertext &encrypted, 
+        const Plaintext &plain, MemoryPool &pool)
+    {
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+
+        auto plain_upper_half_threshold = context_data.plain_upper_half_threshold();
+
+        size_t encrypted_size = encrypted.size();
+        size_t plain_coeff_count = plain.coeff_count();
+
+        // Size check
+        if (!product_fits_in(encrypted_size, coeff_count, coeff_mod_count))
+        {
+            throw logic_error("invalid parameters");
+        }
+
+        double new_scale = encrypted.scale() * plain.scale();
+
+        // Check that scale is positive and not too large
+        if (new_scale <= 0 || (static_cast<int>(log2(new_scale)) >=
+            context_data.total_coeff_modulus_bit_count()))
         {
+            throw invalid_argument("scale out of bounds");
+        }
+
+        // Set the scale
+        encrypted.scale() = new_scale;
+
+        // Multiplying just by a constant?
+        if (plain_coeff_count == 1)
+        {
+            uint64_t plain_modulus = parms.plain_modulus().value();
             for (size_t j = 0; j < coeff_mod_count; j++)
             {
-                const uint64_t *plain_ptr = plain.data();
-                uint64_t *adjusted_poly_ptr = adjusted_poly.get() + (j * coeff_count);
-                uint64_t current_plain_upper_half_increment = plain_upper_half_increment[j];
-                for (size_t i = 0; i < plain_coeff_count; i++, plain_ptr++, adjusted_poly_ptr++)
+                // The NTT of a constant is the constant
+                uint64_t scalar = lift_plain_coeff(plain[0], plain_modulus,
+                    plain_upper_half_threshold, coeff_modulus[j]);
+                for (size_t i = 0; i < encrypted_size; i++)
                 {
-                    // Need to lift the coefficient in each qi
-                    if (*plain_ptr >= plain_upper_half_threshold)
-                    {
-                        *adjusted_poly_ptr = *plain_ptr + current_plain_upper_half_increment;
-                    }
-                    // No need for lifting
-                    else
-                    {
-                        *adjusted_poly_ptr = *plain_ptr;
-                    }
+                    multiply_poly_scalar_coeffmod(
+                        encrypted.data(i) + (j * coeff_count), coeff_count,
+                        scalar, coeff_modulus[j], encrypted.data(i) + (j * coeff_count));
                 }
             }
-            poly_to_transform = adjusted_poly.get();
+            return;
         }
 
-        // Need to multiply each component in encrypted with decomposed_poly (plain poly)
-        // Transform plain poly only once
-        for (size_t i = 0; i < coeff_mod_count; i++)
-        {
-            ntt_negacyclic_harvey(
-                poly_to_transform + (i * coeff_count), coeff_small_ntt_tables[i]);
-        }
+        // Generic plain case: lift and transform the plain poly only once
+        auto plain_ntt(allocate_poly(coeff_count, coeff_mod_count, pool));
+        lift_plain_to_ntt(context_data, plain.data(), plain_coeff_count, plain_ntt.get());
+
+        multiply_plain_transformed(encrypted, plain_ntt.get());
+    }
+
+    void Evaluator::multiply_plain_transformed(Ciphertext &encrypted,
+        const uint64_t *plain_ntt)
+    {
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
+        size_t encrypted_size = encrypted.size();
 
+        // Ciphertexts in NTT form are multiplied as they are
+        bool transform = !encrypted.is_ntt_form();
         for (size_t i = 0; i < encrypted_size; i++)
         {
             uint64_t *encrypted_ptr = encrypted.data(i);
@@ -2487,11 +3363,17 @@ namespace seal
                 //poly_to_transform + (j * coeff_count),
                 //    coeff_small_ntt_tables_[j], encrypted.data(i) + (j * coeff_count), pool);
 
-                // Lazy reduction
-                ntt_negacyclic_harvey_lazy(encrypted_ptr, coeff_small_ntt_tables[j]);
-                dyadic_product_coeffmod(encrypted_ptr, poly_to_transform + (j * coeff_count),
+                if (transform)
+                {
+                    // Lazy reduction
+                    ntt_negacyclic_harvey_lazy(encrypted_ptr, coeff_small_ntt_tables[j]);
+                }
+                dyadic_product_coeffmod(encrypted_ptr, plain_ntt + (j * coeff_count),
                     coeff_count, coeff_modulus[j], encrypted_ptr);
-                inverse_ntt_negacyclic_harvey(encrypted_ptr, coeff_small_ntt_tables[j]);
+                if (transform)
+                {
+                    inverse_ntt_negacyclic_harvey(encrypted_ptr, coeff_small_ntt_tables[j]);
+                }
             }
         }
     }
@@ -2509,6 +3391,12 @@ namespace seal
             throw invalid_argument("encrypted_ntt and plain_ntt parameter mismatch");
         }
 
+        multiply_plain_ntt(encrypted_ntt, plain_ntt.data(), plain_ntt.scale());
+    }
+
+    void Evaluator::multiply_plain_ntt(Ciphertext &encrypted_ntt,
+        const uint64_t *plain_ntt, double plain_scale)
+    {
         // Extract encryption parameters.
         auto &context_data = *context_->context_data(encrypted_ntt.parms_id());
         auto &parms = context_data.parms();
@@ -2523,7 +3411,7 @@ namespace seal
             throw logic_error("invalid parameters");
         }
 
-        double new_scale = encrypted_ntt.scale() * plain_ntt.scale();
+        double new_scale = encrypted_ntt.scale() * plain_scale;
 
         // Check that scale is positive and not too large
         if (new_scale <= 0 || (static_cast<int>(log2(new_scale)) >=
@@ -2538,7 +3426,7 @@ namespace seal
             {
                 dyadic_product_coeffmod(
                     encrypted_ntt.data(i) + (j * coeff_count),
-                    plain_ntt.data() + (j * coeff_count),
+                    plain_ntt + (j * coeff_count),
                     coeff_count, coeff_modulus[j],
                     encrypted_ntt.data(i) + (j * coeff_count));
             }
@@ -2579,11 +3467,6 @@ namespace seal
         size_t coeff_mod_count = coeff_modulus.size();
         size_t plain_coeff_count = plain.coeff_count();
 
-        auto plain_upper_half_threshold = context_data.plain_upper_half_threshold();
-        auto plain_upper_half_increment = context_data.plain_upper_half_increment();
-
-        auto &coeff_small_ntt_tables = context_data.small_ntt_tables();
-
         // Size check
         if (!product_fits_in(coeff_count, coeff_mod_count))
         {
@@ -2594,54 +3477,8 @@ namespace seal
         // Note that the new coefficients are automatically set to 0
         plain.resize(coeff_count * coeff_mod_count);
 
-        // Verify if plain lift is needed
-        if (!context_data.qualifiers().using_fast_plain_lift)
-        {
-            auto adjusted_poly(allocate_zero_uint(coeff_count * coeff_mod_count, pool));
-            for (size_t i = 0; i < plain_coeff_count; i++)
-            {
-                if (plain[i] >= plain_upper_half_threshold)
-                {
-                    add_uint_uint64(plain_upper_half_increment, plain[i],
-                        coeff_mod_count, adjusted_poly.get() + (i * coeff_mod_count));
-                }
-                else
-                {
-                    adjusted_poly[i * coeff_mod_count] = plain[i];
-                }
-            }
-            decompose(context_data, adjusted_poly.get(), plain.data(), pool);
-        }
-        // No need for composed plain lift and decomposition
-        else
-        {
-            for (size_t j = coeff_mod_count; j--; )
-            {
-                const uint64_t *plain_ptr = plain.data();
-                uint64_t *adjusted_poly_ptr = plain.data() + (j * coeff_count);
-                uint64_t current_plain_upper_half_increment = plain_upper_half_increment[j];
-                for (size_t i = 0; i < plain_coeff_count; i++, plain_ptr++, adjusted_poly_ptr++)
-                {
-                    // Need to lift the coefficient in each qi
-                    if (*plain_ptr >= plain_upper_half_threshold)
-                    {
-                        *adjusted_poly_ptr = *plain_ptr + current_plain_upper_half_increment;
-                    }
-                    // No need for lifting
-                    else
-                    {
-                        *adjusted_poly_ptr = *plain_ptr;
-                    }
-                }
-            }
-        }
-
-        // Transform to NTT domain
-        for (size_t i = 0; i < coeff_mod_count; i++)
-        {
-            ntt_negacyclic_harvey(
-                plain.data() + (i * coeff_count), coeff_small_ntt_tables[i]);
-        }
+        // Lift the coefficients to each prime and transform in place
+        lift_plain_to_ntt(context_data, plain.data(), plain_coeff_count, plain.data());
 
         plain.parms_id() = parms_id;
     }
@@ -2773,10 +3610,6 @@ namespace seal
         {
             throw invalid_argument("parameter mismatch");
         }
-        if (parms.scheme() == scheme_type::BFV && encrypted.is_ntt_form())
-        {
-            throw invalid_argument("BFV encrypted cannot be in NTT form");
-        }
         if (parms.scheme() == scheme_type::CKKS && !encrypted.is_ntt_form())
         {
             throw invalid_argument("CKKS encrypted must be in NTT form");
@@ -2799,8 +3632,6 @@ namespace seal
         }
 
         uint64_t m = mul_safe(static_cast<uint64_t>(coeff_count), uint64_t(2));
-        uint64_t subgroup_size = static_cast<uint64_t>(coeff_count >> 1);
-        int n_power_of_two = get_power_of_two(static_cast<uint64_t>(coeff_count));
 
         // Verify parameters
         if (!(galois_elt & 1) || unsigned_geq(galois_elt, m))
@@ -2812,119 +3643,210 @@ namespace seal
             throw invalid_argument("encrypted size must be 2");
         }
 
-        auto &first_context_data = *context_->context_data();
-        auto &coeff_small_ntt_tables = first_context_data.small_ntt_tables();
+        // Use the key for galois_elt if there is one, and otherwise the shortest
+        // sequence of available keys that composes to galois_elt
+        vector<uint64_t> galois_elts;
+        if (galois_keys.has_key(galois_elt))
+        {
+            galois_elts.push_back(galois_elt);
+        }
+        else
+        {
+            galois_elts = plan_galois(galois_elt, galois_keys);
+        }
 
-        // Check if Galois key is generated or not.
-        // If not, attempt a bit decomposition; maybe we have log(n) many keys
-        if (!galois_keys.has_key(galois_elt))
+        // Check each Galois key that is used once
+        for (auto it = galois_elts.begin(); it != galois_elts.end(); it++)
         {
-            // galois_elt = 3^order1 * (-1)^order2
-            uint64_t order1 = Zmstar_to_generator_.at(galois_elt).first;
-            uint64_t order2 = Zmstar_to_generator_.at(galois_elt).second;
+            if (find(galois_elts.begin(), it, *it) != it)
+            {
+                continue;
+            }
+            for (auto &b : galois_keys.key(*it))
+            {
+                if (!b.is_metadata_valid_for(context_) || !b.is_ntt_form() || 
+                    b.parms_id() != galois_keys.parms_id())
+                {
+                    throw invalid_argument("galois_keys is not valid for encryption parameters");
+                }
+            }
+        }
 
-            // We use either 3 or -3 as our generator, depending on which gives smaller HW
-            uint64_t two_power_of_gen = 3;
+        // The scratch space is shared by all key switches
+        auto scratch(allocate_uint(mul_safe(coeff_count,
+            add_safe(mul_safe(coeff_mod_count, size_t(7)), size_t(2))), pool));
+        for (auto step_elt : galois_elts)
+        {
+            apply_galois_one_step(encrypted, step_elt, galois_keys, scratch.get());
+        }
+#ifndef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (encrypted.is_transparent())
+        {
+            throw logic_error("result ciphertext is transparent");
+        }
+#endif
+    }
 
-            // Does order1 or n/2-order1 have smaller Hamming weight?
-            if (hamming_weight(subgroup_size - order1) < hamming_weight(order1))
+    vector<uint64_t> Evaluator::plan_galois(uint64_t galois_elt,
+        const GaloisKeys &galois_keys) const
+    {
+        size_t coeff_count = context_->context_data()->parms().poly_modulus_degree();
+        uint64_t m = mul_safe(static_cast<uint64_t>(coeff_count), uint64_t(2));
+        if (!(galois_elt & 1) || unsigned_geq(galois_elt, m))
+        {
+            throw invalid_argument("galois element is not valid");
+        }
+
+        // The Galois elements of the available keys
+        vector<uint64_t> key_elts;
+        auto &keys = galois_keys.data();
+        for (size_t index = 0; index < keys.size() && 2 * index + 1 < m; index++)
+        {
+            if (!keys[index].empty())
             {
-                order1 = subgroup_size - order1;
-                try_mod_inverse(3, m, two_power_of_gen);
+                key_elts.push_back(static_cast<uint64_t>(2 * index + 1));
             }
+        }
 
-            while(order1)
+        shared_ptr<const vector<uint64_t>> last_elts;
+        {
+            lock_guard<mutex> lock(galois_plans_mutex_);
+            auto it = galois_plans_.find(key_elts);
+            if (it != galois_plans_.end())
+            {
+                last_elts = it->second;
+            }
+        }
+        if (!last_elts)
+        {
+            // Write the group as Z_(N/2) x Z_2 with 3^e * (-1)^s at index e + s * N/2.
+            // A breadth-first search from the identity finds for every element the
+            // last key of a shortest sequence of keys composing to it.
+            size_t subgroup_size = coeff_count >> 1;
+            auto plan = make_shared<vector<uint64_t>>(coeff_count, 0);
+            vector<bool> visited(coeff_count, false);
+            vector<size_t> queue{ 0 };
+            queue.reserve(coeff_count);
+            visited[0] = true;
+            for (size_t next = 0; next < queue.size(); next++)
             {
-                if (order1 & 1)
+                size_t order1 = queue[next] % subgroup_size;
+                size_t order2 = queue[next] / subgroup_size;
+                for (auto key_elt : key_elts)
                 {
-                    if (!galois_keys.has_key(two_power_of_gen))
+                    auto &key_orders = Zmstar_to_generator_.at(key_elt);
+                    size_t index = ((order1 + key_orders.first) % subgroup_size) +
+                        ((order2 ^ key_orders.second) * subgroup_size);
+                    if (!visited[index])
                     {
-                        throw invalid_argument("galois key not present");
+                        visited[index] = true;
+                        (*plan)[index] = key_elt;
+                        queue.push_back(index);
                     }
-                    apply_galois_inplace(encrypted, two_power_of_gen, galois_keys, pool);
                 }
-                two_power_of_gen = mul_safe(two_power_of_gen, two_power_of_gen);
-                two_power_of_gen &= (m - 1);
-                order1 >>= 1;
             }
-            if (order2)
+
+            lock_guard<mutex> lock(galois_plans_mutex_);
+            if (galois_plans_.size() >= galois_plan_cache_size)
             {
-                if (!galois_keys.has_key(m - 1))
-                {
-                    throw invalid_argument("galois key not present");
-                }
-                apply_galois_inplace(encrypted, m - 1, galois_keys, pool);
+                galois_plans_.clear();
             }
-            return;
+            galois_plans_.emplace(key_elts, plan);
+            last_elts = move(plan);
         }
 
-        // Check the Galois key for galois_elt at this point.
-        for (auto &b : galois_keys.key(galois_elt))
+        // Walk back from galois_elt to the identity
+        size_t subgroup_size = coeff_count >> 1;
+        auto &orders = Zmstar_to_generator_.at(galois_elt);
+        size_t order1 = static_cast<size_t>(orders.first);
+        size_t order2 = static_cast<size_t>(orders.second);
+        vector<uint64_t> galois_elts;
+        while (order1 || order2)
         {
-            if (!b.is_metadata_valid_for(context_) || !b.is_ntt_form() || 
-                b.parms_id() != galois_keys.parms_id())
+            uint64_t key_elt = (*last_elts)[order1 + order2 * subgroup_size];
+            if (!key_elt)
             {
-                throw invalid_argument("galois_keys is not valid for encryption parameters");
+                throw invalid_argument("galois key not present");
             }
+            galois_elts.push_back(key_elt);
+            auto &key_orders = Zmstar_to_generator_.at(key_elt);
+            order1 = (order1 + subgroup_size - key_orders.first) % subgroup_size;
+            order2 ^= key_orders.second;
         }
+        return galois_elts;
+    }
 
-        auto temp0(allocate_zero_uint(coeff_count * coeff_mod_count, pool));
-        auto temp1(allocate_zero_uint(coeff_count * coeff_mod_count, pool));
+    void Evaluator::apply_galois_one_step(Ciphertext &encrypted,
+        uint64_t galois_elt, const GaloisKeys &galois_keys, uint64_t *scratch)
+    {
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        int n_power_of_two = get_power_of_two(static_cast<uint64_t>(coeff_count));
 
-        if (parms.scheme() == scheme_type::BFV)
+        auto &first_context_data = *context_->context_data();
+        auto &coeff_small_ntt_tables = first_context_data.small_ntt_tables();
+
+        // Carve the scratch space; see apply_galois_inplace for its size
+        uint64_t *temp0 = scratch;
+        uint64_t *temp1 = temp0 + (coeff_count * coeff_mod_count);
+        uint64_t *wide_innerresult0 = temp1 + (coeff_count * coeff_mod_count);
+        uint64_t *wide_innerresult1 = wide_innerresult0 + (2 * coeff_count * coeff_mod_count);
+        uint64_t *innerresult = wide_innerresult1 + (2 * coeff_count * coeff_mod_count);
+        uint64_t *decomp_encrypted_last = innerresult + (coeff_count * coeff_mod_count);
+        uint64_t *temp_decomp_coeff = decomp_encrypted_last + coeff_count;
+        set_zero_uint(4 * coeff_count * coeff_mod_count, wide_innerresult0);
+
+        // Ciphertexts in NTT form, as always in CKKS, stay in NTT form
+        bool is_ntt_form = encrypted.is_ntt_form();
+        if (!is_ntt_form)
         {
             // Apply Galois for each ciphertext
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
                 util::apply_galois(encrypted.data() + (i * coeff_count), n_power_of_two,
-                    galois_elt, coeff_modulus[i], temp0.get() + (i * coeff_count));
+                    galois_elt, coeff_modulus[i], temp0 + (i * coeff_count));
             }
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
                 util::apply_galois(encrypted.data(1) + (i * coeff_count), n_power_of_two,
-                    galois_elt, coeff_modulus[i], temp1.get() + (i * coeff_count));
+                    galois_elt, coeff_modulus[i], temp1 + (i * coeff_count));
             }
         }
-        else if (parms.scheme() == scheme_type::CKKS)
+        else
         {
             // Apply Galois for each ciphertext
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
                 util::apply_galois_ntt(encrypted.data() + (i * coeff_count), n_power_of_two,
-                    galois_elt, temp0.get() + (i * coeff_count));
+                    galois_elt, temp0 + (i * coeff_count));
             }
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
                 util::apply_galois_ntt(encrypted.data(1) + (i * coeff_count), n_power_of_two,
-                    galois_elt, temp1.get() + (i * coeff_count));
+                    galois_elt, temp1 + (i * coeff_count));
             }
 
             // Transform ct[1] from NTT
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
-                inverse_ntt_negacyclic_harvey(temp1.get() + (i * coeff_count),
+                inverse_ntt_negacyclic_harvey(temp1 + (i * coeff_count),
                     coeff_small_ntt_tables[i]);
             }
         }
-        else
-        {
-            throw logic_error("scheme not implemented");
-        }
 
         // Calculate (temp1 * galois_key.first, temp1 * galois_key.second) + (temp0, 0)
-        const uint64_t *encrypted_coeff = temp1.get();
+        const uint64_t *encrypted_coeff = temp1;
 
         // decompose encrypted_array[count-1] into base w
         // want to create an array of polys, each of whose components i is
         // (encrypted_array[count-1])^(i) - in the notation of FV paper.
-        // This allocation stores one of the decomposed factors modulo one of the primes.
-        auto decomp_encrypted_last(allocate_uint(coeff_count, pool));
-
-        // Lazy reduction
-        auto wide_innerresult0(allocate_zero_poly(coeff_count, 2 * coeff_mod_count, pool));
-        auto wide_innerresult1(allocate_zero_poly(coeff_count, 2 * coeff_mod_count, pool));
-        auto innerresult(allocate_poly(coeff_count, coeff_mod_count, pool));
-        auto temp_decomp_coeff(allocate_uint(coeff_count, pool));
+        // decomp_encrypted_last stores one of the decomposed factors modulo one
+        // of the primes.
 
         /*
         For lazy reduction to work here, we need to ensure that the 128-bit accumulators
@@ -2960,12 +3882,12 @@ namespace seal
                         (uint64_t(1) << decomposition_bit_count) - 1;
                 }
 
-                uint64_t *wide_innerresult0_ptr = wide_innerresult0.get();
-                uint64_t *wide_innerresult1_ptr = wide_innerresult1.get();
+                uint64_t *wide_innerresult0_ptr = wide_innerresult0;
+                uint64_t *wide_innerresult1_ptr = wide_innerresult1;
                 for (size_t j = 0; j < coeff_mod_count; j++)
                 {
-                    uint64_t *temp_decomp_coeff_ptr = temp_decomp_coeff.get();
-                    set_uint_uint(decomp_encrypted_last.get(), coeff_count, temp_decomp_coeff_ptr);
+                    uint64_t *temp_decomp_coeff_ptr = temp_decomp_coeff;
+                    set_uint_uint(decomp_encrypted_last, coeff_count, temp_decomp_coeff_ptr);
 
                     // We don't reduce here, so might get up to two extra bits. Thus 62 bits at most.
                     ntt_negacyclic_harvey_lazy(temp_decomp_coeff_ptr, coeff_small_ntt_tables[j]);
@@ -2982,7 +3904,7 @@ namespace seal
                         wide_innerresult0_ptr[1] += wide_innerproduct[1] + carry;
                     }
 
-                    temp_decomp_coeff_ptr = temp_decomp_coeff.get();
+                    temp_decomp_coeff_ptr = temp_decomp_coeff;
                     for (size_t l = 0; l < coeff_count; l++, wide_innerresult1_ptr += 2)
                     {
                         multiply_uint64(*temp_decomp_coeff_ptr++, *key_ptr_1++, wide_innerproduct);
@@ -2996,9 +3918,9 @@ namespace seal
             }
         }
 
-        uint64_t *temp_ptr = temp0.get();
-        uint64_t *innerresult_poly_ptr = innerresult.get();
-        uint64_t *wide_innerresult_poly_ptr = wide_innerresult0.get();
+        uint64_t *temp_ptr = temp0;
+        uint64_t *innerresult_poly_ptr = innerresult;
+        uint64_t *wide_innerresult_poly_ptr = wide_innerresult0;
         uint64_t *encrypted_ptr = encrypted.data();
         uint64_t *innerresult_coeff_ptr = innerresult_poly_ptr;
         uint64_t *wide_innerresult_coeff_ptr = wide_innerresult_poly_ptr;
@@ -3012,7 +3934,7 @@ namespace seal
                 *innerresult_coeff_ptr = barrett_reduce_128(
                     wide_innerresult_coeff_ptr, coeff_modulus[i]);
             }
-            if (parms.scheme() == scheme_type::BFV)
+            if (!is_ntt_form)
             {
                 inverse_ntt_negacyclic_harvey(innerresult_poly_ptr, 
                     coeff_small_ntt_tables[i]);
@@ -3021,8 +3943,8 @@ namespace seal
                 coeff_modulus[i], encrypted_ptr);
         }
 
-        innerresult_poly_ptr = innerresult.get();
-        wide_innerresult_poly_ptr = wide_innerresult1.get();
+        innerresult_poly_ptr = innerresult;
+        wide_innerresult_poly_ptr = wide_innerresult1;
         encrypted_ptr = encrypted.data(1);
         wide_innerresult_coeff_ptr = wide_innerresult_poly_ptr;
         for (size_t i = 0; i < coeff_mod_count; i++, innerresult_poly_ptr += coeff_count,
@@ -3035,26 +3957,134 @@ namespace seal
                 *innerresult_coeff_ptr = barrett_reduce_128(
                     wide_innerresult_coeff_ptr, coeff_modulus[i]);
             }
-            if (parms.scheme() == scheme_type::BFV)
+            if (!is_ntt_form)
             {
                 inverse_ntt_negacyclic_harvey(encrypted_ptr, coeff_small_ntt_tables[i]);
             }
         }
+    }
+
+    void Evaluator::expand_query(const Ciphertext &encrypted, size_t count,
+        const GaloisKeys &galois_keys, vector<Ciphertext> &destination,
+        size_t thread_count)
+    {
+        // Verify parameters.
+        if (!encrypted.is_metadata_valid_for(context_))
+        {
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        if (parms.scheme() != scheme_type::BFV)
+        {
+            throw invalid_argument("unsupported scheme");
+        }
+        if (encrypted.is_ntt_form())
+        {
+            throw invalid_argument("BFV encrypted cannot be in NTT form");
+        }
+        if (encrypted.size() > 2)
+        {
+            throw invalid_argument("encrypted size must be 2");
+        }
+        for (auto &result : destination)
+        {
+            if (&result == &encrypted)
+            {
+                throw invalid_argument("encrypted must be different from destination");
+            }
+        }
+
+        // The Galois elements also verify count
+        auto galois_elts = expand_query_galois_elts(count);
 
-        // If CKKS, mark encrypted as NTT form
-        if (parms.scheme() == scheme_type::CKKS)
+        // Extract encryption parameters.
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        uint64_t m = mul_safe(static_cast<uint64_t>(coeff_count), uint64_t(2));
+
+        destination.resize(count);
+        destination[0] = encrypted;
+        for (size_t level = 0; level < galois_elts.size(); level++)
         {
-            encrypted.is_ntt_form() = true;
+            // Multiplying by x^(-2^level) is a negacyclic shift by 2N - 2^level
+            size_t half = size_t(1) << level;
+            size_t shift = static_cast<size_t>(m) - half;
+            uint64_t galois_elt = galois_elts[level];
+
+            parallel_for(half, thread_count, [&](size_t begin, size_t end) {
+                auto pool = MemoryPoolHandle::New();
+                Ciphertext automorphism(pool);
+                auto temp(allocate_uint(coeff_count, pool));
+                for (size_t j = begin; j < end; j++)
+                {
+                    Ciphertext &encrypted_j = destination[j];
+                    apply_galois(encrypted_j, galois_elt, galois_keys, automorphism, pool);
+
+                    // At the last level only the first count ciphertexts are needed
+                    if (j + half < count)
+                    {
+                        Ciphertext &odd = destination[j + half];
+                        odd.resize(context_, encrypted_j.parms_id(), 2);
+                        odd.is_ntt_form() = false;
+                        odd.scale() = encrypted_j.scale();
+                        for (size_t k = 0; k < 2; k++)
+                        {
+                            for (size_t i = 0; i < coeff_mod_count; i++)
+                            {
+                                sub_poly_poly_coeffmod(
+                                    encrypted_j.data(k) + (i * coeff_count),
+                                    automorphism.data(k) + (i * coeff_count),
+                                    coeff_count, coeff_modulus[i], temp.get());
+                                negacyclic_shift_poly_coeffmod(temp.get(), coeff_count,
+                                    shift, coeff_modulus[i], odd.data(k) + (i * coeff_count));
+                            }
+                        }
+                    }
+                    for (size_t k = 0; k < 2; k++)
+                    {
+                        for (size_t i = 0; i < coeff_mod_count; i++)
+                        {
+                            add_poly_poly_coeffmod(
+                                encrypted_j.data(k) + (i * coeff_count),
+                                automorphism.data(k) + (i * coeff_count),
+                                coeff_count, coeff_modulus[i],
+                                encrypted_j.data(k) + (i * coeff_count));
+                        }
+                    }
+                }
+            });
         }
 #ifndef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT
         // Transparent ciphertext output is not allowed.
-        if (encrypted.is_transparent())
+        for (auto &result : destination)
         {
-            throw logic_error("result ciphertext is transparent");
+            if (result.is_transparent())
+            {
+                throw logic_error("result ciphertext is transparent");
+            }
         }
 #endif
     }
 
+    vector<uint64_t> Evaluator::expand_query_galois_elts(size_t count) const
+    {
+        size_t coeff_count = context_->context_data()->parms().poly_modulus_degree();
+        if (!count || count > coeff_count)
+        {
+            throw invalid_argument("count is not within [1, poly_modulus_degree]");
+        }
+
+        // One level for every bit of count - 1
+        vector<uint64_t> galois_elts;
+        for (size_t level = 0; (size_t(1) << level) < count; level++)
+        {
+            galois_elts.push_back(static_cast<uint64_t>((coeff_count >> level) + 1));
+        }
+        return galois_elts;
+    }
+
     void Evaluator::rotate_internal(Ciphertext &encrypted, int steps,
         const GaloisKeys &galois_keys, MemoryPoolHandle pool)
     {
@@ -6,6 +6,8 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <functional>
 #include "seal/context.h"
 #include "seal/relinkeys.h"
 #include "seal/smallmodulus.h"
@@ -14,12 +16,84 @@
 #include "seal/plaintext.h"
 #include "seal/galoiskeys.h"
 #include "seal/util/pointer.h"
+#include "seal/util/hpsconverter.h"
 #include "seal/secretkey.h"
 #include "seal/util/uintarithsmallmod.h"
 #include "seal/util/common.h"
 
 namespace seal
 {
+    class PlaintextNTTCache;
+
+    class PlaintextDatabase;
+
+    class CiphertextAccumulator;
+
+    /**
+    Describes how an Evaluator in automatic alignment mode changed the operands 
+    of a CKKS operation before performing it. The first operand of an operation
+    is the ciphertext that is changed in place; the second operand, a ciphertext
+    or a plaintext, is never changed, and a copy of it is aligned instead.
+
+    @see Evaluator::enable_ckks_auto_alignment for the alignment rules.
+    */
+    struct CKKSAlignment
+    {
+        /**
+        The name of the Evaluator function, such as "add_inplace".
+        */
+        const char *operation = nullptr;
+
+        /**
+        The number of levels by which each operand was switched down without
+        rescaling.
+        */
+        std::size_t mod_switch_levels[2]{ 0, 0 };
+
+        /**
+        The number of times each operand was rescaled.
+        */
+        std::size_t rescale_count[2]{ 0, 0 };
+
+        /**
+        The relative change of the scale of the second operand when its scale 
+        was set to the scale of the first operand, or zero if it was not.
+        */
+        double scale_adjustment = 0.0;
+    };
+
+    /**
+    A function that an Evaluator in automatic alignment mode calls with the
+    description of every alignment it performs.
+    */
+    using CKKSAlignmentHandler = std::function<void(const CKKSAlignment &)>;
+
+    /**
+    The algorithms that an Evaluator can use to multiply and square BFV 
+    ciphertexts. Both compute the tensor product in a larger RNS base and scale 
+    it by t/q, and both give ciphertexts that decrypt to the same result with 
+    about the same noise.
+
+    @see Evaluator::set_bfv_multiply_type to select the algorithm.
+    */
+    enum class bfv_multiply_type : std::uint8_t
+    {
+        /**
+        The algorithm of Bajard, Eynard, Hasan, and Zucca, which uses only 
+        integer arithmetic with a Montgomery reduction and a fast floor in an 
+        auxiliary base. This is the default.
+        */
+        BEHZ = 0x0,
+
+        /**
+        The algorithm of Halevi, Polyakov, and Shoup, which estimates the 
+        quotients of its base extensions in floating point and scales the 
+        tensor product by t/q with exact rounding, using one auxiliary base 
+        and no Montgomery reduction.
+        */
+        HPS = 0x1
+    };
+
     /**
     Provides operations on ciphertexts. Due to the properties of the encryption 
     scheme, the arithmetic operations pass through the encryption layer to the 
@@ -81,6 +155,18 @@ namespace seal
     and transform_from_ntt functions, which change the state. Ideally, unless these 
     two functions are called, all other functions should "just work".
 
+    @par NTT form in BFV
+    BFV ciphertexts can also be kept in NTT form for a whole computation. All 
+    functions that require the default NTT form, except expand_query, accept BFV 
+    ciphertexts in NTT form as well, and Decryptor decrypts them directly. Plain 
+    operations take BFV plaintexts in coefficient representation, except that 
+    multiply_plain also takes plaintexts transformed with transform_to_ntt. In 
+    this mode additions and plain multiplications need no NTT at all; multiply 
+    and square still transform their inputs for the base conversions, and 
+    relinearization, rotations, and modulus switching transform only what the key 
+    switching or the rounding needs. This pays off for long chains of plain 
+    multiplications and additions.
+
     @see EncryptionParameters for more details on encryption parameters.
     @see BatchEncoder for more details on batching
     @see RelinKeys for more details on relinearization keys.
@@ -107,6 +193,79 @@ namespace seal
         */
         void negate_inplace(Ciphertext &encrypted);
 
+        /**
+        Enables automatic alignment of the operands of CKKS operations. In this 
+        mode add, sub, add_plain, and sub_plain no longer require their operands
+        to be at the same level and scale, and multiply, square, and multiply_plain
+        no longer require their operands to be at the same level. Instead, the
+        operands are aligned just before the operation:
+
+        - A ciphertext with a larger scale than the other operand of an addition
+        or subtraction is rescaled as long as this brings the two scales closer.
+        - A ciphertext operand of a multiplication is rescaled as long as its scale
+        divided by the last prime of its level is at least the square root of
+        that prime, i.e. products are rescaled only when they are used in another
+        multiplication, and sums of products need only one rescaling.
+        - The operand at the higher level is then switched down to the level of
+        the other operand without rescaling.
+        - If the scales of the operands of an addition or subtraction still 
+        differ, the scale of the second operand is set to the scale of the first
+        one, provided the relative change is at most max_scale_adjustment.
+        Otherwise the operation throws as it would without alignment.
+
+        Operations whose operands are already aligned are performed exactly as 
+        without alignment. Every alignment is reported to the given handler. An
+        operation that throws after aligning its operands leaves its first 
+        operand unchanged and reports nothing. The mode must not be changed while
+        other threads use the Evaluator.
+
+        @param[in] max_scale_adjustment The largest relative change of a scale 
+        that is accepted to make the scales of two operands equal
+        @param[in] handler The function to report alignments to, or an empty
+        function
+        @throws std::logic_error if the encryption parameters are not for CKKS
+        @throws std::invalid_argument if max_scale_adjustment is not within [0, 1)
+        */
+        void enable_ckks_auto_alignment(double max_scale_adjustment = 0.0,
+            CKKSAlignmentHandler handler = CKKSAlignmentHandler());
+
+        /**
+        Disables automatic alignment of the operands of CKKS operations.
+        */
+        void disable_ckks_auto_alignment() noexcept;
+
+        /**
+        Returns whether automatic alignment of the operands of CKKS operations is
+        enabled.
+        */
+        inline bool ckks_auto_alignment() const noexcept
+        {
+            return ckks_auto_alignment_;
+        }
+
+        /**
+        Selects the algorithm with which multiply, square, and the functions 
+        built on them multiply BFV ciphertexts. The pre-computations of the HPS 
+        algorithm for all levels of the modulus switching chain are done when
+        it is first selected. The algorithm must not be changed while other 
+        threads use the Evaluator.
+
+        @param[in] type The multiplication algorithm
+        @throws std::logic_error if the encryption parameters are not for BFV
+        @throws std::invalid_argument if type is not valid
+        @throws std::logic_error if the HPS pre-computations fail for the 
+        encryption parameters
+        */
+        void set_bfv_multiply_type(bfv_multiply_type type);
+
+        /**
+        Returns the algorithm with which BFV ciphertexts are multiplied.
+        */
+        inline bfv_multiply_type current_bfv_multiply_type() const noexcept
+        {
+            return bfv_multiply_type_;
+        }
+
         /**
         Negates a ciphertext and stores the result in the destination parameter.
 
@@ -167,19 +326,30 @@ namespace seal
 
         /**
         Adds together a vector of ciphertexts and stores the result in the destination
-        parameter.
+        parameter. The ciphertexts are summed at the lowest level among them; those 
+        at higher levels are switched down with mod_switch_to. The coefficients are
+        accumulated without modular reduction for as long as the sums fit in 64 bits.
+        The ciphertexts are split into contiguous ranges that are summed in parallel,
+        and the partial sums are added at the end. Dynamic memory allocations in the 
+        process are allocated from the memory pool pointed to by the given 
+        MemoryPoolHandle and from thread-local memory pools.
 
         @param[in] encrypteds The ciphertexts to add
         @param[out] destination The ciphertext to overwrite with the addition result
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @param[in] thread_count The maximum number of threads to use; zero means the
+        number of hardware threads
         @throws std::invalid_argument if encrypteds is empty
         @throws std::invalid_argument if the encrypteds are not valid for the encryption
         parameters
         @throws std::invalid_argument if encrypteds are in different NTT forms
         @throws std::invalid_argument if encrypteds have different scale
         @throws std::invalid_argument if destination is one of encrypteds 
+        @throws std::invalid_argument if pool is uninitialized
         @throws std::logic_error if result ciphertext is transparent
         */
-        void add_many(const std::vector<Ciphertext> &encrypteds, Ciphertext &destination);
+        void add_many(const std::vector<Ciphertext> &encrypteds, Ciphertext &destination,
+            MemoryPoolHandle pool = MemoryManager::GetPool(), std::size_t thread_count = 0);
 
         /**
         Subtracts two ciphertexts. This function computes the difference of encrypted1 
@@ -646,30 +816,39 @@ namespace seal
         /**
         Multiplies several ciphertexts together. This function computes the product 
         of several ciphertext given as an std::vector and stores the result in the 
-        destination parameter. The multiplication is done in a depth-optimal order, 
-        and relinearization is performed automatically after every multiplication 
-        in the process. In relinearization the given relinearization keys are used. 
-        Dynamic memory allocations in the process are allocated from the memory 
-        pool pointed to by the given MemoryPoolHandle. 
+        destination parameter. The ciphertexts are multiplied as a balanced binary
+        tree of depth ceil(log2(encrypteds.size())), and the independent products
+        on each level of the tree are computed in parallel. Relinearization is 
+        performed automatically after every multiplication in the process, and with
+        scheme_type::CKKS every product is also rescaled to the next level. When two
+        ciphertexts at different levels are multiplied, the one at the higher level 
+        is first switched down with mod_switch_to. In relinearization the given 
+        relinearization keys are used. Dynamic memory allocations in the process 
+        are allocated from the memory pool pointed to by the given MemoryPoolHandle
+        and from thread-local memory pools.
 
         @param[in] encrypteds The ciphertexts to multiply
         @param[in] relin_keys The relinearization keys
         @param[out] destination The ciphertext to overwrite with the multiplication result
         @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
-        @throws std::logic_error if scheme is not scheme_type::BFV
+        @param[in] thread_count The maximum number of threads to use; zero means the
+        number of hardware threads
         @throws std::invalid_argument if encrypteds is empty
         @throws std::invalid_argument if the ciphertexts or relin_keys are not valid for
         the encryption parameters
         @throws std::invalid_argument if encrypteds are not in the default NTT form
         @throws std::invalid_argument if, when using scheme_type::CKKS, the output scale
         is too large for the encryption parameters
+        @throws std::invalid_argument if, when using scheme_type::CKKS, a product cannot
+        be rescaled because the end of the modulus switching chain is reached
         @throws std::invalid_argument if the size of relin_keys is too small
         @throws std::invalid_argument if pool is uninitialized
         @throws std::logic_error if result ciphertext is transparent
         */
-        void multiply_many(std::vector<Ciphertext> &encrypteds,
+        void multiply_many(const std::vector<Ciphertext> &encrypteds,
             const RelinKeys &relin_keys, Ciphertext &destination,
-            MemoryPoolHandle pool = MemoryManager::GetPool());
+            MemoryPoolHandle pool = MemoryManager::GetPool(), 
+            std::size_t thread_count = 0);
 
         /**
         Exponentiates a ciphertext. This functions raises encrypted to a power. 
@@ -736,12 +915,18 @@ namespace seal
 
         @param[in] encrypted The ciphertext to add
         @param[in] plain The plaintext to add
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
         @throws std::invalid_argument if encrypted or plain is not valid for the 
         encryption parameters
-        @throws std::invalid_argument if encrypted or plain is in NTT form
+        @throws std::invalid_argument if, when using scheme_type::BFV, plain is in
+        NTT form
+        @throws std::invalid_argument if, when using scheme_type::CKKS, encrypted or
+        plain is not in NTT form
+        @throws std::invalid_argument if pool is uninitialized
         @throws std::logic_error if result ciphertext is transparent
         */
-        void add_plain_inplace(Ciphertext &encrypted, const Plaintext &plain);
+        void add_plain_inplace(Ciphertext &encrypted, const Plaintext &plain,
+            MemoryPoolHandle pool = MemoryManager::GetPool());
 
         /**
         Adds a ciphertext and a plaintext. This function adds a ciphertext and 
@@ -751,16 +936,21 @@ namespace seal
         @param[in] encrypted The ciphertext to add
         @param[in] plain The plaintext to add
         @param[out] destination The ciphertext to overwrite with the addition result
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
         @throws std::invalid_argument if encrypted or plain is not valid for the 
         encryption parameters
-        @throws std::invalid_argument if encrypted or plain is in NTT form
+        @throws std::invalid_argument if, when using scheme_type::BFV, plain is in
+        NTT form
+        @throws std::invalid_argument if, when using scheme_type::CKKS, encrypted or
+        plain is not in NTT form
+        @throws std::invalid_argument if pool is uninitialized
         @throws std::logic_error if result ciphertext is transparent
         */
         inline void add_plain(const Ciphertext &encrypted, const Plaintext &plain,
-            Ciphertext &destination)
+            Ciphertext &destination, MemoryPoolHandle pool = MemoryManager::GetPool())
         {
             destination = encrypted;
-            add_plain_inplace(destination, plain);
+            add_plain_inplace(destination, plain, std::move(pool));
         }
 
         /**
@@ -769,12 +959,18 @@ namespace seal
 
         @param[in] encrypted The ciphertext to subtract from
         @param[in] plain The plaintext to subtract
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
         @throws std::invalid_argument if encrypted or plain is not valid for the 
         encryption parameters
-        @throws std::invalid_argument if encrypted or plain is in NTT form
+        @throws std::invalid_argument if, when using scheme_type::BFV, plain is in
+        NTT form
+        @throws std::invalid_argument if, when using scheme_type::CKKS, encrypted or
+        plain is not in NTT form
+        @throws std::invalid_argument if pool is uninitialized
         @throws std::logic_error if result ciphertext is transparent
         */
-        void sub_plain_inplace(Ciphertext &encrypted, const Plaintext &plain);
+        void sub_plain_inplace(Ciphertext &encrypted, const Plaintext &plain,
+            MemoryPoolHandle pool = MemoryManager::GetPool());
 
         /**
         Subtracts a plaintext from a ciphertext. This function subtracts a plaintext 
@@ -784,16 +980,21 @@ namespace seal
         @param[in] encrypted The ciphertext to subtract from
         @param[in] plain The plaintext to subtract
         @param[out] destination The ciphertext to overwrite with the subtraction result
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
         @throws std::invalid_argument if encrypted or plain is not valid for the 
         encryption parameters
-        @throws std::invalid_argument if encrypted or plain is in NTT form
+        @throws std::invalid_argument if, when using scheme_type::BFV, plain is in
+        NTT form
+        @throws std::invalid_argument if, when using scheme_type::CKKS, encrypted or
+        plain is not in NTT form
+        @throws std::invalid_argument if pool is uninitialized
         @throws std::logic_error if result ciphertext is transparent
         */
         inline void sub_plain(const Ciphertext &encrypted, const Plaintext &plain,
-            Ciphertext &destination)
+            Ciphertext &destination, MemoryPoolHandle pool = MemoryManager::GetPool())
         {
             destination = encrypted;
-            sub_plain_inplace(destination, plain);
+            sub_plain_inplace(destination, plain, std::move(pool));
         }
 
         /**
@@ -807,7 +1008,8 @@ namespace seal
         @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
         @throws std::invalid_argument if the encrypted or plain is not valid for 
         the encryption parameters
-        @throws std::invalid_argument if encrypted and plain are in different NTT forms
+        @throws std::invalid_argument if encrypted and plain are in different NTT forms,
+        unless encrypted is a BFV ciphertext in NTT form and plain is not
         @throws std::invalid_argument if, when using scheme_type::CKKS, the output 
         scale is too large for the encryption parameters
         @throws std::invalid_argument if pool is uninitialized
@@ -829,7 +1031,8 @@ namespace seal
         @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
         @throws std::invalid_argument if the encrypted or plain is not valid for 
         the encryption parameters
-        @throws std::invalid_argument if encrypted and plain are in different NTT forms
+        @throws std::invalid_argument if encrypted and plain are in different NTT forms,
+        unless encrypted is a BFV ciphertext in NTT form and plain is not
         @throws std::invalid_argument if plain is zero
         @throws std::invalid_argument if, when using scheme_type::CKKS, the output 
         scale is too large for the encryption parameters
@@ -844,6 +1047,183 @@ namespace seal
             multiply_plain_inplace(destination, plain, std::move(pool));
         }
 
+        /**
+        Multiplies a ciphertext with a plaintext, taking the NTT transformed
+        plaintext from a PlaintextNTTCache. When a BFV plaintext is not in NTT form,
+        the plaintext is transformed to the NTT domain of the ciphertext's
+        level only if the cache does not already hold it; otherwise this function
+        is equivalent to multiply_plain_inplace without a cache. Dynamic memory
+        allocations in the process are allocated from the memory pool pointed to
+        by the given MemoryPoolHandle.
+
+        @param[in] encrypted The ciphertext to multiply
+        @param[in] plain The plaintext to multiply
+        @param[in] cache The cache of NTT transformed plaintexts
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if the encrypted or plain is not valid for 
+        the encryption parameters
+        @throws std::invalid_argument if encrypted and plain are in different NTT forms,
+        unless encrypted is a BFV ciphertext in NTT form and plain is not
+        @throws std::invalid_argument if the cache was created for encryption
+        parameters that do not contain the level of encrypted
+        @throws std::invalid_argument if pool is uninitialized
+        @throws std::logic_error if result ciphertext is transparent
+        */
+        void multiply_plain_inplace(Ciphertext &encrypted, const Plaintext &plain,
+            PlaintextNTTCache &cache, MemoryPoolHandle pool = MemoryManager::GetPool());
+
+        /**
+        Multiplies a ciphertext with a plaintext, taking the NTT transformed
+        plaintext from a PlaintextNTTCache, and stores the result in the destination
+        parameter. When a BFV plaintext is not in NTT form, the plaintext is
+        transformed to the NTT domain of the ciphertext's level only if the cache
+        does not already hold it; otherwise this function is equivalent to
+        multiply_plain without a cache. Dynamic memory allocations in the process
+        are allocated from the memory pool pointed to by the given MemoryPoolHandle.
+
+        @param[in] encrypted The ciphertext to multiply
+        @param[in] plain The plaintext to multiply
+        @param[in] cache The cache of NTT transformed plaintexts
+        @param[out] destination The ciphertext to overwrite with the multiplication result
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if the encrypted or plain is not valid for 
+        the encryption parameters
+        @throws std::invalid_argument if encrypted and plain are in different NTT forms,
+        unless encrypted is a BFV ciphertext in NTT form and plain is not
+        @throws std::invalid_argument if the cache was created for encryption
+        parameters that do not contain the level of encrypted
+        @throws std::invalid_argument if pool is uninitialized
+        @throws std::logic_error if result ciphertext is transparent
+        */
+        inline void multiply_plain(const Ciphertext &encrypted, 
+            const Plaintext &plain, PlaintextNTTCache &cache,
+            Ciphertext &destination, MemoryPoolHandle pool = MemoryManager::GetPool())
+        {
+            destination = encrypted;
+            multiply_plain_inplace(destination, plain, cache, std::move(pool));
+        }
+
+        /**
+        Multiplies a ciphertext in NTT form with a plaintext in a PlaintextDatabase.
+        The plaintext is read in place from the mapped database file.
+
+        @param[in] encrypted_ntt The ciphertext to multiply
+        @param[in] database The database of plaintexts in NTT form
+        @param[in] index The index of the plaintext in the database
+        @throws std::invalid_argument if encrypted_ntt is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if encrypted_ntt is not in NTT form
+        @throws std::invalid_argument if encrypted_ntt and the database are at
+        different levels
+        @throws std::invalid_argument if, when using scheme_type::CKKS, the output 
+        scale is too large for the encryption parameters
+        @throws std::out_of_range if index is not within [0, database.size())
+        @throws std::logic_error if result ciphertext is transparent
+        */
+        void multiply_plain_inplace(Ciphertext &encrypted_ntt,
+            const PlaintextDatabase &database, std::size_t index);
+
+        /**
+        Multiplies a ciphertext in NTT form with a plaintext in a PlaintextDatabase
+        and stores the result in the destination parameter. The plaintext is read
+        in place from the mapped database file.
+
+        @param[in] encrypted_ntt The ciphertext to multiply
+        @param[in] database The database of plaintexts in NTT form
+        @param[in] index The index of the plaintext in the database
+        @param[out] destination The ciphertext to overwrite with the multiplication result
+        @throws std::invalid_argument if encrypted_ntt is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if encrypted_ntt is not in NTT form
+        @throws std::invalid_argument if encrypted_ntt and the database are at
+        different levels
+        @throws std::invalid_argument if, when using scheme_type::CKKS, the output 
+        scale is too large for the encryption parameters
+        @throws std::out_of_range if index is not within [0, database.size())
+        @throws std::logic_error if result ciphertext is transparent
+        */
+        inline void multiply_plain(const Ciphertext &encrypted_ntt,
+            const PlaintextDatabase &database, std::size_t index,
+            Ciphertext &destination)
+        {
+            destination = encrypted_ntt;
+            multiply_plain_inplace(destination, database, index);
+        }
+
+        /**
+        Computes the inner product of a vector of ciphertexts with a vector of 
+        plaintexts, that is, the sum of the products of encrypteds[i] with plains[i], 
+        and stores the result in the destination parameter. The products are 
+        computed in NTT form and summed in a CiphertextAccumulator without modular 
+        reduction after every term. With scheme_type::BFV, ciphertexts that are not 
+        in NTT form are transformed to NTT form term by term, and only the result 
+        is transformed back, so the inner product costs one inverse NTT instead of
+        one per term. Plaintexts that are not in NTT form are transformed at the 
+        level of the ciphertexts. The terms are split into contiguous ranges that 
+        are accumulated in parallel. Dynamic memory allocations in the process are 
+        allocated from the memory pool pointed to by the given MemoryPoolHandle and
+        from thread-local memory pools.
+
+        @param[in] encrypteds The ciphertexts to multiply
+        @param[in] plains The plaintexts to multiply
+        @param[out] destination The ciphertext to overwrite with the inner product
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @param[in] thread_count The maximum number of threads to use; zero means the
+        number of hardware threads
+        @throws std::invalid_argument if encrypteds is empty
+        @throws std::invalid_argument if encrypteds and plains have different sizes
+        @throws std::invalid_argument if the ciphertexts or plaintexts are not valid 
+        for the encryption parameters
+        @throws std::invalid_argument if the ciphertexts are at different levels or
+        in different NTT forms
+        @throws std::invalid_argument if, when using scheme_type::CKKS, the ciphertexts
+        or plaintexts are not in NTT form
+        @throws std::invalid_argument if the products have different scales or their
+        scale is too large for the encryption parameters
+        @throws std::invalid_argument if destination is one of encrypteds
+        @throws std::invalid_argument if pool is uninitialized
+        @throws std::logic_error if result ciphertext is transparent
+        */
+        void inner_product_plain(const std::vector<Ciphertext> &encrypteds,
+            const std::vector<Plaintext> &plains, Ciphertext &destination,
+            MemoryPoolHandle pool = MemoryManager::GetPool(), 
+            std::size_t thread_count = 0);
+
+        /**
+        Computes the inner product of a vector of ciphertexts with consecutive
+        plaintexts in a PlaintextDatabase, that is, the sum of the products of 
+        encrypteds[i] with the plaintext at index first_index + i, and stores the 
+        result in the destination parameter. This is the answer of a private 
+        information retrieval server to a query. The plaintexts are read in place 
+        from the database. See the other inner_product_plain function for details.
+
+        @param[in] encrypteds The ciphertexts to multiply
+        @param[in] database The database holding the plaintexts
+        @param[in] first_index The index of the plaintext multiplied with encrypteds[0]
+        @param[out] destination The ciphertext to overwrite with the inner product
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @param[in] thread_count The maximum number of threads to use; zero means the
+        number of hardware threads
+        @throws std::invalid_argument if encrypteds is empty
+        @throws std::out_of_range if the database has fewer than 
+        first_index + encrypteds.size() plaintexts
+        @throws std::invalid_argument if the ciphertexts are not valid for the 
+        encryption parameters
+        @throws std::invalid_argument if the ciphertexts are not at the level of the
+        database or in different NTT forms
+        @throws std::invalid_argument if, when using scheme_type::CKKS, the ciphertexts
+        are not in NTT form
+        @throws std::invalid_argument if the products have different scales or their
+        scale is too large for the encryption parameters
+        @throws std::invalid_argument if destination is one of encrypteds
+        @throws std::invalid_argument if pool is uninitialized
+        @throws std::logic_error if result ciphertext is transparent
+        */
+        void inner_product_plain(const std::vector<Ciphertext> &encrypteds,
+            const PlaintextDatabase &database, std::size_t first_index, 
+            Ciphertext &destination, MemoryPoolHandle pool = MemoryManager::GetPool(), 
+            std::size_t thread_count = 0);
+
         /**
         Transforms a plaintext to NTT domain. This functions applies the Number 
         Theoretic Transform to a plaintext by first embedding integers modulo the 
@@ -1036,6 +1416,73 @@ namespace seal
             apply_galois_inplace(destination, galois_elt, galois_keys, std::move(pool));
         }
 
+        /**
+        Returns the Galois elements of the shortest sequence of the given Galois 
+        keys whose automorphisms compose to the Galois automorphism by galois_elt. 
+        This is the sequence of key switches apply_galois_inplace performs when 
+        there is no key for galois_elt itself; for example, with keys only for 
+        the row rotations by 1 and 4 steps, a rotation by 9 steps is planned as 
+        4 + 4 + 1. The search over all Galois elements is done once for every set 
+        of available keys and the result is cached in the Evaluator, so planning 
+        further elements with the same keys is a table walk.
+
+        @param[in] galois_elt The Galois element
+        @param[in] galois_keys The Galois keys
+        @throws std::invalid_argument if the Galois element is not valid
+        @throws std::invalid_argument if galois_elt cannot be composed from the 
+        Galois keys
+        */
+        std::vector<std::uint64_t> plan_galois(std::uint64_t galois_elt,
+            const GaloisKeys &galois_keys) const;
+
+        /**
+        Expands a ciphertext into count ciphertexts, each encrypting one coefficient
+        of the original plaintext, as done with the query in private information
+        retrieval. With l = ceil(log2(count)) the expansion takes l levels; at level
+        a every ciphertext c computed so far is split into c + c(x^(N/2^a + 1)) and
+        (c - c(x^(N/2^a + 1))) * x^(-2^a), where N = degree(poly_modulus). The Galois
+        automorphism of each ciphertext is computed once and shared by both halves,
+        the multiplication by the monomial is a negacyclic shift of the coefficients
+        that needs no NTT, and the ciphertexts of a level are expanded in parallel.
+
+        If encrypted encrypts sum_i a_i x^i, ciphertext k of the result encrypts
+        2^l * sum_j a_(k + j * 2^l) x^(j * 2^l). In particular, if only the first
+        count coefficients are non-zero, ciphertext k encrypts the constant 2^l * a_k.
+        The factor 2^l can be removed by multiplying the plaintext with the inverse
+        of 2^l modulo the plaintext modulus before encryption. The Galois keys for
+        the elements returned by expand_query_galois_elts(count) must be present.
+
+        @param[in] encrypted The ciphertext to expand
+        @param[in] count The number of ciphertexts to produce
+        @param[in] galois_keys The Galois keys
+        @param[out] destination The vector to overwrite with the expanded ciphertexts
+        @param[in] thread_count The number of threads to use; zero means the
+        number of hardware threads
+        @throws std::invalid_argument if encrypted or galois_keys is not valid for 
+        the encryption parameters
+        @throws std::invalid_argument if the encryption parameters do not use the
+        BFV scheme
+        @throws std::invalid_argument if encrypted is in NTT form or has size
+        larger than 2
+        @throws std::invalid_argument if count is not within [1, N]
+        @throws std::invalid_argument if necessary Galois keys are not present
+        @throws std::invalid_argument if encrypted is an element of destination
+        @throws std::logic_error if a result ciphertext is transparent
+        */
+        void expand_query(const Ciphertext &encrypted, std::size_t count,
+            const GaloisKeys &galois_keys, std::vector<Ciphertext> &destination,
+            std::size_t thread_count = 0);
+
+        /**
+        Returns the Galois elements whose keys expand_query needs to expand a
+        ciphertext into count ciphertexts.
+
+        @param[in] count The number of ciphertexts to produce
+        @throws std::invalid_argument if count is not within [1, N], where
+        N = degree(poly_modulus)
+        */
+        std::vector<std::uint64_t> expand_query_galois_elts(std::size_t count) const;
+
         /**
         Rotates plaintext matrix rows cyclically. When batching is used with the 
         BFV scheme, this function rotates the encrypted plaintext matrix rows 
@@ -1328,6 +1775,11 @@ namespace seal
 
         void bfv_square(Ciphertext &encrypted, MemoryPoolHandle pool);
 
+        // Multiplies encrypted1 by encrypted2, which may be encrypted1 itself, with
+        // the HPS algorithm
+        void bfv_multiply_hps(Ciphertext &encrypted1, const Ciphertext &encrypted2,
+            MemoryPoolHandle pool);
+
         void ckks_square(Ciphertext &encrypted, MemoryPoolHandle pool);
 
         void relinearize_internal(Ciphertext &encrypted, const RelinKeys &relin_keys,
@@ -1369,111 +1821,10 @@ namespace seal
                 galois_keys, std::move(pool));
         }
 
-        inline void decompose_single_coeff(const SEALContext::ContextData &context_data,
-            const std::uint64_t *value, std::uint64_t *destination, util::MemoryPool &pool)
-        {
-            auto &parms = context_data.parms();
-            auto &coeff_modulus = parms.coeff_modulus();
-            std::size_t coeff_mod_count = coeff_modulus.size();
-#ifdef SEAL_DEBUG
-            if (value == nullptr)
-            {
-                throw std::invalid_argument("value cannot be null");
-            }
-            if (destination == nullptr)
-            {
-                throw std::invalid_argument("destination cannot be null");
-            }
-            if (destination == value)
-            {
-                throw std::invalid_argument("value cannot be the same as destination");
-            }
-#endif
-            if (coeff_mod_count == 1)
-            {
-                util::set_uint_uint(value, coeff_mod_count, destination);
-                return;
-            }
-
-            auto value_copy(util::allocate_uint(coeff_mod_count, pool));
-            for (std::size_t j = 0; j < coeff_mod_count; j++)
-            {
-                //destination[j] = util::modulo_uint(
-                //    value, coeff_mod_count, coeff_modulus_[j], pool);
-
-                // Manually inlined for efficiency
-                // Make a fresh copy of value
-                util::set_uint_uint(value, coeff_mod_count, value_copy.get());
-
-                // Starting from the top, reduce always 128-bit blocks
-                for (std::size_t k = coeff_mod_count - 1; k--; )
-                {
-                    value_copy[k] = util::barrett_reduce_128(
-                        value_copy.get() + k, coeff_modulus[j]);
-                }
-                destination[j] = value_copy[0];
-            }
-        }
-
-        inline void decompose(const SEALContext::ContextData &context_data, 
-            const std::uint64_t *value, std::uint64_t *destination, util::MemoryPool &pool)
-        {
-            auto &parms = context_data.parms();
-            auto &coeff_modulus = parms.coeff_modulus();
-            std::size_t coeff_count = parms.poly_modulus_degree();
-            std::size_t coeff_mod_count = coeff_modulus.size();
-            std::size_t rns_poly_uint64_count = 
-                util::mul_safe(coeff_mod_count, coeff_count);
-#ifdef SEAL_DEBUG
-            if (value == nullptr)
-            {
-                throw std::invalid_argument("value cannot be null");
-            }
-            if (destination == nullptr)
-            {
-                throw std::invalid_argument("destination cannot be null");
-            }
-            if (destination == value)
-            {
-                throw std::invalid_argument("value cannot be the same as destination");
-            }
-#endif
-            if (coeff_mod_count == 1)
-            {
-                util::set_uint_uint(value, rns_poly_uint64_count, destination);
-                return;
-            }
-
-            auto value_copy(util::allocate_uint(coeff_mod_count, pool));
-            for (size_t i = 0; i < coeff_count; i++)
-            {
-                for (size_t j = 0; j < coeff_mod_count; j++)
-                {
-                    //destination[i + (j * coeff_count)] = 
-                    //    util::modulo_uint(value + (i * coeff_mod_count),
-                    //        coeff_mod_count, coeff_modulus_[j], pool);
-
-                    // Manually inlined for efficiency
-                    // Make a fresh copy of value + (i * coeff_mod_count)
-                    util::set_uint_uint(
-                        value + (i * coeff_mod_count), coeff_mod_count, value_copy.get());
-
-                    // Starting from the top, reduce always 128-bit blocks
-                    for (std::size_t k = coeff_mod_count - 1; k--; )
-                    {
-                        value_copy[k] = util::barrett_reduce_128(
-                            value_copy.get() + k, coeff_modulus[j]);
-                    }
-                    destination[i + (j * coeff_count)] = value_copy[0];
-                }
-            }
-        }
-
-        void bfv_relinearize_one_step(std::uint64_t *encrypted, std::size_t encrypted_size,
-            const SEALContext::ContextData &context_data,
-            const RelinKeys &relin_keys, util::MemoryPool &pool);
-
-        void ckks_relinearize_one_step(std::uint64_t *encrypted, std::size_t encrypted_size,
+        // Switches the components of encrypted from destination_size on to c_0
+        // and c_1 in one pass; the components are overwritten
+        void relinearize_components(std::uint64_t *encrypted, std::size_t encrypted_size,
+            std::size_t destination_size, bool is_ntt_form,
             const SEALContext::ContextData &context_data,
             const RelinKeys &relin_keys, util::MemoryPool &pool);
 
@@ -1482,10 +1833,77 @@ namespace seal
 
         void multiply_plain_ntt(Ciphertext &encrypted_ntt, const Plaintext &plain_ntt);
 
+        void multiply_plain_ntt(Ciphertext &encrypted_ntt,
+            const std::uint64_t *plain_ntt, double plain_scale);
+
+        // Accumulates multiply_add(accumulator, encrypted_ntt, index, plain_ntt, pool)
+        // for every ciphertext in NTT form in several threads; plain_ntt and pool 
+        // are scratch space and a memory pool of the thread
+        void inner_product_plain_internal(const std::vector<Ciphertext> &encrypteds,
+            const std::function<void(CiphertextAccumulator &, const Ciphertext &, 
+                std::size_t, Plaintext &, const MemoryPoolHandle &)> &multiply_add,
+            Ciphertext &destination, MemoryPoolHandle pool, std::size_t thread_count);
+
+        void multiply_plain_transformed(Ciphertext &encrypted,
+            const std::uint64_t *plain_ntt);
+
+        void apply_galois_one_step(Ciphertext &encrypted, std::uint64_t galois_elt,
+            const GaloisKeys &galois_keys, std::uint64_t *scratch);
+
         void populate_Zmstar_to_generator();
 
+        // Performs an operation on the operands of a CKKS operation aligned in 
+        // automatic alignment mode and returns true, or returns false if the 
+        // operands need no alignment; encrypted1 is replaced with the result and 
+        // the alignment is reported only if perform succeeds
+        template<typename T>
+        bool perform_aligned_ckks(Ciphertext &encrypted1, const T &operand2,
+            bool match_scales, const char *operation, MemoryPoolHandle pool,
+            const std::function<void(Ciphertext &, const T &)> &perform);
+
+        // Aligns the operands of a CKKS operation and returns the second operand
+        // to use, which is either encrypted2 or aligned2; encrypted1 is written to
+        // aligned1 only if it changes, and scales are made equal only if 
+        // match_scales is set
+        const Ciphertext &align_ckks(const Ciphertext &encrypted1,
+            const Ciphertext &encrypted2, Ciphertext &aligned1, Ciphertext &aligned2,
+            bool match_scales, CKKSAlignment &alignment, MemoryPoolHandle pool);
+
+        const Plaintext &align_ckks(const Ciphertext &encrypted, const Plaintext &plain,
+            Ciphertext &aligned, Plaintext &aligned_plain, bool match_scales,
+            CKKSAlignment &alignment, MemoryPoolHandle pool);
+
+        // Whether a multiplication operand is rescaled in automatic alignment mode
+        bool rescales_for_multiply(const Ciphertext &encrypted) const;
+
+        // Whether rescaling brings the scale of a ciphertext closer to scale
+        bool rescales_toward(const Ciphertext &encrypted, double scale) const;
+
+        void report_ckks_alignment(const CKKSAlignment &alignment) const;
+
+        // Number of key sets for which plan_galois keeps its search results
+        static constexpr std::size_t galois_plan_cache_size = 16;
+
         std::shared_ptr<SEALContext> context_{ nullptr };
 
         std::map<std::uint64_t, std::pair<std::uint64_t, std::uint64_t>> Zmstar_to_generator_{};
+
+        // For every Galois element, the last key of a shortest sequence of keys
+        // composing to it, for each set of available Galois keys
+        mutable std::map<std::vector<std::uint64_t>, 
+            std::shared_ptr<const std::vector<std::uint64_t>>> galois_plans_{};
+
+        mutable std::mutex galois_plans_mutex_;
+
+        bool ckks_auto_alignment_ = false;
+
+        double max_scale_adjustment_ = 0.0;
+
+        CKKSAlignmentHandler alignment_handler_{};
+
+        bfv_multiply_type bfv_multiply_type_ = bfv_multiply_type::BEHZ;
+
+        // The HPS pre-computations indexed by the chain index of the parameters
+        std::vector<std::shared_ptr<const util::HPSConverter>> hps_converters_{};
     };
 }
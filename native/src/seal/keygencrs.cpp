@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include "seal/keygencrs.h"
+#include "seal/randomtostd.h"
+
+using namespace std;
+
+namespace seal
+{
+    bool KeyGenCRS::is_valid_for(shared_ptr<const SEALContext> context) const noexcept
+    {
+        // Verify parameters
+        if (!context || !context->parameters_set())
+        {
+            return false;
+        }
+        return parms_id_ == context->first_parms_id();
+    }
+
+    void KeyGenCRS::expand(shared_ptr<const SEALContext> context,
+        uint64_t *destination, uint64_t domain) const
+    {
+        if (!is_valid_for(context))
+        {
+            throw invalid_argument("KeyGenCRS is not valid for encryption parameters");
+        }
+        if (!destination)
+        {
+            throw invalid_argument("destination cannot be null");
+        }
+
+        auto &parms = context->context_data()->parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+
+        // The expansion is deterministic, so every party obtains the same value;
+        // the polynomial is sampled directly in NTT form
+        RandomToStandardAdapter engine(make_shared<HashPRNG>(seed_, domain));
+        for (size_t j = 0; j < coeff_mod_count; j++)
+        {
+            uint64_t current_modulus = coeff_modulus[j].value();
+            for (size_t i = 0; i < coeff_count; i++, destination++)
+            {
+                uint64_t new_coeff = (static_cast<uint64_t>(engine()) << 32) +
+                    static_cast<uint64_t>(engine());
+                *destination = new_coeff % current_modulus;
+            }
+        }
+    }
+
+    void KeyGenCRS::save(ostream &stream) const
+    {
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on std::ios_base::badbit and std::ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            stream.write(reinterpret_cast<const char*>(&parms_id_),
+                sizeof(parms_id_type));
+            stream.write(reinterpret_cast<const char*>(seed_.data()),
+                static_cast<streamsize>(sizeof(seed_type)));
+        }
+        catch (const exception &)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+
+        stream.exceptions(old_except_mask);
+    }
+
+    void KeyGenCRS::unsafe_load(istream &stream)
+    {
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on std::ios_base::badbit and std::ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            stream.read(reinterpret_cast<char*>(&parms_id_),
+                sizeof(parms_id_type));
+            stream.read(reinterpret_cast<char*>(seed_.data()),
+                static_cast<streamsize>(sizeof(seed_type)));
+        }
+        catch (const exception &)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+
+        stream.exceptions(old_except_mask);
+    }
+}
@@ -5,16 +5,12 @@
 #pragma once
 
 #include "seal/randomgen.h"
-#include "seal/plaintext.h"
-#include "seal/memorymanager.h"
-#include "seal/util/common.h"
-#include "ciphertext.h"
-#include "publickey.h"
+#include "seal/context.h"
+#include "seal/encryptionparams.h"
 #include <iostream>
 #include <cstdint>
-#include <cstddef>
 #include <memory>
-#include <random>
+#include <stdexcept>
 
 namespace seal
 {
@@ -27,24 +23,45 @@ namespace seal
     we are going to use it as a Common Reference String for our distributed key generation
     protocol.
 
+    @par Seed Representation
+    The KeyGenCRS stores only a 256-bit seed and the parms_id of the encryption
+    parameters it belongs to. The uniformly random polynomial 'a' is expanded
+    deterministically from the seed (in NTT form) by KeyGenerator only when it is
+    needed, so broadcasting a KeyGenCRS to the parties costs only a few bytes. The
+    common random polynomials used in distributed relinearization and Galois key
+    generation are expanded from the same seed in separate domains.
 
     @par Thread Safety
     In general, reading from KeyGenCRS is thread-safe as long as no other thread
-    is concurrently mutating it. This is due to the underlying data structure
-    storing the data not being thread-safe.
+    is concurrently mutating it.
 
 
     @see KeyGenerator for the class that generates the KeyGenCRS.
     @see PublicKey for the class that uses KeyGenCRS.
     */
-    class KeyGenCRS : public PublicKey
+    class KeyGenCRS
     {
     public:
+        /**
+        The type of the seed from which the CRS value is expanded.
+        */
+        using seed_type = HashPRNG::seed_type;
 
         /**
          * Creates an empty CRS value for key generation
          */
-         KeyGenCRS() = default;
+        KeyGenCRS() = default;
+
+        /**
+        Creates a CRS value from a given seed for the given encryption parameters.
+
+        @param[in] seed The seed
+        @param[in] parms_id The parms_id of the encryption parameters
+        */
+        KeyGenCRS(const seed_type &seed, const parms_id_type &parms_id) :
+            parms_id_(parms_id), seed_(seed)
+        {
+        }
 
         /**
         Creates a new KeyGenCRS by copying an old one.
@@ -73,5 +90,130 @@ namespace seal
         @param[in] assign The KeyGenCRS to move from
         */
         KeyGenCRS &operator =(KeyGenCRS &&assign) = default;
+
+        /**
+        Returns a reference to the seed.
+        */
+        inline auto &seed() noexcept
+        {
+            return seed_;
+        }
+
+        /**
+        Returns a const reference to the seed.
+        */
+        inline auto &seed() const noexcept
+        {
+            return seed_;
+        }
+
+        /**
+        Returns a reference to parms_id.
+
+        @see EncryptionParameters for more information about parms_id.
+        */
+        inline auto &parms_id() noexcept
+        {
+            return parms_id_;
+        }
+
+        /**
+        Returns a const reference to parms_id.
+
+        @see EncryptionParameters for more information about parms_id.
+        */
+        inline auto &parms_id() const noexcept
+        {
+            return parms_id_;
+        }
+
+        /**
+        Returns whether two KeyGenCRS values are the same.
+
+        @param[in] compare The KeyGenCRS to compare against
+        */
+        inline bool operator ==(const KeyGenCRS &compare) const noexcept
+        {
+            return parms_id_ == compare.parms_id_ && seed_ == compare.seed_;
+        }
+
+        /**
+        Returns whether two KeyGenCRS values are different.
+
+        @param[in] compare The KeyGenCRS to compare against
+        */
+        inline bool operator !=(const KeyGenCRS &compare) const noexcept
+        {
+            return !operator ==(compare);
+        }
+
+        /**
+        Check whether the current KeyGenCRS is valid for a given SEALContext. If
+        the given SEALContext is not set, the encryption parameters are invalid,
+        or the KeyGenCRS does not belong to the first encryption parameters of
+        the SEALContext, this function returns false. Otherwise, returns true.
+
+        @param[in] context The SEALContext
+        */
+        bool is_valid_for(std::shared_ptr<const SEALContext> context) const noexcept;
+
+        /**
+        Expands the CRS value into a uniformly random polynomial in NTT form, or
+        into one of the further common random polynomials derived from it when
+        domain is non-zero. The destination must have room for a polynomial of
+        the first encryption parameters of the SEALContext.
+
+        @param[in] context The SEALContext
+        @param[out] destination The polynomial to overwrite with the expansion
+        @param[in] domain Separates the polynomials expanded from the same seed
+        @throws std::invalid_argument if the KeyGenCRS is not valid for the context
+        @throws std::invalid_argument if destination is null
+        */
+        void expand(std::shared_ptr<const SEALContext> context,
+            std::uint64_t *destination, std::uint64_t domain = 0) const;
+
+        /**
+        Saves the KeyGenCRS to an output stream. The output is in binary format
+        and not human-readable. The output stream must have the "binary" flag set.
+
+        @param[in] stream The stream to save the KeyGenCRS to
+        @throws std::exception if the KeyGenCRS could not be written to stream
+        */
+        void save(std::ostream &stream) const;
+
+        /**
+        Loads a KeyGenCRS from an input stream overwriting the current KeyGenCRS.
+        No checking of the validity of the KeyGenCRS against encryption parameters
+        is performed.
+
+        @param[in] stream The stream to load the KeyGenCRS from
+        @throws std::exception if a valid KeyGenCRS could not be read from stream
+        */
+        void unsafe_load(std::istream &stream);
+
+        /**
+        Loads a KeyGenCRS from an input stream overwriting the current KeyGenCRS.
+        The loaded KeyGenCRS is verified to be valid for the given SEALContext.
+
+        @param[in] context The SEALContext
+        @param[in] stream The stream to load the KeyGenCRS from
+        @throws std::exception if a valid KeyGenCRS could not be read from stream
+        @throws std::invalid_argument if the loaded KeyGenCRS is invalid for the
+        context
+        */
+        inline void load(std::shared_ptr<SEALContext> context,
+            std::istream &stream)
+        {
+            unsafe_load(stream);
+            if (!is_valid_for(std::move(context)))
+            {
+                throw std::invalid_argument("KeyGenCRS data is invalid");
+            }
+        }
+
+    private:
+        parms_id_type parms_id_ = parms_id_zero;
+
+        seed_type seed_{};
     };
-}
\ No newline at end of file
+}
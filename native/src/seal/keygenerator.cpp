@@ -12,6 +12,7 @@
 #include "seal/util/clipnormal.h"
 #include "seal/util/polycore.h"
 #include "seal/util/smallntt.h"
+#include "seal/util/parallel.h"
 
 using namespace std;
 using namespace seal::util;
@@ -53,6 +54,11 @@ namespace seal {
             throw invalid_argument("encryption parameters are not set correctly");
         }
 
+        if (!keygen_crs.is_valid_for(context_))
+        {
+            throw invalid_argument("keygen_crs is not valid for encryption parameters");
+        }
+
         keygen_crs_ = keygen_crs;
         crs_generated_ = true;
 
@@ -113,6 +119,11 @@ namespace seal {
             throw invalid_argument("secret_key is not valid for encryption parameters");
         }
 
+        if (!keygen_crs.is_valid_for(context_))
+        {
+            throw invalid_argument("keygen_crs is not valid for encryption parameters");
+        }
+
         keygen_crs_ = keygen_crs;
         crs_generated_ = true;
 
@@ -214,27 +225,23 @@ namespace seal {
     void KeyGenerator::generate_crs()
     {
         // Extract encryption parameters.
-        auto &context_data = *context_->context_data();
-        auto &parms = context_data.parms();
+        auto &parms = context_->context_data()->parms();
 
         // Initialize crs.
-        //keygen_crs_ = KeyGenCRS();
         crs_generated_ = false;
-        keygen_crs_.data().resize(context_, parms.parms_id(), 2); // TODO: actually we don't need 2, but there is a hardcoded requirement for that, just leave it as it is for now
-
-        // The crs is in NTT form
-        keygen_crs_.data().is_ntt_form() = true;
 
+        // Only the seed is sampled; the polynomial is expanded when needed
         shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
+        RandomToStandardAdapter engine(random);
+        KeyGenCRS::seed_type seed;
+        for (auto &word : seed)
+        {
+            word = (static_cast<uint64_t>(engine()) << 32) +
+                static_cast<uint64_t>(engine());
+        }
+        keygen_crs_ = KeyGenCRS(seed, parms.parms_id());
 
-        // Sample a uniformly at random (we sample the NTT form directly)
-        uint64_t *crs = keygen_crs_.data().data(0);
-        set_poly_coeffs_uniform(context_data, crs, random);
-
-        // Set the parms_id for crs
-        keygen_crs_.parms_id() = parms.parms_id();
-
-        // Public key has been generated
+        // Crs has been generated
         crs_generated_ = true;
     }
 
@@ -274,8 +281,8 @@ namespace seal {
         uint64_t *public_key_1 = public_key_.data().data(1);
 
         if (!crs_generated_) generate_crs();
-        // copy crs data to pk[1]
-        set_poly_poly(keygen_crs_.data().data(0), coeff_count, coeff_mod_count, public_key_1);
+        // expand crs into pk[1]
+        keygen_crs_.expand(context_, public_key_1);
 
         // calculate a*s + e (mod q) and store in pk[0]
         auto &small_ntt_tables = context_data.small_ntt_tables();
@@ -400,6 +407,14 @@ namespace seal {
         // Make sure we have enough secret keys computed
         compute_secret_key_array(context_data, count + 1);
 
+        // The crs polynomial is expanded once and shared by all components
+        Pointer<uint64_t> crs;
+        if (use_crs)
+        {
+            crs = allocate_poly(coeff_count, coeff_mod_count, pool_);
+            keygen_crs_.expand(context_, crs.get());
+        }
+
         // assume the secret key is already transformed into NTT form. 
         for (size_t k = 0; k < count; k++)
         {
@@ -415,7 +430,7 @@ namespace seal {
                     // We sample a_i directly in NTT form
                     if (use_crs)
                     {
-                        set_poly_poly(keygen_crs_.data().data(0), coeff_count, coeff_mod_count, eval_keys_second);
+                        set_poly_poly(crs.get(), coeff_count, coeff_mod_count, eval_keys_second);
                     }
                     else
                     {
@@ -470,6 +485,220 @@ namespace seal {
         return relin_keys;
     }
 
+    RelinKeysShare KeyGenerator::relin_keys_share_round1(int decomposition_bit_count)
+    {
+        // Check to see if secret key and crs have been generated
+        if (!sk_generated_)
+        {
+            throw logic_error("cannot generate relinearization key share for unspecified secret key");
+        }
+        if (!crs_generated_)
+        {
+            throw logic_error("cannot generate relinearization key share for unspecified crs value");
+        }
+
+        // Check that decomposition_bit_count is in correct interval
+        if (decomposition_bit_count < SEAL_DBC_MIN ||
+            decomposition_bit_count > SEAL_DBC_MAX)
+        {
+            throw invalid_argument("decomposition_bit_count is not in the valid range");
+        }
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data();
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        auto &small_ntt_tables = context_data.small_ntt_tables();
+
+        // Size check
+        if (!product_fits_in(coeff_count, coeff_mod_count))
+        {
+            throw logic_error("invalid parameters");
+        }
+
+        // Initialize decomposition_factors
+        vector<vector<uint64_t>> decomposition_factors;
+        populate_decomposition_factors(context_data, decomposition_bit_count,
+            decomposition_factors);
+
+        // Create the RelinKeysShare object to return
+        RelinKeysShare share;
+        share.data_.reserve(coeff_mod_count);
+        for (size_t l = 0; l < coeff_mod_count; l++)
+        {
+            share.data_.emplace_back(context_, parms.parms_id(),
+                2 * decomposition_factors[l].size(), share.pool());
+            share.data_.back().resize(2 * decomposition_factors[l].size());
+            share.data_.back().is_ntt_form() = true;
+        }
+
+        shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
+
+        // Sample the ephemeral secret u; it is needed again in round 2
+        relin_share_ephemeral_key_ = allocate_poly(coeff_count, coeff_mod_count, pool_);
+        uint64_t *ephemeral_key = relin_share_ephemeral_key_.get();
+        set_poly_coeffs_zero_one_negone(context_data, ephemeral_key, random);
+        for (size_t j = 0; j < coeff_mod_count; j++)
+        {
+            ntt_negacyclic_harvey(ephemeral_key + (j * coeff_count), small_ntt_tables[j]);
+        }
+
+        auto crs(allocate_poly(coeff_count, coeff_mod_count, pool_));
+        auto noise(allocate_poly(coeff_count, coeff_mod_count, pool_));
+        auto temp(allocate_uint(coeff_count, pool_));
+        const uint64_t *secret_key = secret_key_.data().data();
+
+        // Every decomposition component uses its own common random polynomial
+        uint64_t component_index = 0;
+        for (size_t l = 0; l < coeff_mod_count; l++)
+        {
+            for (size_t i = 0; i < decomposition_factors[l].size(); i++)
+            {
+                uint64_t *share_first = share.data_[l].data(2 * i);
+                uint64_t *share_second = share.data_[l].data(2 * i + 1);
+
+                // The common random polynomial a_i is expanded directly in NTT form
+                keygen_crs_.expand(context_, crs.get(), ++component_index);
+
+                // Compute [-a_i*u]_q into share_first and [a_i*s]_q into share_second
+                for (size_t j = 0; j < coeff_mod_count; j++)
+                {
+                    dyadic_product_coeffmod(crs.get() + (j * coeff_count),
+                        ephemeral_key + (j * coeff_count), coeff_count,
+                        coeff_modulus[j], share_first + (j * coeff_count));
+                    negate_poly_coeffmod(share_first + (j * coeff_count), coeff_count,
+                        coeff_modulus[j], share_first + (j * coeff_count));
+                    dyadic_product_coeffmod(crs.get() + (j * coeff_count),
+                        secret_key + (j * coeff_count), coeff_count,
+                        coeff_modulus[j], share_second + (j * coeff_count));
+                }
+
+                // Add w^i*s to share_first; only the l-th prime has a non-zero factor
+                multiply_poly_scalar_coeffmod(secret_key + (l * coeff_count),
+                    coeff_count, decomposition_factors[l][i], coeff_modulus[l], temp.get());
+                add_poly_poly_coeffmod(share_first + (l * coeff_count), temp.get(),
+                    coeff_count, coeff_modulus[l], share_first + (l * coeff_count));
+
+                // Add fresh noise to both polynomials
+                for (size_t k = 0; k < 2; k++)
+                {
+                    uint64_t *share_poly = share.data_[l].data(2 * i + k);
+                    set_poly_coeffs_normal(context_data, noise.get(), random);
+                    for (size_t j = 0; j < coeff_mod_count; j++)
+                    {
+                        ntt_negacyclic_harvey(noise.get() + (j * coeff_count),
+                            small_ntt_tables[j]);
+                        add_poly_poly_coeffmod(noise.get() + (j * coeff_count),
+                            share_poly + (j * coeff_count), coeff_count,
+                            coeff_modulus[j], share_poly + (j * coeff_count));
+                    }
+                }
+            }
+        }
+
+        // Set decomposition_bit_count and parms_id
+        share.decomposition_bit_count_ = decomposition_bit_count;
+        share.parms_id_ = parms.parms_id();
+
+        relin_share_decomposition_bit_count_ = decomposition_bit_count;
+        relin_share_round1_generated_ = true;
+
+        return share;
+    }
+
+    RelinKeysShare KeyGenerator::relin_keys_share_round2(
+        const RelinKeysShare &round1_aggregate)
+    {
+        if (!relin_share_round1_generated_)
+        {
+            throw logic_error("round-1 relinearization key share has not been generated");
+        }
+        if (!round1_aggregate.is_valid_for(context_))
+        {
+            throw invalid_argument("round1_aggregate is not valid for encryption parameters");
+        }
+        if (round1_aggregate.decomposition_bit_count() !=
+            relin_share_decomposition_bit_count_)
+        {
+            throw invalid_argument("round1_aggregate has mismatching decomposition bit count");
+        }
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data();
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        auto &small_ntt_tables = context_data.small_ntt_tables();
+
+        // Create the RelinKeysShare object to return with the same layout
+        RelinKeysShare share;
+        share.data_.reserve(coeff_mod_count);
+        for (size_t l = 0; l < coeff_mod_count; l++)
+        {
+            size_t size = round1_aggregate.data_[l].size();
+            share.data_.emplace_back(context_, parms.parms_id(), size, share.pool());
+            share.data_.back().resize(size);
+            share.data_.back().is_ntt_form() = true;
+        }
+
+        shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
+
+        // Compute u - s once for all decomposition components
+        const uint64_t *secret_key = secret_key_.data().data();
+        uint64_t *ephemeral_key = relin_share_ephemeral_key_.get();
+        auto ephemeral_diff(allocate_poly(coeff_count, coeff_mod_count, pool_));
+        for (size_t j = 0; j < coeff_mod_count; j++)
+        {
+            sub_poly_poly_coeffmod(ephemeral_key + (j * coeff_count),
+                secret_key + (j * coeff_count), coeff_count, coeff_modulus[j],
+                ephemeral_diff.get() + (j * coeff_count));
+        }
+
+        auto noise(allocate_poly(coeff_count, coeff_mod_count, pool_));
+        for (size_t l = 0; l < coeff_mod_count; l++)
+        {
+            size_t decomposition_count = round1_aggregate.data_[l].size() / 2;
+            for (size_t i = 0; i < decomposition_count; i++)
+            {
+                // share_first = s*h0 + e, share_second = (u - s)*h1 + e
+                for (size_t k = 0; k < 2; k++)
+                {
+                    const uint64_t *multiplier = k ? ephemeral_diff.get() : secret_key;
+                    const uint64_t *aggregate_poly = round1_aggregate.data_[l].data(2 * i + k);
+                    uint64_t *share_poly = share.data_[l].data(2 * i + k);
+
+                    set_poly_coeffs_normal(context_data, noise.get(), random);
+                    for (size_t j = 0; j < coeff_mod_count; j++)
+                    {
+                        dyadic_product_coeffmod(aggregate_poly + (j * coeff_count),
+                            multiplier + (j * coeff_count), coeff_count,
+                            coeff_modulus[j], share_poly + (j * coeff_count));
+                        ntt_negacyclic_harvey(noise.get() + (j * coeff_count),
+                            small_ntt_tables[j]);
+                        add_poly_poly_coeffmod(noise.get() + (j * coeff_count),
+                            share_poly + (j * coeff_count), coeff_count,
+                            coeff_modulus[j], share_poly + (j * coeff_count));
+                    }
+                }
+            }
+        }
+
+        // The ephemeral secret must never be used again
+        set_zero_poly(coeff_count, coeff_mod_count, ephemeral_key);
+        set_zero_poly(coeff_count, coeff_mod_count, ephemeral_diff.get());
+        relin_share_ephemeral_key_.release();
+        relin_share_round1_generated_ = false;
+
+        // Set decomposition_bit_count and parms_id
+        share.decomposition_bit_count_ = relin_share_decomposition_bit_count_;
+        share.parms_id_ = parms.parms_id();
+
+        return share;
+    }
+
     GaloisKeys KeyGenerator::galois_keys(int decomposition_bit_count, 
         const vector<uint64_t> &galois_elts)
     {
@@ -479,6 +708,42 @@ namespace seal {
             throw logic_error("cannot generate galois keys for unspecified secret key");
         }
 
+        // Fresh uniformly random a_i, generated on the calling thread
+        return generate_galois_keys(decomposition_bit_count, galois_elts, false, 1);
+    }
+
+    GaloisKeys KeyGenerator::galois_keys_share(int decomposition_bit_count,
+        const vector<uint64_t> &galois_elts, size_t thread_count)
+    {
+        // Check to see if secret key and crs have been generated
+        if (!sk_generated_)
+        {
+            throw logic_error("cannot generate galois keys for unspecified secret key");
+        }
+        if (!crs_generated_)
+        {
+            throw logic_error("cannot generate galois key share for unspecified crs");
+        }
+
+        return generate_galois_keys(decomposition_bit_count, galois_elts, true,
+            thread_count);
+    }
+
+    GaloisKeys KeyGenerator::galois_keys_share(int decomposition_bit_count,
+        const vector<int> &steps, size_t thread_count)
+    {
+        return galois_keys_share(decomposition_bit_count,
+            steps_to_galois_elts(steps), thread_count);
+    }
+
+    GaloisKeys KeyGenerator::galois_keys_share(int decomposition_bit_count)
+    {
+        return galois_keys_share(decomposition_bit_count, default_galois_elts());
+    }
+
+    GaloisKeys KeyGenerator::generate_galois_keys(int decomposition_bit_count,
+        const vector<uint64_t> &galois_elts, bool use_crs, size_t thread_count)
+    {
         // Check that decomposition_bit_count is in correct interval
         if (decomposition_bit_count < SEAL_DBC_MIN || 
             decomposition_bit_count > SEAL_DBC_MAX)
@@ -512,6 +777,9 @@ namespace seal {
         populate_decomposition_factors(context_data, decomposition_bit_count,
             decomposition_factors);
 
+        // Verify the Galois elements and allocate the keys up front; every key
+        // then occupies its own slot and can be filled independently
+        vector<uint64_t> unique_galois_elts;
         for (uint64_t galois_elt : galois_elts)
         {
             // Verify coprime conditions.
@@ -526,15 +794,6 @@ namespace seal {
                 continue;
             }
 
-            // Rotate secret key for each coeff_modulus
-            auto rotated_secret_key(allocate_poly(coeff_count, coeff_mod_count, pool_));
-            for (size_t i = 0; i < coeff_mod_count; i++)
-            {
-                apply_galois_ntt(secret_key_.data().data() + (i * coeff_count),
-                    coeff_count_power, galois_elt,
-                    rotated_secret_key.get() + (i * coeff_count));
-            }
-
             // Initialize galois key
             // This is the location in the galois_keys vector
             uint64_t index = (galois_elt - 1) >> 1;
@@ -555,65 +814,102 @@ namespace seal {
                 // The Galois keys are in NTT form
                 galois_keys.data()[index].back().is_ntt_form() = true;
             }
+            unique_galois_elts.push_back(galois_elt);
+        }
 
+        parallel_for(unique_galois_elts.size(), thread_count,
+            [&](size_t begin, size_t end) {
+            // Each thread uses its own generator, and a pool that is cleared on
+            // destruction since it holds the rotated secret key
+            auto pool = (thread_count == 1) ? pool_ : MemoryPoolHandle::New(true);
             shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
 
-            // Create Galois keys.
-            auto noise(allocate_poly(coeff_count, coeff_mod_count, pool_));
-            auto temp(allocate_uint(coeff_count, pool_));
+            auto rotated_secret_key(allocate_poly(coeff_count, coeff_mod_count, pool));
+            auto noise(allocate_poly(coeff_count, coeff_mod_count, pool));
+            auto temp(allocate_uint(coeff_count, pool));
 
-            for (size_t l = 0; l < coeff_mod_count; l++)
+            for (size_t k = begin; k < end; k++)
             {
-                // populate galois_keys_[k]
-                for (size_t i = 0; i < decomposition_factors[l].size(); i++)
-                {
-                    // generate NTT(a_i) and store in galois_keys_[k][l].second[i]
-                    uint64_t *eval_keys_first = galois_keys.data()[index][l].data(2 * i);
-                    uint64_t *eval_keys_second = galois_keys.data()[index][l].data(2 * i + 1);
+                uint64_t galois_elt = unique_galois_elts[k];
+                uint64_t index = (galois_elt - 1) >> 1;
 
-                    // We sample a_i in NTT form directly
-                    set_poly_coeffs_uniform(context_data, eval_keys_second, random);
-                    for (size_t j = 0; j < coeff_mod_count; j++)
-                    {
-                        // calculate a_i*s and store in galois_keys_[k].first[i]
-                        dyadic_product_coeffmod(eval_keys_second + (j * coeff_count), 
-                            secret_key_.data().data() + (j * coeff_count), 
-                            coeff_count, coeff_modulus[j], 
-                            eval_keys_first + (j * coeff_count));
-                    }
+                // Rotate secret key for each coeff_modulus
+                for (size_t i = 0; i < coeff_mod_count; i++)
+                {
+                    apply_galois_ntt(secret_key_.data().data() + (i * coeff_count),
+                        coeff_count_power, galois_elt,
+                        rotated_secret_key.get() + (i * coeff_count));
+                }
 
-                    // generate NTT(e_i) 
-                    set_poly_coeffs_normal(context_data, noise.get(), random);
-                    for (size_t j = 0; j < coeff_mod_count; j++)
+                // Create Galois keys.
+                uint64_t component_index = 0;
+                for (size_t l = 0; l < coeff_mod_count; l++)
+                {
+                    // populate galois_keys_[k]
+                    for (size_t i = 0; i < decomposition_factors[l].size(); i++)
                     {
-                        ntt_negacyclic_harvey(
-                            noise.get() + (j * coeff_count), small_ntt_tables[j]);
-
-                        // add NTT(e_i) into galois_keys_[k].first[i]
-                        add_poly_poly_coeffmod(noise.get() + (j * coeff_count), 
-                            eval_keys_first + (j * coeff_count), 
-                            coeff_count, coeff_modulus[j],
-                            eval_keys_first + (j * coeff_count));
-
-                        // negate value in galois_keys_[k].first[i]
-                        negate_poly_coeffmod(
-                            eval_keys_first + (j * coeff_count), coeff_count, 
-                            coeff_modulus[j], eval_keys_first + (j * coeff_count));
-
-                        // multiply w^i * rotated_secret_key
-                        uint64_t decomposition_factor_mod = decomposition_factors[l][i] & 
-                            static_cast<uint64_t>(-static_cast<int64_t>(l == j));
-                        multiply_poly_scalar_coeffmod(rotated_secret_key.get() + (j * coeff_count), 
-                            coeff_count, decomposition_factor_mod, 
-                            coeff_modulus[j], temp.get());
-
-                        // add w^i * rotated_secret_key into galois_keys_[k].first[i]
-                        add_poly_poly_coeffmod(eval_keys_first + (j * coeff_count), temp.get(), 
-                            coeff_count, coeff_modulus[j], eval_keys_first + (j * coeff_count));
+                        // generate NTT(a_i) and store in galois_keys_[k][l].second[i]
+                        uint64_t *eval_keys_first = galois_keys.data()[index][l].data(2 * i);
+                        uint64_t *eval_keys_second = galois_keys.data()[index][l].data(2 * i + 1);
+
+                        // We sample a_i in NTT form directly; with the crs every
+                        // Galois element and decomposition component gets its own
+                        // common random polynomial
+                        component_index++;
+                        if (use_crs)
+                        {
+                            keygen_crs_.expand(context_, eval_keys_second,
+                                (galois_elt << 32) + component_index);
+                        }
+                        else
+                        {
+                            set_poly_coeffs_uniform(context_data, eval_keys_second, random);
+                        }
+                        for (size_t j = 0; j < coeff_mod_count; j++)
+                        {
+                            // calculate a_i*s and store in galois_keys_[k].first[i]
+                            dyadic_product_coeffmod(eval_keys_second + (j * coeff_count), 
+                                secret_key_.data().data() + (j * coeff_count), 
+                                coeff_count, coeff_modulus[j], 
+                                eval_keys_first + (j * coeff_count));
+                        }
+
+                        // generate NTT(e_i) 
+                        set_poly_coeffs_normal(context_data, noise.get(), random);
+                        for (size_t j = 0; j < coeff_mod_count; j++)
+                        {
+                            ntt_negacyclic_harvey(
+                                noise.get() + (j * coeff_count), small_ntt_tables[j]);
+
+                            // add NTT(e_i) into galois_keys_[k].first[i]
+                            add_poly_poly_coeffmod(noise.get() + (j * coeff_count), 
+                                eval_keys_first + (j * coeff_count), 
+                                coeff_count, coeff_modulus[j],
+                                eval_keys_first + (j * coeff_count));
+
+                            // negate value in galois_keys_[k].first[i]
+                            negate_poly_coeffmod(
+                                eval_keys_first + (j * coeff_count), coeff_count, 
+                                coeff_modulus[j], eval_keys_first + (j * coeff_count));
+
+                            // multiply w^i * rotated_secret_key
+                            uint64_t decomposition_factor_mod = decomposition_factors[l][i] & 
+                                static_cast<uint64_t>(-static_cast<int64_t>(l == j));
+                            multiply_poly_scalar_coeffmod(rotated_secret_key.get() + (j * coeff_count), 
+                                coeff_count, decomposition_factor_mod, 
+                                coeff_modulus[j], temp.get());
+
+                            // add w^i * rotated_secret_key into galois_keys_[k].first[i]
+                            add_poly_poly_coeffmod(eval_keys_first + (j * coeff_count), temp.get(), 
+                                coeff_count, coeff_modulus[j], eval_keys_first + (j * coeff_count));
+                        }
                     }
                 }
             }
-        }
+
+            // Clear the rotated secret key
+            set_zero_poly(coeff_count, coeff_mod_count, rotated_secret_key.get());
+        });
 
         // Set decomposition_bit_count
         galois_keys.decomposition_bit_count_ = decomposition_bit_count;
@@ -647,14 +943,7 @@ namespace seal {
             throw logic_error("encryption parameters do not support batching");
         }
 
-        auto &parms = context_data.parms();
-        size_t coeff_count = parms.poly_modulus_degree();
-
-        vector<uint64_t> galois_elts;
-        transform(steps.begin(), steps.end(), back_inserter(galois_elts),
-            [&](auto s) { return steps_to_galois_elt(s, coeff_count); });
-
-        return galois_keys(decomposition_bit_count, galois_elts);
+        return galois_keys(decomposition_bit_count, steps_to_galois_elts(steps));
     }
 
     GaloisKeys KeyGenerator::galois_keys(int decomposition_bit_count)
@@ -672,6 +961,26 @@ namespace seal {
             throw invalid_argument("decomposition_bit_count is not in the valid range");
         }
 
+        return galois_keys(decomposition_bit_count, default_galois_elts());
+    }
+
+    vector<uint64_t> KeyGenerator::steps_to_galois_elts(const vector<int> &steps) const
+    {
+        auto &context_data = *context_->context_data();
+        if (!context_data.qualifiers().using_batching)
+        {
+            throw logic_error("encryption parameters do not support batching");
+        }
+        size_t coeff_count = context_data.parms().poly_modulus_degree();
+
+        vector<uint64_t> galois_elts;
+        transform(steps.begin(), steps.end(), back_inserter(galois_elts),
+            [&](auto s) { return steps_to_galois_elt(s, coeff_count); });
+        return galois_elts;
+    }
+
+    vector<uint64_t> KeyGenerator::default_galois_elts() const
+    {
         size_t coeff_count = context_->context_data()->parms().poly_modulus_degree();
         uint64_t m = coeff_count << 1;
         int logn = get_power_of_two(static_cast<uint64_t>(coeff_count));
@@ -697,7 +1006,7 @@ namespace seal {
             neg_two_power_of_three &= (m - 1);
         }
 
-        return galois_keys(decomposition_bit_count, logn_galois_keys);
+        return logn_galois_keys;
     }
 
     void KeyGenerator::set_poly_coeffs_zero_one_negone(
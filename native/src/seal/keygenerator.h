@@ -11,6 +11,7 @@
 #include "seal/publickey.h"
 #include "seal/secretkey.h"
 #include "seal/relinkeys.h"
+#include "seal/relinkeysshare.h"
 #include "seal/galoiskeys.h"
 #include "seal/randomgen.h"
 #include "keygencrs.h"
@@ -64,6 +65,8 @@ namespace seal
         @param[in] keygen_crs A previously generated crs value
         @throws std::invalid_argument if the context is not set or encryption
         parameters are not valid
+        @throws std::invalid_argument if keygen_crs is not valid for encryption
+        parameters
         */
         KeyGenerator(std::shared_ptr<SEALContext> context, const KeyGenCRS &keygen_crs);
 
@@ -75,7 +78,7 @@ namespace seal
         @param[in] secret_key A previously generated secret key
         @param[in] keygen_crs A previously generated crs value
         @throws std::invalid_argument if encryption parameters are not valid
-        @throws std::invalid_argument if secret_key or public_key is not valid
+        @throws std::invalid_argument if secret_key or keygen_crs is not valid
         for encryption parameters
         */
         KeyGenerator(std::shared_ptr<SEALContext> context,
@@ -125,6 +128,38 @@ namespace seal
         */
         RelinKeys relin_keys(int decomposition_bit_count, std::size_t count = 1, bool use_crs = false);
 
+        /**
+        Generates and returns this party's round-1 share of a jointly generated
+        relinearization key. The joint secret key is the sum of the secret keys
+        of all parties, each of which must have been created from the same
+        KeyGenCRS. For every decomposition component a separate common random
+        polynomial is derived deterministically from the KeyGenCRS, so all parties
+        agree on it without further communication. An ephemeral secret is sampled
+        and kept in the KeyGenerator until relin_keys_share_round2 is called.
+
+        @param[in] decomposition_bit_count The decomposition bit count
+        @throws std::logic_error if the secret key or the crs value have not been
+        generated
+        @throws std::invalid_argument if decomposition_bit_count is not within [1, 60]
+        @see RelinKeysShare for a description of the protocol.
+        */
+        RelinKeysShare relin_keys_share_round1(int decomposition_bit_count);
+
+        /**
+        Generates and returns this party's round-2 share of a jointly generated
+        relinearization key from the aggregate of the round-1 shares of all
+        parties. This consumes the ephemeral secret sampled in
+        relin_keys_share_round1.
+
+        @param[in] round1_aggregate The sum of the round-1 shares of all parties
+        @throws std::logic_error if relin_keys_share_round1 has not been called
+        @throws std::invalid_argument if round1_aggregate is not valid for the
+        encryption parameters or its decomposition bit count does not match the
+        one used in relin_keys_share_round1
+        @see RelinKeysShare for a description of the protocol.
+        */
+        RelinKeysShare relin_keys_share_round2(const RelinKeysShare &round1_aggregate);
+
         /**
         Generates and returns Galois keys. This function creates specific Galois 
         keys that can be used to apply specific Galois automorphisms on encrypted 
@@ -178,6 +213,61 @@ namespace seal
         */
         GaloisKeys galois_keys(int decomposition_bit_count);
 
+        /**
+        Generates this party's share of Galois keys for a joint secret key. The
+        share is a set of Galois keys for the local secret key in which the
+        uniformly random polynomials are derived from the KeyGenCRS: every Galois
+        element and decomposition component uses its own common random polynomial
+        expanded from the crs value. Hence the shares of all parties that use the
+        same KeyGenCRS have identical second polynomials, and summing their first
+        polynomials with ShareAggregator yields Galois keys for the joint secret
+        key in a single round.
+
+        The keys for different Galois elements are generated in parallel on
+        thread_count threads; a thread_count of zero uses one thread per hardware
+        thread.
+
+        @param[in] decomposition_bit_count The decomposition bit count
+        @param[in] galois_elts The Galois elements for which to generate keys
+        @param[in] thread_count The number of threads to use
+        @throws std::logic_error if the secret key or the crs value have not been
+        generated
+        @throws std::invalid_argument if decomposition_bit_count is not within [1, 60]
+        @throws std::invalid_argument if the Galois elements are not valid
+        */
+        GaloisKeys galois_keys_share(int decomposition_bit_count,
+            const std::vector<std::uint64_t> &galois_elts,
+            std::size_t thread_count = 0);
+
+        /**
+        Generates this party's share of Galois keys for a joint secret key for the
+        given rotation step counts. See galois_keys for the meaning of the step
+        counts and galois_keys_share for the protocol.
+
+        @param[in] decomposition_bit_count The decomposition bit count
+        @param[in] steps The rotation step counts for which to generate keys
+        @param[in] thread_count The number of threads to use
+        @throws std::logic_error if the secret key or the crs value have not been
+        generated
+        @throws std::logic_error if the encryption parameters do not support batching
+        @throws std::invalid_argument if decomposition_bit_count is not within [1, 60]
+        @throws std::invalid_argument if the step counts are not valid
+        */
+        GaloisKeys galois_keys_share(int decomposition_bit_count,
+            const std::vector<int> &steps, std::size_t thread_count = 0);
+
+        /**
+        Generates this party's share of the logarithmically many Galois keys that
+        the galois_keys overload without Galois elements creates. See
+        galois_keys_share for the protocol.
+
+        @param[in] decomposition_bit_count The decomposition bit count
+        @throws std::logic_error if the secret key or the crs value have not been
+        generated
+        @throws std::invalid_argument if decomposition_bit_count is not within [1, 60]
+        */
+        GaloisKeys galois_keys_share(int decomposition_bit_count);
+
     private:
         KeyGenerator(const KeyGenerator &copy) = delete;
 
@@ -203,6 +293,15 @@ namespace seal
             const SEALContext::ContextData &context_data,
             std::size_t max_power);
 
+        GaloisKeys generate_galois_keys(int decomposition_bit_count,
+            const std::vector<std::uint64_t> &galois_elts,
+            bool use_crs, std::size_t thread_count);
+
+        std::vector<std::uint64_t> steps_to_galois_elts(
+            const std::vector<int> &steps) const;
+
+        std::vector<std::uint64_t> default_galois_elts() const;
+
         void populate_decomposition_factors(
             const SEALContext::ContextData &context_data,
             int decomposition_bit_count,
@@ -251,5 +350,11 @@ namespace seal
         bool pk_generated_ = false;
 
         bool crs_generated_ = false;
+
+        util::Pointer<std::uint64_t> relin_share_ephemeral_key_;
+
+        int relin_share_decomposition_bit_count_ = 0;
+
+        bool relin_share_round1_generated_ = false;
     };
 }
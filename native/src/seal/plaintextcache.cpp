@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include "seal/plaintextcache.h"
+
+using namespace std;
+
+namespace seal
+{
+    namespace
+    {
+        // A 64-bit hash of a plaintext for detecting that it was modified. It
+        // must cost much less than the NTT it saves, which rules out SHA-3. Each
+        // step is a bijection of the state, so a change in one coefficient
+        // always changes the hash.
+        uint64_t hash_plaintext(const Plaintext &plain) noexcept
+        {
+            uint64_t hash = 0x9E3779B97F4A7C15ULL ^ plain.coeff_count();
+            hash ^= plain.is_ntt_form() ? 1 : 0;
+            const Plaintext::pt_coeff_type *ptr = plain.data();
+            for (size_t i = 0; i < plain.coeff_count(); i++)
+            {
+                hash ^= ptr[i];
+                hash *= 0xBF58476D1CE4E5B9ULL;
+                hash ^= hash >> 31;
+            }
+            return hash;
+        }
+    }
+
+    PlaintextNTTCache::PlaintextNTTCache(shared_ptr<SEALContext> context,
+        size_t memory_budget, MemoryPoolHandle pool) :
+        context_(context), evaluator_(context), memory_budget_(memory_budget),
+        pool_(move(pool))
+    {
+        // The context is verified by evaluator_
+        if (context_->context_data()->parms().scheme() != scheme_type::BFV)
+        {
+            throw invalid_argument("unsupported scheme");
+        }
+        if (!pool_)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+    }
+
+    shared_ptr<const Plaintext> PlaintextNTTCache::get(const Plaintext &plain,
+        parms_id_type parms_id, MemoryPoolHandle pool)
+    {
+        // The plaintext may have changed since it was cached. Its hash is
+        // computed before taking the lock, so concurrent calls only serialize
+        // on the lookup.
+        Key key{ &plain, parms_id };
+        uint64_t source_hash = hash_plaintext(plain);
+        {
+            lock_guard<mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end())
+            {
+                if (it->second->source_hash == source_hash)
+                {
+                    entries_.splice(entries_.begin(), entries_, it->second);
+                    hit_count_++;
+                    return it->second->plain_ntt;
+                }
+                remove(it->second);
+            }
+            miss_count_++;
+        }
+
+        // Transform outside the lock; transform_to_ntt_inplace verifies the
+        // parameters
+        auto plain_ntt = make_shared<Plaintext>(pool_);
+        *plain_ntt = plain;
+        evaluator_.transform_to_ntt_inplace(*plain_ntt, parms_id, move(pool));
+
+        size_t byte_count = plain_ntt->coeff_count() * sizeof(Plaintext::pt_coeff_type);
+        if (byte_count > memory_budget_)
+        {
+            return plain_ntt;
+        }
+
+        lock_guard<mutex> lock(mutex_);
+
+        // Another thread may have cached the same plaintext in the meantime
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            remove(it->second);
+        }
+        while (memory_usage_ + byte_count > memory_budget_)
+        {
+            remove(prev(entries_.end()));
+        }
+        entries_.push_front(Entry{ key, source_hash, plain_ntt, byte_count });
+        index_.emplace(key, entries_.begin());
+        memory_usage_ += byte_count;
+        return plain_ntt;
+    }
+
+    void PlaintextNTTCache::erase(const Plaintext &plain)
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end(); )
+        {
+            auto next_it = next(it);
+            if (it->key.plain == &plain)
+            {
+                remove(it);
+            }
+            it = next_it;
+        }
+    }
+
+    void PlaintextNTTCache::clear()
+    {
+        lock_guard<mutex> lock(mutex_);
+        index_.clear();
+        entries_.clear();
+        memory_usage_ = 0;
+    }
+
+    size_t PlaintextNTTCache::size() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    size_t PlaintextNTTCache::memory_usage() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return memory_usage_;
+    }
+
+    size_t PlaintextNTTCache::hit_count() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return hit_count_;
+    }
+
+    size_t PlaintextNTTCache::miss_count() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return miss_count_;
+    }
+
+    void PlaintextNTTCache::remove(list<Entry>::iterator entry)
+    {
+        memory_usage_ -= entry->byte_count;
+        index_.erase(entry->key);
+        entries_.erase(entry);
+    }
+}
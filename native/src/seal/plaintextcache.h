@@ -0,0 +1,192 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "seal/context.h"
+#include "seal/plaintext.h"
+#include "seal/evaluator.h"
+#include "seal/encryptionparams.h"
+#include "seal/memorymanager.h"
+
+namespace seal
+{
+    /**
+    Stores NTT transformed copies of plaintexts that are multiplied with many
+    ciphertexts. Evaluator::multiply_plain transforms a plaintext that is not in
+    NTT form to the NTT domain of the ciphertext's level on every call. When the
+    same plaintexts (for example the weights of a model) are used over and over,
+    passing a PlaintextNTTCache to Evaluator::multiply_plain instead does the
+    transformation only the first time a plaintext is used at a given level.
+
+    The entries are keyed by the address of the plaintext and the parms_id of
+    the level. Each entry also keeps a 64-bit hash of the plaintext it was
+    computed from, so a plaintext that is modified after it was cached is
+    transformed again the next time it is used. The hash is not cryptographic: it
+    detects accidental modifications, not crafted ones. Entries are created
+    lazily and the total size of the transformed plaintexts is kept within a
+    memory budget by evicting the least recently used entries first. A
+    transformed plaintext that does not fit in the budget at all is returned
+    without being cached.
+
+    @par Thread Safety
+    The member functions of PlaintextNTTCache can be called concurrently from
+    several threads. The plaintexts are hashed and transformed without holding
+    the lock, so threads that use the cache at the same time only wait for each
+    other during the lookup.
+
+    @see Evaluator::transform_to_ntt for transforming a single plaintext.
+    */
+    class PlaintextNTTCache
+    {
+    public:
+        /**
+        Creates an empty PlaintextNTTCache for the specified SEALContext. The
+        cached plaintexts are allocated from the memory pool pointed to by the
+        given MemoryPoolHandle.
+
+        @param[in] context The SEALContext
+        @param[in] memory_budget The maximal total size of the entries in bytes
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if the encryption parameters do not use the
+        BFV scheme
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        PlaintextNTTCache(std::shared_ptr<SEALContext> context,
+            std::size_t memory_budget,
+            MemoryPoolHandle pool = MemoryManager::GetPool());
+
+        /**
+        Returns the given plaintext transformed to the NTT domain with respect to
+        the encryption parameters corresponding to a given parms_id. The result is
+        taken from the cache if possible, and otherwise computed and cached.
+        Dynamic memory allocations for the transformation are allocated from the
+        memory pool pointed to by the given MemoryPoolHandle.
+
+        @param[in] plain The plaintext to transform
+        @param[in] parms_id The parms_id with respect to which the NTT is done
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if plain is already in NTT form
+        @throws std::invalid_argument if plain or parms_id is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        std::shared_ptr<const Plaintext> get(const Plaintext &plain,
+            parms_id_type parms_id, MemoryPoolHandle pool = MemoryManager::GetPool());
+
+        /**
+        Removes the entries of a given plaintext at every level. This should be
+        called before a cached plaintext is destroyed, since a new plaintext could
+        later be created at the same address.
+
+        @param[in] plain The plaintext whose entries to remove
+        */
+        void erase(const Plaintext &plain);
+
+        /**
+        Removes all entries.
+        */
+        void clear();
+
+        /**
+        Returns the number of entries.
+        */
+        std::size_t size() const;
+
+        /**
+        Returns the total size of the entries in bytes.
+        */
+        std::size_t memory_usage() const;
+
+        /**
+        Returns the maximal total size of the entries in bytes.
+        */
+        inline std::size_t memory_budget() const noexcept
+        {
+            return memory_budget_;
+        }
+
+        /**
+        Returns the number of calls to get that were answered from the cache.
+        */
+        std::size_t hit_count() const;
+
+        /**
+        Returns the number of calls to get that transformed the plaintext.
+        */
+        std::size_t miss_count() const;
+
+    private:
+        PlaintextNTTCache(const PlaintextNTTCache &copy) = delete;
+
+        PlaintextNTTCache(PlaintextNTTCache &&source) = delete;
+
+        PlaintextNTTCache &operator =(const PlaintextNTTCache &assign) = delete;
+
+        PlaintextNTTCache &operator =(PlaintextNTTCache &&assign) = delete;
+
+        struct Key
+        {
+            const Plaintext *plain;
+
+            parms_id_type parms_id;
+
+            inline bool operator ==(const Key &compare) const
+            {
+                return plain == compare.plain && parms_id == compare.parms_id;
+            }
+        };
+
+        struct KeyHash
+        {
+            inline std::size_t operator()(const Key &key) const
+            {
+                return std::hash<const Plaintext*>()(key.plain) ^
+                    std::hash<parms_id_type>()(key.parms_id);
+            }
+        };
+
+        struct Entry
+        {
+            Key key;
+
+            std::uint64_t source_hash;
+
+            std::shared_ptr<const Plaintext> plain_ntt;
+
+            std::size_t byte_count;
+        };
+
+        // Removes an entry; the lock must be held
+        void remove(std::list<Entry>::iterator entry);
+
+        std::shared_ptr<SEALContext> context_{ nullptr };
+
+        Evaluator evaluator_;
+
+        std::size_t memory_budget_;
+
+        MemoryPoolHandle pool_;
+
+        // Most recently used entries first
+        std::list<Entry> entries_;
+
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+
+        std::size_t memory_usage_ = 0;
+
+        std::size_t hit_count_ = 0;
+
+        std::size_t miss_count_ = 0;
+
+        mutable std::mutex mutex_;
+    };
+}
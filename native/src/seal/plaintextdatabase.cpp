@@ -0,0 +1,362 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include "seal/plaintextdatabase.h"
+#include "seal/evaluator.h"
+#include "seal/memorymanager.h"
+#include "seal/util/common.h"
+#include "seal/util/parallel.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace seal::util;
+
+namespace seal
+{
+    namespace
+    {
+        // "SEALPTDB" in little-endian byte order
+        constexpr uint64_t database_magic = 0x424454504C414553ULL;
+
+        constexpr uint64_t database_version = 1;
+
+        // The plaintexts are aligned to pages in the file and in the mapping
+        constexpr size_t database_alignment = 4096;
+
+        struct DatabaseHeader
+        {
+            uint64_t magic;
+
+            uint64_t version;
+
+            parms_id_type parms_id;
+
+            uint64_t count;
+
+            uint64_t coeff_count;
+
+            uint64_t coeff_mod_count;
+
+            uint64_t stride;
+
+            uint64_t data_offset;
+        };
+
+        inline size_t align_up(size_t value)
+        {
+            return mul_safe(add_safe(value, database_alignment - 1) /
+                database_alignment, database_alignment);
+        }
+
+        inline size_t plains_offset(size_t count)
+        {
+            return align_up(add_safe(sizeof(DatabaseHeader),
+                mul_safe(count, sizeof(double))));
+        }
+
+        const SEALContext::ContextData &verify_parms_id(
+            const shared_ptr<SEALContext> &context, const parms_id_type &parms_id)
+        {
+            if (!context)
+            {
+                throw invalid_argument("invalid context");
+            }
+            if (!context->parameters_set())
+            {
+                throw invalid_argument("encryption parameters are not set correctly");
+            }
+            auto context_data_ptr = context->context_data(parms_id);
+            if (!context_data_ptr)
+            {
+                throw invalid_argument("parms_id is not valid for encryption parameters");
+            }
+            return *context_data_ptr;
+        }
+    }
+
+    PlaintextDatabase::PlaintextDatabase(shared_ptr<SEALContext> context,
+        const string &path, bool verify) : context_(move(context))
+    {
+        // Verify parameters
+        if (!context_)
+        {
+            throw invalid_argument("invalid context");
+        }
+        if (!context_->parameters_set())
+        {
+            throw invalid_argument("encryption parameters are not set correctly");
+        }
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw runtime_error("cannot open file");
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) ||
+            static_cast<uint64_t>(file_size.QuadPart) < sizeof(DatabaseHeader))
+        {
+            CloseHandle(file);
+            throw invalid_argument("file is not a plaintext database");
+        }
+        mapping_size_ = safe_cast<size_t>(file_size.QuadPart);
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping)
+        {
+            throw runtime_error("cannot map file");
+        }
+        mapping_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!mapping_)
+        {
+            CloseHandle(mapping);
+            throw runtime_error("cannot map file");
+        }
+        mapping_handle_ = mapping;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw runtime_error("cannot open file");
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) ||
+            static_cast<uint64_t>(file_stat.st_size) < sizeof(DatabaseHeader))
+        {
+            close(fd);
+            throw invalid_argument("file is not a plaintext database");
+        }
+        mapping_size_ = safe_cast<size_t>(file_stat.st_size);
+        void *mapping = mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            throw runtime_error("cannot map file");
+        }
+        mapping_ = mapping;
+#endif
+
+        try
+        {
+            DatabaseHeader header;
+            copy_n(static_cast<const unsigned char *>(mapping_), sizeof(DatabaseHeader),
+                reinterpret_cast<unsigned char *>(&header));
+            if (header.magic != database_magic || header.version != database_version)
+            {
+                throw invalid_argument("file is not a plaintext database");
+            }
+            auto context_data_ptr = context_->context_data(header.parms_id);
+            if (!context_data_ptr)
+            {
+                throw invalid_argument("database is not valid for encryption parameters");
+            }
+            auto &parms = context_data_ptr->parms();
+            if (header.coeff_count != parms.poly_modulus_degree() ||
+                header.coeff_mod_count != parms.coeff_modulus().size())
+            {
+                throw invalid_argument("database is not valid for encryption parameters");
+            }
+
+            // Bounding the count by the file size first rules out overflows below
+            size_t poly_uint64_count = mul_safe(
+                parms.poly_modulus_degree(), parms.coeff_modulus().size());
+            size_t stride = align_up(mul_safe(poly_uint64_count, sizeof(uint64_t)));
+            if (header.count > mapping_size_ / stride ||
+                header.stride != stride ||
+                header.data_offset != plains_offset(header.count) ||
+                mapping_size_ != header.data_offset + header.count * stride)
+            {
+                throw invalid_argument("file is not a plaintext database");
+            }
+
+            parms_id_ = header.parms_id;
+            size_ = header.count;
+            poly_uint64_count_ = poly_uint64_count;
+            stride_ = stride;
+            auto base = static_cast<const unsigned char *>(mapping_);
+            scales_ = reinterpret_cast<const double *>(base + sizeof(DatabaseHeader));
+            plains_ = base + header.data_offset;
+
+            if (verify)
+            {
+                auto &coeff_modulus = parms.coeff_modulus();
+                size_t coeff_count = parms.poly_modulus_degree();
+                for (size_t i = 0; i < size_; i++)
+                {
+                    auto plain = reinterpret_cast<const uint64_t *>(plains_ + i * stride_);
+                    for (size_t j = 0; j < coeff_modulus.size(); j++)
+                    {
+                        uint64_t modulus = coeff_modulus[j].value();
+                        if (any_of(plain, plain + coeff_count,
+                            [modulus](uint64_t coeff) { return coeff >= modulus; }))
+                        {
+                            throw invalid_argument("database is not valid for encryption parameters");
+                        }
+                        plain += coeff_count;
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+
+    PlaintextDatabase::~PlaintextDatabase()
+    {
+        unmap();
+    }
+
+    void PlaintextDatabase::Build(shared_ptr<SEALContext> context,
+        parms_id_type parms_id, size_t count,
+        function<void(size_t, Plaintext &)> generator, const string &path,
+        size_t thread_count)
+    {
+        // Verify parameters
+        auto &context_data = verify_parms_id(context, parms_id);
+        if (!generator)
+        {
+            throw invalid_argument("generator cannot be empty");
+        }
+
+        auto &parms = context_data.parms();
+        bool is_bfv = parms.scheme() == scheme_type::BFV;
+        size_t poly_uint64_count = mul_safe(
+            parms.poly_modulus_degree(), parms.coeff_modulus().size());
+        size_t stride = align_up(mul_safe(poly_uint64_count, sizeof(uint64_t)));
+        size_t data_offset = plains_offset(count);
+        size_t file_size = add_safe(data_offset, mul_safe(count, stride));
+
+        DatabaseHeader header{ database_magic, database_version, parms_id,
+            count, parms.poly_modulus_degree(), parms.coeff_modulus().size(),
+            stride, data_offset };
+
+        // Create the file at its final size so that the threads can write their
+        // plaintexts to it independently
+        {
+            ofstream stream;
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+            stream.open(path, ios_base::binary | ios_base::trunc);
+            stream.write(reinterpret_cast<const char *>(&header), sizeof(DatabaseHeader));
+            stream.seekp(safe_cast<streamoff>(file_size - 1));
+            stream.put(0);
+        }
+
+        try
+        {
+            Evaluator evaluator(context);
+            vector<double> scales(count);
+            parallel_for(count, thread_count, [&](size_t begin, size_t end) {
+                fstream stream;
+                stream.exceptions(ios_base::badbit | ios_base::failbit);
+                stream.open(path, ios_base::binary | ios_base::in | ios_base::out);
+
+                auto pool = MemoryPoolHandle::New();
+                Plaintext plain(pool);
+                for (size_t i = begin; i < end; i++)
+                {
+                    generator(i, plain);
+                    if (is_bfv && !plain.is_ntt_form())
+                    {
+                        evaluator.transform_to_ntt_inplace(plain, parms_id, pool);
+                    }
+                    if (!plain.is_ntt_form() || plain.parms_id() != parms_id ||
+                        !plain.is_valid_for(context))
+                    {
+                        throw invalid_argument("plaintext is not valid for the database");
+                    }
+                    scales[i] = plain.scale();
+
+                    stream.seekp(safe_cast<streamoff>(data_offset + i * stride));
+                    stream.write(reinterpret_cast<const char *>(plain.data()),
+                        safe_cast<streamsize>(poly_uint64_count * sizeof(uint64_t)));
+                }
+            });
+
+            fstream stream;
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+            stream.open(path, ios_base::binary | ios_base::in | ios_base::out);
+            stream.seekp(safe_cast<streamoff>(sizeof(DatabaseHeader)));
+            stream.write(reinterpret_cast<const char *>(scales.data()),
+                safe_cast<streamsize>(count * sizeof(double)));
+        }
+        catch (...)
+        {
+            remove(path.c_str());
+            throw;
+        }
+    }
+
+    void PlaintextDatabase::Build(shared_ptr<SEALContext> context,
+        parms_id_type parms_id, const vector<Plaintext> &plains,
+        const string &path, size_t thread_count)
+    {
+        Build(move(context), parms_id, plains.size(),
+            [&](size_t index, Plaintext &destination) {
+                destination = plains[index];
+            }, path, thread_count);
+    }
+
+    const uint64_t *PlaintextDatabase::data(size_t index) const
+    {
+        if (index >= size_)
+        {
+            throw out_of_range("index must be within [0, size)");
+        }
+        return reinterpret_cast<const uint64_t *>(plains_ + index * stride_);
+    }
+
+    double PlaintextDatabase::scale(size_t index) const
+    {
+        if (index >= size_)
+        {
+            throw out_of_range("index must be within [0, size)");
+        }
+        return scales_[index];
+    }
+
+    void PlaintextDatabase::get(size_t index, Plaintext &destination) const
+    {
+        auto plain = data(index);
+        destination.parms_id() = parms_id_zero;
+        destination.resize(poly_uint64_count_);
+        copy_n(plain, poly_uint64_count_, destination.data());
+        destination.parms_id() = parms_id_;
+        destination.scale() = scales_[index];
+    }
+
+    void PlaintextDatabase::unmap() noexcept
+    {
+        if (!mapping_)
+        {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(mapping_);
+        CloseHandle(static_cast<HANDLE>(mapping_handle_));
+#else
+        munmap(mapping_, mapping_size_);
+#endif
+        mapping_ = nullptr;
+        mapping_handle_ = nullptr;
+    }
+}
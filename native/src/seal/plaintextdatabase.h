@@ -0,0 +1,200 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include "seal/context.h"
+#include "seal/plaintext.h"
+#include "seal/encryptionparams.h"
+
+namespace seal
+{
+    /**
+    A read-only array of plaintexts in NTT form, stored in a file and mapped into
+    memory. Workloads such as private information retrieval multiply encrypted
+    queries with the same large set of plaintexts in every request. Instead of
+    encoding and transforming the plaintexts at every process start, the
+    database is built once with PlaintextDatabase::Build and then mapped with
+    the PlaintextDatabase constructor. Evaluator::multiply_plain reads the
+    plaintexts in place from the mapping, so loading costs no copies. Unless
+    the coefficients are verified on opening, the operating system pages the
+    data in as it is used.
+
+    @par File Format
+    The file starts with a header that records the parms_id of the plaintexts,
+    their number, and their shape, followed by the scale of every plaintext.
+    The plaintexts follow at offsets that are multiples of 4096 bytes, each
+    padded to a multiple of 4096 bytes, so every plaintext is page-aligned in
+    the mapping. The integers are stored in the byte order of the machine that
+    built the file.
+
+    @par Thread Safety
+    A PlaintextDatabase is immutable after construction and can be used from
+    several threads concurrently.
+
+    @see Evaluator::multiply_plain for multiplying a ciphertext with a plaintext
+    in the database.
+    */
+    class PlaintextDatabase
+    {
+    public:
+        /**
+        Maps a database file built with PlaintextDatabase::Build into memory.
+        By default every coefficient is checked to be reduced modulo its
+        coefficient modulus, so that a corrupted or tampered file is rejected
+        here rather than producing invalid ciphertexts in Evaluator. This reads
+        the whole file once; a caller that trusts the file can skip the check
+        to leave the plaintexts to be paged in as they are used.
+
+        @param[in] context The SEALContext
+        @param[in] path The path of the database file
+        @param[in] verify Whether to check the coefficients of the plaintexts
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if the file is not a database for the
+        encryption parameters
+        @throws std::invalid_argument if verify is true and a coefficient is not
+        reduced modulo its coefficient modulus
+        @throws std::runtime_error if the file cannot be opened or mapped
+        */
+        PlaintextDatabase(std::shared_ptr<SEALContext> context,
+            const std::string &path, bool verify = true);
+
+        /**
+        Unmaps the database file and destroys the PlaintextDatabase.
+        */
+        ~PlaintextDatabase();
+
+        /**
+        Builds a database file of plaintexts in NTT form. The plaintexts are
+        created by calling generator(index, destination) for every index from 0
+        to count - 1 in several threads; the generator must therefore be safe to
+        call concurrently. With the BFV scheme a plaintext that is not in NTT form
+        is transformed with respect to the given parms_id. Otherwise the plaintext
+        must already be in NTT form at the given parms_id. Each thread writes its
+        plaintexts directly to their place in the file, so the plaintexts are
+        never all held in memory. If building fails, the file is removed.
+
+        @param[in] context The SEALContext
+        @param[in] parms_id The parms_id of the plaintexts in the database
+        @param[in] count The number of plaintexts
+        @param[in] generator The function creating the plaintext at an index
+        @param[in] path The path of the database file to create
+        @param[in] thread_count The number of threads to use; zero means the
+        number of hardware threads
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if parms_id is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if a plaintext is not valid for the
+        encryption parameters or not in NTT form at parms_id
+        @throws std::ios_base::failure if writing the file fails
+        */
+        static void Build(std::shared_ptr<SEALContext> context,
+            parms_id_type parms_id, std::size_t count,
+            std::function<void(std::size_t, Plaintext &)> generator,
+            const std::string &path, std::size_t thread_count = 0);
+
+        /**
+        Builds a database file from a vector of plaintexts. See the other Build
+        function for details.
+
+        @param[in] context The SEALContext
+        @param[in] parms_id The parms_id of the plaintexts in the database
+        @param[in] plains The plaintexts
+        @param[in] path The path of the database file to create
+        @param[in] thread_count The number of threads to use; zero means the
+        number of hardware threads
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if parms_id is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if a plaintext is not valid for the
+        encryption parameters or not in NTT form at parms_id
+        @throws std::ios_base::failure if writing the file fails
+        */
+        static void Build(std::shared_ptr<SEALContext> context,
+            parms_id_type parms_id, const std::vector<Plaintext> &plains,
+            const std::string &path, std::size_t thread_count = 0);
+
+        /**
+        Returns the number of plaintexts in the database.
+        */
+        inline std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        /**
+        Returns the parms_id of the plaintexts in the database.
+        */
+        inline const parms_id_type &parms_id() const noexcept
+        {
+            return parms_id_;
+        }
+
+        /**
+        Returns a pointer to the coefficients of the plaintext at a given index
+        in the mapped file. The plaintext has the layout of a Plaintext in NTT
+        form at parms_id().
+
+        @param[in] index The index of the plaintext
+        @throws std::out_of_range if index is not within [0, size())
+        */
+        const std::uint64_t *data(std::size_t index) const;
+
+        /**
+        Returns the scale of the plaintext at a given index.
+
+        @param[in] index The index of the plaintext
+        @throws std::out_of_range if index is not within [0, size())
+        */
+        double scale(std::size_t index) const;
+
+        /**
+        Copies the plaintext at a given index to a Plaintext.
+
+        @param[in] index The index of the plaintext
+        @param[out] destination The plaintext to overwrite with the copy
+        @throws std::out_of_range if index is not within [0, size())
+        */
+        void get(std::size_t index, Plaintext &destination) const;
+
+    private:
+        PlaintextDatabase(const PlaintextDatabase &copy) = delete;
+
+        PlaintextDatabase(PlaintextDatabase &&source) = delete;
+
+        PlaintextDatabase &operator =(const PlaintextDatabase &assign) = delete;
+
+        PlaintextDatabase &operator =(PlaintextDatabase &&assign) = delete;
+
+        void unmap() noexcept;
+
+        std::shared_ptr<SEALContext> context_{ nullptr };
+
+        parms_id_type parms_id_;
+
+        std::size_t size_ = 0;
+
+        std::size_t poly_uint64_count_ = 0;
+
+        std::size_t stride_ = 0;
+
+        const double *scales_ = nullptr;
+
+        const unsigned char *plains_ = nullptr;
+
+        void *mapping_ = nullptr;
+
+        std::size_t mapping_size_ = 0;
+
+        void *mapping_handle_ = nullptr;
+    };
+}
@@ -0,0 +1,199 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include "seal/precomputedencryptor.h"
+#include "seal/util/common.h"
+#include "seal/util/polycore.h"
+#include "seal/util/polyarithsmallmod.h"
+
+using namespace std;
+using namespace seal::util;
+
+namespace seal
+{
+    PrecomputedEncryptor::PrecomputedEncryptor(shared_ptr<SEALContext> context,
+        const PublicKey &public_key, size_t capacity) :
+        context_(context), encryptor_(context, public_key), capacity_(capacity)
+    {
+        // The context and the public key are verified by encryptor_
+        if (!capacity_)
+        {
+            throw invalid_argument("capacity cannot be zero");
+        }
+
+        auto &parms = context_->context_data()->parms();
+        switch (parms.scheme())
+        {
+        case scheme_type::BFV:
+            // The scaled plaintext is added online, so the zero plaintext
+            // needs just one coefficient
+            zero_.resize(1);
+            break;
+
+        case scheme_type::CKKS:
+            // A zero plaintext in NTT form at the first level
+            zero_.resize(mul_safe(parms.poly_modulus_degree(),
+                parms.coeff_modulus().size()));
+            zero_.parms_id() = parms.parms_id();
+            break;
+
+        default:
+            throw invalid_argument("unsupported scheme");
+        }
+        zero_.set_zero();
+
+        worker_ = thread(&PrecomputedEncryptor::fill, this);
+    }
+
+    PrecomputedEncryptor::~PrecomputedEncryptor()
+    {
+        {
+            lock_guard<mutex> lock(queue_mutex_);
+            stop_ = true;
+        }
+        not_full_.notify_all();
+        full_.notify_all();
+        worker_.join();
+    }
+
+    void PrecomputedEncryptor::encrypt(const Plaintext &plain,
+        Ciphertext &destination)
+    {
+        // Verify that plain is valid.
+        if (!plain.is_valid_for(context_))
+        {
+            throw invalid_argument("plain is not valid for encryption parameters");
+        }
+
+        auto &first_parms = context_->context_data()->parms();
+        bool is_ckks = first_parms.scheme() == scheme_type::CKKS;
+        if (!is_ckks && plain.is_ntt_form())
+        {
+            throw invalid_argument("plain cannot be in NTT form");
+        }
+        if (is_ckks && !plain.is_ntt_form())
+        {
+            throw invalid_argument("plain must be in NTT form");
+        }
+
+        // Take a precomputed encryption of zero, or compute one now
+        Ciphertext zero;
+        bool found = false;
+        {
+            lock_guard<mutex> lock(queue_mutex_);
+            if (!queue_.empty())
+            {
+                zero = move(queue_.front());
+                queue_.pop_front();
+                found = true;
+            }
+        }
+        if (found)
+        {
+            not_full_.notify_one();
+        }
+        else
+        {
+            encrypt_zero(zero, MemoryManager::GetPool());
+        }
+
+        auto &context_data = *context_->context_data(
+            is_ckks ? plain.parms_id() : first_parms.parms_id());
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        size_t first_rns_poly_uint64_count =
+            mul_safe(coeff_count, first_parms.coeff_modulus().size());
+
+        // Copy the encryption of zero, dropping primes not in the target level
+        destination.resize(context_, parms.parms_id(), 2);
+        destination.is_ntt_form() = is_ckks;
+        for (size_t k = 0; k < 2; k++)
+        {
+            set_poly_poly(zero.data() + (k * first_rns_poly_uint64_count),
+                coeff_count, coeff_mod_count, destination.data(k));
+        }
+
+        if (is_ckks)
+        {
+            // The plaintext gets added into the c_0 term of ciphertext (c_0,c_1).
+            for (size_t i = 0; i < coeff_mod_count; i++)
+            {
+                add_poly_poly_coeffmod(destination.data() + (i * coeff_count),
+                    plain.data() + (i * coeff_count), coeff_count,
+                    coeff_modulus[i], destination.data() + (i * coeff_count));
+            }
+            destination.scale() = plain.scale();
+        }
+        else
+        {
+            // Multiply plain by scalar coeff_div_plaintext and reposition if in
+            // upper-half, exactly as Encryptor::encrypt does
+            encryptor_.preencrypt(plain.data(), plain.coeff_count(),
+                context_data, destination.data());
+        }
+    }
+
+    size_t PrecomputedEncryptor::available() const
+    {
+        lock_guard<mutex> lock(queue_mutex_);
+        return queue_.size();
+    }
+
+    void PrecomputedEncryptor::wait_until_full() const
+    {
+        unique_lock<mutex> lock(queue_mutex_);
+        full_.wait(lock, [&] { return stop_ || queue_.size() >= capacity_; });
+    }
+
+    void PrecomputedEncryptor::encrypt_zero(Ciphertext &destination,
+        MemoryPoolHandle pool)
+    {
+        encryptor_.encrypt(zero_, destination, move(pool));
+    }
+
+    void PrecomputedEncryptor::fill()
+    {
+        // The background thread allocates from its own pool
+        auto pool = MemoryPoolHandle::New();
+        try
+        {
+            while (true)
+            {
+                {
+                    unique_lock<mutex> lock(queue_mutex_);
+                    not_full_.wait(lock, [&] { return stop_ || queue_.size() < capacity_; });
+                    if (stop_)
+                    {
+                        return;
+                    }
+                }
+
+                Ciphertext zero(pool);
+                encrypt_zero(zero, pool);
+
+                {
+                    lock_guard<mutex> lock(queue_mutex_);
+                    queue_.emplace_back(move(zero));
+                    if (queue_.size() < capacity_)
+                    {
+                        continue;
+                    }
+                }
+                full_.notify_all();
+            }
+        }
+        catch (...)
+        {
+            // Without the background thread, encrypt computes every encryption
+            // of zero on the calling thread
+            {
+                lock_guard<mutex> lock(queue_mutex_);
+                stop_ = true;
+            }
+            full_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "seal/context.h"
+#include "seal/publickey.h"
+#include "seal/plaintext.h"
+#include "seal/ciphertext.h"
+#include "seal/encryptor.h"
+#include "seal/memorymanager.h"
+
+namespace seal
+{
+    /**
+    Encrypts Plaintext objects into Ciphertext objects in two phases. Public-key
+    encryption is dominated by sampling and NTTs that do not depend on the
+    message, so a PrecomputedEncryptor runs a background thread that computes
+    encryptions of zero ahead of time and keeps them in a bounded queue. The
+    online encrypt function then only takes one encryption of zero from the
+    queue and adds the plaintext to it, scaled in exactly the same way as in
+    Encryptor::encrypt. The resulting ciphertexts are indistinguishable from
+    those produced by Encryptor::encrypt.
+
+    The background thread fills the queue up to its capacity and then sleeps
+    until encryptions of zero are taken from it. If the queue is empty when
+    encrypt is called, the encryption of zero is computed on the calling thread
+    instead, so encrypt never blocks waiting for the background thread.
+
+    @par Levels
+    The encryptions of zero are computed at the first encryption parameters.
+    With the CKKS scheme a plaintext at a lower level is encrypted by dropping
+    the primes of the encryption of zero that are not in its coefficient modulus.
+
+    @par Thread Safety
+    The encrypt function can be called concurrently from several threads; each
+    encryption of zero is used exactly once.
+
+    @see Encryptor for the class that encrypts in a single phase.
+    */
+    class PrecomputedEncryptor
+    {
+    public:
+        /**
+        Creates a PrecomputedEncryptor initialized with the specified SEALContext
+        and public key, and starts the background thread that fills a queue of
+        the given capacity.
+
+        @param[in] context The SEALContext
+        @param[in] public_key The public key
+        @param[in] capacity The maximal number of precomputed encryptions of zero
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if public_key is not valid
+        @throws std::invalid_argument if capacity is zero
+        */
+        PrecomputedEncryptor(std::shared_ptr<SEALContext> context,
+            const PublicKey &public_key, std::size_t capacity);
+
+        /**
+        Stops the background thread and destroys the PrecomputedEncryptor.
+        */
+        ~PrecomputedEncryptor();
+
+        /**
+        Encrypts a Plaintext using a precomputed encryption of zero and stores the
+        result in the destination parameter.
+
+        @param[in] plain The plaintext to encrypt
+        @param[out] destination The ciphertext to overwrite with the encrypted plaintext
+        @throws std::invalid_argument if plain is not valid for the encryption parameters
+        @throws std::invalid_argument if plain is not in default NTT form
+        */
+        void encrypt(const Plaintext &plain, Ciphertext &destination);
+
+        /**
+        Returns the number of precomputed encryptions of zero currently available.
+        */
+        std::size_t available() const;
+
+        /**
+        Returns the maximal number of precomputed encryptions of zero.
+        */
+        inline std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        /**
+        Blocks until the queue of precomputed encryptions of zero is full. This
+        can be used to do all of the precomputation before a latency-critical
+        phase starts.
+        */
+        void wait_until_full() const;
+
+    private:
+        PrecomputedEncryptor(const PrecomputedEncryptor &copy) = delete;
+
+        PrecomputedEncryptor(PrecomputedEncryptor &&source) = delete;
+
+        PrecomputedEncryptor &operator =(const PrecomputedEncryptor &assign) = delete;
+
+        PrecomputedEncryptor &operator =(PrecomputedEncryptor &&assign) = delete;
+
+        void encrypt_zero(Ciphertext &destination, MemoryPoolHandle pool);
+
+        void fill();
+
+        std::shared_ptr<SEALContext> context_{ nullptr };
+
+        Encryptor encryptor_;
+
+        Plaintext zero_;
+
+        std::size_t capacity_;
+
+        std::deque<Ciphertext> queue_;
+
+        mutable std::mutex queue_mutex_;
+
+        std::condition_variable not_full_;
+
+        mutable std::condition_variable full_;
+
+        bool stop_ = false;
+
+        std::thread worker_;
+    };
+}
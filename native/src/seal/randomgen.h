@@ -10,6 +10,7 @@
 #include "seal/util/defines.h"
 #include "seal/util/common.h"
 #include "seal/util/aes.h"
+#include "seal/util/hash.h"
 
 namespace seal
 {
@@ -184,6 +185,69 @@ namespace seal
         std::uint64_t seed_[2];
     };
 #endif //SEAL_USE_AES_NI_PRNG
+    /**
+    Provides an implementation of UniformRandomGenerator that deterministically
+    expands a 256-bit seed into a stream of uniform random values by hashing
+    the seed together with a 64-bit domain separator and a running counter
+    using SHA-3. Two instances created with the same seed and domain always
+    produce the same stream, regardless of the platform or of the availability
+    of AES-NI. This is used to expand common reference strings that several
+    parties must agree on without exchanging the expanded values.
+    */
+    class HashPRNG : public UniformRandomGenerator
+    {
+    public:
+        using seed_type = util::HashFunction::sha3_block_type;
+
+        /**
+        Creates a new HashPRNG instance from a given seed and domain separator.
+
+        @param[in] seed The 256-bit seed
+        @param[in] domain The domain separator
+        */
+        HashPRNG(const seed_type &seed, std::uint64_t domain = 0)
+        {
+            std::copy(seed.cbegin(), seed.cend(), input_.begin());
+            input_[seed.size()] = domain;
+            input_[seed.size() + 1] = 0;
+            refill_buffer();
+        }
+
+        /**
+        Generates a new uniform unsigned 32-bit random number.
+        */
+        virtual std::uint32_t generate() override
+        {
+            std::uint32_t result = static_cast<std::uint32_t>(
+                buffer_[buffer_head_ >> 1] >> ((buffer_head_ & 1) << 5));
+            if (++buffer_head_ == 2 * buffer_.size())
+            {
+                refill_buffer();
+            }
+            return result;
+        }
+
+        /**
+        Destroys the random number generator.
+        */
+        virtual ~HashPRNG() override = default;
+
+    private:
+        void refill_buffer()
+        {
+            util::HashFunction::sha3_hash(input_.data(), input_.size(), buffer_);
+            input_.back()++;
+            buffer_head_ = 0;
+        }
+
+        std::array<std::uint64_t,
+            util::HashFunction::sha3_block_uint64_count + 2> input_;
+
+        seed_type buffer_;
+
+        std::size_t buffer_head_ = 0;
+    };
+
     /**
     Provides an implementation of UniformRandomGenerator for the standard C++
     library's uniform random number generators.
@@ -54,6 +54,8 @@ namespace seal
     {
         friend class KeyGenerator;
 
+        friend class ShareAggregator;
+
     public:
         /**
         Creates an empty set of relinearization keys.
@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "seal/relinkeysshare.h"
+#include "seal/util/defines.h"
+#include <stdexcept>
+
+using namespace std;
+using namespace seal::util;
+
+namespace seal
+{
+    RelinKeysShare &RelinKeysShare::operator =(const RelinKeysShare &assign)
+    {
+        // Check for self-assignment
+        if (this == &assign)
+        {
+            return *this;
+        }
+
+        // Copy over fields
+        parms_id_ = assign.parms_id_;
+        decomposition_bit_count_ = assign.decomposition_bit_count_;
+
+        // Then copy over data
+        data_.clear();
+        data_.reserve(assign.data_.size());
+        for (auto &a : assign.data_)
+        {
+            data_.emplace_back(pool_);
+            data_.back() = a;
+        }
+
+        return *this;
+    }
+
+    bool RelinKeysShare::is_valid_for(shared_ptr<const SEALContext> context) const noexcept
+    {
+        // Check metadata
+        if (!is_metadata_valid_for(context))
+        {
+            return false;
+        }
+
+        // Check the data
+        for (auto &a : data_)
+        {
+            if (!a.is_valid_for(context))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool RelinKeysShare::is_metadata_valid_for(
+        shared_ptr<const SEALContext> context) const noexcept
+    {
+        // Verify parameters
+        if (!context || !context->parameters_set())
+        {
+            return false;
+        }
+        if (parms_id_ != context->first_parms_id())
+        {
+            return false;
+        }
+        if (decomposition_bit_count_ < SEAL_DBC_MIN ||
+            decomposition_bit_count_ > SEAL_DBC_MAX)
+        {
+            return false;
+        }
+
+        // There is one entry per prime in the coefficient modulus
+        auto &coeff_modulus = context->context_data()->parms().coeff_modulus();
+        if (data_.size() != coeff_modulus.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < data_.size(); i++)
+        {
+            auto &a = data_[i];
+            if (!a.is_metadata_valid_for(context) || !a.is_ntt_form() ||
+                a.parms_id() != parms_id_)
+            {
+                return false;
+            }
+
+            // Two polynomials per decomposition component
+            size_t decomposition_count = static_cast<size_t>(divide_round_up(
+                coeff_modulus[i].bit_count(), decomposition_bit_count_));
+            if (a.size() != 2 * decomposition_count)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void RelinKeysShare::save(std::ostream &stream) const
+    {
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on std::ios_base::badbit and std::ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            int32_t decomposition_bit_count32 =
+                safe_cast<int32_t>(decomposition_bit_count_);
+            uint64_t data_size = static_cast<uint64_t>(data_.size());
+
+            // Save the parms_id
+            stream.write(reinterpret_cast<const char*>(&parms_id_),
+                sizeof(parms_id_type));
+
+            // Save the decomposition bit count
+            stream.write(reinterpret_cast<const char*>(&decomposition_bit_count32),
+                sizeof(int32_t));
+
+            // Save the size of data_ and then the data
+            stream.write(reinterpret_cast<const char*>(&data_size), sizeof(uint64_t));
+            for (auto &a : data_)
+            {
+                a.save(stream);
+            }
+        }
+        catch (const std::exception &)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+
+        stream.exceptions(old_except_mask);
+    }
+
+    void RelinKeysShare::unsafe_load(std::istream &stream)
+    {
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on std::ios_base::badbit and std::ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            // Clear current data
+            data_.clear();
+
+            // Read the parms_id
+            stream.read(reinterpret_cast<char*>(&parms_id_),
+                sizeof(parms_id_type));
+
+            // Read and validate the decomposition_bit_count
+            int32_t decomposition_bit_count32 = 0;
+            stream.read(reinterpret_cast<char*>(&decomposition_bit_count32),
+                sizeof(int32_t));
+            if (decomposition_bit_count32 < SEAL_DBC_MIN ||
+                decomposition_bit_count32 > SEAL_DBC_MAX)
+            {
+                throw logic_error("decomposition bit count out of bounds");
+            }
+            decomposition_bit_count_ = safe_cast<int>(decomposition_bit_count32);
+
+            // Read and validate the size of data_
+            uint64_t data_size = 0;
+            stream.read(reinterpret_cast<char*>(&data_size), sizeof(uint64_t));
+            if (data_size < SEAL_COEFF_MOD_COUNT_MIN ||
+                data_size > SEAL_COEFF_MOD_COUNT_MAX)
+            {
+                throw logic_error("coefficient modulus count out of bounds");
+            }
+
+            data_.reserve(safe_cast<size_t>(data_size));
+            for (size_t i = 0; i < data_size; i++)
+            {
+                Ciphertext new_data(pool_);
+                new_data.unsafe_load(stream);
+                data_.emplace_back(move(new_data));
+            }
+        }
+        catch (const std::exception &)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+
+        stream.exceptions(old_except_mask);
+    }
+}
@@ -0,0 +1,215 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "seal/ciphertext.h"
+#include "seal/memorymanager.h"
+#include "seal/encryptionparams.h"
+
+namespace seal
+{
+    /**
+    Class to store one party's contribution to a jointly generated relinearization
+    key, or the sum of such contributions from all parties.
+
+    @par Distributed Relinearization Key Generation
+    When several parties hold additive shares s_1, ..., s_P of a joint secret key
+    s = s_1 + ... + s_P (e.g. generated with KeyGenerator from a common KeyGenCRS),
+    a relinearization key for s^2 can be generated without ever reconstructing s
+    in a two-round protocol:
+
+    1. Every party calls KeyGenerator::relin_keys_share_round1 and publishes the
+    resulting RelinKeysShare. The shares are summed with ShareAggregator::aggregate.
+    2. Every party calls KeyGenerator::relin_keys_share_round2 on the aggregated
+    round-1 share and publishes the result. These are again summed.
+    3. ShareAggregator::relin_keys combines the two aggregated shares into a
+    standard RelinKeys object that can be used with Evaluator::relinearize.
+
+    @par Data Layout
+    A RelinKeysShare holds, for every prime in the coefficient modulus, a pair of
+    polynomials in NTT form per decomposition component. These are stored in the
+    same way as in RelinKeys, i.e., using Ciphertext as a container.
+
+    @par Thread Safety
+    In general, reading from RelinKeysShare is thread-safe as long as no other
+    thread is concurrently mutating it. This is due to the underlying data
+    structure storing the shares not being thread-safe.
+
+    @see KeyGenerator for the class that generates the shares.
+    @see ShareAggregator for the class that aggregates the shares.
+    @see RelinKeys for the class that stores the resulting relinearization keys.
+    */
+    class RelinKeysShare
+    {
+        friend class KeyGenerator;
+
+        friend class ShareAggregator;
+
+    public:
+        /**
+        Creates an empty relinearization key share.
+        */
+        RelinKeysShare() = default;
+
+        /**
+        Creates a new RelinKeysShare instance by copying a given instance.
+
+        @param[in] copy The RelinKeysShare to copy from
+        */
+        RelinKeysShare(const RelinKeysShare &copy) = default;
+
+        /**
+        Creates a new RelinKeysShare instance by moving a given instance.
+
+        @param[in] source The RelinKeysShare to move from
+        */
+        RelinKeysShare(RelinKeysShare &&source) = default;
+
+        /**
+        Copies a given RelinKeysShare instance to the current one.
+
+        @param[in] assign The RelinKeysShare to copy from
+        */
+        RelinKeysShare &operator =(const RelinKeysShare &assign);
+
+        /**
+        Moves a given RelinKeysShare instance to the current one.
+
+        @param[in] assign The RelinKeysShare to move from
+        */
+        RelinKeysShare &operator =(RelinKeysShare &&assign) = default;
+
+        /**
+        Returns the decomposition bit count.
+        */
+        inline int decomposition_bit_count() const noexcept
+        {
+            return decomposition_bit_count_;
+        }
+
+        /**
+        Returns a reference to the share data.
+        */
+        inline auto &data() noexcept
+        {
+            return data_;
+        }
+
+        /**
+        Returns a const reference to the share data.
+        */
+        inline auto &data() const noexcept
+        {
+            return data_;
+        }
+
+        /**
+        Returns a reference to parms_id.
+
+        @see EncryptionParameters for more information about parms_id.
+        */
+        inline auto &parms_id() noexcept
+        {
+            return parms_id_;
+        }
+
+        /**
+        Returns a const reference to parms_id.
+
+        @see EncryptionParameters for more information about parms_id.
+        */
+        inline auto &parms_id() const noexcept
+        {
+            return parms_id_;
+        }
+
+        /**
+        Check whether the current RelinKeysShare is valid for a given SEALContext.
+        If the given SEALContext is not set, the encryption parameters are invalid,
+        or the RelinKeysShare data does not match the SEALContext, this function
+        returns false. Otherwise, returns true.
+
+        @param[in] context The SEALContext
+        */
+        bool is_valid_for(std::shared_ptr<const SEALContext> context) const noexcept;
+
+        /**
+        Check whether the current RelinKeysShare is valid for a given SEALContext.
+        If the given SEALContext is not set, the encryption parameters are invalid,
+        or the RelinKeysShare data does not match the SEALContext, this function
+        returns false. Otherwise, returns true. This function only checks the
+        metadata and not the share data itself.
+
+        @param[in] context The SEALContext
+        */
+        bool is_metadata_valid_for(std::shared_ptr<const SEALContext> context) const noexcept;
+
+        /**
+        Saves the RelinKeysShare instance to an output stream. The output is in
+        binary format and not human-readable. The output stream must have the
+        "binary" flag set.
+
+        @param[in] stream The stream to save the RelinKeysShare to
+        @throws std::exception if the RelinKeysShare could not be written to stream
+        */
+        void save(std::ostream &stream) const;
+
+        /**
+        Loads a RelinKeysShare from an input stream overwriting the current
+        RelinKeysShare. No checking of the validity of the data against encryption
+        parameters is performed. This function should not be used unless the
+        RelinKeysShare comes from a fully trusted source.
+
+        @param[in] stream The stream to load the RelinKeysShare from
+        @throws std::exception if a valid RelinKeysShare could not be read from stream
+        */
+        void unsafe_load(std::istream &stream);
+
+        /**
+        Loads a RelinKeysShare from an input stream overwriting the current
+        RelinKeysShare. The loaded RelinKeysShare is verified to be valid for the
+        given SEALContext.
+
+        @param[in] context The SEALContext
+        @param[in] stream The stream to load the RelinKeysShare from
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::exception if a valid RelinKeysShare could not be read from stream
+        @throws std::invalid_argument if the loaded RelinKeysShare is invalid for
+        the context
+        */
+        inline void load(std::shared_ptr<SEALContext> context,
+            std::istream &stream)
+        {
+            unsafe_load(stream);
+            if (!is_valid_for(std::move(context)))
+            {
+                throw std::invalid_argument("RelinKeysShare data is invalid");
+            }
+        }
+
+        /**
+        Returns the currently used MemoryPoolHandle.
+        */
+        inline MemoryPoolHandle pool() const noexcept
+        {
+            return pool_;
+        }
+
+    private:
+        MemoryPoolHandle pool_ = MemoryManager::GetPool();
+
+        parms_id_type parms_id_ = parms_id_zero;
+
+        /**
+        One entry per prime in the coefficient modulus; each entry holds two
+        polynomials per decomposition component.
+        */
+        std::vector<Ciphertext> data_{};
+
+        int decomposition_bit_count_ = 0;
+    };
+}
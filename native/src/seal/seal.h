@@ -5,6 +5,7 @@
 
 #include "seal/biguint.h"
 #include "seal/ciphertext.h"
+#include "seal/ciphertextaccumulator.h"
 #include "seal/ckks.h"
 #include "seal/context.h"
 #include "seal/decryptor.h"
@@ -17,10 +18,15 @@
 #include "seal/keygenerator.h"
 #include "seal/memorymanager.h"
 #include "seal/plaintext.h"
+#include "seal/plaintextcache.h"
+#include "seal/plaintextdatabase.h"
+#include "seal/precomputedencryptor.h"
 #include "seal/batchencoder.h"
 #include "seal/publickey.h"
 #include "seal/randomgen.h"
 #include "seal/randomtostd.h"
 #include "seal/relinkeys.h"
+#include "seal/relinkeysshare.h"
 #include "seal/secretkey.h"
+#include "seal/shareaggregator.h"
 #include "seal/smallmodulus.h"
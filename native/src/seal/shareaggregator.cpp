@@ -0,0 +1,463 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <stdexcept>
+#include "seal/shareaggregator.h"
+#include "seal/util/common.h"
+#include "seal/util/polycore.h"
+#include "seal/util/polyarithsmallmod.h"
+#include "seal/util/uintcore.h"
+#include "seal/util/smallntt.h"
+#include "seal/util/parallel.h"
+
+using namespace std;
+using namespace seal::util;
+
+namespace seal
+{
+    ShareAggregator::ShareAggregator(shared_ptr<SEALContext> context) :
+        context_(move(context))
+    {
+        // Verify parameters
+        if (!context_)
+        {
+            throw invalid_argument("invalid context");
+        }
+        if (!context_->parameters_set())
+        {
+            throw invalid_argument("encryption parameters are not set correctly");
+        }
+    }
+
+    PublicKey ShareAggregator::public_key(const vector<PublicKey> &shares) const
+    {
+        if (shares.empty())
+        {
+            throw invalid_argument("shares cannot be empty");
+        }
+        for (auto &share : shares)
+        {
+            if (!share.is_valid_for(context_))
+            {
+                throw invalid_argument("public key share is not valid for encryption parameters");
+            }
+        }
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data();
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        size_t rns_poly_uint64_count = mul_safe(coeff_count, coeff_mod_count);
+
+        // All shares must have been generated from the same crs value
+        const uint64_t *crs = shares[0].data().data(1);
+        for (auto &share : shares)
+        {
+            if (!equal(crs, crs + rns_poly_uint64_count, share.data().data(1)))
+            {
+                throw invalid_argument("public key shares were not generated from a common crs");
+            }
+        }
+
+        PublicKey public_key(shares[0]);
+        uint64_t *public_key_0 = public_key.data().data(0);
+        for (size_t k = 1; k < shares.size(); k++)
+        {
+            for (size_t j = 0; j < coeff_mod_count; j++)
+            {
+                add_poly_poly_coeffmod(public_key_0 + (j * coeff_count),
+                    shares[k].data().data(0) + (j * coeff_count), coeff_count,
+                    coeff_modulus[j], public_key_0 + (j * coeff_count));
+            }
+        }
+
+        return public_key;
+    }
+
+    RelinKeysShare ShareAggregator::aggregate(
+        const vector<RelinKeysShare> &shares) const
+    {
+        if (shares.empty())
+        {
+            throw invalid_argument("shares cannot be empty");
+        }
+        for (auto &share : shares)
+        {
+            if (!share.is_valid_for(context_))
+            {
+                throw invalid_argument("relinearization key share is not valid for encryption parameters");
+            }
+            if (share.decomposition_bit_count() != shares[0].decomposition_bit_count())
+            {
+                throw invalid_argument("relinearization key shares have mismatching decomposition bit counts");
+            }
+        }
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data();
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+
+        RelinKeysShare aggregate(shares[0]);
+        for (size_t k = 1; k < shares.size(); k++)
+        {
+            for (size_t l = 0; l < coeff_mod_count; l++)
+            {
+                // All polynomials of the component are summed in one pass
+                size_t poly_count = aggregate.data_[l].size();
+                for (size_t i = 0; i < poly_count; i++)
+                {
+                    uint64_t *destination = aggregate.data_[l].data(i);
+                    const uint64_t *operand = shares[k].data_[l].data(i);
+                    for (size_t j = 0; j < coeff_mod_count; j++)
+                    {
+                        add_poly_poly_coeffmod(destination + (j * coeff_count),
+                            operand + (j * coeff_count), coeff_count,
+                            coeff_modulus[j], destination + (j * coeff_count));
+                    }
+                }
+            }
+        }
+
+        return aggregate;
+    }
+
+    RelinKeys ShareAggregator::relin_keys(const RelinKeysShare &round1_aggregate,
+        const RelinKeysShare &round2_aggregate) const
+    {
+        if (!round1_aggregate.is_valid_for(context_))
+        {
+            throw invalid_argument("round1_aggregate is not valid for encryption parameters");
+        }
+        if (!round2_aggregate.is_valid_for(context_))
+        {
+            throw invalid_argument("round2_aggregate is not valid for encryption parameters");
+        }
+        if (round1_aggregate.decomposition_bit_count() !=
+            round2_aggregate.decomposition_bit_count())
+        {
+            throw invalid_argument("aggregated shares have mismatching decomposition bit counts");
+        }
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data();
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+
+        // The relinearization key for s^2 is (h0' + h1', h1)
+        RelinKeys relin_keys;
+        relin_keys.data().resize(1);
+        auto &key = relin_keys.data()[0];
+        key.reserve(coeff_mod_count);
+        for (size_t l = 0; l < coeff_mod_count; l++)
+        {
+            size_t poly_count = round1_aggregate.data_[l].size();
+            key.emplace_back(context_, parms.parms_id(), poly_count,
+                relin_keys.pool());
+            key.back().resize(poly_count);
+            key.back().is_ntt_form() = true;
+
+            for (size_t i = 0; i < poly_count / 2; i++)
+            {
+                uint64_t *eval_keys_first = key[l].data(2 * i);
+                uint64_t *eval_keys_second = key[l].data(2 * i + 1);
+                for (size_t j = 0; j < coeff_mod_count; j++)
+                {
+                    add_poly_poly_coeffmod(
+                        round2_aggregate.data_[l].data(2 * i) + (j * coeff_count),
+                        round2_aggregate.data_[l].data(2 * i + 1) + (j * coeff_count),
+                        coeff_count, coeff_modulus[j],
+                        eval_keys_first + (j * coeff_count));
+                }
+                set_poly_poly(round1_aggregate.data_[l].data(2 * i + 1),
+                    coeff_count, coeff_mod_count, eval_keys_second);
+            }
+        }
+
+        // Set decomposition_bit_count and parms_id
+        relin_keys.decomposition_bit_count_ = round1_aggregate.decomposition_bit_count();
+        relin_keys.parms_id() = parms.parms_id();
+
+        return relin_keys;
+    }
+
+    void ShareAggregator::aggregate_inplace(GaloisKeys &aggregate,
+        const GaloisKeys &share) const
+    {
+        if (!aggregate.is_valid_for(context_))
+        {
+            throw invalid_argument("aggregate is not valid for encryption parameters");
+        }
+        if (!share.is_valid_for(context_))
+        {
+            throw invalid_argument("Galois key share is not valid for encryption parameters");
+        }
+        if (aggregate.decomposition_bit_count() != share.decomposition_bit_count() ||
+            aggregate.data().size() != share.data().size())
+        {
+            throw invalid_argument("Galois key share does not match aggregate");
+        }
+        for (size_t index = 0; index < share.data().size(); index++)
+        {
+            if (aggregate.data()[index].size() != share.data()[index].size())
+            {
+                throw invalid_argument("Galois key share does not match aggregate");
+            }
+        }
+
+        // Extract encryption parameters.
+        auto &context_data = *context_->context_data();
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        size_t rns_poly_uint64_count = mul_safe(coeff_count, coeff_mod_count);
+
+        // All shares must have been generated from the same crs value; check
+        // before modifying aggregate
+        for (size_t index = 0; index < share.data().size(); index++)
+        {
+            for (size_t l = 0; l < share.data()[index].size(); l++)
+            {
+                auto &aggregate_key = aggregate.data()[index][l];
+                auto &share_key = share.data()[index][l];
+                if (aggregate_key.size() != share_key.size())
+                {
+                    throw invalid_argument("Galois key share does not match aggregate");
+                }
+                for (size_t i = 1; i < share_key.size(); i += 2)
+                {
+                    if (!equal(share_key.data(i), share_key.data(i) + rns_poly_uint64_count,
+                        aggregate_key.data(i)))
+                    {
+                        throw invalid_argument("Galois key shares were not generated from a common crs");
+                    }
+                }
+            }
+        }
+
+        for (size_t index = 0; index < share.data().size(); index++)
+        {
+            for (size_t l = 0; l < share.data()[index].size(); l++)
+            {
+                auto &aggregate_key = aggregate.data()[index][l];
+                auto &share_key = share.data()[index][l];
+                for (size_t i = 0; i < share_key.size(); i += 2)
+                {
+                    for (size_t j = 0; j < coeff_mod_count; j++)
+                    {
+                        add_poly_poly_coeffmod(aggregate_key.data(i) + (j * coeff_count),
+                            share_key.data(i) + (j * coeff_count), coeff_count,
+                            coeff_modulus[j], aggregate_key.data(i) + (j * coeff_count));
+                    }
+                }
+            }
+        }
+    }
+
+    GaloisKeys ShareAggregator::galois_keys(const vector<GaloisKeys> &shares) const
+    {
+        if (shares.empty())
+        {
+            throw invalid_argument("shares cannot be empty");
+        }
+
+        GaloisKeys galois_keys(shares[0]);
+        for (size_t k = 1; k < shares.size(); k++)
+        {
+            aggregate_inplace(galois_keys, shares[k]);
+        }
+        if (shares.size() == 1 && !galois_keys.is_valid_for(context_))
+        {
+            throw invalid_argument("Galois key share is not valid for encryption parameters");
+        }
+
+        return galois_keys;
+    }
+
+    void ShareAggregator::decrypt(const Ciphertext &encrypted,
+        const vector<Plaintext> &shares, Plaintext &destination) const
+    {
+        verify_decrypt(encrypted);
+        if (shares.empty())
+        {
+            throw invalid_argument("shares cannot be empty");
+        }
+        for (auto &share : shares)
+        {
+            verify_decryption_share(encrypted, share);
+        }
+
+        decrypt_internal(encrypted, shares.size(),
+            [&](size_t k) -> const Plaintext & { return shares[k]; },
+            destination, MemoryManager::GetPool());
+    }
+
+    void ShareAggregator::decrypt(const vector<Ciphertext> &encrypted,
+        const vector<vector<Plaintext>> &shares, vector<Plaintext> &destination,
+        size_t thread_count) const
+    {
+        if (shares.empty())
+        {
+            throw invalid_argument("shares cannot be empty");
+        }
+        for (auto &party_shares : shares)
+        {
+            if (party_shares.size() != encrypted.size())
+            {
+                throw invalid_argument("shares do not match encrypted");
+            }
+        }
+        for (size_t i = 0; i < encrypted.size(); i++)
+        {
+            verify_decrypt(encrypted[i]);
+            for (auto &party_shares : shares)
+            {
+                verify_decryption_share(encrypted[i], party_shares[i]);
+            }
+        }
+
+        destination.resize(encrypted.size());
+        parallel_for(encrypted.size(), thread_count,
+            [&](size_t begin, size_t end) {
+                auto pool = MemoryPoolHandle::New();
+                for (size_t i = begin; i < end; i++)
+                {
+                    decrypt_internal(encrypted[i], shares.size(),
+                        [&](size_t k) -> const Plaintext & { return shares[k][i]; },
+                        destination[i], pool);
+                }
+            });
+    }
+
+    void ShareAggregator::verify_decrypt(const Ciphertext &encrypted) const
+    {
+        if (!encrypted.is_valid_for(context_))
+        {
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+        if (encrypted.size() != 2)
+        {
+            throw invalid_argument("encrypted must have size 2");
+        }
+
+        auto &parms = context_->context_data()->parms();
+        switch (parms.scheme())
+        {
+        case scheme_type::BFV:
+            // BFV ciphertexts can be in either form
+            break;
+
+        case scheme_type::CKKS:
+            if (!encrypted.is_ntt_form())
+            {
+                throw invalid_argument("encrypted must be in NTT form");
+            }
+            break;
+
+        default:
+            throw invalid_argument("unsupported scheme");
+        }
+    }
+
+    void ShareAggregator::verify_decryption_share(const Ciphertext &encrypted,
+        const Plaintext &share) const
+    {
+        if (!share.is_valid_for(context_) ||
+            share.parms_id() != encrypted.parms_id() ||
+            share.scale() != encrypted.scale())
+        {
+            throw invalid_argument("decryption share does not match encrypted");
+        }
+    }
+
+    template<typename GetShare>
+    void ShareAggregator::decrypt_internal(const Ciphertext &encrypted,
+        size_t share_count, GetShare &&get_share, Plaintext &destination,
+        MemoryPoolHandle pool) const
+    {
+        auto &context_data = *context_->context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = coeff_modulus.size();
+        size_t rns_poly_uint64_count = mul_safe(coeff_count, coeff_mod_count);
+
+        // Sum of c_1 * s_k + e_k over all parties, in NTT form
+        auto phase(allocate_poly(coeff_count, coeff_mod_count, pool));
+        set_poly_poly(get_share(0).data(), coeff_count, coeff_mod_count, phase.get());
+        for (size_t k = 1; k < share_count; k++)
+        {
+            const uint64_t *share = get_share(k).data();
+            for (size_t j = 0; j < coeff_mod_count; j++)
+            {
+                add_poly_poly_coeffmod(phase.get() + (j * coeff_count),
+                    share + (j * coeff_count), coeff_count, coeff_modulus[j],
+                    phase.get() + (j * coeff_count));
+            }
+        }
+
+        if (parms.scheme() == scheme_type::CKKS)
+        {
+            // Since we overwrite destination, we zeroize destination parameters
+            // This is necessary, otherwise resize will throw an exception.
+            destination.parms_id() = parms_id_zero;
+            destination.resize(rns_poly_uint64_count);
+
+            // Add c_0; everything is already in NTT form
+            for (size_t j = 0; j < coeff_mod_count; j++)
+            {
+                add_poly_poly_coeffmod(phase.get() + (j * coeff_count),
+                    encrypted.data() + (j * coeff_count), coeff_count,
+                    coeff_modulus[j], destination.data() + (j * coeff_count));
+            }
+
+            destination.parms_id() = encrypted.parms_id();
+            destination.scale() = encrypted.scale();
+            return;
+        }
+
+        // BFV: one inverse NTT for all parties. A c_0 in NTT form is added
+        // before it, otherwise after it with lazy reduction.
+        auto &small_ntt_tables = context_data.small_ntt_tables();
+        bool is_ntt_form = encrypted.is_ntt_form();
+        for (size_t j = 0; j < coeff_mod_count; j++)
+        {
+            uint64_t *phase_j = phase.get() + (j * coeff_count);
+            const uint64_t *c0_j = encrypted.data() + (j * coeff_count);
+            if (is_ntt_form)
+            {
+                add_poly_poly_coeffmod(phase_j, c0_j, coeff_count,
+                    coeff_modulus[j], phase_j);
+                inverse_ntt_negacyclic_harvey(phase_j, small_ntt_tables[j]);
+                continue;
+            }
+            inverse_ntt_negacyclic_harvey(phase_j, small_ntt_tables[j]);
+            for (size_t i = 0; i < coeff_count; i++)
+            {
+                phase_j[i] += c0_j[i];
+            }
+        }
+
+        // Scale by t/q and round to get the plaintext
+        auto wide_destination(allocate_uint(coeff_count, pool));
+        context_data.base_converter()->decrypt_scale_and_round(phase.get(),
+            wide_destination.get(), pool);
+
+        // How many non-zero coefficients do we really have in the result?
+        size_t plain_coeff_count = max(get_significant_uint64_count_uint(
+            wide_destination.get(), coeff_count), size_t(1));
+
+        // Resize destination to appropriate size
+        destination.parms_id() = parms_id_zero;
+        destination.resize(plain_coeff_count);
+        set_uint_uint(wide_destination.get(), plain_coeff_count, destination.data());
+    }
+}
@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "seal/context.h"
+#include "seal/ciphertext.h"
+#include "seal/plaintext.h"
+#include "seal/memorymanager.h"
+#include "seal/publickey.h"
+#include "seal/relinkeys.h"
+#include "seal/relinkeysshare.h"
+#include "seal/galoiskeys.h"
+
+namespace seal
+{
+    /**
+    Combines the contributions of several parties holding additive shares of a
+    joint secret key into keys for the joint secret key. The ShareAggregator
+    holds no secret material and can be run by any party, or by an untrusted
+    server that collects the shares. Constructing a ShareAggregator requires
+    only a SEALContext.
+
+    @par Joint Public Key
+    When every party creates its KeyGenerator from the same KeyGenCRS, the
+    public keys of the parties share the same second polynomial, and the sum
+    of their first polynomials yields a public key for the joint secret key.
+
+    @par Thread Safety
+    The ShareAggregator holds no mutable state, so one instance can be used
+    concurrently from several threads.
+
+    @see KeyGenerator for the class that generates the shares.
+    @see RelinKeysShare for the distributed relinearization key protocol.
+    */
+    class ShareAggregator
+    {
+    public:
+        /**
+        Creates a ShareAggregator initialized with the specified SEALContext.
+
+        @param[in] context The SEALContext
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        */
+        ShareAggregator(std::shared_ptr<SEALContext> context);
+
+        /**
+        Sums the public keys of all parties into a public key for the joint
+        secret key.
+
+        @param[in] shares The public keys of all parties
+        @throws std::invalid_argument if shares is empty
+        @throws std::invalid_argument if some public key is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if the public keys were not generated from
+        the same KeyGenCRS
+        */
+        PublicKey public_key(const std::vector<PublicKey> &shares) const;
+
+        /**
+        Sums relinearization key shares of the same protocol round from all
+        parties.
+
+        @param[in] shares The shares of all parties
+        @throws std::invalid_argument if shares is empty
+        @throws std::invalid_argument if some share is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if the shares have mismatching
+        decomposition bit counts
+        */
+        RelinKeysShare aggregate(const std::vector<RelinKeysShare> &shares) const;
+
+        /**
+        Creates relinearization keys for the joint secret key from the aggregated
+        round-1 and round-2 shares. The result contains a single key for the
+        square of the joint secret key.
+
+        @param[in] round1_aggregate The sum of the round-1 shares of all parties
+        @param[in] round2_aggregate The sum of the round-2 shares of all parties
+        @throws std::invalid_argument if round1_aggregate or round2_aggregate is
+        not valid for the encryption parameters
+        @throws std::invalid_argument if round1_aggregate and round2_aggregate
+        have mismatching decomposition bit counts
+        */
+        RelinKeys relin_keys(const RelinKeysShare &round1_aggregate,
+            const RelinKeysShare &round2_aggregate) const;
+
+        /**
+        Adds the Galois key share of one more party into aggregate. The first
+        share received is used as the initial value of aggregate, and the others
+        are then added to it one at a time. After all shares have been added,
+        aggregate holds Galois keys for the joint secret key.
+
+        @param[in,out] aggregate The running sum of Galois key shares
+        @param[in] share The Galois key share to add
+        @throws std::invalid_argument if aggregate or share is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if aggregate and share do not have the same
+        Galois elements and decomposition bit count
+        @throws std::invalid_argument if the shares were not generated from the
+        same KeyGenCRS
+        */
+        void aggregate_inplace(GaloisKeys &aggregate, const GaloisKeys &share) const;
+
+        /**
+        Sums the Galois key shares of all parties into Galois keys for the joint
+        secret key.
+
+        @param[in] shares The Galois key shares of all parties
+        @throws std::invalid_argument if shares is empty
+        @throws std::invalid_argument if the shares are not valid for the
+        encryption parameters or do not match each other
+        @throws std::invalid_argument if the shares were not generated from the
+        same KeyGenCRS
+        */
+        GaloisKeys galois_keys(const std::vector<GaloisKeys> &shares) const;
+
+        /**
+        Combines the threshold decryption shares of all parties for a ciphertext
+        and stores the result in the destination parameter. The result is the
+        same as that of Decryptor::decrypt with the joint secret key, up to the
+        smudging noise added by the parties. BFV ciphertexts can be in either
+        form.
+
+        @param[in] encrypted The ciphertext to decrypt
+        @param[in] shares The decryption shares of all parties for encrypted
+        @param[out] destination The plaintext to overwrite with the decrypted
+        ciphertext
+        @throws std::invalid_argument if encrypted is not valid for the
+        encryption parameters, not in the default NTT form, or not of size 2
+        @throws std::invalid_argument if shares is empty
+        @throws std::invalid_argument if some share does not match encrypted
+        */
+        void decrypt(const Ciphertext &encrypted,
+            const std::vector<Plaintext> &shares, Plaintext &destination) const;
+
+        /**
+        Combines the threshold decryption shares of all parties for a batch of
+        ciphertexts. Here shares[k][i] is the share of party k for encrypted[i],
+        as produced by the batched Decryptor::partial_decrypt. The batch is split
+        among thread_count threads; a thread_count of zero uses one thread per
+        hardware thread. The results are stored in destination, which is resized
+        to the number of ciphertexts.
+
+        @param[in] encrypted The ciphertexts to decrypt
+        @param[in] shares The decryption shares of all parties
+        @param[out] destination The plaintexts to overwrite with the decrypted
+        ciphertexts
+        @param[in] thread_count The number of threads to use
+        @throws std::invalid_argument if some ciphertext is not valid for the
+        encryption parameters, not in the default NTT form, or not of size 2
+        @throws std::invalid_argument if shares is empty
+        @throws std::invalid_argument if the share batch of some party does not
+        match encrypted
+        */
+        void decrypt(const std::vector<Ciphertext> &encrypted,
+            const std::vector<std::vector<Plaintext>> &shares,
+            std::vector<Plaintext> &destination, std::size_t thread_count = 0) const;
+
+    private:
+        ShareAggregator(const ShareAggregator &copy) = delete;
+
+        ShareAggregator(ShareAggregator &&source) = delete;
+
+        ShareAggregator &operator =(const ShareAggregator &assign) = delete;
+
+        ShareAggregator &operator =(ShareAggregator &&assign) = delete;
+
+        void verify_decrypt(const Ciphertext &encrypted) const;
+
+        void verify_decryption_share(const Ciphertext &encrypted,
+            const Plaintext &share) const;
+
+        template<typename GetShare>
+        void decrypt_internal(const Ciphertext &encrypted, std::size_t share_count,
+            GetShare &&get_share, Plaintext &destination, MemoryPoolHandle pool) const;
+
+        std::shared_ptr<SEALContext> context_{ nullptr };
+    };
+}
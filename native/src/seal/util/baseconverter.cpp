@@ -12,6 +12,8 @@
 #include "seal/util/uintarithsmallmod.h"
 #include "seal/util/uintarithmod.h"
 #include "seal/util/smallntt.h"
+#include "seal/util/polycore.h"
+#include "seal/util/polyarithsmallmod.h"
 #include "seal/util/globals.h"
 #include "seal/smallmodulus.h"
 #include "seal/defaultparams.h"
@@ -393,6 +395,18 @@ namespace seal
                 }
             }
 
+            // Scale the inverses by 2^64 / q_i for Shoup's multiplication in
+            // rescaling
+            scaled_inv_last_coeff_mod_array_ = allocate_uint(coeff_base_mod_count_ - 1, pool_);
+            for (size_t i = 0; i < coeff_base_mod_count_ - 1; i++)
+            {
+                uint64_t wide_quotient[2]{ 0, 0 };
+                uint64_t wide_coeff[2]{ 0, inv_last_coeff_mod_array_[i] };
+                divide_uint128_uint64_inplace(wide_coeff, coeff_base_array_[i].value(),
+                    wide_quotient);
+                scaled_inv_last_coeff_mod_array_[i] = wide_quotient[0];
+            }
+
             // Generate plain gamma array of small_plain_mod_ is set to non-zero.
             // Otherwise assume we use CKKS and no plain_modulus is needed.
             if (!small_plain_mod_.is_zero())
@@ -484,6 +498,7 @@ namespace seal
             plain_gamma_product_mod_coeff_array_.release();
             bsk_small_ntt_tables_.release();
             inv_last_coeff_mod_array_.release();
+            scaled_inv_last_coeff_mod_array_.release();
             inv_coeff_products_mod_mtilde_ = 0;
             m_tilde_ = 0;
             m_sk_ = 0;
@@ -971,5 +986,75 @@ namespace seal
                 }
             }
         }
+
+        void BaseConverter::decrypt_scale_and_round(uint64_t *input,
+            uint64_t *destination, MemoryPoolHandle pool) const
+        {
+#ifdef SEAL_DEBUG
+            if (small_plain_mod_.is_zero())
+            {
+                throw logic_error("invalid operation");
+            }
+            if (input == nullptr)
+            {
+                throw invalid_argument("input cannot be null");
+            }
+            if (destination == nullptr)
+            {
+                throw invalid_argument("destination cannot be null");
+            }
+#endif
+            // Compute |gamma * plain|qi * ct(s)
+            for (size_t i = 0; i < coeff_base_mod_count_; i++)
+            {
+                multiply_poly_scalar_coeffmod(input + (i * coeff_count_), coeff_count_,
+                    plain_gamma_product_mod_coeff_array_[i], coeff_base_array_[i],
+                    input + (i * coeff_count_));
+            }
+
+            // Make another temp destination to get the poly in mod {gamma U plain_modulus}
+            auto tmp_dest_plain_gamma(allocate_poly(coeff_count_, plain_gamma_count_, pool));
+
+            // Compute FastBConvert from q to {gamma, plain_modulus}
+            fastbconv_plain_gamma(input, tmp_dest_plain_gamma.get(), pool);
+
+            // Compute result multiply by coeff_modulus inverse in mod {gamma U plain_modulus}
+            for (size_t i = 0; i < plain_gamma_count_; i++)
+            {
+                multiply_poly_scalar_coeffmod(tmp_dest_plain_gamma.get() + (i * coeff_count_),
+                    coeff_count_, neg_inv_coeff_products_all_mod_plain_gamma_array_[i],
+                    plain_gamma_array_[i], tmp_dest_plain_gamma.get() + (i * coeff_count_));
+            }
+
+            // First correct the values which are larger than floor(gamma/2)
+            uint64_t gamma_div_2 = plain_gamma_array_[1].value() >> 1;
+
+            // Now compute the subtraction to remove error and perform final multiplication by
+            // gamma inverse mod plain_modulus
+            for (size_t i = 0; i < coeff_count_; i++)
+            {
+                // Need correction beacuse of center mod
+                if (tmp_dest_plain_gamma[i + coeff_count_] > gamma_div_2)
+                {
+                    // Compute -(gamma - a) instead of (a - gamma)
+                    tmp_dest_plain_gamma[i + coeff_count_] = plain_gamma_array_[1].value() -
+                        tmp_dest_plain_gamma[i + coeff_count_];
+                    tmp_dest_plain_gamma[i + coeff_count_] %= plain_gamma_array_[0].value();
+                    destination[i] = add_uint_uint_mod(tmp_dest_plain_gamma[i],
+                        tmp_dest_plain_gamma[i + coeff_count_], plain_gamma_array_[0]);
+                }
+                // No correction needed
+                else
+                {
+                    tmp_dest_plain_gamma[i + coeff_count_] %= plain_gamma_array_[0].value();
+                    destination[i] = sub_uint_uint_mod(tmp_dest_plain_gamma[i],
+                        tmp_dest_plain_gamma[i + coeff_count_], plain_gamma_array_[0]);
+                }
+            }
+
+            // Perform final multiplication by gamma inverse mod plain_modulus
+            multiply_poly_scalar_coeffmod(destination, coeff_count_,
+                inv_gamma_mod_plain_, plain_gamma_array_[0], destination);
+        }
     }
 }
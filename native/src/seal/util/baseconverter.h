@@ -73,6 +73,13 @@ namespace seal
             void fastbconv_plain_gamma(const std::uint64_t *input, 
                 std::uint64_t *destination, MemoryPoolHandle pool) const;
 
+            /**
+            BFV decryption scaling: computes round(t/q * input) mod t for the
+            decryption phase given in q. The input is overwritten.
+            */
+            void decrypt_scale_and_round(std::uint64_t *input,
+                std::uint64_t *destination, MemoryPoolHandle pool) const;
+
             void reset() noexcept;
 
             inline auto is_generated() const noexcept
@@ -160,6 +167,11 @@ namespace seal
                 return inv_last_coeff_mod_array_;
             }
 
+            inline auto &get_scaled_inv_last_coeff_mod_array() const noexcept
+            {
+                return scaled_inv_last_coeff_mod_array_;
+            }
+
             inline auto &get_coeff_base_products_mod_msk() const noexcept
             {
                 return coeff_base_products_mod_aux_bsk_array_[bsk_base_mod_count_ - 1];
@@ -260,6 +272,9 @@ namespace seal
             // For modulus switching: inverses of the last coeff base modulus
             Pointer<std::uint64_t> inv_last_coeff_mod_array_;
 
+            // The same inverses scaled by 2^64 and divided by the coeff base moduli
+            Pointer<std::uint64_t> scaled_inv_last_coeff_mod_array_;
+
             SmallModulus m_tilde_;
 
             SmallModulus m_sk_;
@@ -0,0 +1,22 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#define SEAL_VERSION "3.2.0"
+/* #undef SEAL_DEBUG */
+#define SEAL_USE_IF_CONSTEXPR
+#define SEAL_USE_MAYBE_UNUSED
+#define SEAL_USE_STD_BYTE
+#define SEAL_USE_SHARED_MUTEX
+/* #undef SEAL_ENFORCE_HE_STD_SECURITY */
+/* #undef SEAL_ALLOW_TRANSPARENT_CIPHERTEXT */
+#define SEAL_USE_INTRIN
+/* #undef SEAL_USE__UMUL128 */
+/* #undef SEAL_USE__BITSCANREVERSE64 */
+#define SEAL_USE___BUILTIN_CLZLL
+#define SEAL_USE___INT128
+#define SEAL_USE__ADDCARRY_U64
+#define SEAL_USE__SUBBORROW_U64
+#define SEAL_USE_AES_NI_PRNG
+/* #undef SEAL_USE_MSGSL */
+/* #undef SEAL_USE_MSGSL_SPAN */
+/* #undef SEAL_USE_MSGSL_MULTISPAN */
@@ -0,0 +1,451 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include "seal/util/defines.h"
+#include "seal/util/pointer.h"
+#include "seal/util/uintcore.h"
+#include "seal/util/hpsconverter.h"
+#include "seal/util/uintarith.h"
+#include "seal/util/uintarithsmallmod.h"
+#include "seal/util/smallntt.h"
+#include "seal/util/globals.h"
+#include "seal/util/common.h"
+#include "seal/smallmodulus.h"
+
+using namespace std;
+
+namespace seal
+{
+    namespace util
+    {
+        HPSConverter::HPSConverter(const std::vector<SmallModulus> &coeff_base,
+            size_t coeff_count, const SmallModulus &small_plain_mod,
+            MemoryPoolHandle pool) : pool_(move(pool))
+        {
+#ifdef SEAL_DEBUG
+            if (!pool_)
+            {
+                throw std::invalid_argument("pool is uninitialized");
+            }
+#endif
+            generate(coeff_base, coeff_count, small_plain_mod);
+        }
+
+        void HPSConverter::generate(const std::vector<SmallModulus> &coeff_base,
+            size_t coeff_count, const SmallModulus &small_plain_mod)
+        {
+#ifdef SEAL_DEBUG
+            if (get_power_of_two(coeff_count) < 0)
+            {
+                throw invalid_argument("coeff_count must be a power of 2");
+            }
+            if (coeff_base.size() < SEAL_COEFF_MOD_COUNT_MIN ||
+                coeff_base.size() > SEAL_COEFF_MOD_COUNT_MAX)
+            {
+                throw invalid_argument("coeff_base has invalid size");
+            }
+#endif
+            int coeff_count_power = get_power_of_two(coeff_count);
+
+            reset();
+
+            coeff_count_ = coeff_count;
+            coeff_base_mod_count_ = coeff_base.size();
+
+            // The tensor product of two centered ciphertexts is at most K * n * q^2 / 4
+            // in absolute value, where K counts the cross terms, so its scaling by t/q
+            // is at most K * n * t * q / 4. The auxiliary base must hold twice that with
+            // room left for the quotient estimates in double precision; as in
+            // BaseConverter we reserve 32 bits for K * n.
+            int total_coeff_bit_count = accumulate(coeff_base.cbegin(), coeff_base.cend(), 0,
+                [](int result, auto &mod) { return result + mod.bit_count(); });
+            int aux_bit_count_needed = 32 + small_plain_mod.bit_count() + total_coeff_bit_count;
+            auto &aux_small_mods = global_variables::internal_mods::aux_small_mods;
+            int aux_bit_count = 0;
+            while (aux_bit_count < aux_bit_count_needed)
+            {
+                if (aux_base_mod_count_ == aux_small_mods.size())
+                {
+                    reset();
+                    return;
+                }
+                aux_bit_count += aux_small_mods[aux_base_mod_count_++].bit_count() - 1;
+            }
+
+            // Create moduli arrays
+            coeff_base_array_ = allocate<SmallModulus>(coeff_base_mod_count_, pool_);
+            aux_base_array_ = allocate<SmallModulus>(aux_base_mod_count_, pool_);
+            copy(coeff_base.cbegin(), coeff_base.cend(), coeff_base_array_.get());
+            copy_n(aux_small_mods.cbegin(), aux_base_mod_count_, aux_base_array_.get());
+
+            // Generate P small ntt tables which are used in Evaluator
+            aux_small_ntt_tables_ = allocate<SmallNTTTables>(aux_base_mod_count_, pool_);
+            for (size_t j = 0; j < aux_base_mod_count_; j++)
+            {
+                if (!aux_small_ntt_tables_[j].generate(coeff_count_power, aux_base_array_[j]))
+                {
+                    reset();
+                    return;
+                }
+            }
+
+            // Returns [prod_{i != skip} base[i]]_modulus, or the full product if skip
+            // is out of range
+            auto product_mod = [](const SmallModulus *base, size_t count, size_t skip,
+                const SmallModulus &modulus) {
+                uint64_t result = 1;
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (i != skip)
+                    {
+                        result = multiply_uint_uint_mod(result,
+                            barrett_reduce_64(base[i].value(), modulus), modulus);
+                    }
+                }
+                return result;
+            };
+
+            // Extension from q to P
+            inv_punctured_coeff_mod_coeff_array_ = allocate_uint(coeff_base_mod_count_, pool_);
+            inv_coeff_array_ = allocate<double>(coeff_base_mod_count_, pool_);
+            punctured_coeff_mod_aux_array_ = allocate_uint(
+                mul_safe(aux_base_mod_count_, coeff_base_mod_count_), pool_);
+            neg_coeff_mod_aux_array_ = allocate_uint(aux_base_mod_count_, pool_);
+            for (size_t i = 0; i < coeff_base_mod_count_; i++)
+            {
+                if (!try_invert_uint_mod(product_mod(coeff_base_array_.get(),
+                    coeff_base_mod_count_, i, coeff_base_array_[i]), coeff_base_array_[i],
+                    inv_punctured_coeff_mod_coeff_array_[i]))
+                {
+                    reset();
+                    return;
+                }
+                inv_coeff_array_[i] = 1.0 / static_cast<double>(coeff_base_array_[i].value());
+            }
+            for (size_t j = 0; j < aux_base_mod_count_; j++)
+            {
+                for (size_t i = 0; i < coeff_base_mod_count_; i++)
+                {
+                    punctured_coeff_mod_aux_array_[(j * coeff_base_mod_count_) + i] =
+                        product_mod(coeff_base_array_.get(), coeff_base_mod_count_, i,
+                            aux_base_array_[j]);
+                }
+                neg_coeff_mod_aux_array_[j] = negate_uint_mod(
+                    product_mod(coeff_base_array_.get(), coeff_base_mod_count_,
+                        coeff_base_mod_count_, aux_base_array_[j]), aux_base_array_[j]);
+            }
+
+            // Scaling by t/q in P. With r_i = [t*(q/q_i)^-1]_{q_i}, the scaled value
+            // is sum_i x_i * (r_i / q_i) plus an integer that is determined modulo
+            // every p_j by the integer parts -r_i * q_i^-1 and by t*q^-1.
+            scale_fraction_array_ = allocate_uint(mul_safe(coeff_base_mod_count_, size_t(2)), pool_);
+            scale_integer_mod_aux_array_ = allocate_uint(
+                mul_safe(aux_base_mod_count_, coeff_base_mod_count_), pool_);
+            plain_inv_coeff_mod_aux_array_ = allocate_uint(aux_base_mod_count_, pool_);
+            auto scale_remainder(allocate_uint(coeff_base_mod_count_, pool_));
+            for (size_t i = 0; i < coeff_base_mod_count_; i++)
+            {
+                scale_remainder[i] = multiply_uint_uint_mod(
+                    barrett_reduce_64(small_plain_mod.value(), coeff_base_array_[i]),
+                    inv_punctured_coeff_mod_coeff_array_[i], coeff_base_array_[i]);
+
+                // floor(r_i * 2^128 / q_i); the quotient is less than 2^128 because
+                // r_i < q_i
+                uint64_t numerator[3]{ 0, 0, scale_remainder[i] };
+                uint64_t quotient[3];
+                divide_uint192_uint64_inplace(numerator, coeff_base_array_[i].value(), quotient);
+                scale_fraction_array_[2 * i] = quotient[0];
+                scale_fraction_array_[(2 * i) + 1] = quotient[1];
+            }
+            for (size_t j = 0; j < aux_base_mod_count_; j++)
+            {
+                auto &aux_modulus = aux_base_array_[j];
+                for (size_t i = 0; i < coeff_base_mod_count_; i++)
+                {
+                    uint64_t inv_coeff;
+                    if (!try_invert_uint_mod(barrett_reduce_64(coeff_base_array_[i].value(),
+                        aux_modulus), aux_modulus, inv_coeff))
+                    {
+                        reset();
+                        return;
+                    }
+                    scale_integer_mod_aux_array_[(j * coeff_base_mod_count_) + i] =
+                        negate_uint_mod(multiply_uint_uint_mod(
+                            barrett_reduce_64(scale_remainder[i], aux_modulus),
+                            inv_coeff, aux_modulus), aux_modulus);
+                }
+                uint64_t inv_coeff_product;
+                if (!try_invert_uint_mod(product_mod(coeff_base_array_.get(),
+                    coeff_base_mod_count_, coeff_base_mod_count_, aux_modulus),
+                    aux_modulus, inv_coeff_product))
+                {
+                    reset();
+                    return;
+                }
+                plain_inv_coeff_mod_aux_array_[j] = multiply_uint_uint_mod(
+                    barrett_reduce_64(small_plain_mod.value(), aux_modulus),
+                    inv_coeff_product, aux_modulus);
+            }
+
+            // Extension from P to q
+            inv_punctured_aux_mod_aux_array_ = allocate_uint(aux_base_mod_count_, pool_);
+            inv_aux_array_ = allocate<double>(aux_base_mod_count_, pool_);
+            punctured_aux_mod_coeff_array_ = allocate_uint(
+                mul_safe(coeff_base_mod_count_, aux_base_mod_count_), pool_);
+            neg_aux_mod_coeff_array_ = allocate_uint(coeff_base_mod_count_, pool_);
+            for (size_t j = 0; j < aux_base_mod_count_; j++)
+            {
+                if (!try_invert_uint_mod(product_mod(aux_base_array_.get(),
+                    aux_base_mod_count_, j, aux_base_array_[j]), aux_base_array_[j],
+                    inv_punctured_aux_mod_aux_array_[j]))
+                {
+                    reset();
+                    return;
+                }
+                inv_aux_array_[j] = 1.0 / static_cast<double>(aux_base_array_[j].value());
+            }
+            for (size_t i = 0; i < coeff_base_mod_count_; i++)
+            {
+                for (size_t j = 0; j < aux_base_mod_count_; j++)
+                {
+                    punctured_aux_mod_coeff_array_[(i * aux_base_mod_count_) + j] =
+                        product_mod(aux_base_array_.get(), aux_base_mod_count_, j,
+                            coeff_base_array_[i]);
+                }
+                neg_aux_mod_coeff_array_[i] = negate_uint_mod(
+                    product_mod(aux_base_array_.get(), aux_base_mod_count_,
+                        aux_base_mod_count_, coeff_base_array_[i]), coeff_base_array_[i]);
+            }
+
+            generated_ = true;
+        }
+
+        void HPSConverter::reset() noexcept
+        {
+            generated_ = false;
+            coeff_base_mod_count_ = 0;
+            aux_base_mod_count_ = 0;
+            coeff_count_ = 0;
+            coeff_base_array_.release();
+            aux_base_array_.release();
+            aux_small_ntt_tables_.release();
+            inv_punctured_coeff_mod_coeff_array_.release();
+            inv_coeff_array_.release();
+            punctured_coeff_mod_aux_array_.release();
+            neg_coeff_mod_aux_array_.release();
+            scale_fraction_array_.release();
+            scale_integer_mod_aux_array_.release();
+            plain_inv_coeff_mod_aux_array_.release();
+            inv_punctured_aux_mod_aux_array_.release();
+            inv_aux_array_.release();
+            punctured_aux_mod_coeff_array_.release();
+            neg_aux_mod_coeff_array_.release();
+        }
+
+        void HPSConverter::convert(const uint64_t *input, const SmallModulus *from_base,
+            size_t from_count, const uint64_t *inv_punctured_products,
+            const double *inv_from_base, const SmallModulus *to_base, size_t to_count,
+            const uint64_t *punctured_products, const uint64_t *neg_products,
+            uint64_t *destination, MemoryPool &pool) const
+        {
+            // y_i = [x_i * (M/m_i)^-1]_{m_i}, stored coefficient by coefficient
+            auto temp(allocate_uint(mul_safe(coeff_count_, from_count), pool));
+            for (size_t i = 0; i < from_count; i++)
+            {
+                uint64_t inv_punctured_product = inv_punctured_products[i];
+                const SmallModulus &modulus = from_base[i];
+                uint64_t *temp_ptr = temp.get() + i;
+                for (size_t k = 0; k < coeff_count_; k++, input++, temp_ptr += from_count)
+                {
+                    *temp_ptr = multiply_uint_uint_mod(*input, inv_punctured_product, modulus);
+                }
+            }
+
+            // The sum of y_i * M/m_i exceeds the input by a multiple of M, which is
+            // floor(sum_i y_i/m_i); rounding instead gives the centered lift. The
+            // estimate is off only for inputs within a tiny distance of M/2.
+            auto quotient(allocate_uint(coeff_count_, pool));
+            const uint64_t *temp_ptr = temp.get();
+            for (size_t k = 0; k < coeff_count_; k++)
+            {
+                double sum = 0.0;
+                for (size_t i = 0; i < from_count; i++, temp_ptr++)
+                {
+                    sum += static_cast<double>(*temp_ptr) * inv_from_base[i];
+                }
+                quotient[k] = static_cast<uint64_t>(sum + 0.5);
+            }
+
+            for (size_t j = 0; j < to_count; j++)
+            {
+                const SmallModulus &modulus = to_base[j];
+                const uint64_t *punctured_products_row = punctured_products + (j * from_count);
+                temp_ptr = temp.get();
+                for (size_t k = 0; k < coeff_count_; k++, destination++)
+                {
+                    // Lazy reduction; the products are at most 61 + 61 bits and there
+                    // are at most 64 of them, and the quotient is at most 64
+                    unsigned long long accumulator[2];
+                    multiply_uint64(quotient[k], neg_products[j], accumulator);
+                    for (size_t i = 0; i < from_count; i++, temp_ptr++)
+                    {
+                        unsigned long long product[2];
+                        unsigned long long temp_sum;
+                        multiply_uint64(*temp_ptr, punctured_products_row[i], product);
+                        accumulator[1] += product[1] +
+                            add_uint64(accumulator[0], product[0], &temp_sum);
+                        accumulator[0] = temp_sum;
+                    }
+                    *destination = barrett_reduce_128(accumulator, modulus);
+                }
+            }
+        }
+
+        void HPSConverter::extend_to_aux(const uint64_t *input,
+            uint64_t *destination, MemoryPoolHandle pool) const
+        {
+#ifdef SEAL_DEBUG
+            if (input == nullptr)
+            {
+                throw invalid_argument("input cannot be null");
+            }
+            if (destination == nullptr)
+            {
+                throw invalid_argument("destination cannot be null");
+            }
+            if (!pool)
+            {
+                throw invalid_argument("pool is uninitialized");
+            }
+            if (!generated_)
+            {
+                throw logic_error("HPSConverter is not generated");
+            }
+#endif
+            convert(input, coeff_base_array_.get(), coeff_base_mod_count_,
+                inv_punctured_coeff_mod_coeff_array_.get(), inv_coeff_array_.get(),
+                aux_base_array_.get(), aux_base_mod_count_,
+                punctured_coeff_mod_aux_array_.get(), neg_coeff_mod_aux_array_.get(),
+                destination, pool);
+        }
+
+        void HPSConverter::scale_and_round(const uint64_t *input,
+            uint64_t *destination, MemoryPoolHandle pool) const
+        {
+#ifdef SEAL_DEBUG
+            if (input == nullptr)
+            {
+                throw invalid_argument("input cannot be null");
+            }
+            if (destination == nullptr)
+            {
+                throw invalid_argument("destination cannot be null");
+            }
+            if (!pool)
+            {
+                throw invalid_argument("pool is uninitialized");
+            }
+            if (!generated_)
+            {
+                throw logic_error("HPSConverter is not generated");
+            }
+#endif
+            /**
+             Require: Input in q U P
+             Ensure: Output round(t/q * input) in P, then extended to q
+            */
+            const uint64_t *input_aux = input + (coeff_count_ * coeff_base_mod_count_);
+
+            // The input in q stored coefficient by coefficient
+            auto temp(allocate_uint(mul_safe(coeff_count_, coeff_base_mod_count_), pool));
+            for (size_t i = 0; i < coeff_base_mod_count_; i++)
+            {
+                const uint64_t *input_ptr = input + (i * coeff_count_);
+                uint64_t *temp_ptr = temp.get() + i;
+                for (size_t k = 0; k < coeff_count_; k++, temp_ptr += coeff_base_mod_count_)
+                {
+                    *temp_ptr = *input_ptr++;
+                }
+            }
+
+            // Round the fractional part sum_i x_i * (r_i / q_i). Each product of a
+            // 60-bit x_i with a 128-bit fraction takes 192 bits, and the sum of up to
+            // 62 of them has an integer part of up to 66 bits, so the sum is kept in
+            // four words with the fraction in the lower two.
+            auto rounded(allocate_uint(mul_safe(coeff_count_, size_t(2)), pool));
+            const uint64_t *temp_ptr = temp.get();
+            for (size_t k = 0; k < coeff_count_; k++)
+            {
+                unsigned long long sum[4]{ 0, 0, 0, 0 };
+                const uint64_t *fraction_ptr = scale_fraction_array_.get();
+                for (size_t i = 0; i < coeff_base_mod_count_; i++, temp_ptr++, fraction_ptr += 2)
+                {
+                    unsigned long long product_low[2];
+                    unsigned long long product_high[2];
+                    unsigned long long temp_sum;
+                    multiply_uint64(*temp_ptr, fraction_ptr[0], product_low);
+                    multiply_uint64(*temp_ptr, fraction_ptr[1], product_high);
+                    unsigned char carry = add_uint64(sum[0], product_low[0], &temp_sum);
+                    sum[0] = temp_sum;
+                    carry = add_uint64(sum[1], product_low[1], carry, &temp_sum);
+                    unsigned char carry2 = add_uint64(temp_sum, product_high[0], &temp_sum);
+                    sum[1] = temp_sum;
+                    carry = add_uint64(sum[2], product_high[1], carry, &temp_sum);
+                    sum[3] += carry;
+                    carry2 = add_uint64(temp_sum, static_cast<uint64_t>(carry2), &temp_sum);
+                    sum[2] = temp_sum;
+                    sum[3] += carry2;
+                }
+                unsigned long long temp_sum;
+                unsigned char carry = add_uint64(sum[2], sum[1] >> 63, &temp_sum);
+                rounded[2 * k] = temp_sum;
+                rounded[(2 * k) + 1] = sum[3] + carry;
+            }
+
+            // Add the integer parts modulo every p_j
+            auto temp_aux(allocate_uint(mul_safe(coeff_count_, aux_base_mod_count_), pool));
+            uint64_t *temp_aux_ptr = temp_aux.get();
+            for (size_t j = 0; j < aux_base_mod_count_; j++)
+            {
+                const SmallModulus &modulus = aux_base_array_[j];
+                const uint64_t *integer_row =
+                    scale_integer_mod_aux_array_.get() + (j * coeff_base_mod_count_);
+                uint64_t plain_inv_coeff = plain_inv_coeff_mod_aux_array_[j];
+                const uint64_t *rounded_ptr = rounded.get();
+                temp_ptr = temp.get();
+                for (size_t k = 0; k < coeff_count_; k++, input_aux++, temp_aux_ptr++,
+                    rounded_ptr += 2)
+                {
+                    // Lazy reduction; the products are at most 60 + 61 bits and there
+                    // are at most 62 of them, plus one product of 61 + 61 bits
+                    unsigned long long accumulator[2];
+                    unsigned long long temp_sum;
+                    multiply_uint64(*input_aux, plain_inv_coeff, accumulator);
+                    accumulator[1] += add_uint64(accumulator[0],
+                        barrett_reduce_128(rounded_ptr, modulus), &temp_sum);
+                    accumulator[0] = temp_sum;
+                    for (size_t i = 0; i < coeff_base_mod_count_; i++, temp_ptr++)
+                    {
+                        unsigned long long product[2];
+                        multiply_uint64(*temp_ptr, integer_row[i], product);
+                        accumulator[1] += product[1] +
+                            add_uint64(accumulator[0], product[0], &temp_sum);
+                        accumulator[0] = temp_sum;
+                    }
+                    *temp_aux_ptr = barrett_reduce_128(accumulator, modulus);
+                }
+            }
+
+            // The scaled value is small enough relative to P for its centered lift
+            // to be exact
+            convert(temp_aux.get(), aux_base_array_.get(), aux_base_mod_count_,
+                inv_punctured_aux_mod_aux_array_.get(), inv_aux_array_.get(),
+                coeff_base_array_.get(), coeff_base_mod_count_,
+                punctured_aux_mod_coeff_array_.get(), neg_aux_mod_coeff_array_.get(),
+                destination, pool);
+        }
+    }
+}
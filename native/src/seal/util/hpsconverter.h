@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include "seal/util/pointer.h"
+#include "seal/memorymanager.h"
+#include "seal/smallmodulus.h"
+#include "seal/util/smallntt.h"
+
+namespace seal
+{
+    namespace util
+    {
+        /**
+        Pre-computations and base conversions for the BFV multiplication of
+        Halevi, Polyakov, and Shoup. The tensor product is computed in the base
+        q U P, where the auxiliary base P is large enough to hold the product of
+        two centered ciphertexts scaled by t/q, and is then scaled down to q
+        without the Montgomery reduction and the extra moduli of BEHZ. The
+        quotients of the base extensions are estimated in double precision; the
+        fractions of the scaling step use 128-bit fixed point so that the result
+        is rounded exactly.
+        */
+        class HPSConverter
+        {
+        public:
+            HPSConverter(MemoryPoolHandle pool) : pool_(std::move(pool))
+            {
+                if (!pool_)
+                {
+                    throw std::invalid_argument("pool is uninitialized");
+                }
+            }
+
+            HPSConverter(const std::vector<SmallModulus> &coeff_base,
+                std::size_t coeff_count, const SmallModulus &small_plain_mod,
+                MemoryPoolHandle pool);
+
+            /**
+            Generates the pre-computations for the given parameters.
+            */
+            void generate(const std::vector<SmallModulus> &coeff_base,
+                std::size_t coeff_count, const SmallModulus &small_plain_mod);
+
+            /**
+            Base extension from q to P: writes the centered lift of a polynomial
+            given in q to P
+            */
+            void extend_to_aux(const std::uint64_t *input,
+                std::uint64_t *destination, MemoryPoolHandle pool) const;
+
+            /**
+            BFV multiplication scaling: computes round(t/q * input) in q for a
+            polynomial given in q U P, with the q part first
+            */
+            void scale_and_round(const std::uint64_t *input,
+                std::uint64_t *destination, MemoryPoolHandle pool) const;
+
+            void reset() noexcept;
+
+            inline auto is_generated() const noexcept
+            {
+                return generated_;
+            }
+
+            inline auto coeff_base_mod_count() const noexcept
+            {
+                return coeff_base_mod_count_;
+            }
+
+            inline auto aux_base_mod_count() const noexcept
+            {
+                return aux_base_mod_count_;
+            }
+
+            inline auto &get_aux_mod_array() const noexcept
+            {
+                return aux_base_array_;
+            }
+
+            inline auto &get_aux_small_ntt_tables() const noexcept
+            {
+                return aux_small_ntt_tables_;
+            }
+
+        private:
+            HPSConverter(const HPSConverter &copy) = delete;
+
+            HPSConverter(HPSConverter &&source) = delete;
+
+            HPSConverter &operator =(const HPSConverter &assign) = delete;
+
+            HPSConverter &operator =(HPSConverter &&assign) = delete;
+
+            // Converts the centered lift of the product of the input with the
+            // punctured products of from_base to to_base;
+            // inv_punctured_products holds [(M/m_i)^-1]_{m_i}, punctured_products
+            // holds [M/m_i]_{to_j} row by row, and neg_products holds [-M]_{to_j}
+            void convert(const std::uint64_t *input, const SmallModulus *from_base,
+                std::size_t from_count, const std::uint64_t *inv_punctured_products,
+                const double *inv_from_base, const SmallModulus *to_base,
+                std::size_t to_count, const std::uint64_t *punctured_products,
+                const std::uint64_t *neg_products, std::uint64_t *destination,
+                MemoryPool &pool) const;
+
+            MemoryPoolHandle pool_;
+
+            bool generated_ = false;
+
+            std::size_t coeff_base_mod_count_ = 0;
+
+            std::size_t aux_base_mod_count_ = 0;
+
+            std::size_t coeff_count_ = 0;
+
+            Pointer<SmallModulus> coeff_base_array_;
+
+            Pointer<SmallModulus> aux_base_array_;
+
+            Pointer<SmallNTTTables> aux_small_ntt_tables_;
+
+            // Extension from q to P
+            Pointer<std::uint64_t> inv_punctured_coeff_mod_coeff_array_;
+
+            Pointer<double> inv_coeff_array_;
+
+            Pointer<std::uint64_t> punctured_coeff_mod_aux_array_;
+
+            Pointer<std::uint64_t> neg_coeff_mod_aux_array_;
+
+            // Scaling by t/q in P: [t*(q/q_i)^-1]_{q_i} / q_i in 128-bit fixed
+            // point, the integer parts -[t*(q/q_i)^-1]_{q_i} * q_i^-1 mod p_j, and
+            // t*q^-1 mod p_j
+            Pointer<std::uint64_t> scale_fraction_array_;
+
+            Pointer<std::uint64_t> scale_integer_mod_aux_array_;
+
+            Pointer<std::uint64_t> plain_inv_coeff_mod_aux_array_;
+
+            // Extension from P to q
+            Pointer<std::uint64_t> inv_punctured_aux_mod_aux_array_;
+
+            Pointer<double> inv_aux_array_;
+
+            Pointer<std::uint64_t> punctured_aux_mod_coeff_array_;
+
+            Pointer<std::uint64_t> neg_aux_mod_coeff_array_;
+        };
+    }
+}
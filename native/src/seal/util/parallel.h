@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace seal
+{
+    namespace util
+    {
+        /**
+        Returns the number of hardware threads, or 1 if it cannot be determined.
+        */
+        inline std::size_t hardware_thread_count() noexcept
+        {
+            std::size_t thread_count = std::thread::hardware_concurrency();
+            return thread_count ? thread_count : 1;
+        }
+
+        /**
+        Splits the range [0, count) into at most thread_count contiguous ranges
+        and calls f(begin, end) for each of them in a separate thread. The calling
+        thread processes the first range itself. A thread_count of zero means
+        hardware_thread_count(). Giving each call a whole range allows f to set
+        up scratch memory and random number generators once per thread. If a
+        thread cannot be started, the calling thread processes its range. If any
+        call throws, the first exception is rethrown after all threads are joined.
+        */
+        template<typename F>
+        void parallel_for(std::size_t count, std::size_t thread_count, F &&f)
+        {
+            if (!thread_count)
+            {
+                thread_count = hardware_thread_count();
+            }
+            thread_count = std::min(thread_count, count);
+            if (thread_count <= 1)
+            {
+                if (count)
+                {
+                    f(std::size_t(0), count);
+                }
+                return;
+            }
+
+            std::vector<std::exception_ptr> errors(thread_count);
+            auto run = [&](std::size_t thread_index) {
+                std::size_t begin = count * thread_index / thread_count;
+                std::size_t end = count * (thread_index + 1) / thread_count;
+                try
+                {
+                    f(begin, end);
+                }
+                catch (...)
+                {
+                    errors[thread_index] = std::current_exception();
+                }
+            };
+
+            // If a thread cannot be started, the calling thread processes the
+            // ranges that have no thread; the threads already started must be
+            // joined in any case
+            std::vector<std::thread> threads;
+            threads.reserve(thread_count - 1);
+            std::size_t started_count = 1;
+            try
+            {
+                for (; started_count < thread_count; started_count++)
+                {
+                    threads.emplace_back(run, started_count);
+                }
+            }
+            catch (...)
+            {
+                // std::system_error if the system is out of threads, or
+                // std::bad_alloc; destroying joinable threads would terminate
+            }
+            run(0);
+            for (std::size_t i = started_count; i < thread_count; i++)
+            {
+                run(i);
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+            for (auto &error : errors)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+    }
+}
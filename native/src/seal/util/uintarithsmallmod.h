@@ -143,6 +143,27 @@ namespace seal
                 (modulus.value() & static_cast<std::uint64_t>(-borrow));
         }
 
+        inline std::uint64_t barrett_reduce_64(std::uint64_t input,
+            const SmallModulus &modulus)
+        {
+#ifdef SEAL_DEBUG
+            if (modulus.is_zero())
+            {
+                throw std::invalid_argument("modulus");
+            }
+#endif
+            // Reduces input using base 2^64 Barrett reduction with the high
+            // word of const_ratio, which underestimates the quotient by at
+            // most one for any 64-bit input
+            unsigned long long tmp;
+            multiply_uint64_hw64(input, modulus.const_ratio()[1], &tmp);
+            std::uint64_t result = input - tmp * modulus.value();
+
+            // One more subtraction is enough
+            return result - (modulus.value() & static_cast<std::uint64_t>(
+                -static_cast<std::int64_t>(result >= modulus.value())));
+        }
+
         template<typename T, typename = std::enable_if<is_uint64_v<T>>>
         inline std::uint64_t barrett_reduce_128(const T *input, 
             const SmallModulus &modulus)
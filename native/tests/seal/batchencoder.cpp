@@ -174,4 +174,86 @@ namespace SEALTest
             ASSERT_TRUE(short_plain[i] == 0);
         }
     }
+
+    TEST(BatchEncoderTest, BatchUnbatchMany)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0) });
+        parms.set_plain_modulus(257);
+
+        auto context = SEALContext::Create(parms);
+        BatchEncoder batch_encoder(context);
+        size_t slot_count = batch_encoder.slot_count();
+
+        vector<vector<uint64_t>> values(7);
+        vector<vector<int64_t>> signed_values(7);
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            // Also matrices shorter than the slot count
+            size_t size = slot_count - 3 * i;
+            for (size_t j = 0; j < size; j++)
+            {
+                values[i].push_back((i * 13 + j * 5) % 257);
+                signed_values[i].push_back(static_cast<int64_t>((i * 13 + j * 5) % 257) - 128);
+            }
+        }
+
+        for (size_t thread_count : { 0, 1, 3 })
+        {
+            vector<Plaintext> plains;
+            batch_encoder.encode(values, plains, thread_count);
+            vector<Plaintext> signed_plains;
+            batch_encoder.encode(signed_values, signed_plains, thread_count);
+            ASSERT_EQ(values.size(), plains.size());
+            ASSERT_EQ(values.size(), signed_plains.size());
+
+            vector<vector<uint64_t>> decoded;
+            batch_encoder.decode(plains, decoded, thread_count);
+            vector<vector<int64_t>> signed_decoded;
+            batch_encoder.decode(signed_plains, signed_decoded, thread_count);
+            ASSERT_EQ(values.size(), decoded.size());
+            ASSERT_EQ(values.size(), signed_decoded.size());
+
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                Plaintext plain;
+                batch_encoder.encode(values[i], plain);
+                ASSERT_TRUE(plain == plains[i]);
+                batch_encoder.encode(signed_values[i], plain);
+                ASSERT_TRUE(plain == signed_plains[i]);
+
+                // Encoding in place gives the same plaintext
+                Plaintext in_place(values[i].size());
+                for (size_t j = 0; j < values[i].size(); j++)
+                {
+                    in_place[j] = values[i][j];
+                }
+                batch_encoder.encode(in_place);
+                ASSERT_TRUE(in_place == plains[i]);
+
+                vector<uint64_t> expected(values[i]);
+                expected.resize(slot_count, 0);
+                ASSERT_TRUE(expected == decoded[i]);
+                vector<int64_t> signed_expected(signed_values[i]);
+                signed_expected.resize(slot_count, 0);
+                ASSERT_TRUE(signed_expected == signed_decoded[i]);
+
+                batch_encoder.decode(in_place);
+                for (size_t j = 0; j < slot_count; j++)
+                {
+                    ASSERT_EQ(expected[j], in_place[j]);
+                }
+            }
+        }
+
+        vector<vector<uint64_t>> too_large{ vector<uint64_t>(slot_count + 1) };
+        vector<Plaintext> plains;
+        ASSERT_THROW(batch_encoder.encode(too_large, plains), logic_error);
+
+        plains.resize(2);
+        plains[1].parms_id() = parms.parms_id();
+        vector<vector<uint64_t>> decoded;
+        ASSERT_THROW(batch_encoder.decode(plains, decoded), invalid_argument);
+    }
 }
@@ -0,0 +1,229 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/context.h"
+#include "seal/ciphertextaccumulator.h"
+#include "seal/encryptor.h"
+#include "seal/decryptor.h"
+#include "seal/evaluator.h"
+#include "seal/keygenerator.h"
+#include "seal/intencoder.h"
+#include "seal/ckks.h"
+#include "seal/defaultparams.h"
+#include "tempfile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace
+    {
+        bool are_equal(const Ciphertext &encrypted1, const Ciphertext &encrypted2)
+        {
+            return encrypted1.parms_id() == encrypted2.parms_id() &&
+                encrypted1.size() == encrypted2.size() &&
+                encrypted1.is_ntt_form() == encrypted2.is_ntt_form() &&
+                equal(encrypted1.data(), encrypted1.data() + encrypted1.uint64_count(),
+                    encrypted2.data());
+        }
+    }
+
+    TEST(CiphertextAccumulatorTest, FVAddMany)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 12);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        IntegerEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+
+        CiphertextAccumulator accumulator(context);
+        ASSERT_TRUE(accumulator.empty());
+        ASSERT_EQ(0ULL, accumulator.term_budget());
+        Ciphertext sum;
+        ASSERT_THROW(accumulator.reduce(sum), logic_error);
+
+        // More terms than fit into the 128-bit accumulators with 60-bit primes
+        Ciphertext encrypted, expected;
+        for (uint64_t i = 0; i < 600; i++)
+        {
+            encryptor.encrypt(encoder.encode(i % 7), encrypted);
+            if (i == 300)
+            {
+                evaluator.square_inplace(encrypted);
+            }
+            accumulator.add(encrypted);
+            if (i)
+            {
+                evaluator.add_inplace(expected, encrypted);
+            }
+            else
+            {
+                expected = encrypted;
+                ASSERT_LE(256ULL, accumulator.term_budget());
+                ASSERT_GT(300ULL, accumulator.term_budget());
+            }
+        }
+        ASSERT_EQ(600ULL, accumulator.term_count());
+        accumulator.reduce(sum);
+        ASSERT_TRUE(are_equal(expected, sum));
+
+        Plaintext plain;
+        decryptor.decrypt(sum, plain);
+        ASSERT_EQ(static_cast<uint64_t>(1795 - 6 + 36), encoder.decode_uint64(plain));
+
+        // Terms at other levels or in NTT form are not accepted
+        Ciphertext encrypted_low;
+        evaluator.mod_switch_to_next(encrypted, encrypted_low);
+        ASSERT_THROW(accumulator.add(encrypted_low), invalid_argument);
+        evaluator.transform_to_ntt_inplace(encrypted);
+        ASSERT_THROW(accumulator.add(encrypted), invalid_argument);
+
+        accumulator.clear();
+        ASSERT_TRUE(accumulator.empty());
+        accumulator.add(encrypted_low);
+        accumulator.reduce(sum);
+        ASSERT_TRUE(are_equal(encrypted_low, sum));
+    }
+
+    TEST(CiphertextAccumulatorTest, FVInnerProduct)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+
+        vector<Ciphertext> encrypteds(300);
+        vector<Plaintext> plains(encrypteds.size());
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            Plaintext plain(2);
+            plain[0] = i % 3;
+            plain[1] = 1;
+            encryptor.encrypt(plain, encrypteds[i]);
+            evaluator.transform_to_ntt_inplace(encrypteds[i]);
+            plains[i] = Plaintext(3);
+            plains[i][2] = i % 2;
+            plains[i][0] = 1;
+            evaluator.transform_to_ntt_inplace(plains[i], parms.parms_id());
+        }
+
+        // Two accumulators over halves of the terms give the same sum
+        CiphertextAccumulator accumulator1(context), accumulator2(context);
+        Ciphertext expected, product;
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            (i < 200 ? accumulator1 : accumulator2).multiply_plain_add(encrypteds[i], plains[i]);
+            evaluator.multiply_plain(encrypteds[i], plains[i], product);
+            if (i)
+            {
+                evaluator.add_inplace(expected, product);
+            }
+            else
+            {
+                expected = product;
+            }
+        }
+        accumulator1.add(accumulator2);
+        ASSERT_EQ(300ULL, accumulator1.term_count());
+        ASSERT_TRUE(accumulator1.is_ntt_form());
+        Ciphertext sum;
+        accumulator1.reduce(sum);
+        ASSERT_TRUE(are_equal(expected, sum));
+
+        // Merging an accumulator into itself doubles the sum and the term count
+        accumulator1.add(accumulator1);
+        ASSERT_EQ(600ULL, accumulator1.term_count());
+        accumulator1.reduce(sum);
+        Ciphertext doubled;
+        evaluator.add(expected, expected, doubled);
+        ASSERT_TRUE(are_equal(doubled, sum));
+
+        // The same products with the plaintexts read from a database
+        TempFile file("ciphertextaccumulator_test.dat");
+        PlaintextDatabase::Build(context, parms.parms_id(), plains, file.path(), 1);
+        {
+            PlaintextDatabase database(context, file.path());
+            CiphertextAccumulator accumulator(context);
+            for (size_t i = 0; i < encrypteds.size(); i++)
+            {
+                accumulator.multiply_plain_add(encrypteds[i], database, i);
+            }
+            accumulator.reduce(sum);
+            ASSERT_TRUE(are_equal(expected, sum));
+        }
+
+        evaluator.transform_from_ntt_inplace(sum);
+        Plaintext plain;
+        decryptor.decrypt(sum, plain);
+        evaluator.transform_from_ntt_inplace(expected);
+        Plaintext expected_plain;
+        decryptor.decrypt(expected, expected_plain);
+        ASSERT_TRUE(plain == expected_plain);
+
+        // Ciphertexts must be in NTT form
+        ASSERT_THROW(accumulator1.multiply_plain_add(expected, plains[0]), invalid_argument);
+    }
+
+    TEST(CiphertextAccumulatorTest, CKKSInnerProduct)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        CiphertextAccumulator accumulator(context);
+        double delta = pow(2.0, 30);
+        Plaintext plain;
+        Ciphertext encrypted;
+        for (int i = 0; i < 10; i++)
+        {
+            encoder.encode(static_cast<double>(i), delta, plain);
+            encryptor.encrypt(plain, encrypted);
+            encoder.encode(0.5, delta, plain);
+            accumulator.multiply_plain_add(encrypted, plain);
+        }
+        ASSERT_EQ(delta * delta, accumulator.scale());
+
+        Ciphertext sum;
+        vector<double> result;
+        accumulator.reduce(sum);
+        decryptor.decrypt(sum, plain);
+        encoder.decode(plain, result);
+        for (auto value : result)
+        {
+            ASSERT_NEAR(22.5, value, 0.01);
+        }
+
+        // The scales of all terms must agree
+        ASSERT_THROW(accumulator.add(encrypted), invalid_argument);
+        encoder.encode(0.5, delta * 2, plain);
+        ASSERT_THROW(accumulator.multiply_plain_add(encrypted, plain), invalid_argument);
+    }
+}
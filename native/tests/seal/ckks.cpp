@@ -8,6 +8,7 @@
 #include "seal/keygenerator.h"
 #include <vector>
 #include <ctime>
+#include <random>
 
 using namespace seal;
 using namespace seal::util;
@@ -368,4 +369,57 @@ namespace SEALTest
             }
         }
     }
+
+    TEST(CKKSEncoderTest, CKKSEncoderDecodeManyPrimesTest)
+    {
+        // The coefficients are small enough for the floating-point CRT with the
+        // smaller scales and need exact composition with the larger ones
+        EncryptionParameters parms(scheme_type::CKKS);
+        size_t slots = 32;
+        parms.set_poly_modulus_degree(2 * slots);
+        vector<SmallModulus> coeff_modulus;
+        for (size_t i = 0; i < 10; i++)
+        {
+            coeff_modulus.push_back(DefaultParams::small_mods_60bit(i));
+        }
+        parms.set_coeff_modulus(coeff_modulus);
+        auto context = SEALContext::Create(parms);
+        CKKSEncoder encoder(context);
+
+        // A fixed seed keeps failures reproducible
+        mt19937 engine(1729);
+        int data_bound = (1 << 20);
+        uniform_int_distribution<int> dist(-data_bound / 2, data_bound / 2 - 1);
+        vector<complex<double>> values(slots);
+        for (size_t i = 0; i < slots; i++)
+        {
+            values[i] = complex<double>(
+                static_cast<double>(dist(engine)), static_cast<double>(dist(engine)));
+        }
+
+        for (int log_scale : { 30, 60, 100, 120, 200, 400 })
+        {
+            Plaintext plain;
+            encoder.encode(values, parms.parms_id(), pow(2.0, log_scale), plain);
+            vector<complex<double>> result;
+            encoder.decode(plain, result);
+            ASSERT_EQ(slots, result.size());
+            for (size_t i = 0; i < slots; i++)
+            {
+                ASSERT_NEAR(values[i].real(), result[i].real(), 0.0001);
+                ASSERT_NEAR(values[i].imag(), result[i].imag(), 0.0001);
+            }
+
+            // Decoding at a lower level
+            auto next_parms_id = context->context_data()->
+                next_context_data()->parms().parms_id();
+            encoder.encode(values, next_parms_id, pow(2.0, log_scale), plain);
+            encoder.decode(plain, result);
+            for (size_t i = 0; i < slots; i++)
+            {
+                ASSERT_NEAR(values[i].real(), result[i].real(), 0.0001);
+                ASSERT_NEAR(values[i].imag(), result[i].imag(), 0.0001);
+            }
+        }
+    }
 }
@@ -6,13 +6,17 @@
 #include "seal/encryptor.h"
 #include "seal/decryptor.h"
 #include "seal/keygenerator.h"
+#include "seal/evaluator.h"
 #include "seal/batchencoder.h"
 #include "seal/ckks.h"
 #include "seal/intencoder.h"
 #include "seal/defaultparams.h"
+#include "seal/util/uintarithsmallmod.h"
+#include <algorithm>
 #include <cstdint>
 #include <cstddef>
 #include <ctime>
+#include <thread>
 
 using namespace seal;
 using namespace std;
@@ -397,4 +401,375 @@ namespace SEALTest
             }
         }
     }
+
+    TEST(EncryptorTest, FVEncryptBatch)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(128);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        IntegerEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        vector<Plaintext> plains;
+        for (uint64_t i = 0; i < 7; i++)
+        {
+            plains.emplace_back(encoder.encode(0x12345678 + i));
+        }
+        for (size_t thread_count : { 0, 1, 3, 16 })
+        {
+            vector<Ciphertext> encrypted(2);
+            encryptor.encrypt(plains, encrypted, thread_count);
+            ASSERT_EQ(plains.size(), encrypted.size());
+            for (size_t i = 0; i < plains.size(); i++)
+            {
+                Plaintext plain;
+                ASSERT_TRUE(encrypted[i].parms_id() == parms.parms_id());
+                ASSERT_FALSE(encrypted[i].is_ntt_form());
+                decryptor.decrypt(encrypted[i], plain);
+                ASSERT_EQ(0x12345678ULL + i, encoder.decode_uint64(plain));
+            }
+        }
+
+        vector<Ciphertext> encrypted;
+        encryptor.encrypt(vector<Plaintext>{}, encrypted);
+        ASSERT_TRUE(encrypted.empty());
+
+        plains.back().resize(parms.poly_modulus_degree() + 1);
+        ASSERT_THROW(encryptor.encrypt(plains, encrypted), invalid_argument);
+        ASSERT_TRUE(encrypted.empty());
+    }
+
+    TEST(EncryptorTest, CKKSEncryptBatch)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        // Plaintexts at different levels
+        auto next_parms_id = context->context_data()->next_context_data()->parms().parms_id();
+        vector<Plaintext> plains(5);
+        for (size_t i = 0; i < plains.size(); i++)
+        {
+            encoder.encode(static_cast<double>(i) + 0.5,
+                (i % 2) ? next_parms_id : parms.parms_id(), pow(2.0, 30), plains[i]);
+        }
+
+        vector<Ciphertext> encrypted;
+        encryptor.encrypt(plains, encrypted, 2);
+        ASSERT_EQ(plains.size(), encrypted.size());
+        for (size_t i = 0; i < plains.size(); i++)
+        {
+            ASSERT_TRUE(encrypted[i].parms_id() == plains[i].parms_id());
+            ASSERT_TRUE(encrypted[i].is_ntt_form());
+            ASSERT_EQ(plains[i].scale(), encrypted[i].scale());
+
+            Plaintext plain;
+            vector<double> result;
+            decryptor.decrypt(encrypted[i], plain);
+            encoder.decode(plain, result);
+            ASSERT_NEAR(static_cast<double>(i) + 0.5, result[0], 0.01);
+        }
+    }
+
+    TEST(EncryptorTest, FVDecryptBatch)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(257);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        BatchEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+
+        // The last ciphertext has size 3 and needs the square of the secret key
+        vector<Ciphertext> encrypted(5);
+        for (size_t i = 0; i < encrypted.size(); i++)
+        {
+            vector<uint64_t> values(encoder.slot_count());
+            for (size_t j = 0; j < values.size(); j++)
+            {
+                values[j] = (i * 31 + j * 7) % 257;
+            }
+            Plaintext plain;
+            encoder.encode(values, plain);
+            encryptor.encrypt(plain, encrypted[i]);
+        }
+        evaluator.square_inplace(encrypted.back());
+        ASSERT_EQ(3ULL, encrypted.back().size());
+
+        for (size_t thread_count : { 0, 1, 2, 16 })
+        {
+            vector<Plaintext> decrypted(1);
+            decryptor.decrypt(encrypted, decrypted, thread_count);
+            vector<vector<uint64_t>> decoded;
+            decryptor.decrypt_decode(encrypted, encoder, decoded, thread_count);
+            vector<vector<int64_t>> decoded_signed;
+            decryptor.decrypt_decode(encrypted, encoder, decoded_signed, thread_count);
+            ASSERT_EQ(encrypted.size(), decrypted.size());
+            ASSERT_EQ(encrypted.size(), decoded.size());
+            ASSERT_EQ(encrypted.size(), decoded_signed.size());
+            for (size_t i = 0; i < encrypted.size(); i++)
+            {
+                Plaintext plain;
+                decryptor.decrypt(encrypted[i], plain);
+                ASSERT_TRUE(plain == decrypted[i]);
+
+                vector<uint64_t> expected;
+                encoder.decode(plain, expected);
+                ASSERT_TRUE(expected == decoded[i]);
+                vector<int64_t> expected_signed;
+                encoder.decode(plain, expected_signed);
+                ASSERT_TRUE(expected_signed == decoded_signed[i]);
+
+                vector<uint64_t> result;
+                decryptor.decrypt_decode(encrypted[i], encoder, result);
+                ASSERT_TRUE(expected == result);
+            }
+        }
+
+        vector<Plaintext> decrypted;
+        decryptor.decrypt(vector<Ciphertext>{}, decrypted);
+        ASSERT_TRUE(decrypted.empty());
+
+        // An encoder for other encryption parameters is rejected
+        parms.set_plain_modulus(769);
+        BatchEncoder other_encoder(SEALContext::Create(parms));
+        vector<uint64_t> result;
+        ASSERT_THROW(decryptor.decrypt_decode(encrypted[0], other_encoder, result),
+            invalid_argument);
+
+        encrypted.back().parms_id() = parms_id_zero;
+        ASSERT_THROW(decryptor.decrypt(encrypted, decrypted), invalid_argument);
+        ASSERT_TRUE(decrypted.empty());
+    }
+
+    TEST(EncryptorTest, FVInvariantNoiseBudget)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(257);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        Decryptor decryptor(context, keygen.secret_key());
+        size_t coeff_count = parms.poly_modulus_degree();
+
+        // With c_1 = 0 the noise is [t * c_0]_q, so setting c_0 to t^(-1) * x
+        // gives a ciphertext whose scaled noise is exactly x
+        auto noise_ciphertext = [&](parms_id_type parms_id, int bit_count,
+            bool negative, Ciphertext &destination) {
+            auto &coeff_modulus = context->context_data(parms_id)->parms().coeff_modulus();
+            destination.resize(context, parms_id, 2);
+            destination.is_ntt_form() = false;
+            fill(destination.data(), destination.data() + destination.uint64_count(), 0);
+            for (size_t j = 0; j < coeff_modulus.size(); j++)
+            {
+                auto &modulus = coeff_modulus[j];
+                uint64_t inv_plain;
+                ASSERT_TRUE(util::try_invert_uint_mod(
+                    parms.plain_modulus().value(), modulus, inv_plain));
+
+                // 2^bit_count - 1 in the last coefficient and a smaller value
+                // in the first one
+                uint64_t power = 1;
+                for (int k = 0; k < bit_count; k++)
+                {
+                    power = (power + power) % modulus.value();
+                }
+                uint64_t value = (power + modulus.value() - 1) % modulus.value();
+                if (negative)
+                {
+                    value = util::negate_uint_mod(value, modulus);
+                }
+                destination.data()[(j + 1) * coeff_count - 1] =
+                    util::multiply_uint_uint_mod(value, inv_plain, modulus);
+                destination.data()[j * coeff_count] =
+                    util::multiply_uint_uint_mod(5, inv_plain, modulus);
+            }
+        };
+
+        vector<Ciphertext> encrypted;
+        vector<int> expected;
+        for (auto context_data = context->context_data(); context_data;
+            context_data = context_data->next_context_data())
+        {
+            int total_bit_count = context_data->total_coeff_modulus_bit_count();
+            for (int bit_count = 1; bit_count < total_bit_count - 1; bit_count++)
+            {
+                for (bool negative : { false, true })
+                {
+                    Ciphertext ciphertext;
+                    noise_ciphertext(context_data->parms().parms_id(), bit_count,
+                        negative, ciphertext);
+                    int noise_bit_count = max(bit_count, 3);
+                    int expected_budget = max(0, total_bit_count - noise_bit_count - 1);
+                    ASSERT_EQ(expected_budget, decryptor.invariant_noise_budget(ciphertext));
+                    encrypted.push_back(move(ciphertext));
+                    expected.push_back(expected_budget);
+                }
+            }
+        }
+
+        // Fresh and multiplied ciphertexts, including one of size 3 below the
+        // first level
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Ciphertext fresh;
+        encryptor.encrypt(Plaintext("1x^10 + 2x^3 + 3"), fresh);
+        Ciphertext squared;
+        evaluator.square(fresh, squared);
+        Ciphertext switched;
+        evaluator.mod_switch_to_next(fresh, switched);
+        evaluator.square_inplace(switched);
+        ASSERT_EQ(3ULL, switched.size());
+        for (auto &ciphertext : { fresh, squared, switched })
+        {
+            int budget = decryptor.invariant_noise_budget(ciphertext);
+            ASSERT_TRUE(budget > 0);
+            encrypted.push_back(ciphertext);
+            expected.push_back(budget);
+        }
+        ASSERT_TRUE(expected[expected.size() - 3] > expected[expected.size() - 2]);
+
+        for (size_t thread_count : { 0, 1, 3 })
+        {
+            vector<int> budgets;
+            decryptor.invariant_noise_budget(encrypted, budgets, thread_count);
+            ASSERT_TRUE(expected == budgets);
+        }
+
+        encrypted.back().parms_id() = parms_id_zero;
+        vector<int> budgets;
+        ASSERT_THROW(decryptor.invariant_noise_budget(encrypted, budgets),
+            invalid_argument);
+    }
+
+    TEST(EncryptorTest, FVDecryptConcurrent)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        IntegerEncoder encoder(context);
+
+        ASSERT_THROW(Decryptor(context, keygen.secret_key(), 0), invalid_argument);
+
+        // Ciphertexts of sizes 2, 3 and 4
+        vector<Ciphertext> encrypted(3);
+        encryptor.encrypt(encoder.encode(3), encrypted[0]);
+        evaluator.square(encrypted[0], encrypted[1]);
+        evaluator.multiply(encrypted[1], encrypted[0], encrypted[2]);
+        ASSERT_EQ(4ULL, encrypted[2].size());
+        vector<uint64_t> expected{ 3, 9, 27 };
+
+        // Threads sharing one Decryptor extend the secret key powers
+        // concurrently, with and without precomputed powers
+        for (size_t max_power : { 1, 3 })
+        {
+            Decryptor decryptor(context, keygen.secret_key(), max_power);
+            vector<thread> threads;
+            vector<int> failures(8, 0);
+            for (size_t t = 0; t < failures.size(); t++)
+            {
+                threads.emplace_back([&, t] {
+                    auto pool = MemoryPoolHandle::New();
+                    for (size_t i = 0; i < 30; i++)
+                    {
+                        size_t index = (i + t) % encrypted.size();
+                        Plaintext plain(pool);
+                        decryptor.decrypt(encrypted[index], plain);
+                        if (encoder.decode_uint64(plain) != expected[index])
+                        {
+                            failures[t]++;
+                        }
+                    }
+                });
+            }
+            for (auto &worker : threads)
+            {
+                worker.join();
+            }
+            ASSERT_TRUE(all_of(failures.begin(), failures.end(),
+                [](int count) { return count == 0; }));
+        }
+    }
+
+    TEST(EncryptorTest, CKKSDecryptBatch)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        // Ciphertexts at different levels
+        auto next_parms_id = context->context_data()->next_context_data()->parms().parms_id();
+        vector<Ciphertext> encrypted(5);
+        for (size_t i = 0; i < encrypted.size(); i++)
+        {
+            Plaintext plain;
+            encoder.encode(static_cast<double>(i) + 0.5,
+                (i % 2) ? next_parms_id : parms.parms_id(), pow(2.0, 30), plain);
+            encryptor.encrypt(plain, encrypted[i]);
+        }
+
+        vector<Plaintext> decrypted;
+        decryptor.decrypt(encrypted, decrypted, 2);
+        vector<vector<double>> decoded;
+        decryptor.decrypt_decode(encrypted, encoder, decoded, 2);
+        vector<vector<complex<double>>> decoded_complex;
+        decryptor.decrypt_decode(encrypted, encoder, decoded_complex, 3);
+        ASSERT_EQ(encrypted.size(), decrypted.size());
+        ASSERT_EQ(encrypted.size(), decoded.size());
+        ASSERT_EQ(encrypted.size(), decoded_complex.size());
+        for (size_t i = 0; i < encrypted.size(); i++)
+        {
+            Plaintext plain;
+            decryptor.decrypt(encrypted[i], plain);
+            ASSERT_TRUE(plain == decrypted[i]);
+            ASSERT_TRUE(decrypted[i].parms_id() == encrypted[i].parms_id());
+            ASSERT_EQ(encrypted[i].scale(), decrypted[i].scale());
+
+            vector<double> expected;
+            encoder.decode(plain, expected);
+            ASSERT_TRUE(expected == decoded[i]);
+            vector<complex<double>> expected_complex;
+            encoder.decode(plain, expected_complex);
+            ASSERT_TRUE(expected_complex == decoded_complex[i]);
+
+            vector<double> result;
+            decryptor.decrypt_decode(encrypted[i], encoder, result);
+            ASSERT_TRUE(expected == result);
+            ASSERT_NEAR(static_cast<double>(i) + 0.5, result[0], 0.01);
+        }
+    }
 }
@@ -11,10 +11,16 @@
 #include "seal/ckks.h"
 #include "seal/intencoder.h"
 #include "seal/defaultparams.h"
+#include "seal/plaintextdatabase.h"
+#include "seal/util/uintarithsmallmod.h"
+#include "tempfile.h"
+#include <algorithm>
 #include <cstdint>
 #include <cstddef>
+#include <cmath>
 #include <string>
 #include <ctime>
+#include <vector>
 
 using namespace seal;
 using namespace std;
@@ -1000,6 +1006,47 @@ namespace SEALTest
         }
     }
 
+    TEST(EvaluatorTest, FVEncryptMultiplyPlainLargePlainModulusDecrypt)
+    {
+        // The plain modulus is larger than the first prime, so the plaintexts
+        // cannot be lifted coefficient by coefficient with q_i - t
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(uint64_t(1) << 40);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_30bit(0),
+            DefaultParams::small_mods_60bit(0) });
+        auto context = SEALContext::Create(parms);
+        ASSERT_FALSE(context->context_data()->qualifiers().using_fast_plain_lift);
+        KeyGenerator keygen(context);
+
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+
+        // Coefficients in the upper half stand for negative values
+        Ciphertext encrypted;
+        Plaintext plain;
+        encryptor.encrypt(Plaintext("1x^1 + 2"), encrypted);
+        evaluator.multiply_plain_inplace(encrypted, Plaintext("FFFFFFFFFFx^2 + 7FFFFFFx^1 + 3"));
+        decryptor.decrypt(encrypted, plain);
+        ASSERT_EQ("FFFFFFFFFFx^3 + 7FFFFFDx^2 + 10000001x^1 + 6", plain.to_string());
+
+        encryptor.encrypt(Plaintext("1x^1 + 2"), encrypted);
+        evaluator.multiply_plain_inplace(encrypted, Plaintext("FFFFFFFFFF"));
+        decryptor.decrypt(encrypted, plain);
+        ASSERT_EQ("FFFFFFFFFFx^1 + FFFFFFFFFE", plain.to_string());
+
+        // The same lift is used for plaintexts transformed to NTT form
+        Plaintext plain_ntt("FFFFFFFFFFx^2 + 7FFFFFFx^1 + 3");
+        evaluator.transform_to_ntt_inplace(plain_ntt, parms.parms_id());
+        encryptor.encrypt(Plaintext("1x^1 + 2"), encrypted);
+        evaluator.transform_to_ntt_inplace(encrypted);
+        evaluator.multiply_plain_inplace(encrypted, plain_ntt);
+        evaluator.transform_from_ntt_inplace(encrypted);
+        decryptor.decrypt(encrypted, plain);
+        ASSERT_EQ("FFFFFFFFFFx^3 + 7FFFFFDx^2 + 10000001x^1 + 6", plain.to_string());
+    }
+
     TEST(EvaluatorTest, FVEncryptMultiplyDecrypt)
     {
         {
@@ -1224,6 +1271,108 @@ namespace SEALTest
             ASSERT_TRUE(encrypted1.parms_id() == parms.parms_id());
         }
     }
+    TEST(EvaluatorTest, FVEncryptMultiplyHPSDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(64);
+        for (auto plain_modulus : { uint64_t(1) << 6, (uint64_t(1) << 40) + 1 })
+        {
+            parms.set_plain_modulus(plain_modulus);
+            parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+                DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_40bit(0) });
+            auto context = SEALContext::Create(parms);
+            KeyGenerator keygen(context);
+            Encryptor encryptor(context, keygen.public_key());
+            Decryptor decryptor(context, keygen.secret_key());
+            Evaluator evaluator(context);
+            Evaluator evaluator_hps(context);
+            ASSERT_TRUE(bfv_multiply_type::BEHZ == evaluator_hps.current_bfv_multiply_type());
+            evaluator_hps.set_bfv_multiply_type(bfv_multiply_type::HPS);
+            ASSERT_TRUE(bfv_multiply_type::HPS == evaluator_hps.current_bfv_multiply_type());
+
+            Ciphertext encrypted1, encrypted2;
+            encryptor.encrypt(Plaintext("1x^10 + 2"), encrypted1);
+            encryptor.encrypt(Plaintext("3x^5 + 1"), encrypted2);
+
+            // Both algorithms decrypt to the same result, and HPS leaves at least
+            // about as much noise budget since it lifts its inputs centered
+            auto check = [&](const Ciphertext &encrypted, const Ciphertext &expected) {
+                ASSERT_EQ(expected.size(), encrypted.size());
+                ASSERT_EQ(expected.is_ntt_form(), encrypted.is_ntt_form());
+                Ciphertext encrypted_copy = encrypted, expected_copy = expected;
+                if (encrypted.is_ntt_form())
+                {
+                    evaluator.transform_from_ntt_inplace(encrypted_copy);
+                    evaluator.transform_from_ntt_inplace(expected_copy);
+                }
+                Plaintext plain, expected_plain;
+                decryptor.decrypt(encrypted_copy, plain);
+                decryptor.decrypt(expected_copy, expected_plain);
+                ASSERT_TRUE(plain == expected_plain);
+                ASSERT_LE(decryptor.invariant_noise_budget(expected_copy),
+                    decryptor.invariant_noise_budget(encrypted_copy) + 1);
+            };
+
+            Ciphertext product, expected;
+            evaluator_hps.multiply(encrypted1, encrypted2, product);
+            evaluator.multiply(encrypted1, encrypted2, expected);
+            check(product, expected);
+            Plaintext plain;
+            decryptor.decrypt(product, plain);
+            ASSERT_EQ("3x^15 + 1x^10 + 6x^5 + 2", plain.to_string());
+
+            // Squares and products of larger ciphertexts
+            Ciphertext square;
+            evaluator_hps.square(encrypted1, square);
+            evaluator.square(encrypted1, expected);
+            check(square, expected);
+            decryptor.decrypt(square, plain);
+            ASSERT_EQ("1x^20 + 4x^10 + 4", plain.to_string());
+
+            evaluator_hps.multiply(square, encrypted2, product);
+            evaluator.multiply(square, encrypted2, expected);
+            check(product, expected);
+            ASSERT_EQ(4ULL, product.size());
+            evaluator_hps.square_inplace(square);
+            evaluator.square(encrypted1, expected);
+            evaluator.square_inplace(expected);
+            check(square, expected);
+            ASSERT_EQ(5ULL, square.size());
+            decryptor.decrypt(square, plain);
+            ASSERT_EQ("1x^40 + 8x^30 + 18x^20 + 20x^10 + 10", plain.to_string());
+
+            // Ciphertexts in NTT form
+            Ciphertext encrypted1_ntt, encrypted2_ntt;
+            evaluator.transform_to_ntt(encrypted1, encrypted1_ntt);
+            evaluator.transform_to_ntt(encrypted2, encrypted2_ntt);
+            evaluator_hps.multiply(encrypted1_ntt, encrypted2_ntt, product);
+            evaluator.multiply(encrypted1_ntt, encrypted2_ntt, expected);
+            check(product, expected);
+            evaluator_hps.square(encrypted1_ntt, product);
+            evaluator.square(encrypted1_ntt, expected);
+            check(product, expected);
+            ASSERT_THROW(evaluator_hps.multiply(encrypted1_ntt, encrypted2, product),
+                invalid_argument);
+
+            // Lower levels of the modulus switching chain
+            evaluator.mod_switch_to_next_inplace(encrypted1);
+            evaluator.mod_switch_to_next_inplace(encrypted2);
+            evaluator_hps.multiply(encrypted1, encrypted2, product);
+            evaluator.multiply(encrypted1, encrypted2, expected);
+            check(product, expected);
+            decryptor.decrypt(product, plain);
+            ASSERT_EQ("3x^15 + 1x^10 + 6x^5 + 2", plain.to_string());
+        }
+
+        // Only BFV ciphertexts are multiplied with HPS
+        EncryptionParameters ckks_parms(scheme_type::CKKS);
+        ckks_parms.set_poly_modulus_degree(64);
+        ckks_parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0) });
+        Evaluator evaluator(SEALContext::Create(ckks_parms));
+        ASSERT_THROW(evaluator.set_bfv_multiply_type(bfv_multiply_type::HPS), logic_error);
+    }
+
     TEST(EvaluatorTest, FVRelinearize)
     {
         EncryptionParameters parms(scheme_type::BFV);
@@ -1364,6 +1513,80 @@ namespace SEALTest
         decryptor.decrypt(encrypted, plain2);
         ASSERT_TRUE(plain2.to_string() == "1x^40 + 8x^30 + 18x^20 + 20x^10 + 10");
     }
+    TEST(EvaluatorTest, FVRelinearizeInOnePass)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1), DefaultParams::small_mods_40bit(2) });
+        parms.set_noise_standard_deviation(3.20);
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+
+        // With 4-bit decomposition, the summands of more than two components
+        // do not fit into the lazily reduced sums at once
+        RelinKeys rlk = keygen.relin_keys(4, 3);
+
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+
+        Ciphertext encrypted;
+        encryptor.encrypt(Plaintext("1x^10 + 2"), encrypted);
+        evaluator.square_inplace(encrypted);
+        evaluator.square_inplace(encrypted);
+        ASSERT_EQ(5ULL, encrypted.size());
+
+        for (bool is_ntt_form : { false, true })
+        {
+            if (is_ntt_form)
+            {
+                evaluator.transform_to_ntt_inplace(encrypted);
+            }
+
+            // Relinearization is linear in the components, so relinearizing
+            // every component on its own and adding up the results gives the
+            // same ciphertext
+            size_t poly_uint64_count = encrypted.uint64_count() / encrypted.size();
+            Ciphertext expected;
+            for (size_t j = 1; j < encrypted.size(); j++)
+            {
+                // The first term keeps c_0 and c_1, the others one c_j each
+                Ciphertext component = encrypted;
+                fill_n(component.data(), encrypted.uint64_count(), 0);
+                if (j == 1)
+                {
+                    copy_n(encrypted.data(), 2 * poly_uint64_count, component.data());
+                }
+                else
+                {
+                    copy_n(encrypted.data(j), poly_uint64_count, component.data(j));
+                }
+                evaluator.relinearize_inplace(component, rlk);
+                if (j == 1)
+                {
+                    expected = component;
+                }
+                else
+                {
+                    evaluator.add_inplace(expected, component);
+                }
+            }
+
+            Ciphertext relinearized;
+            evaluator.relinearize(encrypted, rlk, relinearized);
+            ASSERT_EQ(2ULL, relinearized.size());
+            ASSERT_EQ(is_ntt_form, relinearized.is_ntt_form());
+            ASSERT_TRUE(equal(expected.data(), expected.data() + expected.uint64_count(),
+                relinearized.data()));
+
+            Plaintext plain;
+            decryptor.decrypt(relinearized, plain);
+            ASSERT_EQ("1x^40 + 8x^30 + 18x^20 + 20x^10 + 10", plain.to_string());
+        }
+    }
+
     TEST(EvaluatorTest, CKKSEncryptNaiveMultiplyDecrypt)
     {
         EncryptionParameters parms(scheme_type::CKKS);
@@ -2341,6 +2564,78 @@ namespace SEALTest
             }
         }
     }
+    TEST(EvaluatorTest, CKKSRescaleInNTTForm)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+
+        // The dropped prime is larger than one of the remaining primes and
+        // smaller than the other
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_30bit(0), DefaultParams::small_mods_40bit(0) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+
+        Plaintext plain;
+        Ciphertext encrypted;
+        encoder.encode(3.0, pow(2.0, 60), plain);
+        encryptor.encrypt(plain, encrypted);
+
+        // Reference rescaling in coefficient representation, where the result
+        // is qk^(-1) * ((ct mod qi) - (ct mod qk)) mod qi
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        Ciphertext encrypted_coeff = encrypted;
+        evaluator.transform_from_ntt_inplace(encrypted_coeff);
+        vector<uint64_t> expected;
+        for (size_t i = 0; i < encrypted.size(); i++)
+        {
+            const uint64_t *last_ptr = encrypted_coeff.data(i) + 2 * coeff_count;
+            for (size_t j = 0; j < 2; j++)
+            {
+                uint64_t inv_last;
+                ASSERT_TRUE(util::try_mod_inverse(coeff_modulus[2].value(),
+                    coeff_modulus[j].value(), inv_last));
+                for (size_t k = 0; k < coeff_count; k++)
+                {
+                    uint64_t difference = util::sub_uint_uint_mod(
+                        encrypted_coeff.data(i)[j * coeff_count + k],
+                        last_ptr[k] % coeff_modulus[j].value(), coeff_modulus[j]);
+                    expected.push_back(util::multiply_uint_uint_mod(difference,
+                        inv_last, coeff_modulus[j]));
+                }
+            }
+        }
+
+        Ciphertext rescaled;
+        evaluator.rescale_to_next(encrypted, rescaled);
+        ASSERT_TRUE(rescaled.is_ntt_form());
+        ASSERT_EQ(2ULL, rescaled.size());
+        evaluator.transform_from_ntt_inplace(rescaled);
+        ASSERT_TRUE(equal(expected.begin(), expected.end(), rescaled.data()));
+
+        // In place the result is the same
+        Ciphertext rescaled_inplace = encrypted;
+        evaluator.rescale_to_next_inplace(rescaled_inplace);
+        evaluator.transform_to_ntt_inplace(rescaled);
+        ASSERT_TRUE(rescaled_inplace.parms_id() == rescaled.parms_id());
+        ASSERT_EQ(rescaled.scale(), rescaled_inplace.scale());
+        ASSERT_TRUE(equal(rescaled.data(), rescaled.data() + rescaled.uint64_count(),
+            rescaled_inplace.data()));
+
+        vector<double> result;
+        decryptor.decrypt(rescaled_inplace, plain);
+        encoder.decode(plain, result);
+        for (auto value : result)
+        {
+            ASSERT_NEAR(3.0, value, 0.001);
+        }
+    }
+
     TEST(EvaluatorTest, CKKSEncryptSquareRelinRescaleDecrypt)
     {
         EncryptionParameters parms(scheme_type::CKKS);
@@ -2816,6 +3111,141 @@ namespace SEALTest
             }
         }
     }
+    TEST(EvaluatorTest, CKKSEncryptAutoAlignDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        size_t slot_size = 32;
+        parms.set_poly_modulus_degree(slot_size * 2);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_40bit(0), DefaultParams::small_mods_40bit(1),
+            DefaultParams::small_mods_40bit(2), DefaultParams::small_mods_40bit(3) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+        RelinKeys rlk = keygen.relin_keys(30, 1);
+
+        vector<CKKSAlignment> alignments;
+        double delta = static_cast<double>(1ULL << 40);
+        Plaintext plain1, plain2, plain3, plain;
+        encoder.encode(3.0, delta, plain1);
+        encoder.encode(-2.0, delta, plain2);
+        encoder.encode(5.0, delta, plain3);
+        Ciphertext encrypted1, encrypted2, encrypted3, product;
+        encryptor.encrypt(plain1, encrypted1);
+        encryptor.encrypt(plain2, encrypted2);
+        encryptor.encrypt(plain3, encrypted3);
+        auto decrypt_near = [&](const Ciphertext &encrypted, double expected) {
+            vector<double> result;
+            decryptor.decrypt(encrypted, plain);
+            encoder.decode(plain, result);
+            for (auto value : result)
+            {
+                ASSERT_NEAR(expected, value, 0.001 * (1.0 + fabs(expected)));
+            }
+        };
+
+        // Operands at different levels and scales are rejected by default
+        evaluator.multiply(encrypted1, encrypted2, product);
+        evaluator.relinearize_inplace(product, rlk);
+        ASSERT_FALSE(evaluator.ckks_auto_alignment());
+        ASSERT_THROW(evaluator.add_inplace(product, encrypted3), invalid_argument);
+
+        // The product is rescaled, encrypted3 is switched down, and the scales
+        // differ only by the ratio of the dropped prime and delta; the error of
+        // such adjustments grows with the magnitude of the values
+        evaluator.enable_ckks_auto_alignment(0.001,
+            [&](const CKKSAlignment &alignment) { alignments.push_back(alignment); });
+        ASSERT_TRUE(evaluator.ckks_auto_alignment());
+        Ciphertext sum = product;
+        evaluator.add_inplace(sum, encrypted3);
+        ASSERT_EQ(1ULL, alignments.size());
+        ASSERT_EQ(string("add_inplace"), alignments[0].operation);
+        ASSERT_EQ(1ULL, alignments[0].rescale_count[0]);
+        ASSERT_EQ(0ULL, alignments[0].rescale_count[1]);
+        ASSERT_EQ(0ULL, alignments[0].mod_switch_levels[0]);
+        ASSERT_EQ(1ULL, alignments[0].mod_switch_levels[1]);
+        ASSERT_LT(0.0, alignments[0].scale_adjustment);
+        ASSERT_TRUE(sum.parms_id() ==
+            context->context_data()->next_context_data()->parms().parms_id());
+        ASSERT_TRUE(encrypted3.parms_id() == parms.parms_id());
+        decrypt_near(sum, -1.0);
+
+        // Aligned operands are not reported
+        alignments.clear();
+        Ciphertext doubled = sum;
+        evaluator.add_inplace(doubled, sum);
+        ASSERT_TRUE(alignments.empty());
+        decrypt_near(doubled, -2.0);
+
+        // A product is rescaled only when it is multiplied again
+        evaluator.multiply_inplace(sum, encrypted1);
+        evaluator.relinearize_inplace(sum, rlk);
+        ASSERT_EQ(1ULL, alignments.size());
+        ASSERT_EQ(0ULL, alignments[0].rescale_count[0]);
+        ASSERT_EQ(1ULL, alignments[0].mod_switch_levels[1]);
+        evaluator.multiply_inplace(sum, encrypted2);
+        evaluator.relinearize_inplace(sum, rlk);
+        ASSERT_EQ(2ULL, alignments.size());
+        ASSERT_EQ(string("multiply_inplace"), alignments[1].operation);
+        ASSERT_EQ(1ULL, alignments[1].rescale_count[0]);
+        ASSERT_EQ(2ULL, alignments[1].mod_switch_levels[1]);
+        decrypt_near(sum, 6.0);
+        evaluator.square_inplace(sum);
+        ASSERT_EQ(3ULL, alignments.size());
+        ASSERT_EQ(1ULL, alignments[2].rescale_count[0]);
+        ASSERT_EQ(1ULL, alignments[2].rescale_count[1]);
+        evaluator.relinearize_inplace(sum, rlk);
+        decrypt_near(sum, 36.0);
+
+        // A plaintext at a higher level is switched down to the ciphertext
+        alignments.clear();
+        evaluator.rescale_to_next_inplace(product);
+        encoder.encode(1.5, product.scale(), plain);
+        evaluator.add_plain_inplace(product, plain);
+        ASSERT_EQ(1ULL, alignments.size());
+        ASSERT_EQ(string("add_plain_inplace"), alignments[0].operation);
+        ASSERT_EQ(1ULL, alignments[0].mod_switch_levels[1]);
+        ASSERT_EQ(0.0, alignments[0].scale_adjustment);
+        ASSERT_TRUE(plain.parms_id() == parms.parms_id());
+        decrypt_near(product, -4.5);
+
+        // Scales that differ by more than the tolerance are not adjusted
+        encoder.encode(1.0, delta * 2, plain);
+        ASSERT_THROW(evaluator.sub_plain_inplace(product, plain), invalid_argument);
+        encryptor.encrypt(plain, encrypted3);
+        ASSERT_THROW(evaluator.sub_inplace(product, encrypted3), invalid_argument);
+
+        // A first operand that was already switched down when the scales turned
+        // out not to match is left unchanged, and nothing is reported
+        alignments.clear();
+        Ciphertext encrypted3_copy = encrypted3;
+        ASSERT_THROW(evaluator.sub_inplace(encrypted3, product), invalid_argument);
+        ASSERT_TRUE(encrypted3.parms_id() == parms.parms_id());
+        ASSERT_EQ(encrypted3_copy.scale(), encrypted3.scale());
+        ASSERT_TRUE(equal(encrypted3.data(), encrypted3.data() + encrypted3.uint64_count(),
+            encrypted3_copy.data()));
+        encoder.encode(1.0, product.parms_id(), delta * 2, plain);
+        ASSERT_THROW(evaluator.add_plain_inplace(encrypted1, plain), invalid_argument);
+        ASSERT_TRUE(encrypted1.parms_id() == parms.parms_id());
+        ASSERT_TRUE(alignments.empty());
+
+        evaluator.disable_ckks_auto_alignment();
+        ASSERT_FALSE(evaluator.ckks_auto_alignment());
+        ASSERT_THROW(evaluator.add_inplace(encrypted1, product), invalid_argument);
+        ASSERT_THROW(evaluator.enable_ckks_auto_alignment(1.0), invalid_argument);
+
+        // Only CKKS operands are aligned
+        EncryptionParameters bfv_parms(scheme_type::BFV);
+        bfv_parms.set_poly_modulus_degree(64);
+        bfv_parms.set_plain_modulus(1 << 6);
+        bfv_parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0) });
+        Evaluator bfv_evaluator(SEALContext::Create(bfv_parms));
+        ASSERT_THROW(bfv_evaluator.enable_ckks_auto_alignment(), logic_error);
+    }
+
     TEST(EvaluatorTest, CKKSEncryptRotateDecrypt)
     {
         EncryptionParameters parms(scheme_type::CKKS);
@@ -3403,6 +3833,228 @@ namespace SEALTest
         ASSERT_TRUE(sum.parms_id() == parms.parms_id());
     }
 
+    TEST(EvaluatorTest, FVEncryptAddManyLazyDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        SmallModulus plain_modulus(1 << 10);
+        parms.set_poly_modulus_degree(128);
+        parms.set_plain_modulus(plain_modulus);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0), 
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+
+        IntegerEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+
+        // With 60-bit primes the coefficients are reduced every 16 additions, and
+        // the ciphertexts are split between several threads
+        vector<Ciphertext> encrypteds(200);
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            encryptor.encrypt(encoder.encode(static_cast<uint64_t>(i % 5)), encrypteds[i]);
+        }
+        evaluator.square_inplace(encrypteds[7]);
+
+        Ciphertext sum, expected;
+        for (size_t thread_count : { 1, 4 })
+        {
+            evaluator.add_many(encrypteds, sum, MemoryManager::GetPool(), thread_count);
+            expected = encrypteds[0];
+            for (size_t i = 1; i < encrypteds.size(); i++)
+            {
+                evaluator.add_inplace(expected, encrypteds[i]);
+            }
+            ASSERT_EQ(3ULL, sum.size());
+            ASSERT_TRUE(sum.parms_id() == parms.parms_id());
+            ASSERT_TRUE(equal(sum.data(), sum.data() + sum.uint64_count(), expected.data()));
+            Plaintext plain;
+            decryptor.decrypt(sum, plain);
+            ASSERT_EQ(static_cast<uint64_t>(400 - 2 + 4), encoder.decode_uint64(plain));
+        }
+    }
+
+    TEST(EvaluatorTest, CKKSEncryptMultiplyManyAddManyDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        size_t slot_size = 64;
+        parms.set_poly_modulus_degree(slot_size * 2);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0), 
+            DefaultParams::small_mods_40bit(0), DefaultParams::small_mods_40bit(1), 
+            DefaultParams::small_mods_40bit(2), DefaultParams::small_mods_40bit(3) });
+        auto context = SEALContext::Create(parms);
+        auto next_parms_id = context->context_data()->
+            next_context_data()->parms().parms_id();
+        KeyGenerator keygen(context);
+
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+        RelinKeys rlk = keygen.relin_keys(16);
+
+        // The last ciphertext starts one level lower than the others
+        double delta = static_cast<double>(1ULL << 40);
+        vector<Ciphertext> encrypteds(5);
+        Plaintext plain;
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            encoder.encode(1.0 + 0.25 * static_cast<double>(i), 
+                i == 4 ? next_parms_id : parms.parms_id(), delta, plain);
+            encryptor.encrypt(plain, encrypteds[i]);
+        }
+
+        // The tree has depth 3, so the product is rescaled 3 times
+        Ciphertext result;
+        vector<double> output;
+        evaluator.multiply_many(encrypteds, rlk, result);
+        ASSERT_EQ(2ULL, result.size());
+        ASSERT_EQ(1ULL, context->context_data(result.parms_id())->chain_index());
+        decryptor.decrypt(result, plain);
+        encoder.decode(plain, output);
+        for (size_t i = 0; i < slot_size; i++)
+        {
+            ASSERT_NEAR(1.0 * 1.25 * 1.5 * 1.75 * 2.0, output[i], 0.01);
+        }
+
+        evaluator.add_many(encrypteds, result);
+        ASSERT_TRUE(result.parms_id() == next_parms_id);
+        decryptor.decrypt(result, plain);
+        encoder.decode(plain, output);
+        for (size_t i = 0; i < slot_size; i++)
+        {
+            ASSERT_NEAR(7.5, output[i], 0.01);
+        }
+
+        encrypteds[2].scale() *= 2;
+        ASSERT_THROW(evaluator.add_many(encrypteds, result), invalid_argument);
+    }
+
+    TEST(EvaluatorTest, FVEncryptInnerProductPlainDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        SmallModulus plain_modulus(257);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(plain_modulus);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0), DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+
+        BatchEncoder batch_encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+
+        vector<Ciphertext> encrypteds(50);
+        vector<Plaintext> plains(encrypteds.size());
+        vector<uint64_t> plain_vec(64), expected_vec(64, 0);
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            for (size_t j = 0; j < plain_vec.size(); j++)
+            {
+                plain_vec[j] = (i + j) % 5;
+            }
+            Plaintext plain;
+            batch_encoder.encode(plain_vec, plain);
+            encryptor.encrypt(plain, encrypteds[i]);
+            for (size_t j = 0; j < plain_vec.size(); j++)
+            {
+                expected_vec[j] += plain_vec[j] * (i % 3 + j % 2);
+                plain_vec[j] = i % 3 + j % 2;
+            }
+            batch_encoder.encode(plain_vec, plains[i]);
+        }
+        for (auto &value : expected_vec)
+        {
+            value %= plain_modulus.value();
+        }
+
+        vector<Ciphertext> products(encrypteds.size());
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            evaluator.multiply_plain(encrypteds[i], plains[i], products[i]);
+        }
+        Ciphertext expected;
+        evaluator.add_many(products, expected);
+
+        // The result equals the sum of the products for any number of threads
+        Ciphertext result;
+        Plaintext plain;
+        for (size_t thread_count : { 1, 3 })
+        {
+            evaluator.inner_product_plain(encrypteds, plains, result, 
+                MemoryManager::GetPool(), thread_count);
+            ASSERT_FALSE(result.is_ntt_form());
+            ASSERT_TRUE(equal(result.data(), result.data() + result.uint64_count(), 
+                expected.data()));
+            decryptor.decrypt(result, plain);
+            batch_encoder.decode(plain, plain_vec);
+            ASSERT_TRUE(plain_vec == expected_vec);
+        }
+
+        // The plaintexts can be read from a database at an offset
+        vector<Plaintext> database_plains{ Plaintext("1") };
+        database_plains.insert(database_plains.end(), plains.begin(), plains.end());
+        TempFile file("evaluator_inner_product_test.dat");
+        PlaintextDatabase::Build(context, parms.parms_id(), database_plains, 
+            file.path(), 1);
+        {
+            PlaintextDatabase database(context, file.path());
+            evaluator.inner_product_plain(encrypteds, database, 1, result);
+            ASSERT_TRUE(equal(result.data(), result.data() + result.uint64_count(), 
+                expected.data()));
+            ASSERT_THROW(evaluator.inner_product_plain(encrypteds, database, 2, result),
+                out_of_range);
+        }
+
+        plains.pop_back();
+        ASSERT_THROW(evaluator.inner_product_plain(encrypteds, plains, result), 
+            invalid_argument);
+    }
+
+    TEST(EvaluatorTest, CKKSEncryptInnerProductPlainDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0), DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+
+        double delta = static_cast<double>(1ULL << 30);
+        vector<Ciphertext> encrypteds(8);
+        vector<Plaintext> plains(encrypteds.size());
+        for (size_t i = 0; i < encrypteds.size(); i++)
+        {
+            Plaintext plain;
+            encoder.encode(static_cast<double>(i), delta, plain);
+            encryptor.encrypt(plain, encrypteds[i]);
+            encoder.encode(0.25, delta, plains[i]);
+        }
+
+        Ciphertext result;
+        evaluator.inner_product_plain(encrypteds, plains, result);
+        ASSERT_EQ(delta * delta, result.scale());
+        Plaintext plain;
+        vector<double> output;
+        decryptor.decrypt(result, plain);
+        encoder.decode(plain, output);
+        for (auto value : output)
+        {
+            ASSERT_NEAR(7.0, value, 0.01);
+        }
+
+        encoder.encode(0.25, delta * 2, plains[3]);
+        ASSERT_THROW(evaluator.inner_product_plain(encrypteds, plains, result), 
+            invalid_argument);
+    }
+
     TEST(EvaluatorTest, TransformPlainToNTT)
     {
         EncryptionParameters parms(scheme_type::BFV);
@@ -3582,6 +4234,112 @@ namespace SEALTest
         ASSERT_TRUE(encrypted.parms_id() == parms.parms_id());
     }
 
+    TEST(EvaluatorTest, FVEncryptNTTResidentDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        SmallModulus plain_modulus(257);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(plain_modulus);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        RelinKeys rlk = keygen.relin_keys(16, 3);
+        GaloisKeys glk = keygen.galois_keys(24);
+
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+        BatchEncoder batch_encoder(context);
+
+        vector<uint64_t> values1(64), values2(64), values3(64);
+        for (uint64_t i = 0; i < 64; i++)
+        {
+            values1[i] = i;
+            values2[i] = (3 * i + 1) % 257;
+            values3[i] = 256 - i;
+        }
+        Plaintext plain1, plain2, plain3, plain1_ntt;
+        batch_encoder.encode(values1, plain1);
+        batch_encoder.encode(values2, plain2);
+        batch_encoder.encode(values3, plain3);
+        evaluator.transform_to_ntt(plain1, parms.parms_id(), plain1_ntt);
+
+        // The same computation in coefficient and in NTT form
+        Ciphertext encrypted1, encrypted2, encrypted1_ntt, encrypted2_ntt;
+        encryptor.encrypt(plain1, encrypted1);
+        encryptor.encrypt(plain2, encrypted2);
+        evaluator.transform_to_ntt(encrypted1, encrypted1_ntt);
+        evaluator.transform_to_ntt(encrypted2, encrypted2_ntt);
+
+        evaluator.multiply_plain_inplace(encrypted1, plain2);
+        evaluator.multiply_plain_inplace(encrypted1_ntt, plain2);
+        evaluator.add_plain_inplace(encrypted1, plain3);
+        evaluator.add_plain_inplace(encrypted1_ntt, plain3);
+        evaluator.sub_plain_inplace(encrypted2, plain1);
+        evaluator.sub_plain_inplace(encrypted2_ntt, plain1);
+        evaluator.add_inplace(encrypted1, encrypted2);
+        evaluator.add_inplace(encrypted1_ntt, encrypted2_ntt);
+        evaluator.multiply_inplace(encrypted1, encrypted2);
+        evaluator.multiply_inplace(encrypted1_ntt, encrypted2_ntt);
+        evaluator.square_inplace(encrypted1);
+        evaluator.square_inplace(encrypted1_ntt);
+        ASSERT_EQ(5ULL, encrypted1_ntt.size());
+        ASSERT_TRUE(encrypted1_ntt.is_ntt_form());
+        evaluator.relinearize_inplace(encrypted1, rlk);
+        evaluator.relinearize_inplace(encrypted1_ntt, rlk);
+        evaluator.square_inplace(encrypted2);
+        evaluator.square_inplace(encrypted2_ntt);
+        evaluator.relinearize_inplace(encrypted2, rlk);
+        evaluator.relinearize_inplace(encrypted2_ntt, rlk);
+        evaluator.sub_inplace(encrypted1, encrypted2);
+        evaluator.sub_inplace(encrypted1_ntt, encrypted2_ntt);
+        evaluator.rotate_rows_inplace(encrypted1, 3, glk);
+        evaluator.rotate_rows_inplace(encrypted1_ntt, 3, glk);
+        evaluator.rotate_columns_inplace(encrypted1, glk);
+        evaluator.rotate_columns_inplace(encrypted1_ntt, glk);
+        evaluator.multiply_plain_inplace(encrypted1, plain1);
+        evaluator.multiply_plain_inplace(encrypted1_ntt, plain1_ntt);
+        evaluator.mod_switch_to_next_inplace(encrypted1);
+        evaluator.mod_switch_to_next_inplace(encrypted1_ntt);
+        ASSERT_TRUE(encrypted1_ntt.is_ntt_form());
+
+        // Both are decrypted directly, and the results agree to the last bit
+        Plaintext plain, plain_ntt;
+        decryptor.decrypt(encrypted1, plain);
+        decryptor.decrypt(encrypted1_ntt, plain_ntt);
+        ASSERT_TRUE(plain == plain_ntt);
+        ASSERT_EQ(decryptor.invariant_noise_budget(encrypted1),
+            decryptor.invariant_noise_budget(encrypted1_ntt));
+        ASSERT_TRUE(decryptor.invariant_noise_budget(encrypted1) > 0);
+        evaluator.transform_from_ntt_inplace(encrypted1_ntt);
+        ASSERT_TRUE(equal(encrypted1.data(), encrypted1.data() + encrypted1.uint64_count(),
+            encrypted1_ntt.data()));
+
+        vector<uint64_t> result;
+        batch_encoder.decode(plain, result);
+        for (size_t i = 0; i < 64; i++)
+        {
+            // Slot i holds the values of slot j after the rotations
+            size_t j = (i + 32) % 64;
+            j = (j / 32) * 32 + (j % 32 + 3) % 32;
+            uint64_t x = (values1[j] * values2[j] + values3[j] + values2[j] +
+                257 - values1[j]) % 257;
+            uint64_t y = (values2[j] + 257 - values1[j]) % 257;
+            uint64_t expected = (x * y) % 257;
+            expected = (expected * expected) % 257;
+            expected = (expected + 257 - (y * y) % 257) % 257;
+            ASSERT_EQ((expected * values1[i]) % 257, result[i]);
+        }
+
+        // Plain operations in BFV take coefficient form plaintexts, except for
+        // multiply_plain, and ciphertexts must be in the same form
+        ASSERT_THROW(evaluator.add_plain_inplace(encrypted2_ntt, plain1_ntt), invalid_argument);
+        ASSERT_THROW(evaluator.sub_plain_inplace(encrypted2_ntt, plain1_ntt), invalid_argument);
+        ASSERT_THROW(evaluator.multiply_inplace(encrypted2_ntt, encrypted2), invalid_argument);
+        ASSERT_THROW(evaluator.multiply_plain_inplace(encrypted2, plain1_ntt), invalid_argument);
+    }
+
     TEST(EvaluatorTest, FVEncryptApplyGaloisDecrypt)
     {
         EncryptionParameters parms(scheme_type::BFV);
@@ -3659,6 +4417,145 @@ namespace SEALTest
         ASSERT_TRUE("1x^3 + 2x^2 + 1x^1 + 1" == plain.to_string());
     }
 
+    TEST(EvaluatorTest, FVEncryptExpandQueryDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        SmallModulus plain_modulus(257);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(plain_modulus);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0), DefaultParams::small_mods_40bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+
+        ASSERT_TRUE(evaluator.expand_query_galois_elts(1).empty());
+        ASSERT_TRUE((vector<uint64_t>{ 65, 33, 17 }) == evaluator.expand_query_galois_elts(5));
+        auto galois_elts = evaluator.expand_query_galois_elts(64);
+        ASSERT_TRUE((vector<uint64_t>{ 65, 33, 17, 9, 5, 3 }) == galois_elts);
+        ASSERT_THROW(evaluator.expand_query_galois_elts(0), invalid_argument);
+        ASSERT_THROW(evaluator.expand_query_galois_elts(65), invalid_argument);
+        GaloisKeys glk = keygen.galois_keys(24, galois_elts);
+
+        Plaintext plain(64);
+        for (size_t i = 0; i < 64; i++)
+        {
+            plain[i] = (i * 37 + 11) % 257;
+        }
+        Ciphertext encrypted;
+        encryptor.encrypt(plain, encrypted);
+
+        vector<Ciphertext> expanded;
+        Plaintext result;
+        evaluator.expand_query(encrypted, 64, glk, expanded);
+        ASSERT_EQ(64ULL, expanded.size());
+        for (size_t k = 0; k < 64; k++)
+        {
+            decryptor.decrypt(expanded[k], result);
+            ASSERT_EQ(1ULL, result.significant_coeff_count());
+            ASSERT_EQ((64 * plain[k]) % 257, result[0]);
+        }
+
+        // A count that is not a power of two, in one and several threads
+        plain.resize(5);
+        encryptor.encrypt(plain, encrypted);
+        for (size_t thread_count : { 1, 3 })
+        {
+            evaluator.expand_query(encrypted, 5, glk, expanded, thread_count);
+            ASSERT_EQ(5ULL, expanded.size());
+            for (size_t k = 0; k < 5; k++)
+            {
+                ASSERT_TRUE(expanded[k].parms_id() == encrypted.parms_id());
+                decryptor.decrypt(expanded[k], result);
+                ASSERT_EQ(1ULL, result.significant_coeff_count());
+                ASSERT_EQ((8 * plain[k]) % 257, result[0]);
+            }
+        }
+
+        // The coefficients beyond count are collected at multiples of 2^l
+        plain = "3x^9 + 2x^4 + 1x^1";
+        encryptor.encrypt(plain, encrypted);
+        evaluator.expand_query(encrypted, 4, glk, expanded);
+        decryptor.decrypt(expanded[0], result);
+        ASSERT_TRUE("8x^4" == result.to_string());
+        decryptor.decrypt(expanded[1], result);
+        ASSERT_TRUE("Cx^8 + 4" == result.to_string());
+
+        evaluator.expand_query(encrypted, 1, glk, expanded);
+        ASSERT_EQ(1ULL, expanded.size());
+        decryptor.decrypt(expanded[0], result);
+        ASSERT_TRUE(plain == result);
+
+        ASSERT_THROW(evaluator.expand_query(encrypted, 65, glk, expanded), invalid_argument);
+
+        // The input cannot be overwritten while it is expanded
+        ASSERT_THROW(evaluator.expand_query(expanded[0], 4, glk, expanded), invalid_argument);
+        ASSERT_EQ(1ULL, expanded.size());
+        decryptor.decrypt(expanded[0], result);
+        ASSERT_TRUE(plain == result);
+
+        evaluator.transform_to_ntt_inplace(encrypted);
+        ASSERT_THROW(evaluator.expand_query(encrypted, 4, glk, expanded), invalid_argument);
+    }
+
+    TEST(EvaluatorTest, FVEncryptRotatePlannedDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        SmallModulus plain_modulus(257);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(plain_modulus);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0), DefaultParams::small_mods_40bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        GaloisKeys glk = keygen.galois_keys(24, vector<int>{ 1, 5 });
+
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+        BatchEncoder batch_encoder(context);
+
+        // With keys for 1 and 5 steps in rows of 32 slots the shortest plans for
+        // 10, 9, and -1 steps are 5 + 5, 5 + 1 + 1 + 1 + 1, and 6 * 5 + 1
+        uint64_t elt1 = 3;
+        uint64_t elt5 = 115;
+        ASSERT_TRUE((evaluator.plan_galois(elt5 * elt5 % 128, glk) ==
+            vector<uint64_t>{ elt5, elt5 }));
+        ASSERT_EQ(5ULL, evaluator.plan_galois(elt5 * elt1 % 128 * elt1 % 128 * 
+            elt1 % 128 * elt1 % 128, glk).size());
+        ASSERT_EQ(0ULL, evaluator.plan_galois(1, glk).size());
+        ASSERT_THROW(evaluator.plan_galois(2, glk), invalid_argument);
+        ASSERT_THROW(evaluator.plan_galois(127, glk), invalid_argument);
+
+        vector<uint64_t> plain_vec(64);
+        for (size_t i = 0; i < plain_vec.size(); i++)
+        {
+            plain_vec[i] = i;
+        }
+        Plaintext plain;
+        batch_encoder.encode(plain_vec, plain);
+        Ciphertext encrypted;
+        encryptor.encrypt(plain, encrypted);
+
+        for (int steps : { 10, 9, -1 })
+        {
+            Ciphertext rotated;
+            evaluator.rotate_rows(encrypted, steps, glk, rotated);
+            decryptor.decrypt(rotated, plain);
+            vector<uint64_t> result;
+            batch_encoder.decode(plain, result);
+            for (size_t i = 0; i < 64; i++)
+            {
+                size_t row = i / 32;
+                size_t col = (i % 32 + 32 + static_cast<size_t>(steps + 32)) % 32;
+                ASSERT_EQ(plain_vec[row * 32 + col], result[i]);
+            }
+        }
+
+        // There is no key for the column rotation
+        ASSERT_THROW(evaluator.rotate_columns_inplace(encrypted, glk), invalid_argument);
+    }
+
     TEST(EvaluatorTest, FVEncryptRotateMatrixDecrypt)
     {
         EncryptionParameters parms(scheme_type::BFV);
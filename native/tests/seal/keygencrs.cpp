@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/keygencrs.h"
+#include "seal/context.h"
+#include "seal/defaultparams.h"
+#include "seal/keygenerator.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    TEST(KeyGenCRSTest, SaveLoadKeyGenCRS)
+    {
+        stringstream stream;
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+
+        KeyGenCRS crs = keygen.keygen_crs();
+        ASSERT_TRUE(crs.parms_id() == parms.parms_id());
+        ASSERT_TRUE(crs.is_valid_for(context));
+        crs.save(stream);
+
+        // Only the seed and parms_id are stored
+        ASSERT_EQ(sizeof(parms_id_type) + sizeof(KeyGenCRS::seed_type),
+            stream.str().size());
+
+        KeyGenCRS crs2;
+        ASSERT_FALSE(crs2.is_valid_for(context));
+        crs2.load(context, stream);
+        ASSERT_TRUE(crs == crs2);
+
+        // Loading into a different context fails
+        parms.set_poly_modulus_degree(128);
+        auto context2 = SEALContext::Create(parms);
+        crs.save(stream);
+        ASSERT_THROW(crs2.load(context2, stream), invalid_argument);
+    }
+
+    TEST(KeyGenCRSTest, ExpandKeyGenCRS)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_40bit(0) });
+        auto context = SEALContext::Create(parms);
+        auto &coeff_modulus = parms.coeff_modulus();
+
+        KeyGenCRS crs({ 1, 2, 3, 4 }, parms.parms_id());
+        vector<uint64_t> poly(128), poly2(128), poly3(128);
+        crs.expand(context, poly.data());
+        crs.expand(context, poly2.data());
+        crs.expand(context, poly3.data(), 1);
+
+        // The expansion is deterministic and reduced modulo every prime, and
+        // different domains give different polynomials
+        ASSERT_TRUE(poly == poly2);
+        ASSERT_FALSE(poly == poly3);
+        ASSERT_TRUE(all_of(poly.begin(), poly.begin() + 64,
+            [&](uint64_t c) { return c < coeff_modulus[0].value(); }));
+        ASSERT_TRUE(all_of(poly.begin() + 64, poly.end(),
+            [&](uint64_t c) { return c < coeff_modulus[1].value(); }));
+
+        // The public key of a KeyGenerator uses the expanded crs
+        KeyGenerator keygen(context, crs);
+        ASSERT_TRUE(equal(poly.begin(), poly.end(), keygen.public_key().data().data(1)));
+
+        KeyGenCRS other({ 1, 2, 3, 5 }, parms.parms_id());
+        other.expand(context, poly2.data());
+        ASSERT_FALSE(poly == poly2);
+
+        KeyGenCRS invalid;
+        ASSERT_THROW(invalid.expand(context, poly.data()), invalid_argument);
+        ASSERT_THROW(KeyGenerator(context, invalid), invalid_argument);
+    }
+}
@@ -633,11 +633,7 @@ namespace SEALTest
                 ASSERT_EQ(sk.data()[i], sk2.data()[i]);
             }
 
-            ASSERT_EQ(crs.data().uint64_count(), crs2.data().uint64_count());
-            for (size_t i = 0; i < crs.data().uint64_count(); i++)
-            {
-                ASSERT_EQ(crs.data()[i], crs2.data()[i]);
-            }
+            ASSERT_TRUE(crs == crs2);
 
             Encryptor encryptor(context, pk2);
             Decryptor decryptor(context, sk);
@@ -657,11 +653,7 @@ namespace SEALTest
             auto pk2 = keygen2.public_key();
             auto crs2 = keygen2.keygen_crs();
 
-            ASSERT_EQ(crs.data().uint64_count(), crs2.data().uint64_count());
-            for (size_t i = 0; i < crs.data().uint64_count(); i++)
-            {
-                ASSERT_EQ(crs.data()[i], crs2.data()[i]);
-            }
+            ASSERT_TRUE(crs == crs2);
 
             Encryptor encryptor(context, pk2);
             Decryptor decryptor(context, sk2);
@@ -736,11 +728,7 @@ namespace SEALTest
             auto relin_keys2 = keygen2.relin_keys(60, 1, true);
             auto crs2 = keygen2.keygen_crs();
 
-            ASSERT_EQ(crs.data().uint64_count(), crs2.data().uint64_count());
-            for (size_t i = 0; i < crs.data().uint64_count(); i++)
-            {
-                ASSERT_EQ(crs.data()[i], crs2.data()[i]);
-            }
+            ASSERT_TRUE(crs == crs2);
 
             Evaluator evaluator(context);
             Evaluator evaluator2(context);
@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/context.h"
+#include "seal/plaintextcache.h"
+#include "seal/encryptor.h"
+#include "seal/decryptor.h"
+#include "seal/evaluator.h"
+#include "seal/keygenerator.h"
+#include "seal/defaultparams.h"
+#include <cstdint>
+#include <cstddef>
+
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    TEST(PlaintextNTTCacheTest, FVMultiplyPlainCached)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1), DefaultParams::small_mods_40bit(2) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+        PlaintextNTTCache cache(context, 1 << 20);
+        ASSERT_EQ(0ULL, cache.size());
+        ASSERT_EQ(0ULL, cache.memory_usage());
+
+        Plaintext plain("1x^28 + 3Fx^7 + 2");
+        Plaintext weight("3x^5 + 1Fx^2 + 7");
+        Ciphertext encrypted;
+        encryptor.encrypt(plain, encrypted);
+        Ciphertext encrypted_low;
+        evaluator.mod_switch_to_next(encrypted, encrypted_low);
+
+        Plaintext expected;
+        Plaintext result;
+        Ciphertext product;
+        evaluator.multiply_plain(encrypted, weight, product);
+        decryptor.decrypt(product, expected);
+
+        // One transformation per level; the rest are taken from the cache
+        for (int i = 0; i < 3; i++)
+        {
+            evaluator.multiply_plain(encrypted, weight, cache, product);
+            decryptor.decrypt(product, result);
+            ASSERT_TRUE(result == expected);
+
+            evaluator.multiply_plain(encrypted_low, weight, cache, product);
+            ASSERT_TRUE(product.parms_id() == encrypted_low.parms_id());
+            decryptor.decrypt(product, result);
+            ASSERT_TRUE(result == expected);
+        }
+        ASSERT_EQ(2ULL, cache.size());
+        ASSERT_EQ(2ULL, cache.miss_count());
+        ASSERT_EQ(4ULL, cache.hit_count());
+
+        // A modified plaintext is transformed again
+        weight[0] = 9;
+        evaluator.multiply_plain(encrypted, weight, cache, product);
+        decryptor.decrypt(product, result);
+        evaluator.multiply_plain(encrypted, weight, product);
+        decryptor.decrypt(product, expected);
+        ASSERT_TRUE(result == expected);
+        ASSERT_EQ(3ULL, cache.miss_count());
+        ASSERT_EQ(2ULL, cache.size());
+
+        // Constant plaintexts bypass the cache
+        Plaintext constant("5");
+        evaluator.multiply_plain(encrypted, constant, cache, product);
+        decryptor.decrypt(product, result);
+        ASSERT_TRUE(result == Plaintext("5x^28 + 3Bx^7 + A"));
+        ASSERT_EQ(2ULL, cache.size());
+
+        cache.erase(weight);
+        ASSERT_EQ(0ULL, cache.size());
+        ASSERT_EQ(0ULL, cache.memory_usage());
+
+        evaluator.transform_to_ntt_inplace(weight, parms.parms_id());
+        ASSERT_THROW(cache.get(weight, parms.parms_id()), invalid_argument);
+    }
+
+    TEST(PlaintextNTTCacheTest, FVEvictLeastRecentlyUsed)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1) });
+        auto context = SEALContext::Create(parms);
+
+        // Each entry holds the 2 * 64 coefficients of the NTT form
+        size_t entry_size = 128 * sizeof(uint64_t);
+        PlaintextNTTCache cache(context, 2 * entry_size);
+        ASSERT_EQ(2 * entry_size, cache.memory_budget());
+
+        Plaintext plain1("1x^2"), plain2("2x^2"), plain3("3x^2");
+        auto plain1_ntt = cache.get(plain1, parms.parms_id());
+        cache.get(plain2, parms.parms_id());
+        ASSERT_EQ(2ULL, cache.size());
+        ASSERT_EQ(2 * entry_size, cache.memory_usage());
+
+        // Using plain1 again makes plain2 the least recently used entry
+        ASSERT_TRUE(cache.get(plain1, parms.parms_id()) == plain1_ntt);
+        cache.get(plain3, parms.parms_id());
+        ASSERT_EQ(2ULL, cache.size());
+        ASSERT_EQ(1ULL, cache.hit_count());
+        cache.get(plain1, parms.parms_id());
+        cache.get(plain3, parms.parms_id());
+        ASSERT_EQ(3ULL, cache.hit_count());
+        cache.get(plain2, parms.parms_id());
+        ASSERT_EQ(4ULL, cache.miss_count());
+
+        // The evicted plaintexts are still valid for the caller
+        Plaintext expected;
+        Evaluator evaluator(context);
+        evaluator.transform_to_ntt(plain1, parms.parms_id(), expected);
+        ASSERT_TRUE(*plain1_ntt == expected);
+
+        // Entries that do not fit are returned but not cached
+        PlaintextNTTCache small_cache(context, entry_size - 1);
+        ASSERT_TRUE(*small_cache.get(plain1, parms.parms_id()) == expected);
+        ASSERT_EQ(0ULL, small_cache.size());
+
+        cache.clear();
+        ASSERT_EQ(0ULL, cache.size());
+        ASSERT_EQ(0ULL, cache.memory_usage());
+
+        EncryptionParameters ckks_parms(scheme_type::CKKS);
+        ckks_parms.set_poly_modulus_degree(64);
+        ckks_parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0) });
+        ASSERT_THROW(PlaintextNTTCache(SEALContext::Create(ckks_parms), 1024),
+            invalid_argument);
+    }
+}
@@ -0,0 +1,180 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/context.h"
+#include "seal/plaintextdatabase.h"
+#include "seal/encryptor.h"
+#include "seal/decryptor.h"
+#include "seal/evaluator.h"
+#include "seal/keygenerator.h"
+#include "seal/ckks.h"
+#include "seal/defaultparams.h"
+#include "tempfile.h"
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    TEST(PlaintextDatabaseTest, FVBuildMapMultiply)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+
+        vector<Plaintext> plains;
+        for (uint64_t i = 0; i < 10; i++)
+        {
+            Plaintext plain(3);
+            plain[0] = i;
+            plain[2] = 63 - i;
+            plains.push_back(plain);
+        }
+        TempFile file("plaintextdatabase_test.dat");
+        const string &path = file.path();
+        PlaintextDatabase::Build(context, parms.parms_id(), plains.size(),
+            [&](size_t index, Plaintext &destination) {
+                destination = plains[index];
+            }, path, 3);
+
+        {
+            PlaintextDatabase database(context, path);
+            ASSERT_EQ(10ULL, database.size());
+            ASSERT_TRUE(database.parms_id() == parms.parms_id());
+
+            Ciphertext encrypted;
+            encryptor.encrypt(Plaintext("1x^5 + 3"), encrypted);
+            Ciphertext encrypted_ntt;
+            evaluator.transform_to_ntt(encrypted, encrypted_ntt);
+            for (size_t i = 0; i < database.size(); i++)
+            {
+                // The plaintexts are page-aligned and equal to transform_to_ntt
+                ASSERT_EQ(0ULL, reinterpret_cast<uintptr_t>(database.data(i)) % 4096);
+                Plaintext expected;
+                Plaintext plain;
+                evaluator.transform_to_ntt(plains[i], parms.parms_id(), expected);
+                Plaintext plain_ntt;
+                database.get(i, plain_ntt);
+                ASSERT_TRUE(plain_ntt == expected);
+                ASSERT_TRUE(plain_ntt.parms_id() == parms.parms_id());
+                ASSERT_EQ(1.0, database.scale(i));
+
+                Ciphertext product;
+                evaluator.multiply_plain(encrypted_ntt, database, i, product);
+                evaluator.transform_from_ntt_inplace(product);
+                Plaintext result;
+                decryptor.decrypt(product, result);
+                evaluator.multiply_plain(encrypted, plains[i], product);
+                decryptor.decrypt(product, plain);
+                ASSERT_TRUE(result == plain);
+            }
+
+            ASSERT_THROW(database.data(10), out_of_range);
+            ASSERT_THROW(evaluator.multiply_plain_inplace(encrypted, database, 0),
+                invalid_argument);
+
+            // A database for other encryption parameters
+            parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0) });
+            ASSERT_THROW(PlaintextDatabase(SEALContext::Create(parms), path),
+                invalid_argument);
+        }
+
+        // A coefficient that is not reduced is rejected unless verification
+        // is turned off; the first plaintext starts at the second page
+        {
+            fstream stream(path, ios_base::binary | ios_base::in | ios_base::out);
+            stream.seekp(4096 + 5 * sizeof(uint64_t));
+            uint64_t coeff = DefaultParams::small_mods_40bit(0).value();
+            stream.write(reinterpret_cast<const char *>(&coeff), sizeof(uint64_t));
+        }
+        ASSERT_THROW(PlaintextDatabase(context, path), invalid_argument);
+        {
+            PlaintextDatabase database(context, path, false);
+            ASSERT_EQ(DefaultParams::small_mods_40bit(0).value(), database.data(0)[5]);
+        }
+
+        // A failed build removes the file
+        plains[3].resize(65);
+        ASSERT_THROW(PlaintextDatabase::Build(context, parms.parms_id(), plains,
+            path), invalid_argument);
+        ASSERT_FALSE(ifstream(path).is_open());
+        ASSERT_THROW(PlaintextDatabase(context, path), runtime_error);
+
+        {
+            ofstream stream(path, ios_base::binary);
+            stream << string(8192, 'x');
+        }
+        ASSERT_THROW(PlaintextDatabase(context, path), invalid_argument);
+    }
+
+    TEST(PlaintextDatabaseTest, CKKSBuildMapMultiply)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context);
+
+        auto next_parms_id = context->context_data()->next_context_data()->parms().parms_id();
+        vector<Plaintext> plains(5);
+        for (size_t i = 0; i < plains.size(); i++)
+        {
+            encoder.encode(static_cast<double>(i) + 1.5, next_parms_id,
+                pow(2.0, 20 + static_cast<int>(i)), plains[i]);
+        }
+        TempFile file("plaintextdatabase_ckks_test.dat");
+        const string &path = file.path();
+        PlaintextDatabase::Build(context, next_parms_id, plains, path);
+        {
+            PlaintextDatabase database(context, path);
+            ASSERT_EQ(5ULL, database.size());
+
+            Plaintext plain;
+            Ciphertext encrypted;
+            encoder.encode(2.0, next_parms_id, pow(2.0, 30), plain);
+            encryptor.encrypt(plain, encrypted);
+            for (size_t i = 0; i < plains.size(); i++)
+            {
+                ASSERT_EQ(plains[i].scale(), database.scale(i));
+                Ciphertext product;
+                evaluator.multiply_plain(encrypted, database, i, product);
+                ASSERT_EQ(encrypted.scale() * plains[i].scale(), product.scale());
+
+                vector<double> result;
+                decryptor.decrypt(product, plain);
+                encoder.decode(plain, result);
+                ASSERT_NEAR(2.0 * (static_cast<double>(i) + 1.5), result[0], 0.01);
+            }
+
+            // The ciphertext must be at the level of the database
+            encoder.encode(1.0, parms.parms_id(), pow(2.0, 30), plain);
+            encryptor.encrypt(plain, encrypted);
+            ASSERT_THROW(evaluator.multiply_plain_inplace(encrypted, database, 0),
+                invalid_argument);
+        }
+
+        // Plaintexts at another level cannot be added
+        ASSERT_THROW(PlaintextDatabase::Build(context, parms.parms_id(), plains,
+            path), invalid_argument);
+    }
+}
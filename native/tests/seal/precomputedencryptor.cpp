@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/context.h"
+#include "seal/precomputedencryptor.h"
+#include "seal/decryptor.h"
+#include "seal/keygenerator.h"
+#include "seal/ckks.h"
+#include "seal/intencoder.h"
+#include "seal/defaultparams.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    TEST(PrecomputedEncryptorTest, FVPrecomputedEncrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(128);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        IntegerEncoder encoder(context);
+        Decryptor decryptor(context, keygen.secret_key());
+
+        ASSERT_THROW(PrecomputedEncryptor(context, keygen.public_key(), 0),
+            invalid_argument);
+
+        PrecomputedEncryptor encryptor(context, keygen.public_key(), 4);
+        ASSERT_EQ(4ULL, encryptor.capacity());
+        encryptor.wait_until_full();
+        ASSERT_EQ(4ULL, encryptor.available());
+
+        // More encryptions than the capacity also exercise the case where the
+        // queue is empty and the encryption of zero is computed on the spot
+        Ciphertext encrypted;
+        Plaintext plain;
+        for (uint64_t i = 0; i < 20; i++)
+        {
+            encryptor.encrypt(encoder.encode(0x12345678 + i), encrypted);
+            ASSERT_TRUE(encrypted.parms_id() == parms.parms_id());
+            ASSERT_FALSE(encrypted.is_ntt_form());
+            ASSERT_EQ(2ULL, encrypted.size());
+            ASSERT_TRUE(decryptor.invariant_noise_budget(encrypted) > 0);
+            decryptor.decrypt(encrypted, plain);
+            ASSERT_EQ(0x12345678ULL + i, encoder.decode_uint64(plain));
+        }
+
+        // Two encryptions of the same plaintext must differ
+        Ciphertext encrypted2;
+        encryptor.encrypt(encoder.encode(1), encrypted);
+        encryptor.encrypt(encoder.encode(1), encrypted2);
+        ASSERT_FALSE(equal(encrypted.data(), encrypted.data() + encrypted.uint64_count(),
+            encrypted2.data()));
+
+        plain.resize(parms.poly_modulus_degree() + 1);
+        ASSERT_THROW(encryptor.encrypt(plain, encrypted), invalid_argument);
+    }
+
+    TEST(PrecomputedEncryptorTest, CKKSPrecomputedEncrypt)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+        CKKSEncoder encoder(context);
+        Decryptor decryptor(context, keygen.secret_key());
+        PrecomputedEncryptor encryptor(context, keygen.public_key(), 2);
+
+        // Plaintexts at different levels
+        auto next_parms_id = context->context_data()->next_context_data()->parms().parms_id();
+        for (size_t i = 0; i < 6; i++)
+        {
+            Plaintext plain;
+            encoder.encode(static_cast<double>(i) + 0.5,
+                (i % 2) ? next_parms_id : parms.parms_id(), pow(2.0, 30), plain);
+
+            Ciphertext encrypted;
+            encryptor.encrypt(plain, encrypted);
+            ASSERT_TRUE(encrypted.parms_id() == plain.parms_id());
+            ASSERT_TRUE(encrypted.is_ntt_form());
+            ASSERT_EQ(plain.scale(), encrypted.scale());
+
+            vector<double> result;
+            decryptor.decrypt(encrypted, plain);
+            encoder.decode(plain, result);
+            ASSERT_NEAR(static_cast<double>(i) + 0.5, result[0], 0.01);
+        }
+
+        Plaintext plain(parms.poly_modulus_degree());
+        Ciphertext encrypted;
+        ASSERT_THROW(encryptor.encrypt(plain, encrypted), invalid_argument);
+    }
+}
@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/relinkeysshare.h"
+#include "seal/context.h"
+#include "seal/keygenerator.h"
+#include "seal/util/uintcore.h"
+#include "seal/defaultparams.h"
+
+using namespace seal;
+using namespace seal::util;
+using namespace std;
+
+namespace SEALTest
+{
+    TEST(RelinKeysShareTest, RelinKeysShareSaveLoad)
+    {
+        stringstream stream;
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1) });
+        auto context = SEALContext::Create(parms);
+        KeyGenerator keygen(context);
+
+        RelinKeysShare share;
+        RelinKeysShare test_share;
+        share = keygen.relin_keys_share_round1(30);
+        ASSERT_EQ(share.decomposition_bit_count(), 30);
+        ASSERT_TRUE(share.is_valid_for(context));
+        ASSERT_EQ(2ULL, share.data().size());
+        ASSERT_EQ(4ULL, share.data()[0].size());
+        share.save(stream);
+        test_share.load(context, stream);
+        ASSERT_TRUE(share.parms_id() == test_share.parms_id());
+        ASSERT_EQ(share.decomposition_bit_count(), test_share.decomposition_bit_count());
+        ASSERT_EQ(share.data().size(), test_share.data().size());
+        for (size_t i = 0; i < share.data().size(); i++)
+        {
+            ASSERT_EQ(share.data()[i].size(), test_share.data()[i].size());
+            ASSERT_EQ(share.data()[i].uint64_count(), test_share.data()[i].uint64_count());
+            ASSERT_TRUE(is_equal_uint_uint(share.data()[i].data(),
+                test_share.data()[i].data(), share.data()[i].uint64_count()));
+        }
+
+        // Round 2 consumes the ephemeral secret
+        auto share2 = keygen.relin_keys_share_round2(share);
+        ASSERT_TRUE(share2.is_valid_for(context));
+        ASSERT_THROW(keygen.relin_keys_share_round2(share), logic_error);
+    }
+}
@@ -0,0 +1,430 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/shareaggregator.h"
+#include "seal/context.h"
+#include "seal/keygenerator.h"
+#include "seal/encryptor.h"
+#include "seal/decryptor.h"
+#include "seal/evaluator.h"
+#include "seal/ckks.h"
+#include "seal/batchencoder.h"
+#include "seal/defaultparams.h"
+#include "seal/util/polyarithsmallmod.h"
+
+using namespace seal;
+using namespace seal::util;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace
+    {
+        // Only for testing: reconstructs the joint secret key from all shares
+        SecretKey joint_secret_key(shared_ptr<SEALContext> context,
+            const vector<SecretKey> &shares)
+        {
+            auto &parms = context->context_data()->parms();
+            auto &coeff_modulus = parms.coeff_modulus();
+            size_t coeff_count = parms.poly_modulus_degree();
+
+            SecretKey secret_key(shares[0]);
+            for (size_t k = 1; k < shares.size(); k++)
+            {
+                for (size_t j = 0; j < coeff_modulus.size(); j++)
+                {
+                    add_poly_poly_coeffmod(
+                        secret_key.data().data() + (j * coeff_count),
+                        shares[k].data().data() + (j * coeff_count), coeff_count,
+                        coeff_modulus[j], secret_key.data().data() + (j * coeff_count));
+                }
+            }
+            return secret_key;
+        }
+    }
+
+    TEST(ShareAggregatorTest, FVJointPublicKey)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(128);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1), DefaultParams::small_mods_40bit(2) });
+        auto context = SEALContext::Create(parms);
+        ShareAggregator aggregator(context);
+
+        KeyGenerator keygen1(context);
+        KeyGenerator keygen2(context, keygen1.keygen_crs());
+        KeyGenerator keygen3(context, keygen1.keygen_crs());
+        auto public_key = aggregator.public_key({ keygen1.public_key(),
+            keygen2.public_key(), keygen3.public_key() });
+        auto secret_key = joint_secret_key(context, { keygen1.secret_key(),
+            keygen2.secret_key(), keygen3.secret_key() });
+
+        Encryptor encryptor(context, public_key);
+        Decryptor decryptor(context, secret_key);
+        Ciphertext encrypted;
+        Plaintext plain("1x^63 + 2x^33 + 3x^23 + 4x^13 + 5x^1 + 6");
+        Plaintext plain2;
+        encryptor.encrypt(plain, encrypted);
+        decryptor.decrypt(encrypted, plain2);
+        ASSERT_TRUE(plain == plain2);
+
+        // Public keys from different crs values cannot be combined
+        KeyGenerator keygen4(context);
+        ASSERT_THROW(aggregator.public_key({ keygen1.public_key(),
+            keygen4.public_key() }), invalid_argument);
+    }
+
+    TEST(ShareAggregatorTest, FVJointRelinKeys)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(128);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1), DefaultParams::small_mods_40bit(2) });
+        auto context = SEALContext::Create(parms);
+        ShareAggregator aggregator(context);
+        Evaluator evaluator(context);
+
+        for (int dbc : { 60, 20 })
+        {
+            KeyGenerator keygen1(context);
+            KeyGenerator keygen2(context, keygen1.keygen_crs());
+            KeyGenerator keygen3(context, keygen1.keygen_crs());
+            vector<KeyGenerator*> keygens{ &keygen1, &keygen2, &keygen3 };
+
+            vector<RelinKeysShare> round1;
+            for (auto keygen : keygens)
+            {
+                round1.emplace_back(keygen->relin_keys_share_round1(dbc));
+            }
+            auto round1_aggregate = aggregator.aggregate(round1);
+            vector<RelinKeysShare> round2;
+            for (auto keygen : keygens)
+            {
+                round2.emplace_back(keygen->relin_keys_share_round2(round1_aggregate));
+            }
+            auto relin_keys = aggregator.relin_keys(round1_aggregate,
+                aggregator.aggregate(round2));
+            ASSERT_TRUE(relin_keys.is_valid_for(context));
+            ASSERT_EQ(1ULL, relin_keys.size());
+            ASSERT_EQ(dbc, relin_keys.decomposition_bit_count());
+
+            auto public_key = aggregator.public_key({ keygen1.public_key(),
+                keygen2.public_key(), keygen3.public_key() });
+            auto secret_key = joint_secret_key(context, { keygen1.secret_key(),
+                keygen2.secret_key(), keygen3.secret_key() });
+            Encryptor encryptor(context, public_key);
+            Decryptor decryptor(context, secret_key);
+
+            Ciphertext encrypted;
+            Plaintext plain("1x^10 + 2");
+            encryptor.encrypt(plain, encrypted);
+            evaluator.square_inplace(encrypted);
+            evaluator.relinearize_inplace(encrypted, relin_keys);
+            ASSERT_EQ(2ULL, encrypted.size());
+            ASSERT_TRUE(decryptor.invariant_noise_budget(encrypted) > 0);
+            decryptor.decrypt(encrypted, plain);
+            ASSERT_EQ("1x^20 + 4x^10 + 4", plain.to_string());
+
+            evaluator.square_inplace(encrypted);
+            evaluator.relinearize_inplace(encrypted, relin_keys);
+            ASSERT_TRUE(decryptor.invariant_noise_budget(encrypted) > 0);
+            decryptor.decrypt(encrypted, plain);
+            ASSERT_EQ("1x^40 + 8x^30 + 18x^20 + 20x^10 + 10", plain.to_string());
+        }
+    }
+
+    TEST(ShareAggregatorTest, CKKSJointRelinKeys)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        ShareAggregator aggregator(context);
+        Evaluator evaluator(context);
+        CKKSEncoder encoder(context);
+
+        KeyGenerator keygen1(context);
+        KeyGenerator keygen2(context, keygen1.keygen_crs());
+        auto round1_aggregate = aggregator.aggregate({
+            keygen1.relin_keys_share_round1(20), keygen2.relin_keys_share_round1(20) });
+        auto relin_keys = aggregator.relin_keys(round1_aggregate, aggregator.aggregate({
+            keygen1.relin_keys_share_round2(round1_aggregate),
+            keygen2.relin_keys_share_round2(round1_aggregate) }));
+
+        Encryptor encryptor(context, aggregator.public_key({ keygen1.public_key(),
+            keygen2.public_key() }));
+        Decryptor decryptor(context, joint_secret_key(context, { keygen1.secret_key(),
+            keygen2.secret_key() }));
+
+        vector<complex<double>> input(32), output;
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            input[i] = complex<double>(static_cast<double>(i % 7) - 3.0, 0.5);
+        }
+        Plaintext plain;
+        Ciphertext encrypted;
+        encoder.encode(input, pow(2.0, 40), plain);
+        encryptor.encrypt(plain, encrypted);
+        evaluator.square_inplace(encrypted);
+        evaluator.relinearize_inplace(encrypted, relin_keys);
+        ASSERT_EQ(2ULL, encrypted.size());
+        decryptor.decrypt(encrypted, plain);
+        encoder.decode(plain, output);
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            ASSERT_NEAR(0.0, abs(output[i] - input[i] * input[i]), 0.01);
+        }
+    }
+
+    TEST(ShareAggregatorTest, FVJointGaloisKeys)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(128);
+        parms.set_plain_modulus(257);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1), DefaultParams::small_mods_40bit(2) });
+        auto context = SEALContext::Create(parms);
+        ShareAggregator aggregator(context);
+        Evaluator evaluator(context);
+        BatchEncoder batch_encoder(context);
+
+        KeyGenerator keygen1(context);
+        KeyGenerator keygen2(context, keygen1.keygen_crs());
+        KeyGenerator keygen3(context, keygen1.keygen_crs());
+
+        // Shares generated on different numbers of threads use the same crs
+        auto galois_keys = keygen1.galois_keys_share(24, vector<int>{ 1, -3, 0 }, 1);
+        aggregator.aggregate_inplace(galois_keys,
+            keygen2.galois_keys_share(24, vector<int>{ 1, -3, 0 }, 2));
+        aggregator.aggregate_inplace(galois_keys,
+            keygen3.galois_keys_share(24, vector<int>{ 1, -3, 0 }, 3));
+        ASSERT_TRUE(galois_keys.is_valid_for(context));
+        ASSERT_EQ(3ULL, galois_keys.size());
+
+        Encryptor encryptor(context, aggregator.public_key({ keygen1.public_key(),
+            keygen2.public_key(), keygen3.public_key() }));
+        Decryptor decryptor(context, joint_secret_key(context, { keygen1.secret_key(),
+            keygen2.secret_key(), keygen3.secret_key() }));
+
+        size_t row_size = batch_encoder.slot_count() / 2;
+        vector<uint64_t> input(batch_encoder.slot_count()), output;
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            input[i] = i % 200;
+        }
+        Plaintext plain;
+        Ciphertext encrypted;
+        batch_encoder.encode(input, plain);
+        encryptor.encrypt(plain, encrypted);
+
+        evaluator.rotate_rows_inplace(encrypted, 1, galois_keys);
+        evaluator.rotate_rows_inplace(encrypted, -3, galois_keys);
+        evaluator.rotate_columns_inplace(encrypted, galois_keys);
+        ASSERT_TRUE(decryptor.invariant_noise_budget(encrypted) > 0);
+        decryptor.decrypt(encrypted, plain);
+        batch_encoder.decode(plain, output);
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            // Rotated left by -2 within each row, then rows swapped
+            size_t row = i / row_size;
+            size_t col = (i % row_size + row_size - 2) % row_size;
+            ASSERT_EQ(input[(1 - row) * row_size + col], output[i]);
+        }
+
+        // The default set of Galois keys
+        auto all_keys = aggregator.galois_keys({ keygen1.galois_keys_share(24),
+            keygen2.galois_keys_share(24) });
+        ASSERT_EQ(keygen1.galois_keys(24).size(), all_keys.size());
+
+        // Shares from different crs values or key sets cannot be combined
+        KeyGenerator keygen4(context);
+        ASSERT_THROW(aggregator.aggregate_inplace(galois_keys,
+            keygen4.galois_keys_share(24, vector<int>{ 1, -3, 0 })), invalid_argument);
+        ASSERT_THROW(aggregator.aggregate_inplace(galois_keys,
+            keygen1.galois_keys_share(24, vector<int>{ 1 })), invalid_argument);
+        ASSERT_THROW(aggregator.aggregate_inplace(galois_keys,
+            keygen1.galois_keys_share(30, vector<int>{ 1, -3, 0 })), invalid_argument);
+    }
+
+    TEST(ShareAggregatorTest, CKKSJointGaloisKeys)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        ShareAggregator aggregator(context);
+        Evaluator evaluator(context);
+        CKKSEncoder encoder(context);
+
+        KeyGenerator keygen1(context);
+        KeyGenerator keygen2(context, keygen1.keygen_crs());
+        auto galois_keys = aggregator.galois_keys({
+            keygen1.galois_keys_share(20, vector<int>{ 5 }),
+            keygen2.galois_keys_share(20, vector<int>{ 5 }) });
+
+        Encryptor encryptor(context, aggregator.public_key({ keygen1.public_key(),
+            keygen2.public_key() }));
+        Decryptor decryptor(context, joint_secret_key(context, { keygen1.secret_key(),
+            keygen2.secret_key() }));
+
+        vector<complex<double>> input(32), output;
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            input[i] = complex<double>(static_cast<double>(i), 0.5);
+        }
+        Plaintext plain;
+        Ciphertext encrypted;
+        encoder.encode(input, pow(2.0, 40), plain);
+        encryptor.encrypt(plain, encrypted);
+        evaluator.rotate_vector_inplace(encrypted, 5, galois_keys);
+        decryptor.decrypt(encrypted, plain);
+        encoder.decode(plain, output);
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            ASSERT_NEAR(0.0, abs(output[i] - input[(i + 5) % input.size()]), 0.01);
+        }
+    }
+
+    TEST(ShareAggregatorTest, FVThresholdDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_noise_standard_deviation(3.20);
+        parms.set_poly_modulus_degree(128);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_40bit(0),
+            DefaultParams::small_mods_40bit(1), DefaultParams::small_mods_40bit(2) });
+        auto context = SEALContext::Create(parms);
+        ShareAggregator aggregator(context);
+
+        KeyGenerator keygen1(context);
+        KeyGenerator keygen2(context, keygen1.keygen_crs());
+        KeyGenerator keygen3(context, keygen1.keygen_crs());
+        Encryptor encryptor(context, aggregator.public_key({ keygen1.public_key(),
+            keygen2.public_key(), keygen3.public_key() }));
+        Decryptor decryptor1(context, keygen1.secret_key());
+        Decryptor decryptor2(context, keygen2.secret_key());
+        Decryptor decryptor3(context, keygen3.secret_key());
+
+        Ciphertext encrypted;
+        Plaintext plain("1x^63 + 2x^33 + 3x^23 + 4x^13 + 5x^1 + 6");
+        encryptor.encrypt(plain, encrypted);
+        vector<Plaintext> shares(3);
+        decryptor1.partial_decrypt(encrypted, shares[0], 40);
+        decryptor2.partial_decrypt(encrypted, shares[1], 40);
+        decryptor3.partial_decrypt(encrypted, shares[2], 40);
+        ASSERT_TRUE(shares[0].is_ntt_form());
+        ASSERT_TRUE(shares[0].parms_id() == encrypted.parms_id());
+        Plaintext plain2;
+        aggregator.decrypt(encrypted, shares, plain2);
+        ASSERT_TRUE(plain == plain2);
+
+        // A missing share does not decrypt
+        aggregator.decrypt(encrypted, { shares[0], shares[1] }, plain2);
+        ASSERT_FALSE(plain == plain2);
+
+        // Ciphertexts in NTT form decrypt to the same plaintext, alone and
+        // batched with ciphertexts in coefficient form
+        Evaluator evaluator(context);
+        Ciphertext encrypted_ntt;
+        evaluator.transform_to_ntt(encrypted, encrypted_ntt);
+        decryptor1.partial_decrypt(encrypted_ntt, shares[0], 40);
+        decryptor2.partial_decrypt(encrypted_ntt, shares[1], 40);
+        decryptor3.partial_decrypt(encrypted_ntt, shares[2], 40);
+        aggregator.decrypt(encrypted_ntt, shares, plain2);
+        ASSERT_TRUE(plain == plain2);
+        vector<Ciphertext> mixed{ encrypted_ntt, encrypted };
+        vector<vector<Plaintext>> ntt_shares(3);
+        decryptor1.partial_decrypt(mixed, ntt_shares[0], 40, 2);
+        decryptor2.partial_decrypt(mixed, ntt_shares[1], 40, 2);
+        decryptor3.partial_decrypt(mixed, ntt_shares[2], 40, 2);
+        vector<Plaintext> ntt_results;
+        aggregator.decrypt(mixed, ntt_shares, ntt_results, 2);
+        ASSERT_TRUE(plain == ntt_results[0]);
+        ASSERT_TRUE(plain == ntt_results[1]);
+
+        // Batched shares on several threads
+        vector<Ciphertext> batch(5);
+        vector<Plaintext> plains;
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            plains.emplace_back(to_string(i + 1) + "x^" + to_string(10 * i + 1) +
+                " + 3");
+            encryptor.encrypt(plains.back(), batch[i]);
+        }
+        vector<vector<Plaintext>> batch_shares(3);
+        decryptor1.partial_decrypt(batch, batch_shares[0], 40, 2);
+        decryptor2.partial_decrypt(batch, batch_shares[1], 40, 3);
+        decryptor3.partial_decrypt(batch, batch_shares[2], 40, 1);
+        vector<Plaintext> results;
+        aggregator.decrypt(batch, batch_shares, results, 2);
+        ASSERT_EQ(batch.size(), results.size());
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            ASSERT_TRUE(plains[i] == results[i]);
+        }
+
+        // Shares must match the ciphertexts
+        batch_shares[2].pop_back();
+        ASSERT_THROW(aggregator.decrypt(batch, batch_shares, results), invalid_argument);
+        ASSERT_THROW(decryptor1.partial_decrypt(encrypted, shares[0], 61),
+            invalid_argument);
+        evaluator.square_inplace(encrypted);
+        ASSERT_THROW(decryptor1.partial_decrypt(encrypted, shares[0], 40),
+            invalid_argument);
+    }
+
+    TEST(ShareAggregatorTest, CKKSThresholdDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus({ DefaultParams::small_mods_60bit(0),
+            DefaultParams::small_mods_60bit(1), DefaultParams::small_mods_60bit(2) });
+        auto context = SEALContext::Create(parms);
+        ShareAggregator aggregator(context);
+        Evaluator evaluator(context);
+        CKKSEncoder encoder(context);
+
+        KeyGenerator keygen1(context);
+        KeyGenerator keygen2(context, keygen1.keygen_crs());
+        Encryptor encryptor(context, aggregator.public_key({ keygen1.public_key(),
+            keygen2.public_key() }));
+        Decryptor decryptor1(context, keygen1.secret_key());
+        Decryptor decryptor2(context, keygen2.secret_key());
+
+        vector<complex<double>> input(32), output;
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            input[i] = complex<double>(static_cast<double>(i % 7) - 3.0, 0.5);
+        }
+        Plaintext plain;
+        Ciphertext encrypted;
+        encoder.encode(input, pow(2.0, 40), plain);
+        encryptor.encrypt(plain, encrypted);
+
+        // Decrypt both at the first and at a lower level
+        for (int level = 0; level < 2; level++)
+        {
+            vector<Plaintext> shares(2);
+            decryptor1.partial_decrypt(encrypted, shares[0], 20);
+            decryptor2.partial_decrypt(encrypted, shares[1], 20);
+            aggregator.decrypt(encrypted, shares, plain);
+            ASSERT_TRUE(plain.parms_id() == encrypted.parms_id());
+            ASSERT_EQ(encrypted.scale(), plain.scale());
+            encoder.decode(plain, output);
+            for (size_t i = 0; i < input.size(); i++)
+            {
+                ASSERT_NEAR(0.0, abs(output[i] - input[i]), 0.001);
+            }
+            evaluator.mod_switch_to_next_inplace(encrypted);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace SEALTest
+{
+    // A unique path in the temporary directory; the file is removed when the
+    // TempFile goes out of scope, also if the test fails
+    class TempFile
+    {
+    public:
+        TempFile(const std::string &name)
+        {
+#ifdef _WIN32
+            const char *dir = std::getenv("TEMP");
+            const char *default_dir = ".";
+            const char separator = '\\';
+#else
+            const char *dir = std::getenv("TMPDIR");
+            const char *default_dir = "/tmp";
+            const char separator = '/';
+#endif
+            path_ = dir && *dir ? dir : default_dir;
+            if (path_.back() != separator)
+            {
+                path_ += separator;
+            }
+
+            // A random suffix keeps concurrent runs of the tests apart
+            std::random_device rd;
+            std::ostringstream suffix;
+            suffix << '-' << std::hex << std::setfill('0') << std::setw(8) << rd()
+                << std::setw(8) << rd();
+            auto extension = name.rfind('.');
+            if (extension == std::string::npos)
+            {
+                extension = name.size();
+            }
+            path_ += name.substr(0, extension) + suffix.str() + name.substr(extension);
+        }
+
+        ~TempFile()
+        {
+            std::remove(path_.c_str());
+        }
+
+        const std::string &path() const
+        {
+            return path_;
+        }
+
+    private:
+        TempFile(const TempFile &copy) = delete;
+
+        TempFile &operator =(const TempFile &assign) = delete;
+
+        std::string path_;
+    };
+}
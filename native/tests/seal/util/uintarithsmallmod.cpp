@@ -139,6 +139,34 @@ namespace SEALTest
             ASSERT_EQ(0ULL, sub_uint_uint_mod(4611686018427289600ULL, 4611686018427289600ULL, mod));
         }
 
+        TEST(UIntArithSmallMod, BarrettReduce64)
+        {
+            SmallModulus mod(2);
+            ASSERT_EQ(0ULL, barrett_reduce_64(0, mod));
+            ASSERT_EQ(1ULL, barrett_reduce_64(1, mod));
+            ASSERT_EQ(1ULL, barrett_reduce_64(0xFFFFFFFFFFFFFFFFULL, mod));
+
+            mod = 3;
+            ASSERT_EQ(0ULL, barrett_reduce_64(0, mod));
+            ASSERT_EQ(1ULL, barrett_reduce_64(1, mod));
+            ASSERT_EQ(0ULL, barrett_reduce_64(123, mod));
+            ASSERT_EQ(0ULL, barrett_reduce_64(0xFFFFFFFFFFFFFFFFULL, mod));
+
+            mod = 13131313131313ULL;
+            ASSERT_EQ(0ULL, barrett_reduce_64(0, mod));
+            ASSERT_EQ(1ULL, barrett_reduce_64(1, mod));
+            ASSERT_EQ(0ULL, barrett_reduce_64(13131313131313ULL, mod));
+            ASSERT_EQ(0xFFFFFFFFFFFFFFFFULL % 13131313131313ULL,
+                barrett_reduce_64(0xFFFFFFFFFFFFFFFFULL, mod));
+            ASSERT_EQ(0x8000000000000000ULL % 13131313131313ULL,
+                barrett_reduce_64(0x8000000000000000ULL, mod));
+
+            mod = 0xFFFFFFFFFFFFFC1ULL;
+            ASSERT_EQ(0ULL, barrett_reduce_64(0xFFFFFFFFFFFFFC1ULL, mod));
+            ASSERT_EQ(0xFFFFFFFFFFFFFFFFULL % 0xFFFFFFFFFFFFFC1ULL,
+                barrett_reduce_64(0xFFFFFFFFFFFFFFFFULL, mod));
+        }
+
         TEST(UIntArithSmallMod, BarrettReduce128)
         {
             uint64_t input[2];